@@ -16,15 +16,23 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+// Required for splice()
+#define _GNU_SOURCE
+
 #include <julea-config.h>
 
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <gmodule.h>
 
+#include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <unistd.h>
 
 #include <julea.h>
@@ -63,6 +71,22 @@ jd_backend_files_free(gpointer data)
 // FIXME not deleted?
 static GPrivate jd_backend_files = G_PRIVATE_INIT(jd_backend_files_free);
 
+static void
+jd_backend_pipe_free(gpointer data)
+{
+	gint* fds = data;
+
+	close(fds[0]);
+	close(fds[1]);
+
+	g_free(fds);
+}
+
+/**
+ * Each thread has its own pipe for splicing data from sockets into files.
+ **/
+static GPrivate jd_backend_pipe = G_PRIVATE_INIT(jd_backend_pipe_free);
+
 static void
 backend_file_unref(gpointer data)
 {
@@ -103,6 +127,114 @@ jd_backend_files_get_thread(void)
 	return files;
 }
 
+static gint*
+jd_backend_pipe_get_thread(void)
+{
+	gint* fds;
+
+	fds = g_private_get(&jd_backend_pipe);
+
+	if (G_UNLIKELY(fds == NULL))
+	{
+		fds = g_new(gint, 2);
+
+		if (pipe2(fds, O_CLOEXEC) == -1)
+		{
+			g_free(fds);
+			return NULL;
+		}
+
+		g_private_replace(&jd_backend_pipe, fds);
+	}
+
+	return fds;
+}
+
+/**
+ * Closes the thread's pipe, a new one is created on the next use.
+ **/
+static void
+jd_backend_pipe_reset_thread(void)
+{
+	g_private_replace(&jd_backend_pipe, NULL);
+}
+
+/**
+ * Waits for a file descriptor to become ready.
+ * Honors the receive and send timeouts of sockets, so that stalled clients do not block the server indefinitely.
+ *
+ * \return TRUE if the file descriptor might be ready, FALSE if the timeout has expired.
+ **/
+static gboolean
+backend_wait(gint fd, gshort events)
+{
+	struct pollfd pfd = { fd, events, 0 };
+	struct timeval timeout = { 0, 0 };
+	socklen_t timeout_len = sizeof(timeout);
+	gint option;
+	gint poll_timeout = -1;
+	gint ret;
+
+	option = (events == POLLIN) ? SO_RCVTIMEO : SO_SNDTIMEO;
+
+	// Fails for pipes, which do not have a timeout.
+	if (getsockopt(fd, SOL_SOCKET, option, &timeout, &timeout_len) == 0 && (timeout.tv_sec > 0 || timeout.tv_usec > 0))
+	{
+		poll_timeout = timeout.tv_sec * 1000 + timeout.tv_usec / 1000;
+	}
+
+	do
+	{
+		ret = poll(&pfd, 1, poll_timeout);
+	} while (ret < 0 && errno == EINTR);
+
+	// Errors are reported by the next operation on the file descriptor.
+	return (ret != 0);
+}
+
+/**
+ * Reads and drops data from a file descriptor.
+ **/
+static gboolean
+backend_discard(gint fd, guint64 length)
+{
+	gchar buffer[4096];
+
+	while (length > 0)
+	{
+		gssize nbytes;
+
+		nbytes = read(fd, buffer, MIN(sizeof(buffer), length));
+
+		if (nbytes == 0)
+		{
+			return FALSE;
+		}
+		else if (nbytes < 0)
+		{
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				if (!backend_wait(fd, POLLIN))
+				{
+					return FALSE;
+				}
+
+				continue;
+			}
+			else if (errno == EINTR)
+			{
+				continue;
+			}
+
+			return FALSE;
+		}
+
+		length -= nbytes;
+	}
+
+	return TRUE;
+}
+
 static JBackendObject*
 backend_file_get(GHashTable* files, gchar const* key)
 {
@@ -381,6 +513,171 @@ backend_write(gpointer backend_data, gpointer backend_object, gconstpointer buff
 	return (nbytes_total == length);
 }
 
+static gboolean
+backend_send(gpointer backend_data, gpointer backend_object, gint fd, guint64 length, guint64 offset, guint64* bytes_sent)
+{
+	JBackendObject* bo = backend_object;
+
+	gsize nbytes_total = 0;
+
+	(void)backend_data;
+
+	j_trace_file_begin(bo->path, J_TRACE_FILE_READ);
+
+	while (nbytes_total < length)
+	{
+		off_t file_offset = offset + nbytes_total;
+		gssize nbytes;
+
+		nbytes = sendfile(fd, bo->fd, &file_offset, length - nbytes_total);
+
+		if (nbytes == 0)
+		{
+			break;
+		}
+		else if (nbytes < 0)
+		{
+			// Sockets managed by GIO are non-blocking.
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				if (backend_wait(fd, POLLOUT))
+				{
+					continue;
+				}
+
+				// The client has stopped receiving, so the remaining data cannot be sent.
+				// Shut down the connection to make sure that it is not used anymore.
+				shutdown(fd, SHUT_RDWR);
+			}
+			else if (errno == EINTR)
+			{
+				continue;
+			}
+
+			break;
+		}
+
+		nbytes_total += nbytes;
+	}
+
+	j_trace_file_end(bo->path, J_TRACE_FILE_READ, nbytes_total, offset);
+
+	if (bytes_sent != NULL)
+	{
+		*bytes_sent = nbytes_total;
+	}
+
+	return (nbytes_total == length);
+}
+
+static gboolean
+backend_receive(gpointer backend_data, gpointer backend_object, gint fd, guint64 length, guint64 offset, guint64* bytes_written)
+{
+	JBackendObject* bo = backend_object;
+
+	gint* pipe_fds;
+	gsize nbytes_received = 0;
+	gsize nbytes_total = 0;
+	gboolean ret = TRUE;
+
+	(void)backend_data;
+
+	pipe_fds = jd_backend_pipe_get_thread();
+
+	if (pipe_fds == NULL)
+	{
+		if (!backend_discard(fd, length))
+		{
+			shutdown(fd, SHUT_RDWR);
+		}
+
+		return FALSE;
+	}
+
+	j_trace_file_begin(bo->path, J_TRACE_FILE_WRITE);
+
+	// Move the data from the socket into the pipe and from the pipe into the file.
+	while (ret && nbytes_received < length)
+	{
+		gssize nbytes;
+
+		nbytes = splice(fd, NULL, pipe_fds[1], NULL, length - nbytes_received, SPLICE_F_MOVE | SPLICE_F_MORE);
+
+		if (nbytes == 0)
+		{
+			ret = FALSE;
+			break;
+		}
+		else if (nbytes < 0)
+		{
+			// Sockets managed by GIO are non-blocking.
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				if (backend_wait(fd, POLLIN))
+				{
+					continue;
+				}
+
+				// The client has stopped sending, so the remaining data cannot be skipped.
+				// Shut down the connection to make sure that it is not used anymore.
+				shutdown(fd, SHUT_RDWR);
+			}
+			else if (errno == EINTR)
+			{
+				continue;
+			}
+
+			ret = FALSE;
+			break;
+		}
+
+		nbytes_received += nbytes;
+
+		while (nbytes > 0)
+		{
+			loff_t file_offset = offset + nbytes_total;
+			gssize nbytes_written;
+
+			nbytes_written = splice(pipe_fds[0], NULL, bo->fd, &file_offset, nbytes, SPLICE_F_MOVE);
+
+			if (nbytes_written <= 0)
+			{
+				if (nbytes_written < 0 && errno == EINTR)
+				{
+					continue;
+				}
+
+				// Empty the socket to keep it usable, the pipe is recreated below.
+				if (!backend_discard(fd, length - nbytes_received))
+				{
+					shutdown(fd, SHUT_RDWR);
+				}
+
+				ret = FALSE;
+				break;
+			}
+
+			nbytes -= nbytes_written;
+			nbytes_total += nbytes_written;
+		}
+	}
+
+	j_trace_file_end(bo->path, J_TRACE_FILE_WRITE, nbytes_total, offset);
+
+	if (!ret)
+	{
+		// The pipe might still contain data that would otherwise end up in the next file.
+		jd_backend_pipe_reset_thread();
+	}
+
+	if (bytes_written != NULL)
+	{
+		*bytes_written = nbytes_total;
+	}
+
+	return (ret && nbytes_total == length);
+}
+
 static gboolean
 backend_init(gchar const* path, gpointer* backend_data)
 {
@@ -428,7 +725,9 @@ static JBackend posix_backend = {
 		.backend_status = backend_status,
 		.backend_sync = backend_sync,
 		.backend_read = backend_read,
-		.backend_write = backend_write }
+		.backend_write = backend_write,
+		.backend_send = backend_send,
+		.backend_receive = backend_receive }
 };
 
 G_MODULE_EXPORT
@@ -19,6 +19,7 @@
 #include <julea-config.h>
 
 #include <glib.h>
+#include <gio/gio.h>
 
 #include <julea.h>
 
@@ -113,6 +114,76 @@ benchmark_message_add_operation_large(BenchmarkResult* result)
 	_benchmark_message_add_operation(result, TRUE);
 }
 
+static GSocketConnection*
+benchmark_message_connect(gchar const* server, gboolean local)
+{
+	g_autoptr(GSocketClient) client = NULL;
+
+	client = g_socket_client_new();
+
+	if (local)
+	{
+		g_autoptr(GSocketConnectable) server_address = NULL;
+		g_autoptr(GSocketAddress) address = NULL;
+		g_autofree gchar* path = NULL;
+
+		server_address = g_network_address_parse(server, 4711, NULL);
+		path = j_helper_get_local_socket_path(j_configuration_get_local_socket_directory(j_configuration()), g_network_address_get_port(G_NETWORK_ADDRESS(server_address)));
+		address = j_helper_local_socket_address_new(path);
+
+		return g_socket_client_connect(client, G_SOCKET_CONNECTABLE(address), NULL, NULL);
+	}
+
+	return g_socket_client_connect_to_host(client, server, 4711, NULL, NULL);
+}
+
+static void
+_benchmark_message_ping(BenchmarkResult* result, gboolean local)
+{
+	guint const n = 50000;
+
+	g_autoptr(GSocketConnection) connection = NULL;
+	gchar const* server;
+	gdouble elapsed;
+
+	server = j_configuration_get_server(j_configuration(), J_BACKEND_TYPE_OBJECT, 0);
+	connection = benchmark_message_connect(server, local);
+	g_assert_true(connection != NULL);
+
+	j_helper_set_nodelay(connection, TRUE);
+
+	j_benchmark_timer_start();
+
+	for (guint i = 0; i < n; i++)
+	{
+		g_autoptr(JMessage) message = NULL;
+		g_autoptr(JMessage) reply = NULL;
+
+		message = j_message_new(J_MESSAGE_PING, 0);
+		j_message_send(message, connection);
+
+		reply = j_message_new_reply(message);
+		j_message_receive(reply, connection);
+	}
+
+	elapsed = j_benchmark_timer_elapsed();
+
+	result->elapsed_time = elapsed;
+	result->operations = n;
+}
+
+static void
+benchmark_message_ping_tcp(BenchmarkResult* result)
+{
+	_benchmark_message_ping(result, FALSE);
+}
+
+static void
+benchmark_message_ping_local(BenchmarkResult* result)
+{
+	_benchmark_message_ping(result, TRUE);
+}
+
 void
 benchmark_message(void)
 {
@@ -120,4 +191,19 @@ benchmark_message(void)
 	j_benchmark_run("/message/new-append", benchmark_message_new_append);
 	j_benchmark_run("/message/add-operation-small", benchmark_message_add_operation_small);
 	j_benchmark_run("/message/add-operation-large", benchmark_message_add_operation_large);
+
+	{
+		g_autoptr(GSocketConnectable) server_address = NULL;
+		gchar const* server;
+
+		server = j_configuration_get_server(j_configuration(), J_BACKEND_TYPE_OBJECT, 0);
+		server_address = g_network_address_parse(server, 4711, NULL);
+
+		// Compare TCP and local sockets if the server runs on the local host.
+		if (server_address != NULL && j_helper_is_local_host(g_network_address_get_hostname(G_NETWORK_ADDRESS(server_address))))
+		{
+			j_benchmark_run("/message/ping-tcp", benchmark_message_ping_tcp);
+			j_benchmark_run("/message/ping-local", benchmark_message_ping_local);
+		}
+	}
 }
@@ -146,6 +146,19 @@ struct JBackend
 
 			gboolean (*backend_read)(gpointer, gpointer, gpointer, guint64, guint64, guint64*);
 			gboolean (*backend_write)(gpointer, gpointer, gconstpointer, guint64, guint64, guint64*);
+
+			/**
+			 * Sends data directly to a file descriptor, usually a socket.
+			 * This is optional and allows backends to avoid copying data through user space.
+			 **/
+			gboolean (*backend_send)(gpointer, gpointer, gint, guint64, guint64, guint64*);
+
+			/**
+			 * Receives data directly from a file descriptor, usually a socket, and writes it to an object.
+			 * This is optional and allows backends to avoid copying data through user space.
+			 * Implementations have to consume the given amount of data from the file descriptor even if writing fails.
+			 **/
+			gboolean (*backend_receive)(gpointer, gpointer, gint, guint64, guint64, guint64*);
 		} object;
 
 		struct
@@ -399,6 +412,12 @@ gboolean j_backend_object_sync(JBackend*, gpointer);
 gboolean j_backend_object_read(JBackend*, gpointer, gpointer, guint64, guint64, guint64*);
 gboolean j_backend_object_write(JBackend*, gpointer, gconstpointer, guint64, guint64, guint64*);
 
+gboolean j_backend_object_supports_send(JBackend*);
+gboolean j_backend_object_send(JBackend*, gpointer, gint, guint64, guint64, guint64*);
+
+gboolean j_backend_object_supports_receive(JBackend*);
+gboolean j_backend_object_receive(JBackend*, gpointer, gint, guint64, guint64, guint64*);
+
 gboolean j_backend_kv_init(JBackend*, gchar const*);
 void j_backend_kv_fini(JBackend*);
 
@@ -29,6 +29,8 @@
 
 #include <glib.h>
 
+#include <core/jbackground-operation.h>
+
 G_BEGIN_DECLS
 
 G_GNUC_INTERNAL void j_background_operation_init(guint count);
@@ -36,6 +38,8 @@ G_GNUC_INTERNAL void j_background_operation_fini(void);
 
 G_GNUC_INTERNAL guint j_background_operation_get_num_threads(void);
 
+G_GNUC_INTERNAL void j_background_operation_execute_all(JBackgroundOperationFunc, gpointer*, guint);
+
 G_END_DECLS
 
 #endif
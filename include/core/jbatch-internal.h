@@ -35,10 +35,12 @@ G_BEGIN_DECLS
 
 G_GNUC_INTERNAL JBatch* j_batch_new_from_batch(JBatch*);
 
-G_GNUC_INTERNAL JList* j_batch_get_operations(JBatch*);
+G_GNUC_INTERNAL GArray* j_batch_get_operations(JBatch*);
 
 G_GNUC_INTERNAL gboolean j_batch_execute_internal(JBatch*);
 
+G_GNUC_INTERNAL void j_batch_fini(void);
+
 G_END_DECLS
 
 #endif
@@ -39,6 +39,7 @@ typedef void (*JBatchAsyncCallback)(JBatch*, gboolean, gpointer);
 
 G_END_DECLS
 
+#include <core/jcompletion-queue.h>
 #include <core/joperation.h>
 #include <core/jsemantics.h>
 
@@ -54,10 +55,14 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC(JBatch, j_batch_unref)
 JSemantics* j_batch_get_semantics(JBatch*);
 
 void j_batch_add(JBatch*, JOperation*);
+gpointer j_batch_allocate(JBatch*, gsize);
 
 gboolean j_batch_execute(JBatch*) G_GNUC_WARN_UNUSED_RESULT;
 
 void j_batch_execute_async(JBatch*, JBatchAsyncCallback, gpointer);
+void j_batch_execute_queued(JBatch*, JCompletionQueue*);
+void j_batch_set_auto_flush(JBatch*, gboolean);
+
 void j_batch_wait(JBatch*);
 
 G_END_DECLS
@@ -35,12 +35,57 @@ struct JCache;
 
 typedef struct JCache JCache;
 
+/**
+ * Usage statistics of a cache.
+ **/
+struct JCacheStatistics
+{
+	/**
+	 * The cache's size.
+	 **/
+	guint64 size;
+
+	/**
+	 * The number of bytes currently in use.
+	 **/
+	guint64 used;
+
+	/**
+	 * The maximum number of bytes that have been in use at the same time.
+	 **/
+	guint64 used_max;
+
+	/**
+	 * The number of segments requested.
+	 **/
+	guint64 gets;
+
+	/**
+	 * The number of requests that failed because the cache was full.
+	 **/
+	guint64 gets_failed;
+
+	/**
+	 * The number of segments that had to be allocated outside the cache's arena.
+	 **/
+	guint64 gets_heap;
+
+	/**
+	 * The number of segments released.
+	 **/
+	guint64 releases;
+};
+
+typedef struct JCacheStatistics JCacheStatistics;
+
 JCache* j_cache_new(guint64);
 void j_cache_free(JCache*);
 
 gpointer j_cache_get(JCache*, guint64);
 void j_cache_release(JCache*, gpointer);
 
+void j_cache_get_statistics(JCache*, JCacheStatistics*);
+
 G_END_DECLS
 
 #endif
@@ -30,6 +30,7 @@
 #include <glib.h>
 
 #include <core/jbackend.h>
+#include <core/jplacement.h>
 
 G_BEGIN_DECLS
 
@@ -49,6 +50,7 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC(JConfiguration, j_configuration_unref)
 
 gchar const* j_configuration_get_server(JConfiguration*, JBackendType, guint32);
 guint32 j_configuration_get_server_count(JConfiguration*, JBackendType);
+JPlacement* j_configuration_get_placement(JConfiguration*, JBackendType);
 
 gchar const* j_configuration_get_backend(JConfiguration*, JBackendType);
 gchar const* j_configuration_get_backend_component(JConfiguration*, JBackendType);
@@ -57,6 +59,13 @@ gchar const* j_configuration_get_backend_path(JConfiguration*, JBackendType);
 guint64 j_configuration_get_max_operation_size(JConfiguration*);
 guint32 j_configuration_get_max_connections(JConfiguration*);
 guint64 j_configuration_get_stripe_size(JConfiguration*);
+guint32 j_configuration_get_max_batch_operations(JConfiguration*);
+guint64 j_configuration_get_max_batch_size(JConfiguration*);
+guint32 j_configuration_get_hedge_percentile(JConfiguration*);
+guint32 j_configuration_get_hedge_budget(JConfiguration*);
+gboolean j_configuration_get_local_sockets(JConfiguration*);
+gchar const* j_configuration_get_local_socket_directory(JConfiguration*);
+gchar const* j_configuration_get_fabric_provider(JConfiguration*);
 
 G_END_DECLS
 
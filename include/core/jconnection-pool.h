@@ -37,6 +37,11 @@ G_BEGIN_DECLS
 gpointer j_connection_pool_pop(JBackendType, guint);
 void j_connection_pool_push(JBackendType, guint, gpointer);
 
+void j_connection_pool_get_load(JBackendType, guint, gint64*, guint*);
+gint64 j_connection_pool_get_latency_percentile(JBackendType, guint, guint);
+
+gboolean j_connection_pool_discard(JBackendType, guint, gpointer);
+
 G_END_DECLS
 
 #endif
@@ -37,7 +37,9 @@ enum JDistributionType
 {
 	J_DISTRIBUTION_ROUND_ROBIN,
 	J_DISTRIBUTION_SINGLE_SERVER,
-	J_DISTRIBUTION_WEIGHTED
+	J_DISTRIBUTION_WEIGHTED,
+	J_DISTRIBUTION_ERASURE,
+	J_DISTRIBUTION_REPLICATED
 };
 
 typedef enum JDistributionType JDistributionType;
@@ -70,6 +72,15 @@ void j_distribution_set2(JDistribution*, gchar const*, guint64, guint64);
 void j_distribution_reset(JDistribution*, guint64, guint64);
 gboolean j_distribution_distribute(JDistribution*, guint*, guint64*, guint64*, guint64*);
 
+gboolean j_distribution_uses_server(JDistribution*, guint);
+guint64 j_distribution_get_size(JDistribution*, guint, guint64);
+
+gboolean j_distribution_get_erasure_code(JDistribution*, guint*, guint*, guint64*);
+guint j_distribution_get_erasure_server(JDistribution*, guint);
+
+guint j_distribution_get_replica_count(JDistribution*);
+void j_distribution_get_replica(JDistribution*, guint, guint, guint64, guint*, guint64*);
+
 G_END_DECLS
 
 #endif
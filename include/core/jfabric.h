@@ -0,0 +1,81 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2020 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#ifndef JULEA_FABRIC_H
+#define JULEA_FABRIC_H
+
+#if !defined(JULEA_H) && !defined(JULEA_COMPILATION)
+#error "Only <julea.h> can be included directly."
+#endif
+
+#include <glib.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+struct JFabric;
+
+typedef struct JFabric JFabric;
+
+struct JFabricConnection;
+
+typedef struct JFabricConnection JFabricConnection;
+
+struct JFabricMemory;
+
+typedef struct JFabricMemory JFabricMemory;
+
+gboolean j_fabric_is_supported(void);
+
+JFabric* j_fabric_new(gchar const*, gchar const*);
+void j_fabric_free(JFabric*);
+
+gboolean j_fabric_get_address(JFabric*, guint32*, gpointer*, gsize*);
+JFabricConnection* j_fabric_wait_request(JFabric*, guint64*);
+void j_fabric_interrupt(JFabric*);
+
+JFabricConnection* j_fabric_connect(JFabric*, guint32, gconstpointer, gsize, guint64);
+
+gboolean j_fabric_connection_accept(JFabricConnection*);
+gboolean j_fabric_connection_wait(JFabricConnection*);
+void j_fabric_connection_free(JFabricConnection*);
+
+// FIXME get rid of GSocketConnection
+JFabricConnection* j_fabric_connection_get(GSocketConnection*);
+void j_fabric_connection_set(GSocketConnection*, JFabricConnection*);
+
+gboolean j_fabric_connection_read(JFabricConnection*, JFabricMemory*, guint64, guint64, guint64);
+gboolean j_fabric_connection_write(JFabricConnection*, JFabricMemory*, guint64, guint64, guint64);
+
+JFabricMemory* j_fabric_memory_register(JFabricConnection*, gconstpointer, guint64, gboolean);
+void j_fabric_memory_deregister(JFabricMemory*);
+
+JFabricMemory* j_fabric_memory_acquire(JFabricConnection*, gconstpointer, guint64, gboolean);
+void j_fabric_memory_copy_back(JFabricMemory*, guint64, guint64);
+void j_fabric_memory_release(JFabricMemory*);
+
+guint64 j_fabric_memory_get_address(JFabricMemory*);
+guint64 j_fabric_memory_get_key(JFabricMemory*);
+
+G_END_DECLS
+
+#endif
@@ -39,6 +39,9 @@ gboolean j_helper_execute_parallel(JBackgroundOperationFunc, gpointer*, guint);
 guint32 j_helper_hash(gchar const*);
 // FIXME get rid of GSocketConnection
 void j_helper_set_nodelay(GSocketConnection*, gboolean);
+gchar* j_helper_get_local_socket_path(gchar const*, guint16);
+GSocketAddress* j_helper_local_socket_address_new(gchar const*);
+gboolean j_helper_is_local_host(gchar const*);
 gchar* j_helper_str_replace(gchar const*, gchar const*, gchar const*);
 gpointer j_helper_alloc_aligned(gsize, gsize);
 
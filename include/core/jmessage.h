@@ -53,7 +53,8 @@ enum JMessageType
 	J_MESSAGE_DB_INSERT,
 	J_MESSAGE_DB_UPDATE,
 	J_MESSAGE_DB_DELETE,
-	J_MESSAGE_DB_QUERY
+	J_MESSAGE_DB_QUERY,
+	J_MESSAGE_FABRIC
 };
 
 typedef enum JMessageType JMessageType;
@@ -62,6 +63,31 @@ struct JMessage;
 
 typedef struct JMessage JMessage;
 
+struct JMessageFanout;
+
+typedef struct JMessageFanout JMessageFanout;
+
+/**
+ * Handles a reply received as part of a fan-out.
+ * Additional data following the reply can be read from the connection.
+ *
+ * \param reply      The reply.
+ * \param connection The connection the reply has been received on.
+ * \param data       User data.
+ *
+ * \return TRUE if more replies are expected, FALSE otherwise.
+ **/
+typedef gboolean (*JMessageReplyFunc)(JMessage* reply, gpointer connection, gpointer data);
+
+/**
+ * Called once a fan-out entry has been completed, either because all replies have been handled or because an error occurred.
+ * The fan-out must not be modified.
+ *
+ * \param ret  TRUE on success, FALSE if an error occurred or the entry has been cancelled.
+ * \param data User data.
+ **/
+typedef void (*JMessageDoneFunc)(gboolean ret, gpointer data);
+
 G_END_DECLS
 
 #include <core/jsemantics.h>
@@ -89,14 +115,34 @@ gint32 j_message_get_4(JMessage*);
 gint64 j_message_get_8(JMessage*);
 gpointer j_message_get_n(JMessage*, gsize);
 gchar const* j_message_get_string(JMessage*);
+gconstpointer j_message_get_send(JMessage*, guint64);
+gboolean j_message_receive_send(JMessage*, gpointer, guint64);
 
 gboolean j_message_send(JMessage*, gpointer);
 gboolean j_message_receive(JMessage*, gpointer);
+gboolean j_message_receive_nonblocking(JMessage*, gpointer, gboolean*);
+
+void j_message_multiplex_init(gpointer);
+
+JMessageFanout* j_message_fanout_new(void);
+void j_message_fanout_free(JMessageFanout*);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(JMessageFanout, j_message_fanout_free)
+
+void j_message_fanout_add(JMessageFanout*, JMessage*, gpointer, JMessageReplyFunc, gpointer);
+void j_message_fanout_add_full(JMessageFanout*, JMessage*, gpointer, JMessageReplyFunc, JMessageDoneFunc, gpointer);
+gboolean j_message_fanout_execute(JMessageFanout*);
+gboolean j_message_fanout_execute_until(JMessageFanout*, gint64);
+void j_message_fanout_wakeup(JMessageFanout*);
+gboolean j_message_fanout_is_pending(JMessageFanout*, gpointer);
+void j_message_fanout_cancel(JMessageFanout*, gpointer);
+void j_message_fanout_prune(JMessageFanout*);
 
 gboolean j_message_read(JMessage*, GInputStream*);
 gboolean j_message_write(JMessage*, GOutputStream*);
 
 void j_message_add_send(JMessage*, gconstpointer, guint64);
+void j_message_add_send_length(JMessage*, guint64);
 void j_message_add_operation(JMessage*, gsize);
 
 void j_message_set_semantics(JMessage*, JSemantics*);
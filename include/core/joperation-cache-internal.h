@@ -37,6 +37,7 @@ G_GNUC_INTERNAL void j_operation_cache_init(void);
 G_GNUC_INTERNAL void j_operation_cache_fini(void);
 
 G_GNUC_INTERNAL gboolean j_operation_cache_flush(void);
+G_GNUC_INTERNAL gboolean j_operation_cache_flush_batch(JBatch*);
 
 G_GNUC_INTERNAL gboolean j_operation_cache_add(JBatch*);
 
@@ -29,24 +29,64 @@
 
 #include <glib.h>
 
+#include <core/jbackend.h>
 #include <core/jlist.h>
+#include <core/jmessage.h>
 #include <core/jsemantics.h>
 
 G_BEGIN_DECLS
 
 typedef gboolean (*JOperationExecFunc)(JList*, JSemantics*);
 typedef void (*JOperationFreeFunc)(gpointer);
+typedef guint64 (*JOperationCacheFunc)(gpointer, gpointer);
+typedef JMessage* (*JOperationSubmitFunc)(JList*, JSemantics*, JBackendType*, guint32*, gboolean*);
+typedef gboolean (*JOperationCompleteFunc)(JList*, JMessage*);
 
 /**
  * An operation.
  **/
 struct JOperation
 {
+	/**
+	 * A string identifying the resource the operation works on, for example an object or a key-value namespace.
+	 * Operations with the same key and exec_func can be executed together.
+	 * Operations with the same key are never reordered.
+	 * NULL if the operation must not be reordered at all.
+	 **/
 	gconstpointer key;
 	gpointer data;
 
 	JOperationExecFunc exec_func;
 	JOperationFreeFunc free_func;
+
+	/**
+	 * Allows the operation to be executed in the background if the persistency semantics are eventual.
+	 * If called with a NULL buffer, returns the number of bytes needed to copy the operation's payload.
+	 * If called with a buffer of that size, copies the payload into it and completes the operation for the caller.
+	 * NULL if the operation cannot be executed in the background, for example because it returns data.
+	 **/
+	JOperationCacheFunc cache_func;
+
+	/**
+	 * Allows the operations to be executed without blocking a thread, see j_batch_execute_queued().
+	 * Returns the message for the operations, the backend type and index of the server to send it to and whether a reply is expected.
+	 * Returns NULL if the operations have to be executed using exec_func, for example because a client-side backend is used.
+	 * NULL if the operation can only be executed using exec_func.
+	 **/
+	JOperationSubmitFunc submit_func;
+
+	/**
+	 * Handles the reply to the message returned by submit_func, which is NULL if no reply is expected.
+	 * Returns whether the operations have been successful.
+	 **/
+	JOperationCompleteFunc complete_func;
+
+	/**
+	 * The approximate number of payload bytes the operation adds to a message or its reply, for example the length of the data to read or write.
+	 * Used to split large batches, see j_batch_set_auto_flush().
+	 * 0 if the payload is negligible.
+	 **/
+	guint64 size;
 };
 
 typedef struct JOperation JOperation;
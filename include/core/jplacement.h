@@ -0,0 +1,60 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2020 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#ifndef JULEA_PLACEMENT_H
+#define JULEA_PLACEMENT_H
+
+#if !defined(JULEA_H) && !defined(JULEA_COMPILATION)
+#error "Only <julea.h> can be included directly."
+#endif
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+enum JPlacementType
+{
+	J_PLACEMENT_MODULO,
+	J_PLACEMENT_JUMP,
+	J_PLACEMENT_RENDEZVOUS,
+	J_PLACEMENT_RING
+};
+
+typedef enum JPlacementType JPlacementType;
+
+struct JPlacement;
+
+typedef struct JPlacement JPlacement;
+
+JPlacement* j_placement_new(JPlacementType, guint32, guint32);
+void j_placement_free(JPlacement*);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(JPlacement, j_placement_free)
+
+gboolean j_placement_type_from_string(gchar const*, JPlacementType*);
+
+JPlacementType j_placement_get_type(JPlacement*);
+guint32 j_placement_get_index(JPlacement*, gchar const*);
+
+G_END_DECLS
+
+#endif
@@ -40,7 +40,9 @@ enum JStatisticsType
 	J_STATISTICS_BYTES_READ,
 	J_STATISTICS_BYTES_WRITTEN,
 	J_STATISTICS_BYTES_RECEIVED,
-	J_STATISTICS_BYTES_SENT
+	J_STATISTICS_BYTES_SENT,
+	J_STATISTICS_HEDGED_READS,
+	J_STATISTICS_HEDGED_READS_WON
 };
 
 typedef enum JStatisticsType JStatisticsType;
@@ -49,6 +51,8 @@ struct JStatistics;
 
 typedef struct JStatistics JStatistics;
 
+JStatistics* j_statistics(void);
+
 JStatistics* j_statistics_new(gboolean);
 void j_statistics_free(JStatistics*);
 
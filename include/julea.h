@@ -37,16 +37,20 @@
 #include <core/jbackground-operation.h>
 #include <core/jbatch.h>
 #include <core/jcache.h>
+#include <core/jcompletion-queue.h>
 #include <core/jconfiguration.h>
 #include <core/jconnection-pool.h>
 #include <core/jcredentials.h>
 #include <core/jdistribution.h>
+#include <core/jfabric.h>
 #include <core/jhelper.h>
 #include <core/jlist.h>
 #include <core/jlist-iterator.h>
 #include <core/jmemory-chunk.h>
 #include <core/jmessage.h>
 #include <core/joperation.h>
+#include <core/jplacement.h>
+#include <core/jreed-solomon.h>
 #include <core/jsemantics.h>
 #include <core/jstatistics.h>
 #include <core/jtrace.h>
@@ -33,8 +33,39 @@
 
 G_BEGIN_DECLS
 
+/**
+ * A contiguous range of an object that is read or written.
+ **/
+struct JObjectRange
+{
+	gpointer data;
+	guint64 length;
+	guint64 offset;
+
+	/**
+	 * The number of bytes read or written is added to this counter.
+	 **/
+	guint64* bytes;
+
+	/**
+	 * The original ranges if this range has been coalesced, NULL otherwise.
+	 * Contains #JObjectRange elements.
+	 **/
+	GArray* parts;
+
+	/**
+	 * The counter of a coalesced range.
+	 **/
+	guint64 nbytes;
+};
+
+typedef struct JObjectRange JObjectRange;
+
 G_GNUC_INTERNAL JBackend* j_object_get_backend(void);
 
+G_GNUC_INTERNAL GArray* j_object_range_coalesce(GArray*, gboolean, JSemantics*);
+G_GNUC_INTERNAL void j_object_range_complete(GArray*, gboolean);
+
 G_END_DECLS
 
 #endif
@@ -46,10 +46,21 @@ struct JDistributionVTable
 
 	void (*distribution_reset)(gpointer, guint64, guint64);
 	gboolean (*distribution_distribute)(gpointer, guint*, guint64*, guint64*, guint64*);
+
+	gboolean (*distribution_uses_server)(gpointer, guint);
+	guint64 (*distribution_get_size)(gpointer, guint, guint64);
+
+	gboolean (*distribution_get_erasure_code)(gpointer, guint*, guint*, guint64*);
+	guint (*distribution_get_erasure_server)(gpointer, guint);
+
+	guint (*distribution_get_replica_count)(gpointer);
+	void (*distribution_get_replica)(gpointer, guint, guint, guint64, guint*, guint64*);
 };
 
 typedef struct JDistributionVTable JDistributionVTable;
 
+void j_distribution_erasure_get_vtable(JDistributionVTable*);
+void j_distribution_replicated_get_vtable(JDistributionVTable*);
 void j_distribution_round_robin_get_vtable(JDistributionVTable*);
 void j_distribution_single_server_get_vtable(JDistributionVTable*);
 void j_distribution_weighted_get_vtable(JDistributionVTable*);
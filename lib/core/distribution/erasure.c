@@ -0,0 +1,459 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2020 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <bson.h>
+
+#include <jconfiguration.h>
+#include <jtrace.h>
+
+#include "distribution.h"
+
+/**
+ * \defgroup JDistribution Distribution
+ *
+ * Data structures and functions for managing distributions.
+ *
+ * @{
+ **/
+
+/**
+ * The default maximum number of data blocks per stripe.
+ * Larger stripes make partial writes more expensive, because the whole stripe has to be read to update its parity.
+ **/
+#define J_DISTRIBUTION_ERASURE_DATA_BLOCKS 4
+
+/**
+ * A distribution.
+ **/
+struct JDistributionErasure
+{
+	/**
+	 * The server count.
+	 **/
+	guint server_count;
+
+	/**
+	 * The length.
+	 **/
+	guint64 length;
+
+	/**
+	 * The offset.
+	 **/
+	guint64 offset;
+
+	/**
+	 * The block size.
+	 */
+	guint64 block_size;
+
+	guint start_index;
+
+	/**
+	 * The number of data blocks per stripe.
+	 **/
+	guint data_blocks;
+
+	/**
+	 * The number of parity blocks per stripe.
+	 **/
+	guint parity_blocks;
+};
+
+typedef struct JDistributionErasure JDistributionErasure;
+
+/**
+ * Distributes data in a round robin fashion across the data servers.
+ * Parity blocks are not returned, they have to be handled by the caller.
+ *
+ * \private
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param index        A server index.
+ * \param new_length   A new length.
+ * \param new_offset   A new offset.
+ *
+ * \return TRUE on success, FALSE if the distribution is finished.
+ **/
+static gboolean
+distribution_distribute(gpointer data, guint* index, guint64* new_length, guint64* new_offset, guint64* block_id)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionErasure* distribution = data;
+
+	guint64 block;
+	guint64 displacement;
+	guint64 stripe;
+
+	if (distribution->length == 0)
+	{
+		return FALSE;
+	}
+
+	block = distribution->offset / distribution->block_size;
+	stripe = block / distribution->data_blocks;
+	displacement = distribution->offset % distribution->block_size;
+
+	*index = (distribution->start_index + (block % distribution->data_blocks)) % distribution->server_count;
+	*new_length = MIN(distribution->length, distribution->block_size - displacement);
+	*new_offset = (stripe * distribution->block_size) + displacement;
+	*block_id = block;
+
+	distribution->length -= *new_length;
+	distribution->offset += *new_length;
+
+	return TRUE;
+}
+
+static gpointer
+distribution_new(guint server_count, guint64 stripe_size)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionErasure* distribution;
+
+	distribution = g_slice_new(JDistributionErasure);
+	distribution->server_count = server_count;
+	distribution->length = 0;
+	distribution->offset = 0;
+	distribution->block_size = stripe_size;
+	distribution->parity_blocks = (server_count > 1) ? 1 : 0;
+	distribution->data_blocks = MIN(server_count - distribution->parity_blocks, J_DISTRIBUTION_ERASURE_DATA_BLOCKS);
+
+	distribution->start_index = g_random_int_range(0, distribution->server_count);
+
+	return distribution;
+}
+
+/**
+ * Decreases a distribution's reference count.
+ * When the reference count reaches zero, frees the memory allocated for the distribution.
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ **/
+static void
+distribution_free(gpointer data)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionErasure* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+
+	g_slice_free(JDistributionErasure, distribution);
+}
+
+/**
+ * Sets the block size, the start index or the number of data and parity blocks for the erasure-coded distribution.
+ * Each stripe needs one server per data and parity block.
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param key          A key.
+ * \param value        A value.
+ */
+static void
+distribution_set(gpointer data, gchar const* key, guint64 value)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionErasure* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+
+	if (g_strcmp0(key, "block-size") == 0)
+	{
+		distribution->block_size = value;
+	}
+	else if (g_strcmp0(key, "start-index") == 0)
+	{
+		g_return_if_fail(value < distribution->server_count);
+
+		distribution->start_index = value;
+	}
+	else if (g_strcmp0(key, "data-blocks") == 0)
+	{
+		g_return_if_fail(value > 0);
+		g_return_if_fail(value + distribution->parity_blocks <= MIN(distribution->server_count, 256));
+
+		distribution->data_blocks = value;
+	}
+	else if (g_strcmp0(key, "parity-blocks") == 0)
+	{
+		g_return_if_fail(distribution->data_blocks + value <= MIN(distribution->server_count, 256));
+
+		distribution->parity_blocks = value;
+	}
+}
+
+/**
+ * Serializes distribution.
+ *
+ * \private
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution Credentials.
+ *
+ * \return A new BSON object. Should be freed with g_slice_free().
+ **/
+static void
+distribution_serialize(gpointer data, bson_t* b)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionErasure* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+
+	bson_append_int64(b, "block_size", -1, distribution->block_size);
+	bson_append_int32(b, "start_index", -1, distribution->start_index);
+	bson_append_int32(b, "data_blocks", -1, distribution->data_blocks);
+	bson_append_int32(b, "parity_blocks", -1, distribution->parity_blocks);
+}
+
+/**
+ * Deserializes distribution.
+ *
+ * \private
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution distribution.
+ * \param b           A BSON object.
+ **/
+static void
+distribution_deserialize(gpointer data, bson_t const* b)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionErasure* distribution = data;
+
+	bson_iter_t iterator;
+
+	g_return_if_fail(distribution != NULL);
+	g_return_if_fail(b != NULL);
+
+	bson_iter_init(&iterator, b);
+
+	while (bson_iter_next(&iterator))
+	{
+		gchar const* key;
+
+		key = bson_iter_key(&iterator);
+
+		if (g_strcmp0(key, "block_size") == 0)
+		{
+			distribution->block_size = bson_iter_int64(&iterator);
+		}
+		else if (g_strcmp0(key, "start_index") == 0)
+		{
+			distribution->start_index = bson_iter_int32(&iterator);
+		}
+		else if (g_strcmp0(key, "data_blocks") == 0)
+		{
+			distribution->data_blocks = bson_iter_int32(&iterator);
+		}
+		else if (g_strcmp0(key, "parity_blocks") == 0)
+		{
+			distribution->parity_blocks = bson_iter_int32(&iterator);
+		}
+	}
+}
+
+/**
+ * Initializes a distribution.
+ *
+ * \code
+ * JDistribution* d;
+ *
+ * j_distribution_init(d, 0, 0);
+ * \endcode
+ *
+ * \param length A length.
+ * \param offset An offset.
+ *
+ * \return A new distribution. Should be freed with j_distribution_unref().
+ **/
+static void
+distribution_reset(gpointer data, guint64 length, guint64 offset)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionErasure* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+
+	distribution->length = length;
+	distribution->offset = offset;
+}
+
+/**
+ * Checks whether a server can hold data.
+ *
+ * \private
+ *
+ * \param distribution A distribution.
+ * \param index        A server index.
+ *
+ * \return TRUE if the server can hold data or parity, FALSE otherwise.
+ **/
+static gboolean
+distribution_uses_server(gpointer data, guint index)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionErasure* distribution = data;
+
+	if (index >= distribution->server_count)
+	{
+		return FALSE;
+	}
+
+	return ((index + distribution->server_count - distribution->start_index) % distribution->server_count < distribution->data_blocks + distribution->parity_blocks);
+}
+
+/**
+ * Calculates the size implied by the data stored on a server.
+ *
+ * \private
+ *
+ * \param distribution A distribution.
+ * \param index        A server index.
+ * \param local_size   The size of the data stored on the server.
+ *
+ * \return The offset following the server's last byte, 0 for parity servers.
+ **/
+static guint64
+distribution_get_size(gpointer data, guint index, guint64 local_size)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionErasure* distribution = data;
+
+	guint64 block;
+	guint64 displacement;
+	guint64 stripe;
+	guint position;
+
+	position = (index + distribution->server_count - distribution->start_index) % distribution->server_count;
+
+	// Parity blocks always cover whole stripes and do not tell anything about the size.
+	if (local_size == 0 || position >= distribution->data_blocks)
+	{
+		return 0;
+	}
+
+	// This reverses distribution_distribute() for the server's last byte.
+	stripe = (local_size - 1) / distribution->block_size;
+	displacement = (local_size - 1) % distribution->block_size;
+	block = (stripe * distribution->data_blocks) + position;
+
+	return (block * distribution->block_size) + displacement + 1;
+}
+
+/**
+ * Returns the parameters of the erasure code.
+ *
+ * \private
+ *
+ * \param distribution  A distribution.
+ * \param data_blocks   Returns the number of data blocks per stripe.
+ * \param parity_blocks Returns the number of parity blocks per stripe.
+ * \param block_size    Returns the block size.
+ *
+ * \return TRUE.
+ **/
+static gboolean
+distribution_get_erasure_code(gpointer data, guint* data_blocks, guint* parity_blocks, guint64* block_size)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionErasure* distribution = data;
+
+	*data_blocks = distribution->data_blocks;
+	*parity_blocks = distribution->parity_blocks;
+	*block_size = distribution->block_size;
+
+	return TRUE;
+}
+
+/**
+ * Returns the server storing a stripe's block.
+ * The blocks of stripe s are stored at offset s × block size on their servers.
+ *
+ * \private
+ *
+ * \param distribution A distribution.
+ * \param block        A block within the stripe, data blocks are followed by parity blocks.
+ *
+ * \return A server index.
+ **/
+static guint
+distribution_get_erasure_server(gpointer data, guint block)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionErasure* distribution = data;
+
+	return (distribution->start_index + block) % distribution->server_count;
+}
+
+void
+j_distribution_erasure_get_vtable(JDistributionVTable* vtable)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	vtable->distribution_new = distribution_new;
+	vtable->distribution_free = distribution_free;
+	vtable->distribution_set = distribution_set;
+	vtable->distribution_set2 = NULL;
+	vtable->distribution_serialize = distribution_serialize;
+	vtable->distribution_deserialize = distribution_deserialize;
+	vtable->distribution_reset = distribution_reset;
+	vtable->distribution_distribute = distribution_distribute;
+	vtable->distribution_uses_server = distribution_uses_server;
+	vtable->distribution_get_size = distribution_get_size;
+	vtable->distribution_get_erasure_code = distribution_get_erasure_code;
+	vtable->distribution_get_erasure_server = distribution_get_erasure_server;
+	vtable->distribution_get_replica_count = NULL;
+	vtable->distribution_get_replica = NULL;
+}
+
+/**
+ * @}
+ **/
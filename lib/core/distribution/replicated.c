@@ -0,0 +1,436 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2020 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <bson.h>
+
+#include <jconfiguration.h>
+#include <jtrace.h>
+
+#include "distribution.h"
+
+/**
+ * \defgroup JDistribution Distribution
+ *
+ * Data structures and functions for managing distributions.
+ *
+ * @{
+ **/
+
+/**
+ * The default number of copies of each block.
+ **/
+#define J_DISTRIBUTION_REPLICATED_REPLICAS 2
+
+/**
+ * A distribution.
+ **/
+struct JDistributionReplicated
+{
+	/**
+	 * The server count.
+	 **/
+	guint server_count;
+
+	/**
+	 * The length.
+	 **/
+	guint64 length;
+
+	/**
+	 * The offset.
+	 **/
+	guint64 offset;
+
+	/**
+	 * The block size.
+	 */
+	guint64 block_size;
+
+	guint start_index;
+
+	/**
+	 * The number of copies of each block, stored on consecutive servers.
+	 **/
+	guint replicas;
+};
+
+typedef struct JDistributionReplicated JDistributionReplicated;
+
+/**
+ * Distributes data in a round robin fashion.
+ * Only the first replica is returned, the others can be determined using distribution_get_replica().
+ *
+ * Each round of blocks occupies one slot per replica on every server.
+ * Replica r of a block is stored in slot r of its round on the r-th server following the block's first server.
+ *
+ * \private
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param index        A server index.
+ * \param new_length   A new length.
+ * \param new_offset   A new offset.
+ *
+ * \return TRUE on success, FALSE if the distribution is finished.
+ **/
+static gboolean
+distribution_distribute(gpointer data, guint* index, guint64* new_length, guint64* new_offset, guint64* block_id)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionReplicated* distribution = data;
+
+	guint64 block;
+	guint64 displacement;
+	guint64 round;
+
+	if (distribution->length == 0)
+	{
+		return FALSE;
+	}
+
+	block = distribution->offset / distribution->block_size;
+	round = block / distribution->server_count;
+	displacement = distribution->offset % distribution->block_size;
+
+	*index = (distribution->start_index + block) % distribution->server_count;
+	*new_length = MIN(distribution->length, distribution->block_size - displacement);
+	*new_offset = (round * distribution->replicas * distribution->block_size) + displacement;
+	*block_id = block;
+
+	distribution->length -= *new_length;
+	distribution->offset += *new_length;
+
+	return TRUE;
+}
+
+static gpointer
+distribution_new(guint server_count, guint64 stripe_size)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionReplicated* distribution;
+
+	distribution = g_slice_new(JDistributionReplicated);
+	distribution->server_count = server_count;
+	distribution->length = 0;
+	distribution->offset = 0;
+	distribution->block_size = stripe_size;
+	distribution->replicas = MIN(server_count, J_DISTRIBUTION_REPLICATED_REPLICAS);
+
+	distribution->start_index = g_random_int_range(0, distribution->server_count);
+
+	return distribution;
+}
+
+/**
+ * Decreases a distribution's reference count.
+ * When the reference count reaches zero, frees the memory allocated for the distribution.
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ **/
+static void
+distribution_free(gpointer data)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionReplicated* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+
+	g_slice_free(JDistributionReplicated, distribution);
+}
+
+/**
+ * Sets the block size, the start index or the number of replicas for the replicated distribution.
+ * Each replica of a block is stored on a different server.
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param key          A key.
+ * \param value        A value.
+ */
+static void
+distribution_set(gpointer data, gchar const* key, guint64 value)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionReplicated* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+
+	if (g_strcmp0(key, "block-size") == 0)
+	{
+		distribution->block_size = value;
+	}
+	else if (g_strcmp0(key, "start-index") == 0)
+	{
+		g_return_if_fail(value < distribution->server_count);
+
+		distribution->start_index = value;
+	}
+	else if (g_strcmp0(key, "replicas") == 0)
+	{
+		g_return_if_fail(value > 0);
+		g_return_if_fail(value <= distribution->server_count);
+
+		distribution->replicas = value;
+	}
+}
+
+/**
+ * Serializes distribution.
+ *
+ * \private
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution Credentials.
+ *
+ * \return A new BSON object. Should be freed with g_slice_free().
+ **/
+static void
+distribution_serialize(gpointer data, bson_t* b)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionReplicated* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+
+	bson_append_int64(b, "block_size", -1, distribution->block_size);
+	bson_append_int32(b, "start_index", -1, distribution->start_index);
+	bson_append_int32(b, "replicas", -1, distribution->replicas);
+}
+
+/**
+ * Deserializes distribution.
+ *
+ * \private
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution distribution.
+ * \param b           A BSON object.
+ **/
+static void
+distribution_deserialize(gpointer data, bson_t const* b)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionReplicated* distribution = data;
+
+	bson_iter_t iterator;
+
+	g_return_if_fail(distribution != NULL);
+	g_return_if_fail(b != NULL);
+
+	bson_iter_init(&iterator, b);
+
+	while (bson_iter_next(&iterator))
+	{
+		gchar const* key;
+
+		key = bson_iter_key(&iterator);
+
+		if (g_strcmp0(key, "block_size") == 0)
+		{
+			distribution->block_size = bson_iter_int64(&iterator);
+		}
+		else if (g_strcmp0(key, "start_index") == 0)
+		{
+			distribution->start_index = bson_iter_int32(&iterator);
+		}
+		else if (g_strcmp0(key, "replicas") == 0)
+		{
+			distribution->replicas = bson_iter_int32(&iterator);
+		}
+	}
+}
+
+/**
+ * Initializes a distribution.
+ *
+ * \code
+ * JDistribution* d;
+ *
+ * j_distribution_init(d, 0, 0);
+ * \endcode
+ *
+ * \param length A length.
+ * \param offset An offset.
+ *
+ * \return A new distribution. Should be freed with j_distribution_unref().
+ **/
+static void
+distribution_reset(gpointer data, guint64 length, guint64 offset)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionReplicated* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+
+	distribution->length = length;
+	distribution->offset = offset;
+}
+
+/**
+ * Checks whether a server can hold data.
+ *
+ * \private
+ *
+ * \param distribution A distribution.
+ * \param index        A server index.
+ *
+ * \return TRUE if the server can hold data, FALSE otherwise.
+ **/
+static gboolean
+distribution_uses_server(gpointer data, guint index)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionReplicated* distribution = data;
+
+	return (index < distribution->server_count);
+}
+
+/**
+ * Calculates the size implied by the data stored on a server.
+ *
+ * \private
+ *
+ * \param distribution A distribution.
+ * \param index        A server index.
+ * \param local_size   The size of the data stored on the server.
+ *
+ * \return The offset following the server's last byte.
+ **/
+static guint64
+distribution_get_size(gpointer data, guint index, guint64 local_size)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionReplicated* distribution = data;
+
+	guint64 block;
+	guint64 displacement;
+	guint64 round;
+	guint64 slot;
+	guint replica;
+	guint first_index;
+
+	if (local_size == 0)
+	{
+		return 0;
+	}
+
+	// This reverses distribution_distribute() and distribution_get_replica() for the server's last byte.
+	slot = (local_size - 1) / distribution->block_size;
+	round = slot / distribution->replicas;
+	replica = slot % distribution->replicas;
+	displacement = (local_size - 1) % distribution->block_size;
+	first_index = (index + distribution->server_count - replica) % distribution->server_count;
+	block = (round * distribution->server_count) + ((first_index + distribution->server_count - distribution->start_index) % distribution->server_count);
+
+	return (block * distribution->block_size) + displacement + 1;
+}
+
+/**
+ * Returns the number of copies of each block.
+ *
+ * \private
+ *
+ * \param distribution A distribution.
+ *
+ * \return The number of replicas.
+ **/
+static guint
+distribution_get_replica_count(gpointer data)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionReplicated* distribution = data;
+
+	return distribution->replicas;
+}
+
+/**
+ * Returns where a replica of a block is stored.
+ *
+ * \private
+ *
+ * \param distribution   A distribution.
+ * \param replica        A replica.
+ * \param index          The server index of the first replica.
+ * \param offset         The offset of the first replica.
+ * \param replica_index  Returns the replica's server index.
+ * \param replica_offset Returns the replica's offset.
+ **/
+static void
+distribution_get_replica(gpointer data, guint replica, guint index, guint64 offset, guint* replica_index, guint64* replica_offset)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionReplicated* distribution = data;
+
+	*replica_index = (index + replica) % distribution->server_count;
+	*replica_offset = offset + (replica * distribution->block_size);
+}
+
+void
+j_distribution_replicated_get_vtable(JDistributionVTable* vtable)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	vtable->distribution_new = distribution_new;
+	vtable->distribution_free = distribution_free;
+	vtable->distribution_set = distribution_set;
+	vtable->distribution_set2 = NULL;
+	vtable->distribution_serialize = distribution_serialize;
+	vtable->distribution_deserialize = distribution_deserialize;
+	vtable->distribution_reset = distribution_reset;
+	vtable->distribution_distribute = distribution_distribute;
+	vtable->distribution_uses_server = distribution_uses_server;
+	vtable->distribution_get_size = distribution_get_size;
+	vtable->distribution_get_erasure_code = NULL;
+	vtable->distribution_get_erasure_server = NULL;
+	vtable->distribution_get_replica_count = distribution_get_replica_count;
+	vtable->distribution_get_replica = distribution_get_replica;
+}
+
+/**
+ * @}
+ **/
@@ -278,6 +278,61 @@ distribution_reset(gpointer data, guint64 length, guint64 offset)
 	distribution->offset = offset;
 }
 
+/**
+ * Checks whether a server can hold data.
+ *
+ * \private
+ *
+ * \param distribution A distribution.
+ * \param index        A server index.
+ *
+ * \return TRUE if the server can hold data, FALSE otherwise.
+ **/
+static gboolean
+distribution_uses_server(gpointer data, guint index)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionRoundRobin* distribution = data;
+
+	return (index < distribution->server_count);
+}
+
+/**
+ * Calculates the size implied by the data stored on a server.
+ *
+ * \private
+ *
+ * \param distribution A distribution.
+ * \param index        A server index.
+ * \param local_size   The size of the data stored on the server.
+ *
+ * \return The offset following the server's last byte.
+ **/
+static guint64
+distribution_get_size(gpointer data, guint index, guint64 local_size)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionRoundRobin* distribution = data;
+
+	guint64 block;
+	guint64 displacement;
+	guint64 round;
+
+	if (local_size == 0)
+	{
+		return 0;
+	}
+
+	// This reverses distribution_distribute() for the server's last byte.
+	round = (local_size - 1) / distribution->block_size;
+	displacement = (local_size - 1) % distribution->block_size;
+	block = (round * distribution->server_count) + ((index + distribution->server_count - distribution->start_index) % distribution->server_count);
+
+	return (block * distribution->block_size) + displacement + 1;
+}
+
 void
 j_distribution_round_robin_get_vtable(JDistributionVTable* vtable)
 {
@@ -291,6 +346,12 @@ j_distribution_round_robin_get_vtable(JDistributionVTable* vtable)
 	vtable->distribution_deserialize = distribution_deserialize;
 	vtable->distribution_reset = distribution_reset;
 	vtable->distribution_distribute = distribution_distribute;
+	vtable->distribution_uses_server = distribution_uses_server;
+	vtable->distribution_get_size = distribution_get_size;
+	vtable->distribution_get_erasure_code = NULL;
+	vtable->distribution_get_erasure_server = NULL;
+	vtable->distribution_get_replica_count = NULL;
+	vtable->distribution_get_replica = NULL;
 }
 
 /**
@@ -276,6 +276,48 @@ distribution_reset(gpointer data, guint64 length, guint64 offset)
 	distribution->offset = offset;
 }
 
+/**
+ * Checks whether a server can hold data.
+ *
+ * \private
+ *
+ * \param distribution A distribution.
+ * \param index        A server index.
+ *
+ * \return TRUE if the server can hold data, FALSE otherwise.
+ **/
+static gboolean
+distribution_uses_server(gpointer data, guint index)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionSingleServer* distribution = data;
+
+	return (index == distribution->index);
+}
+
+/**
+ * Calculates the size implied by the data stored on a server.
+ *
+ * \private
+ *
+ * \param distribution A distribution.
+ * \param index        A server index.
+ * \param local_size   The size of the data stored on the server.
+ *
+ * \return The offset following the server's last byte.
+ **/
+static guint64
+distribution_get_size(gpointer data, guint index, guint64 local_size)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionSingleServer* distribution = data;
+
+	// Offsets are not changed because all data is stored on the same server.
+	return (index == distribution->index) ? local_size : 0;
+}
+
 void
 j_distribution_single_server_get_vtable(JDistributionVTable* vtable)
 {
@@ -289,6 +331,12 @@ j_distribution_single_server_get_vtable(JDistributionVTable* vtable)
 	vtable->distribution_deserialize = distribution_deserialize;
 	vtable->distribution_reset = distribution_reset;
 	vtable->distribution_distribute = distribution_distribute;
+	vtable->distribution_uses_server = distribution_uses_server;
+	vtable->distribution_get_size = distribution_get_size;
+	vtable->distribution_get_erasure_code = NULL;
+	vtable->distribution_get_erasure_server = NULL;
+	vtable->distribution_get_replica_count = NULL;
+	vtable->distribution_get_replica = NULL;
 }
 
 /**
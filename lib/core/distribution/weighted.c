@@ -339,6 +339,69 @@ distribution_reset(gpointer data, guint64 length, guint64 offset)
 	distribution->offset = offset;
 }
 
+/**
+ * Checks whether a server can hold data.
+ *
+ * \private
+ *
+ * \param distribution A distribution.
+ * \param index        A server index.
+ *
+ * \return TRUE if the server can hold data, FALSE otherwise.
+ **/
+static gboolean
+distribution_uses_server(gpointer data, guint index)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionWeighted* distribution = data;
+
+	return (index < distribution->server_count && distribution->weights[index] > 0);
+}
+
+/**
+ * Calculates the size implied by the data stored on a server.
+ *
+ * \private
+ *
+ * \param distribution A distribution.
+ * \param index        A server index.
+ * \param local_size   The size of the data stored on the server.
+ *
+ * \return The offset following the server's last byte.
+ **/
+static guint64
+distribution_get_size(gpointer data, guint index, guint64 local_size)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributionWeighted* distribution = data;
+
+	guint64 block;
+	guint64 displacement;
+	guint64 local_block;
+	guint64 round;
+	guint block_offset = 0;
+
+	if (local_size == 0 || index >= distribution->server_count || distribution->weights[index] == 0)
+	{
+		return 0;
+	}
+
+	for (guint i = 0; i < index; i++)
+	{
+		block_offset += distribution->weights[i];
+	}
+
+	// This reverses distribution_distribute() for the server's last byte.
+	local_block = (local_size - 1) / distribution->block_size;
+	displacement = (local_size - 1) % distribution->block_size;
+	round = local_block / distribution->weights[index];
+	block = (round * distribution->sum) + block_offset + (local_block % distribution->weights[index]);
+
+	return (block * distribution->block_size) + displacement + 1;
+}
+
 void
 j_distribution_weighted_get_vtable(JDistributionVTable* vtable)
 {
@@ -352,6 +415,12 @@ j_distribution_weighted_get_vtable(JDistributionVTable* vtable)
 	vtable->distribution_deserialize = distribution_deserialize;
 	vtable->distribution_reset = distribution_reset;
 	vtable->distribution_distribute = distribution_distribute;
+	vtable->distribution_uses_server = distribution_uses_server;
+	vtable->distribution_get_size = distribution_get_size;
+	vtable->distribution_get_erasure_code = NULL;
+	vtable->distribution_get_erasure_server = NULL;
+	vtable->distribution_get_replica_count = NULL;
+	vtable->distribution_get_replica = NULL;
 }
 
 /**
@@ -461,6 +461,111 @@ j_backend_object_write(JBackend* backend, gpointer data, gconstpointer buffer, g
 	return ret;
 }
 
+/**
+ * Checks whether an object backend can send data directly to a file descriptor.
+ *
+ * \param backend A backend.
+ *
+ * \return TRUE if j_backend_object_send() can be used, FALSE otherwise.
+ **/
+gboolean
+j_backend_object_supports_send(JBackend* backend)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT, FALSE);
+
+	return (backend->object.backend_send != NULL);
+}
+
+/**
+ * Sends data from an object directly to a file descriptor.
+ *
+ * \param backend    A backend.
+ * \param data       An object.
+ * \param fd         A file descriptor, usually a socket.
+ * \param length     A length.
+ * \param offset     An offset within the object.
+ * \param bytes_sent Returns the number of bytes sent.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+j_backend_object_send(JBackend* backend, gpointer data, gint fd, guint64 length, guint64 offset, guint64* bytes_sent)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT, FALSE);
+	g_return_val_if_fail(backend->object.backend_send != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(fd >= 0, FALSE);
+	g_return_val_if_fail(bytes_sent != NULL, FALSE);
+
+	{
+		J_TRACE("backend_send", "%p, %d, %" G_GUINT64_FORMAT ", %" G_GUINT64_FORMAT ", %p", data, fd, length, offset, (gpointer)bytes_sent);
+		ret = backend->object.backend_send(backend->data, data, fd, length, offset, bytes_sent);
+	}
+
+	return ret;
+}
+
+/**
+ * Checks whether an object backend can receive data directly from a file descriptor.
+ *
+ * \param backend A backend.
+ *
+ * \return TRUE if j_backend_object_receive() can be used, FALSE otherwise.
+ **/
+gboolean
+j_backend_object_supports_receive(JBackend* backend)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT, FALSE);
+
+	return (backend->object.backend_receive != NULL);
+}
+
+/**
+ * Receives data directly from a file descriptor and writes it to an object.
+ * Exactly \p length bytes are consumed from the file descriptor, even if writing fails.
+ *
+ * \param backend       A backend.
+ * \param data          An object.
+ * \param fd            A file descriptor, usually a socket.
+ * \param length        A length.
+ * \param offset        An offset within the object.
+ * \param bytes_written Returns the number of bytes written.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+j_backend_object_receive(JBackend* backend, gpointer data, gint fd, guint64 length, guint64 offset, guint64* bytes_written)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT, FALSE);
+	g_return_val_if_fail(backend->object.backend_receive != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(fd >= 0, FALSE);
+	g_return_val_if_fail(bytes_written != NULL, FALSE);
+
+	{
+		J_TRACE("backend_receive", "%p, %d, %" G_GUINT64_FORMAT ", %" G_GUINT64_FORMAT ", %p", data, fd, length, offset, (gpointer)bytes_written);
+		ret = backend->object.backend_receive(backend->data, data, fd, length, offset, bytes_written);
+	}
+
+	return ret;
+}
+
 gboolean
 j_backend_kv_init(JBackend* backend, gchar const* path)
 {
@@ -26,6 +26,11 @@
 
 #include <unistd.h>
 
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
 #include <jbackground-operation.h>
 #include <jbackground-operation-internal.h>
 
@@ -34,9 +39,27 @@
 
 /**
  * \defgroup JBackgroundOperation Background Operation
+ *
+ * Background operations are executed by a fixed number of worker threads.
+ * Each worker has its own deque of operations.
+ * Operations created by a worker are put into its own deque, other operations are distributed round-robin.
+ * Workers take operations from the head of their own deque and steal from the tail of other deques when idle.
+ * Waiting for an operation that has not been started yet executes it in the waiting thread.
+ *
  * @{
  **/
 
+enum JBackgroundOperationState
+{
+	J_BACKGROUND_OPERATION_QUEUED,
+	J_BACKGROUND_OPERATION_RUNNING,
+	/**
+	 * The operation is running and somebody is waiting for it.
+	 **/
+	J_BACKGROUND_OPERATION_WAITED,
+	J_BACKGROUND_OPERATION_COMPLETED
+};
+
 /**
  * A background operation.
  **/
@@ -58,19 +81,21 @@ struct JBackgroundOperation
 	gpointer result;
 
 	/**
-	 * Whether the background operation has finished.
+	 * The state, see #JBackgroundOperationState.
+	 * An operation is contained in a deque if and only if it is queued.
 	 **/
-	gboolean completed;
+	gint state;
 
 	/**
-	 * The mutex for #completed.
-	 */
-	GMutex mutex[1];
+	 * The deque containing the operation while it is queued.
+	 **/
+	struct JBackgroundOperationDeque* deque;
 
 	/**
-	 * The condition for #completed.
-	 */
-	GCond cond[1];
+	 * Whether the operation has been allocated by j_background_operation_new().
+	 * Such operations hold a reference while they are queued or running.
+	 **/
+	gboolean allocated;
 
 	/**
 	 * The reference count.
@@ -78,7 +103,155 @@ struct JBackgroundOperation
 	gint ref_count;
 };
 
-static GThreadPool* j_thread_pool = NULL;
+struct JBackgroundOperationDeque
+{
+	GMutex mutex[1];
+	GQueue queue[1];
+	GThread* thread;
+};
+
+typedef struct JBackgroundOperationDeque JBackgroundOperationDeque;
+
+struct JBackgroundOperationExecutor
+{
+	JBackgroundOperationDeque* deques;
+	guint deques_len;
+
+	/**
+	 * The deque for operations that are not created by a worker.
+	 **/
+	guint next;
+
+	/**
+	 * The number of queued operations.
+	 **/
+	gint pending;
+
+	/**
+	 * The number of idle workers.
+	 **/
+	gint idle;
+
+	gboolean shutdown;
+
+	/**
+	 * The mutex for idle workers and #shutdown.
+	 **/
+	GMutex mutex[1];
+	GCond cond[1];
+};
+
+typedef struct JBackgroundOperationExecutor JBackgroundOperationExecutor;
+
+static JBackgroundOperationExecutor* j_executor = NULL;
+
+/**
+ * The deque of the current worker thread.
+ **/
+static GPrivate j_executor_deque;
+
+#ifndef __linux__
+static GMutex j_background_operation_mutex;
+static GCond j_background_operation_cond;
+#endif
+
+/**
+ * Executes an operation and wakes up waiters.
+ *
+ * \private
+ *
+ * \param background_operation A running background operation.
+ **/
+static void
+j_background_operation_run(JBackgroundOperation* background_operation)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gint state;
+
+	background_operation->result = (*(background_operation->func))(background_operation->data);
+
+	do
+	{
+		state = g_atomic_int_get(&(background_operation->state));
+	} while (!g_atomic_int_compare_and_exchange(&(background_operation->state), state, J_BACKGROUND_OPERATION_COMPLETED));
+
+	// Operations that are not allocated may be freed as soon as they have completed, so only their address can be used from here on.
+	if (state == J_BACKGROUND_OPERATION_WAITED)
+	{
+#ifdef __linux__
+		syscall(SYS_futex, &(background_operation->state), FUTEX_WAKE_PRIVATE, G_MAXINT, NULL, NULL, 0);
+#else
+		g_mutex_lock(&j_background_operation_mutex);
+		g_cond_broadcast(&j_background_operation_cond);
+		g_mutex_unlock(&j_background_operation_mutex);
+#endif
+	}
+}
+
+/**
+ * Takes an operation from a deque and marks it as running.
+ *
+ * \private
+ *
+ * \param deque A deque.
+ * \param steal Whether to take the operation from the tail.
+ *
+ * \return An operation, NULL if the deque is empty.
+ **/
+static JBackgroundOperation*
+j_background_operation_deque_pop(JBackgroundOperationDeque* deque, gboolean steal)
+{
+	JBackgroundOperation* background_operation;
+
+	g_mutex_lock(deque->mutex);
+
+	background_operation = (steal) ? g_queue_pop_tail(deque->queue) : g_queue_pop_head(deque->queue);
+
+	if (background_operation != NULL)
+	{
+		g_atomic_int_set(&(background_operation->state), J_BACKGROUND_OPERATION_RUNNING);
+		g_atomic_int_add(&(j_executor->pending), -1);
+	}
+
+	g_mutex_unlock(deque->mutex);
+
+	return background_operation;
+}
+
+static void
+j_background_operation_push(JBackgroundOperation* background_operation)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JBackgroundOperationDeque* deque;
+
+	deque = g_private_get(&j_executor_deque);
+
+	if (deque == NULL)
+	{
+		guint index;
+
+		index = (guint)g_atomic_int_add(&(j_executor->next), 1) % j_executor->deques_len;
+		deque = &(j_executor->deques[index]);
+	}
+
+	background_operation->deque = deque;
+
+	// The counter is incremented first, so it never drops below zero.
+	g_atomic_int_inc(&(j_executor->pending));
+
+	g_mutex_lock(deque->mutex);
+	g_queue_push_head(deque->queue, background_operation);
+	g_mutex_unlock(deque->mutex);
+
+	if (g_atomic_int_get(&(j_executor->idle)) > 0)
+	{
+		g_mutex_lock(j_executor->mutex);
+		g_cond_signal(j_executor->cond);
+		g_mutex_unlock(j_executor->mutex);
+	}
+}
 
 /**
  * Executes background operations.
@@ -88,26 +261,65 @@ static GThreadPool* j_thread_pool = NULL;
  * \code
  * \endcode
  *
- * \param data A background operations.
- * \param user_data User data.
+ * \param data The worker's deque.
  **/
-static void
-j_background_operation_thread(gpointer data, gpointer user_data)
+static gpointer
+j_background_operation_thread(gpointer data)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	JBackgroundOperation* background_operation = data;
+	JBackgroundOperationDeque* deque = data;
+	guint index;
 
-	(void)user_data;
+	g_private_set(&j_executor_deque, deque);
+	index = deque - j_executor->deques;
 
-	background_operation->result = (*(background_operation->func))(background_operation->data);
+	while (TRUE)
+	{
+		JBackgroundOperation* background_operation;
+
+		background_operation = j_background_operation_deque_pop(deque, FALSE);
+
+		for (guint i = 1; background_operation == NULL && i < j_executor->deques_len; i++)
+		{
+			background_operation = j_background_operation_deque_pop(&(j_executor->deques[(index + i) % j_executor->deques_len]), TRUE);
+		}
+
+		if (background_operation != NULL)
+		{
+			gboolean allocated = background_operation->allocated;
+
+			j_background_operation_run(background_operation);
+
+			if (allocated)
+			{
+				j_background_operation_unref(background_operation);
+			}
+
+			continue;
+		}
 
-	g_mutex_lock(background_operation->mutex);
-	background_operation->completed = TRUE;
-	g_cond_signal(background_operation->cond);
-	g_mutex_unlock(background_operation->mutex);
+		g_mutex_lock(j_executor->mutex);
+		g_atomic_int_inc(&(j_executor->idle));
 
-	j_background_operation_unref(background_operation);
+		while (g_atomic_int_get(&(j_executor->pending)) == 0 && !j_executor->shutdown)
+		{
+			g_cond_wait(j_executor->cond, j_executor->mutex);
+		}
+
+		g_atomic_int_add(&(j_executor->idle), -1);
+
+		// Remaining operations are executed before shutting down.
+		if (j_executor->shutdown && g_atomic_int_get(&(j_executor->pending)) == 0)
+		{
+			g_mutex_unlock(j_executor->mutex);
+			break;
+		}
+
+		g_mutex_unlock(j_executor->mutex);
+	}
+
+	return NULL;
 }
 
 /**
@@ -122,17 +334,38 @@ j_background_operation_init(guint count)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	GThreadPool* thread_pool;
+	JBackgroundOperationExecutor* executor;
 
-	g_return_if_fail(j_thread_pool == NULL);
+	g_return_if_fail(j_executor == NULL);
 
 	if (count == 0)
 	{
 		count = g_get_num_processors();
 	}
 
-	thread_pool = g_thread_pool_new(j_background_operation_thread, NULL, count, FALSE, NULL);
-	g_atomic_pointer_set(&j_thread_pool, thread_pool);
+	executor = g_slice_new(JBackgroundOperationExecutor);
+	executor->deques = g_new(JBackgroundOperationDeque, count);
+	executor->deques_len = count;
+	executor->next = 0;
+	executor->pending = 0;
+	executor->idle = 0;
+	executor->shutdown = FALSE;
+
+	g_mutex_init(executor->mutex);
+	g_cond_init(executor->cond);
+
+	for (guint i = 0; i < count; i++)
+	{
+		g_mutex_init(executor->deques[i].mutex);
+		g_queue_init(executor->deques[i].queue);
+	}
+
+	g_atomic_pointer_set(&j_executor, executor);
+
+	for (guint i = 0; i < count; i++)
+	{
+		executor->deques[i].thread = g_thread_new("JBackgroundOperation", j_background_operation_thread, &(executor->deques[i]));
+	}
 }
 
 /**
@@ -147,14 +380,30 @@ j_background_operation_fini(void)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	GThreadPool* thread_pool;
+	JBackgroundOperationExecutor* executor;
+
+	g_return_if_fail(j_executor != NULL);
+
+	executor = g_atomic_pointer_get(&j_executor);
 
-	g_return_if_fail(j_thread_pool != NULL);
+	g_mutex_lock(executor->mutex);
+	executor->shutdown = TRUE;
+	g_cond_broadcast(executor->cond);
+	g_mutex_unlock(executor->mutex);
 
-	thread_pool = g_atomic_pointer_get(&j_thread_pool);
-	g_atomic_pointer_set(&j_thread_pool, NULL);
+	for (guint i = 0; i < executor->deques_len; i++)
+	{
+		g_thread_join(executor->deques[i].thread);
+		g_mutex_clear(executor->deques[i].mutex);
+	}
+
+	g_atomic_pointer_set(&j_executor, NULL);
 
-	g_thread_pool_free(thread_pool, FALSE, TRUE);
+	g_cond_clear(executor->cond);
+	g_mutex_clear(executor->mutex);
+
+	g_free(executor->deques);
+	g_slice_free(JBackgroundOperationExecutor, executor);
 }
 
 guint
@@ -162,7 +411,7 @@ j_background_operation_get_num_threads(void)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	return g_thread_pool_get_max_threads(j_thread_pool);
+	return j_executor->deques_len;
 }
 
 /**
@@ -199,13 +448,12 @@ j_background_operation_new(JBackgroundOperationFunc func, gpointer data)
 	background_operation->func = func;
 	background_operation->data = data;
 	background_operation->result = NULL;
-	background_operation->completed = FALSE;
+	background_operation->state = J_BACKGROUND_OPERATION_QUEUED;
+	background_operation->deque = NULL;
+	background_operation->allocated = TRUE;
 	background_operation->ref_count = 2;
 
-	g_mutex_init(background_operation->mutex);
-	g_cond_init(background_operation->cond);
-
-	g_thread_pool_push(j_thread_pool, background_operation, NULL);
+	j_background_operation_push(background_operation);
 
 	return background_operation;
 }
@@ -256,15 +504,13 @@ j_background_operation_unref(JBackgroundOperation* background_operation)
 
 	if (g_atomic_int_dec_and_test(&(background_operation->ref_count)))
 	{
-		g_cond_clear(background_operation->cond);
-		g_mutex_clear(background_operation->mutex);
-
 		g_slice_free(JBackgroundOperation, background_operation);
 	}
 }
 
 /**
  * Waits for a background operation to finish.
+ * If the operation has not been started yet, it is executed by the calling thread.
  *
  * \code
  * JBackgroundOperation* background_operation;
@@ -281,20 +527,133 @@ j_background_operation_wait(JBackgroundOperation* background_operation)
 {
 	J_TRACE_FUNCTION(NULL);
 
+	gboolean claimed = FALSE;
+
 	g_return_val_if_fail(background_operation != NULL, NULL);
 
-	g_mutex_lock(background_operation->mutex);
+	if (g_atomic_int_get(&(background_operation->state)) == J_BACKGROUND_OPERATION_QUEUED)
+	{
+		JBackgroundOperationDeque* deque = background_operation->deque;
+
+		// Workers only take operations while holding the deque's lock.
+		g_mutex_lock(deque->mutex);
+
+		if (g_atomic_int_get(&(background_operation->state)) == J_BACKGROUND_OPERATION_QUEUED)
+		{
+			g_queue_remove(deque->queue, background_operation);
+			g_atomic_int_set(&(background_operation->state), J_BACKGROUND_OPERATION_RUNNING);
+			g_atomic_int_add(&(j_executor->pending), -1);
+			claimed = TRUE;
+		}
+
+		g_mutex_unlock(deque->mutex);
+	}
+
+	if (claimed)
+	{
+		j_background_operation_run(background_operation);
+
+		// Drop the reference that would have been dropped by the worker.
+		if (background_operation->allocated)
+		{
+			j_background_operation_unref(background_operation);
+		}
 
-	while (!background_operation->completed)
+		return background_operation->result;
+	}
+
+#ifdef __linux__
+	while (TRUE)
+	{
+		gint state = g_atomic_int_get(&(background_operation->state));
+
+		if (state == J_BACKGROUND_OPERATION_COMPLETED)
+		{
+			break;
+		}
+
+		if (state == J_BACKGROUND_OPERATION_WAITED || g_atomic_int_compare_and_exchange(&(background_operation->state), state, J_BACKGROUND_OPERATION_WAITED))
+		{
+			syscall(SYS_futex, &(background_operation->state), FUTEX_WAIT_PRIVATE, J_BACKGROUND_OPERATION_WAITED, NULL, NULL, 0);
+		}
+	}
+#else
+	g_mutex_lock(&j_background_operation_mutex);
+
+	while (TRUE)
 	{
-		g_cond_wait(background_operation->cond, background_operation->mutex);
+		gint state = g_atomic_int_get(&(background_operation->state));
+
+		if (state == J_BACKGROUND_OPERATION_COMPLETED)
+		{
+			break;
+		}
+
+		if (state == J_BACKGROUND_OPERATION_WAITED || g_atomic_int_compare_and_exchange(&(background_operation->state), state, J_BACKGROUND_OPERATION_WAITED))
+		{
+			g_cond_wait(&j_background_operation_cond, &j_background_operation_mutex);
+		}
 	}
 
-	g_mutex_unlock(background_operation->mutex);
+	g_mutex_unlock(&j_background_operation_mutex);
+#endif
 
 	return background_operation->result;
 }
 
+/**
+ * Executes a function for multiple data elements in parallel.
+ * The first element is handled by the calling thread, which afterwards helps with the elements that have not been started yet.
+ * The operations are allocated at once and are not reference counted.
+ *
+ * \param func   A function.
+ * \param data   An array of data elements, which are replaced by the function's return values.
+ * \param length The number of data elements.
+ **/
+void
+j_background_operation_execute_all(JBackgroundOperationFunc func, gpointer* data, guint length)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_autofree JBackgroundOperation* background_operations = NULL;
+
+	g_return_if_fail(func != NULL);
+	g_return_if_fail(data != NULL);
+
+	if (length == 0)
+	{
+		return;
+	}
+
+	background_operations = g_new(JBackgroundOperation, length);
+
+	for (guint i = 0; i < length; i++)
+	{
+		JBackgroundOperation* background_operation = &(background_operations[i]);
+
+		background_operation->func = func;
+		background_operation->data = data[i];
+		background_operation->result = NULL;
+		background_operation->state = J_BACKGROUND_OPERATION_RUNNING;
+		background_operation->deque = NULL;
+		background_operation->allocated = FALSE;
+		background_operation->ref_count = 1;
+
+		if (i > 0)
+		{
+			background_operation->state = J_BACKGROUND_OPERATION_QUEUED;
+			j_background_operation_push(background_operation);
+		}
+	}
+
+	j_background_operation_run(&(background_operations[0]));
+
+	for (guint i = 0; i < length; i++)
+	{
+		data[i] = j_background_operation_wait(&(background_operations[i]));
+	}
+}
+
 /**
  * @}
  **/
@@ -29,10 +29,15 @@
 
 #include <jbackground-operation.h>
 #include <jcache.h>
+#include <jcompletion-queue.h>
+#include <jcompletion-queue-internal.h>
+#include <jconfiguration.h>
+#include <jconnection-pool.h>
+#include <jhelper.h>
 #include <jlist.h>
-#include <jlist-iterator.h>
+#include <jmemory-chunk.h>
+#include <jmessage.h>
 #include <joperation-cache-internal.h>
-#include <joperation-internal.h>
 #include <jsemantics.h>
 #include <jtrace.h>
 
@@ -48,9 +53,41 @@
 struct JBatch
 {
 	/**
-	 * The list of pending operations.
+	 * The pending operations.
+	 * Contains #JOperation elements, which are stored contiguously.
 	 **/
-	JList* list;
+	GArray* operations;
+
+	/**
+	 * The arena for the operations' data, see j_batch_allocate().
+	 * Contains #JMemoryChunk elements, NULL if nothing has been allocated yet.
+	 **/
+	GPtrArray* chunks;
+
+	/**
+	 * The index of the chunk used for new allocations.
+	 **/
+	guint chunk;
+
+	/**
+	 * The payload size of the pending operations, see #JOperation.
+	 **/
+	guint64 size;
+
+	/**
+	 * Whether the pending operations are executed automatically once the batch becomes too large, see j_batch_set_auto_flush().
+	 **/
+	gboolean auto_flush;
+
+	/**
+	 * Whether operations have been executed automatically since the last call to j_batch_execute().
+	 **/
+	gboolean flushed;
+
+	/**
+	 * The combined return value of the automatic executions.
+	 **/
+	gboolean flush_ret;
 
 	/**
 	 * The semantics.
@@ -73,10 +110,17 @@ struct JBatchAsync
 	JBatch* batch;
 	JBatchAsyncCallback callback;
 	gpointer user_data;
+
+	/**
+	 * The queue to add the batch to after it has been executed, NULL if the callback should be used.
+	 **/
+	JCompletionQueue* queue;
 };
 
 typedef struct JBatchAsync JBatchAsync;
 
+static gboolean j_batch_submit(JBatch*, JCompletionQueue*);
+
 static gpointer
 j_batch_background_operation(gpointer data)
 {
@@ -92,6 +136,12 @@ j_batch_background_operation(gpointer data)
 		(*async->callback)(async->batch, ret, async->user_data);
 	}
 
+	if (async->queue != NULL)
+	{
+		j_completion_queue_push(async->queue, async->batch, ret);
+		j_completion_queue_unref(async->queue);
+	}
+
 	j_batch_unref(async->batch);
 
 	g_slice_free(JBatchAsync, async);
@@ -99,6 +149,50 @@ j_batch_background_operation(gpointer data)
 	return NULL;
 }
 
+/**
+ * The size of the arena's first chunk.
+ * Each following chunk is twice as large, up to #J_BATCH_CHUNK_MAX_SIZE.
+ **/
+#define J_BATCH_CHUNK_MIN_SIZE (4 * 1024)
+#define J_BATCH_CHUNK_MAX_SIZE (1024 * 1024)
+
+/**
+ * Frees a batch's operations and resets its arena.
+ *
+ * \private
+ *
+ * \param batch A batch.
+ **/
+static void
+j_batch_clear(JBatch* batch)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	for (guint i = 0; i < batch->operations->len; i++)
+	{
+		JOperation* operation = &g_array_index(batch->operations, JOperation, i);
+
+		if (operation->free_func != NULL)
+		{
+			operation->free_func(operation->data);
+		}
+	}
+
+	g_array_set_size(batch->operations, 0);
+	batch->size = 0;
+
+	// The chunks are kept, so that the batch can be reused without allocating memory again.
+	if (batch->chunks != NULL)
+	{
+		for (guint i = 0; i < batch->chunks->len; i++)
+		{
+			j_memory_chunk_reset(g_ptr_array_index(batch->chunks, i));
+		}
+
+		batch->chunk = 0;
+	}
+}
+
 /**
  * Creates a new batch.
  *
@@ -119,7 +213,13 @@ j_batch_new(JSemantics* semantics)
 	g_return_val_if_fail(semantics != NULL, NULL);
 
 	batch = g_slice_new(JBatch);
-	batch->list = j_list_new((JListFreeFunc)j_operation_free);
+	batch->operations = g_array_new(FALSE, FALSE, sizeof(JOperation));
+	batch->chunks = NULL;
+	batch->chunk = 0;
+	batch->size = 0;
+	batch->auto_flush = FALSE;
+	batch->flushed = FALSE;
+	batch->flush_ret = TRUE;
 	batch->semantics = j_semantics_ref(semantics);
 	batch->background_operation = NULL;
 	batch->ref_count = 1;
@@ -201,7 +301,13 @@ j_batch_unref(JBatch* batch)
 			j_semantics_unref(batch->semantics);
 		}
 
-		j_list_unref(batch->list);
+		j_batch_clear(batch);
+		g_array_unref(batch->operations);
+
+		if (batch->chunks != NULL)
+		{
+			g_ptr_array_unref(batch->chunks);
+		}
 
 		g_slice_free(JBatch, batch);
 	}
@@ -259,26 +365,34 @@ j_batch_execute(JBatch* batch)
 	J_TRACE_FUNCTION(NULL);
 
 	gboolean ret;
+	gboolean flushed;
+	gboolean flush_ret;
 
 	g_return_val_if_fail(batch != NULL, FALSE);
 
-	if (j_list_length(batch->list) == 0)
+	flushed = batch->flushed;
+	flush_ret = batch->flush_ret;
+	batch->flushed = FALSE;
+	batch->flush_ret = TRUE;
+
+	if (batch->operations->len == 0)
 	{
-		return FALSE;
+		// All operations might already have been executed automatically.
+		return (flushed && flush_ret);
 	}
 
 	if (j_semantics_get(batch->semantics, J_SEMANTICS_PERSISTENCY) == J_SEMANTICS_PERSISTENCY_EVENTUAL
 	    && j_operation_cache_add(batch))
 	{
-		return TRUE;
+		return flush_ret;
 	}
 
-	j_operation_cache_flush();
+	j_operation_cache_flush_batch(batch);
 
 	ret = j_batch_execute_internal(batch);
-	j_list_delete_all(batch->list);
+	j_batch_clear(batch);
 
-	return ret;
+	return ret && flush_ret;
 }
 
 /**
@@ -306,10 +420,92 @@ j_batch_execute_async(JBatch* batch, JBatchAsyncCallback callback, gpointer user
 	async->batch = j_batch_ref(batch);
 	async->callback = callback;
 	async->user_data = user_data;
+	async->queue = NULL;
 
 	batch->background_operation = j_background_operation_new(j_batch_background_operation, async);
 }
 
+/**
+ * Executes the batch asynchronously and adds it to a completion queue afterwards.
+ *
+ * In contrast to j_batch_execute_async(), the caller does not have to wait for the batch or handle its completion in another thread.
+ * Instead, completed batches are retrieved from the queue, which can be polled or attached to a GMainContext.
+ * A single queue can be used for any number of batches.
+ * j_batch_wait() must not be used for batches executed this way.
+ *
+ * If all of the batch's operations support it, the batch does not occupy a thread while it is being executed.
+ * Instead, its messages are sent by a single driver thread that handles the replies of all queued batches as they arrive.
+ * This is currently the case for key-value operations using server-side backends.
+ * Other batches, as well as batches with strict ordering or eventual persistency semantics, are executed by a background worker.
+ *
+ * \code
+ * g_autoptr(JCompletionQueue) queue = NULL;
+ * JBatch* batch;
+ *
+ * queue = j_completion_queue_new();
+ * j_batch_execute_queued(batch, queue);
+ * ...
+ * batch = j_completion_queue_wait(queue, NULL);
+ * \endcode
+ *
+ * \param batch A batch.
+ * \param queue A completion queue.
+ **/
+void
+j_batch_execute_queued(JBatch* batch, JCompletionQueue* queue)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JBatchAsync* async;
+
+	g_return_if_fail(batch != NULL);
+	g_return_if_fail(queue != NULL);
+	g_return_if_fail(batch->background_operation == NULL);
+
+	if (j_batch_submit(batch, queue))
+	{
+		return;
+	}
+
+	async = g_slice_new(JBatchAsync);
+	async->batch = j_batch_ref(batch);
+	async->callback = NULL;
+	async->user_data = NULL;
+	async->queue = j_completion_queue_ref(queue);
+
+	// The batch is handed back using the queue, so the background operation does not have to be kept.
+	j_background_operation_unref(j_background_operation_new(j_batch_background_operation, async));
+}
+
+/**
+ * Sets whether the batch's pending operations are executed automatically once the batch becomes too large.
+ *
+ * If enabled, j_batch_add() executes the pending operations as soon as their number or payload size reaches the limits set by the [clients] max-batch-operations and max-batch-size options.
+ * This keeps the memory needed for very large batches bounded.
+ * Results of operations returning data are available once the operations have been executed, either automatically or by j_batch_execute().
+ * j_batch_execute() still has to be called for the remaining operations and returns FALSE if any of the automatic executions failed.
+ * Should not be enabled for batches that are executed asynchronously.
+ *
+ * \code
+ * JBatch* batch;
+ *
+ * batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+ * j_batch_set_auto_flush(batch, TRUE);
+ * \endcode
+ *
+ * \param batch      A batch.
+ * \param auto_flush Whether operations should be executed automatically.
+ **/
+void
+j_batch_set_auto_flush(JBatch* batch, gboolean auto_flush)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_if_fail(batch != NULL);
+
+	batch->auto_flush = auto_flush;
+}
+
 void
 j_batch_wait(JBatch* batch)
 {
@@ -348,19 +544,29 @@ j_batch_new_from_batch(JBatch* old_batch)
 
 	g_return_val_if_fail(old_batch != NULL, NULL);
 
+	// The operations' data lives in the arena, so both are moved to the new batch.
 	batch = g_slice_new(JBatch);
-	batch->list = old_batch->list;
+	batch->operations = old_batch->operations;
+	batch->chunks = old_batch->chunks;
+	batch->chunk = old_batch->chunk;
+	batch->size = old_batch->size;
+	batch->auto_flush = FALSE;
+	batch->flushed = FALSE;
+	batch->flush_ret = TRUE;
 	batch->semantics = j_semantics_ref(old_batch->semantics);
 	batch->background_operation = NULL;
 	batch->ref_count = 1;
 
-	old_batch->list = j_list_new((JListFreeFunc)j_operation_free);
+	old_batch->operations = g_array_new(FALSE, FALSE, sizeof(JOperation));
+	old_batch->chunks = NULL;
+	old_batch->chunk = 0;
+	old_batch->size = 0;
 
 	return batch;
 }
 
 /**
- * Returns a batch's parts.
+ * Returns a batch's operations.
  *
  * \private
  *
@@ -369,16 +575,16 @@ j_batch_new_from_batch(JBatch* old_batch)
  *
  * \param batch A batch.
  *
- * \return A list of parts.
+ * \return An array of #JOperation elements.
  **/
-JList*
+GArray*
 j_batch_get_operations(JBatch* batch)
 {
 	J_TRACE_FUNCTION(NULL);
 
 	g_return_val_if_fail(batch != NULL, NULL);
 
-	return batch->list;
+	return batch->operations;
 }
 
 /**
@@ -403,8 +609,29 @@ j_batch_get_semantics(JBatch* batch)
 	return batch->semantics;
 }
 
+/**
+ * Checks whether a number of operations with a given payload size is large enough to be sent as a separate message.
+ *
+ * \private
+ *
+ * \param operations The number of operations.
+ * \param size       The operations' payload size.
+ *
+ * \return TRUE if a limit has been reached, FALSE otherwise.
+ **/
+static gboolean
+j_batch_limit_reached(guint operations, guint64 size)
+{
+	JConfiguration* configuration = j_configuration();
+
+	return (operations >= j_configuration_get_max_batch_operations(configuration)
+		|| size >= j_configuration_get_max_batch_size(configuration));
+}
+
 /**
  * Adds a new operation to the batch.
+ * The operation is copied into the batch and freed.
+ * If automatic execution is enabled and the batch has become too large, the pending operations are executed.
  *
  * \private
  *
@@ -422,7 +649,307 @@ j_batch_add(JBatch* batch, JOperation* operation)
 	g_return_if_fail(batch != NULL);
 	g_return_if_fail(operation != NULL);
 
-	j_list_append(batch->list, operation);
+	g_array_append_val(batch->operations, *operation);
+	batch->size += operation->size;
+	g_slice_free(JOperation, operation);
+
+	if (batch->auto_flush && j_batch_limit_reached(batch->operations->len, batch->size))
+	{
+		gboolean ret;
+
+		// j_batch_execute() also combines the results of earlier automatic executions.
+		ret = j_batch_execute(batch);
+
+		batch->flushed = TRUE;
+		batch->flush_ret = ret;
+	}
+}
+
+/**
+ * Allocates memory for an operation's data.
+ * The memory is taken from an arena that belongs to the batch.
+ * It is released all at once after the batch's operations have been executed or when the batch is freed, so it must not be freed manually.
+ * An operation's free function therefore only has to release the resources referenced by its data.
+ *
+ * \code
+ * JKVOperation* kop;
+ *
+ * kop = j_batch_allocate(batch, sizeof(JKVOperation));
+ * \endcode
+ *
+ * \param batch A batch.
+ * \param size  The size of the memory.
+ *
+ * \return A pointer to the memory, aligned suitably for any type.
+ **/
+gpointer
+j_batch_allocate(JBatch* batch, gsize size)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JMemoryChunk* chunk;
+	gpointer ret;
+	guint64 chunk_size;
+
+	g_return_val_if_fail(batch != NULL, NULL);
+	g_return_val_if_fail(size > 0, NULL);
+
+	size = (size + 15) & ~(gsize)15;
+
+	if (batch->chunks == NULL)
+	{
+		batch->chunks = g_ptr_array_new_with_free_func((GDestroyNotify)j_memory_chunk_free);
+	}
+
+	for (; batch->chunk < batch->chunks->len; batch->chunk++)
+	{
+		if ((ret = j_memory_chunk_get(g_ptr_array_index(batch->chunks, batch->chunk), size)) != NULL)
+		{
+			return ret;
+		}
+	}
+
+	chunk_size = MIN((guint64)J_BATCH_CHUNK_MIN_SIZE << MIN(batch->chunks->len, 8), J_BATCH_CHUNK_MAX_SIZE);
+	chunk = j_memory_chunk_new(MAX(chunk_size, size));
+	g_ptr_array_add(batch->chunks, chunk);
+
+	return j_memory_chunk_get(chunk, size);
+}
+
+/**
+ * A group of operations that are executed together.
+ **/
+struct JBatchGroup
+{
+	JBatch* batch;
+
+	JOperationExecFunc exec_func;
+	JOperationSubmitFunc submit_func;
+	JOperationCompleteFunc complete_func;
+
+	/**
+	 * The operations' data.
+	 **/
+	JList* list;
+
+	/**
+	 * The number of operations and their payload size.
+	 **/
+	guint operations;
+	guint64 size;
+
+	/**
+	 * The group's level in the dependency graph.
+	 * A group only depends on groups with lower levels, so all groups with the same level can be executed concurrently.
+	 **/
+	guint level;
+
+	/**
+	 * The return value of exec_func or complete_func.
+	 **/
+	gboolean ret;
+
+	/**
+	 * The queued batch the group belongs to, NULL if the group is executed using exec_func.
+	 **/
+	struct JBatchQueued* queued;
+
+	/**
+	 * Whether a reply is expected for the group's message.
+	 **/
+	gboolean reply;
+
+	/**
+	 * The connection the group's message has been sent on, NULL if none.
+	 * It is returned to the pool as soon as the group has been completed.
+	 **/
+	gpointer connection;
+	JBackendType backend;
+	guint32 index;
+};
+
+typedef struct JBatchGroup JBatchGroup;
+
+static void
+j_batch_group_free(gpointer data)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JBatchGroup* group = data;
+
+	j_list_unref(group->list);
+	g_slice_free(JBatchGroup, group);
+}
+
+static gint
+j_batch_group_compare(gconstpointer a, gconstpointer b)
+{
+	JBatchGroup const* group_a = *((JBatchGroup const* const*)a);
+	JBatchGroup const* group_b = *((JBatchGroup const* const*)b);
+
+	if (group_a->level < group_b->level)
+	{
+		return -1;
+	}
+	else if (group_a->level > group_b->level)
+	{
+		return 1;
+	}
+
+	return 0;
+}
+
+static gpointer
+j_batch_group_execute(gpointer data)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JBatchGroup* group = data;
+
+	group->ret = j_batch_execute_same(group->batch, group->exec_func, group->list);
+
+	return group;
+}
+
+/**
+ * Regroups the batch's operations.
+ * Operations are combined with earlier operations that have the same exec_func and key, even if they are not adjacent.
+ * An operation can only join a group if no later group contains an operation with the same key.
+ * This keeps all operations on the same resource in order, while operations on different resources can be reordered.
+ * Operations without a key act as barriers that are never reordered.
+ * Groups are split once they reach the limits checked by j_batch_limit_reached(), so that a single message does not become arbitrarily large.
+ *
+ * Each group depends on the previous group with the same key and on the last barrier.
+ * Groups have to be executed level by level, independent groups on the same level can be executed concurrently.
+ * For example, creating an item results in an object group and a key-value group that are sent to their servers at the same time.
+ *
+ * \private
+ *
+ * \param batch A batch.
+ *
+ * \return The groups sorted by level.
+ **/
+static GPtrArray*
+j_batch_group_operations(JBatch* batch)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_autoptr(GHashTable) last_groups = NULL;
+	GPtrArray* groups;
+	// Groups created after the last barrier have at least this level.
+	guint min_level = 0;
+	guint max_level = 0;
+
+	groups = g_ptr_array_new_with_free_func(j_batch_group_free);
+	// Maps keys to the last group containing an operation with that key.
+	last_groups = g_hash_table_new(g_str_hash, g_str_equal);
+
+	for (guint i = 0; i < batch->operations->len; i++)
+	{
+		JOperation* operation = &g_array_index(batch->operations, JOperation, i);
+		JBatchGroup* last_group = NULL;
+		JBatchGroup* group;
+
+		if (operation->key != NULL)
+		{
+			last_group = g_hash_table_lookup(last_groups, operation->key);
+		}
+
+		if (last_group != NULL && last_group->exec_func == operation->exec_func && last_group->level >= min_level
+		    && !j_batch_limit_reached(last_group->operations, last_group->size))
+		{
+			j_list_append(last_group->list, operation->data);
+			last_group->operations++;
+			last_group->size += operation->size;
+			continue;
+		}
+
+		group = g_slice_new(JBatchGroup);
+		group->batch = batch;
+		group->exec_func = operation->exec_func;
+		group->submit_func = operation->submit_func;
+		group->complete_func = operation->complete_func;
+		group->list = j_list_new(NULL);
+		group->operations = 1;
+		group->size = operation->size;
+		group->ret = FALSE;
+		group->queued = NULL;
+		group->reply = FALSE;
+		group->connection = NULL;
+
+		if (operation->key != NULL)
+		{
+			group->level = min_level;
+
+			if (last_group != NULL)
+			{
+				group->level = MAX(group->level, last_group->level + 1);
+			}
+
+			g_hash_table_insert(last_groups, (gpointer)(guintptr)operation->key, group);
+		}
+		else
+		{
+			group->level = (groups->len > 0) ? max_level + 1 : 0;
+			min_level = group->level + 1;
+		}
+
+		max_level = MAX(max_level, group->level);
+
+		j_list_append(group->list, operation->data);
+		g_ptr_array_add(groups, group);
+	}
+
+	// The sort is stable, so groups on the same level stay in batch order.
+	g_ptr_array_sort(groups, j_batch_group_compare);
+
+	return groups;
+}
+
+/**
+ * Regroups and executes the batch's operations, see j_batch_group_operations().
+ * Independent groups on the same level are executed concurrently.
+ *
+ * \private
+ *
+ * \param batch A batch.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+static gboolean
+j_batch_execute_regrouped(JBatch* batch)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_autoptr(GPtrArray) groups = NULL;
+	gboolean ret = TRUE;
+
+	groups = j_batch_group_operations(batch);
+
+	for (guint i = 0; i < groups->len;)
+	{
+		JBatchGroup* group = g_ptr_array_index(groups, i);
+		guint length = 1;
+
+		while (i + length < groups->len && ((JBatchGroup*)g_ptr_array_index(groups, i + length))->level == group->level)
+		{
+			length++;
+		}
+
+		// If there is only a single group on this level, it is executed in the calling thread.
+		j_helper_execute_parallel(j_batch_group_execute, &(groups->pdata[i]), length);
+
+		for (guint j = i; j < i + length; j++)
+		{
+			JBatchGroup* executed_group = g_ptr_array_index(groups, j);
+
+			ret = executed_group->ret && ret;
+		}
+
+		i += length;
+	}
+
+	return ret;
 }
 
 /**
@@ -443,48 +970,402 @@ j_batch_execute_internal(JBatch* batch)
 	J_TRACE_FUNCTION(NULL);
 
 	g_autoptr(JList) same_list = NULL;
-	g_autoptr(JListIterator) iterator = NULL;
-	JOperationExecFunc last_exec_func;
-	gconstpointer last_key;
 	gboolean ret = TRUE;
+	guint start = 0;
+
+	/**
+	 * Unless strict ordering is requested, operations on different resources can be reordered.
+	 * For example, a collection has to be created before items in it can be created.
+	 * This is guaranteed because both operations use the same key.
+	 */
+	if (j_semantics_get(batch->semantics, J_SEMANTICS_ORDERING) != J_SEMANTICS_ORDERING_STRICT)
+	{
+		return j_batch_execute_regrouped(batch);
+	}
 
-	iterator = j_list_iterator_new(batch->list);
 	same_list = j_list_new(NULL);
-	last_key = NULL;
-	last_exec_func = NULL;
 
-	if (j_semantics_get(batch->semantics, J_SEMANTICS_ORDERING) == J_SEMANTICS_ORDERING_RELAXED)
+	/**
+	 * Try to combine as many adjacent operations of the same type as possible.
+	 * We only combine operations with the same type and the same key.
+	 */
+	while (start < batch->operations->len)
 	{
-		/* FIXME: perform some optimizations */
-		/**
-		 * It is important to consider dependencies:
-		 * - Operations have to be performed before their dependent ones.
-		 *   For example, a collection has to be created before items in it can be created.
-		 */
+		JOperation* first = &g_array_index(batch->operations, JOperation, start);
+		guint end = start;
+		guint64 size = 0;
+
+		while (end < batch->operations->len)
+		{
+			JOperation* operation = &g_array_index(batch->operations, JOperation, end);
+
+			if (operation->exec_func != first->exec_func || g_strcmp0(operation->key, first->key) != 0)
+			{
+				break;
+			}
+
+			// Very large runs are split into several messages.
+			if (j_batch_limit_reached(end - start, size))
+			{
+				break;
+			}
+
+			j_list_append(same_list, operation->data);
+			size += operation->size;
+			end++;
+		}
+
+		ret = j_batch_execute_same(batch, first->exec_func, same_list) && ret;
+		start = end;
 	}
 
+	return ret;
+}
+
+/**
+ * A batch executed by the driver thread, see j_batch_execute_queued().
+ **/
+struct JBatchQueued
+{
+	JBatch* batch;
+	JCompletionQueue* queue;
+
 	/**
-	 * Try to combine as many operations of the same type as possible.
-	 * These are temporarily stored in same_list.
-	 */
-	while (j_list_iterator_next(iterator))
+	 * The batch's groups sorted by level, see j_batch_group_operations().
+	 * Contains #JBatchGroup elements.
+	 **/
+	GPtrArray* groups;
+
+	/**
+	 * The first group of the next level.
+	 **/
+	guint next;
+
+	/**
+	 * The number of groups of the current level that have not been completed yet.
+	 **/
+	guint outstanding;
+};
+
+typedef struct JBatchQueued JBatchQueued;
+
+/**
+ * The queued batches that have not been picked up by the driver yet.
+ * Contains #JBatchQueued elements.
+ **/
+static GAsyncQueue* j_batch_driver_queue = NULL;
+static GThread* j_batch_driver_thread = NULL;
+
+/**
+ * The driver's fan-out, shared by all batches.
+ * Woken up by j_batch_submit(), so that new batches do not have to wait for outstanding replies.
+ **/
+static JMessageFanout* j_batch_driver_fanout = NULL;
+
+G_LOCK_DEFINE_STATIC(j_batch_driver);
+
+/**
+ * Tells the driver to exit once all batches have been completed.
+ **/
+static JBatchQueued j_batch_driver_shutdown;
+
+/**
+ * The batches whose current level has been completed.
+ * Only used by the driver thread.
+ * Contains #JBatchQueued elements.
+ **/
+static GQueue j_batch_driver_ready = G_QUEUE_INIT;
+
+static gboolean
+j_batch_group_reply(JMessage* reply, gpointer connection, gpointer data)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JBatchGroup* group = data;
+
+	(void)connection;
+
+	group->ret = group->complete_func(group->list, reply);
+
+	return FALSE;
+}
+
+static void
+j_batch_group_done(gboolean ret, gpointer data)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JBatchGroup* group = data;
+	JBatchQueued* queued = group->queued;
+
+	if (!group->reply)
+	{
+		group->ret = group->complete_func(group->list, NULL);
+	}
+
+	group->ret = group->ret && ret;
+
+	// The message's slot is released together with the message, so other users of the connection are not affected.
+	if (group->connection != NULL)
+	{
+		j_connection_pool_push(group->backend, group->index, group->connection);
+		group->connection = NULL;
+	}
+
+	// The fan-out must not be modified here, so the next level is submitted by the driver afterwards.
+	queued->outstanding--;
+
+	if (queued->outstanding == 0)
+	{
+		g_queue_push_tail(&j_batch_driver_ready, queued);
+	}
+}
+
+/**
+ * Submits a queued batch's groups until a level is waiting for replies.
+ *
+ * \private
+ *
+ * \param queued A queued batch.
+ * \param fanout The driver's fan-out.
+ *
+ * \return TRUE if all groups have been completed, FALSE otherwise.
+ **/
+static gboolean
+j_batch_queued_submit(JBatchQueued* queued, JMessageFanout* fanout)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	while (queued->outstanding == 0 && queued->next < queued->groups->len)
 	{
-		JOperation* operation = j_list_iterator_get(iterator);
+		guint level = ((JBatchGroup*)g_ptr_array_index(queued->groups, queued->next))->level;
 
-		/* We only combine operations with the same type and the same key. */
-		if ((operation->exec_func != last_exec_func || operation->key != last_key) && last_exec_func != NULL)
+		for (; queued->next < queued->groups->len; queued->next++)
 		{
-			ret = j_batch_execute_same(batch, last_exec_func, same_list) && ret;
+			JBatchGroup* group = g_ptr_array_index(queued->groups, queued->next);
+			g_autoptr(JMessage) message = NULL;
+			JBackendType backend;
+			gpointer connection;
+			guint32 index;
+
+			if (group->level != level)
+			{
+				break;
+			}
+
+			message = group->submit_func(group->list, queued->batch->semantics, &backend, &index, &(group->reply));
+
+			// The operations are executed locally, which does not involve waiting for servers.
+			if (message == NULL)
+			{
+				group->ret = group->exec_func(group->list, queued->batch->semantics);
+				continue;
+			}
+
+			connection = j_connection_pool_pop(backend, index);
+
+			if (connection == NULL)
+			{
+				group->ret = FALSE;
+				continue;
+			}
+
+			group->connection = connection;
+			group->backend = backend;
+			group->index = index;
+			group->queued = queued;
+			queued->outstanding++;
+
+			j_message_fanout_add_full(fanout, message, connection, (group->reply) ? j_batch_group_reply : NULL, j_batch_group_done, group);
 		}
+	}
+
+	return (queued->outstanding == 0 && queued->next >= queued->groups->len);
+}
+
+/**
+ * Hands a completed batch back to its caller.
+ *
+ * \private
+ *
+ * \param queued A queued batch.
+ **/
+static void
+j_batch_queued_finish(JBatchQueued* queued)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = TRUE;
 
-		last_key = operation->key;
-		last_exec_func = operation->exec_func;
-		j_list_append(same_list, operation->data);
+	for (guint i = 0; i < queued->groups->len; i++)
+	{
+		JBatchGroup* group = g_ptr_array_index(queued->groups, i);
+
+		ret = group->ret && ret;
 	}
 
-	ret = j_batch_execute_same(batch, last_exec_func, same_list) && ret;
+	g_ptr_array_unref(queued->groups);
+	j_batch_clear(queued->batch);
 
-	return ret;
+	j_completion_queue_push(queued->queue, queued->batch, ret);
+
+	j_completion_queue_unref(queued->queue);
+	j_batch_unref(queued->batch);
+
+	g_slice_free(JBatchQueued, queued);
+}
+
+/**
+ * Sends the messages of queued batches and handles their replies.
+ * All batches share a single fan-out, so the driver waits for all servers at once.
+ *
+ * \private
+ *
+ * \param data The driver's fan-out.
+ *
+ * \return NULL.
+ **/
+static gpointer
+j_batch_driver(gpointer data)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JMessageFanout* fanout = data;
+	gboolean shutdown = FALSE;
+	guint active = 0;
+
+	while (!shutdown || active > 0)
+	{
+		JBatchQueued* queued;
+
+		// Only block if there are no batches in flight.
+		queued = (active == 0) ? g_async_queue_pop(j_batch_driver_queue) : g_async_queue_try_pop(j_batch_driver_queue);
+
+		for (; queued != NULL; queued = g_async_queue_try_pop(j_batch_driver_queue))
+		{
+			if (queued == &j_batch_driver_shutdown)
+			{
+				shutdown = TRUE;
+				continue;
+			}
+
+			active++;
+			g_queue_push_tail(&j_batch_driver_ready, queued);
+		}
+
+		while ((queued = g_queue_pop_head(&j_batch_driver_ready)) != NULL)
+		{
+			if (j_batch_queued_submit(queued, fanout))
+			{
+				j_batch_queued_finish(queued);
+				active--;
+			}
+		}
+
+		if (active > 0)
+		{
+			// Returns early when a batch has been submitted, see j_batch_submit().
+			j_message_fanout_execute_until(fanout, -1);
+			j_message_fanout_prune(fanout);
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Hands a batch to the driver thread if all of its operations can be submitted without blocking.
+ *
+ * \private
+ *
+ * \param batch A batch.
+ * \param queue A completion queue.
+ *
+ * \return TRUE if the batch has been handed to the driver, FALSE if it has to be executed by a background worker.
+ **/
+static gboolean
+j_batch_submit(JBatch* batch, JCompletionQueue* queue)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JBatchQueued* queued;
+
+	// Batches with earlier automatic executions have to combine their results in j_batch_execute().
+	if (batch->operations->len == 0 || batch->flushed)
+	{
+		return FALSE;
+	}
+
+	// Batches with eventual persistency might be cached, see j_batch_execute().
+	if (j_semantics_get(batch->semantics, J_SEMANTICS_PERSISTENCY) == J_SEMANTICS_PERSISTENCY_EVENTUAL
+	    || j_semantics_get(batch->semantics, J_SEMANTICS_ORDERING) == J_SEMANTICS_ORDERING_STRICT)
+	{
+		return FALSE;
+	}
+
+	for (guint i = 0; i < batch->operations->len; i++)
+	{
+		JOperation* operation = &g_array_index(batch->operations, JOperation, i);
+
+		if (operation->submit_func == NULL || operation->complete_func == NULL)
+		{
+			return FALSE;
+		}
+	}
+
+	j_operation_cache_flush_batch(batch);
+
+	queued = g_slice_new(JBatchQueued);
+	queued->batch = j_batch_ref(batch);
+	queued->queue = j_completion_queue_ref(queue);
+	queued->groups = j_batch_group_operations(batch);
+	queued->next = 0;
+	queued->outstanding = 0;
+
+	G_LOCK(j_batch_driver);
+
+	if (j_batch_driver_thread == NULL)
+	{
+		j_batch_driver_queue = g_async_queue_new();
+		j_batch_driver_fanout = j_message_fanout_new();
+		j_batch_driver_thread = g_thread_new("julea-batch-driver", j_batch_driver, j_batch_driver_fanout);
+	}
+
+	g_async_queue_push(j_batch_driver_queue, queued);
+	// The driver might be waiting for replies of other batches.
+	j_message_fanout_wakeup(j_batch_driver_fanout);
+
+	G_UNLOCK(j_batch_driver);
+
+	return TRUE;
+}
+
+/**
+ * Stops the driver thread after all queued batches have been completed.
+ *
+ * \private
+ **/
+void
+j_batch_fini(void)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	G_LOCK(j_batch_driver);
+
+	if (j_batch_driver_thread != NULL)
+	{
+		g_async_queue_push(j_batch_driver_queue, &j_batch_driver_shutdown);
+		g_thread_join(j_batch_driver_thread);
+		j_batch_driver_thread = NULL;
+
+		g_async_queue_unref(j_batch_driver_queue);
+		j_batch_driver_queue = NULL;
+
+		j_message_fanout_free(j_batch_driver_fanout);
+		j_batch_driver_fanout = NULL;
+	}
+
+	G_UNLOCK(j_batch_driver);
 }
 
 /**
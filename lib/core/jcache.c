@@ -32,9 +32,56 @@
 
 /**
  * \defgroup JCache Cache
+ *
+ * A cache manages a preallocated arena that is used as a ring buffer.
+ * Each segment is preceded by a header, so segments can be released in constant time.
+ * Segments are handed out at the head of the ring and reclaimed at its tail.
+ * Segments that are released out of order are reclaimed as soon as all older segments have been released.
+ * If the arena does not have enough contiguous space, segments are allocated from the heap instead.
+ *
  * @{
  **/
 
+#define J_CACHE_ALIGNMENT 16
+
+enum JCacheBlockState
+{
+	J_CACHE_BLOCK_USED = 0x4a430001,
+	J_CACHE_BLOCK_FREE = 0x4a430002,
+	J_CACHE_BLOCK_SKIP = 0x4a430003,
+	J_CACHE_BLOCK_HEAP = 0x4a430004
+};
+
+typedef enum JCacheBlockState JCacheBlockState;
+
+/**
+ * The header of a segment.
+ **/
+struct JCacheBlock
+{
+	/**
+	 * The number of bytes requested.
+	 **/
+	guint64 length;
+
+	/**
+	 * The number of bytes occupied in the arena, including the header.
+	 **/
+	guint64 size;
+
+	JCacheBlockState state;
+
+	/**
+	 * Segments allocated from the heap are linked, so they can be freed together with the cache.
+	 **/
+	struct JCacheBlock* prev;
+	struct JCacheBlock* next;
+};
+
+typedef struct JCacheBlock JCacheBlock;
+
+#define J_CACHE_HEADER_SIZE ((sizeof(JCacheBlock) + J_CACHE_ALIGNMENT - 1) / J_CACHE_ALIGNMENT * J_CACHE_ALIGNMENT)
+
 /**
  * A cache.
  */
@@ -45,13 +92,170 @@ struct JCache
 	*/
 	guint64 size;
 
-	GHashTable* buffers;
-
+	/**
+	 * The number of bytes handed out.
+	 **/
 	guint64 used;
 
+	/**
+	 * The arena.
+	 **/
+	gchar* arena;
+
+	/**
+	 * The arena's size.
+	 **/
+	guint64 capacity;
+
+	/**
+	 * The offset of the next segment.
+	 **/
+	guint64 head;
+
+	/**
+	 * The offset of the oldest segment.
+	 **/
+	guint64 tail;
+
+	/**
+	 * The number of bytes between #tail and #head.
+	 **/
+	guint64 ring_used;
+
+	/**
+	 * The segments allocated from the heap.
+	 **/
+	JCacheBlock* heap;
+
+	JCacheStatistics statistics;
+
 	GMutex mutex[1];
 };
 
+static guint64
+j_cache_align(guint64 length)
+{
+	return (length + J_CACHE_ALIGNMENT - 1) / J_CACHE_ALIGNMENT * J_CACHE_ALIGNMENT;
+}
+
+/**
+ * Allocates a block from the arena.
+ * The cache's mutex has to be held.
+ *
+ * \private
+ *
+ * \param cache A cache.
+ * \param size  The block's size, including the header.
+ *
+ * \return A block, NULL if the arena does not have enough contiguous space.
+ **/
+static JCacheBlock*
+j_cache_ring_alloc(JCache* cache, guint64 size)
+{
+	JCacheBlock* block;
+	guint64 offset;
+
+	if (cache->ring_used == 0)
+	{
+		cache->head = 0;
+		cache->tail = 0;
+	}
+	else if (cache->head == cache->tail)
+	{
+		return NULL;
+	}
+
+	if (cache->head >= cache->tail)
+	{
+		guint64 remaining = cache->capacity - cache->head;
+
+		if (size <= remaining)
+		{
+			offset = cache->head;
+		}
+		else if (size <= cache->tail)
+		{
+			// Skip the rest of the arena and wrap around.
+			if (remaining >= J_CACHE_HEADER_SIZE)
+			{
+				block = (JCacheBlock*)(cache->arena + cache->head);
+				block->size = remaining;
+				block->state = J_CACHE_BLOCK_SKIP;
+			}
+
+			cache->ring_used += remaining;
+			offset = 0;
+		}
+		else
+		{
+			return NULL;
+		}
+	}
+	else if (cache->head + size <= cache->tail)
+	{
+		offset = cache->head;
+	}
+	else
+	{
+		return NULL;
+	}
+
+	block = (JCacheBlock*)(cache->arena + offset);
+	block->size = size;
+	block->state = J_CACHE_BLOCK_USED;
+
+	cache->ring_used += size;
+	cache->head = offset + size;
+
+	if (cache->head == cache->capacity)
+	{
+		cache->head = 0;
+	}
+
+	return block;
+}
+
+/**
+ * Reclaims released blocks at the tail of the arena.
+ * The cache's mutex has to be held.
+ *
+ * \private
+ *
+ * \param cache A cache.
+ **/
+static void
+j_cache_ring_reclaim(JCache* cache)
+{
+	while (cache->ring_used > 0)
+	{
+		JCacheBlock* block;
+		guint64 remaining = cache->capacity - cache->tail;
+
+		// The rest of the arena is too small for a header and has been skipped.
+		if (remaining < J_CACHE_HEADER_SIZE)
+		{
+			cache->ring_used -= remaining;
+			cache->tail = 0;
+			continue;
+		}
+
+		block = (JCacheBlock*)(cache->arena + cache->tail);
+
+		if (block->state != J_CACHE_BLOCK_FREE && block->state != J_CACHE_BLOCK_SKIP)
+		{
+			break;
+		}
+
+		cache->ring_used -= block->size;
+		cache->tail += block->size;
+
+		if (cache->tail == cache->capacity)
+		{
+			cache->tail = 0;
+		}
+	}
+}
+
 /**
  * Creates a new cache.
  *
@@ -76,8 +280,17 @@ j_cache_new(guint64 size)
 
 	cache = g_slice_new(JCache);
 	cache->size = size;
-	cache->buffers = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, NULL);
 	cache->used = 0;
+	// Leave room for headers and for space that is skipped when wrapping around.
+	cache->capacity = 2 * (j_cache_align(size) + J_CACHE_HEADER_SIZE);
+	cache->arena = g_malloc(cache->capacity);
+	cache->head = 0;
+	cache->tail = 0;
+	cache->ring_used = 0;
+	cache->heap = NULL;
+
+	memset(&(cache->statistics), 0, sizeof(cache->statistics));
+	cache->statistics.size = size;
 
 	g_mutex_init(cache->mutex);
 
@@ -86,6 +299,7 @@ j_cache_new(guint64 size)
 
 /**
  * Frees the memory allocated for the cache.
+ * Segments that have not been released become invalid.
  *
  * \code
  * JCache* cache;
@@ -102,20 +316,17 @@ j_cache_free(JCache* cache)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	GHashTableIter iter[1];
-	gpointer key;
-	gpointer value;
-
 	g_return_if_fail(cache != NULL);
 
-	g_hash_table_iter_init(iter, cache->buffers);
-
-	while (g_hash_table_iter_next(iter, &key, &value))
+	while (cache->heap != NULL)
 	{
-		g_free(key);
+		JCacheBlock* block = cache->heap;
+
+		cache->heap = block->next;
+		g_free(block);
 	}
 
-	g_hash_table_unref(cache->buffers);
+	g_free(cache->arena);
 
 	g_mutex_clear(cache->mutex);
 
@@ -124,6 +335,7 @@ j_cache_free(JCache* cache)
 
 /**
  * Gets a new segment from the cache.
+ * The segment is aligned to 16 bytes.
  *
  * \code
  * JCache* cache;
@@ -143,51 +355,148 @@ j_cache_get(JCache* cache, guint64 length)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	gpointer ret = NULL;
+	JCacheBlock* block;
 
 	g_return_val_if_fail(cache != NULL, NULL);
 
 	g_mutex_lock(cache->mutex);
 
+	cache->statistics.gets++;
+
 	if (cache->used + length > cache->size)
 	{
-		goto end;
+		cache->statistics.gets_failed++;
+		g_mutex_unlock(cache->mutex);
+
+		return NULL;
 	}
 
-	ret = g_malloc(length);
-	cache->used += length;
+	block = j_cache_ring_alloc(cache, J_CACHE_HEADER_SIZE + j_cache_align(length));
+
+	if (block == NULL)
+	{
+		// The arena is fragmented, fall back to the heap.
+		block = g_malloc(J_CACHE_HEADER_SIZE + length);
+		block->size = 0;
+		block->state = J_CACHE_BLOCK_HEAP;
+		block->prev = NULL;
+		block->next = cache->heap;
+
+		if (cache->heap != NULL)
+		{
+			cache->heap->prev = block;
+		}
+
+		cache->heap = block;
+		cache->statistics.gets_heap++;
+	}
 
-	g_hash_table_insert(cache->buffers, ret, GSIZE_TO_POINTER(length));
+	block->length = length;
+
+	cache->used += length;
+	cache->statistics.used = cache->used;
+	cache->statistics.used_max = MAX(cache->statistics.used_max, cache->used);
 
-end:
 	g_mutex_unlock(cache->mutex);
 
-	return ret;
+	return (gchar*)block + J_CACHE_HEADER_SIZE;
 }
 
+/**
+ * Releases a segment.
+ *
+ * \code
+ * JCache* cache;
+ * gpointer data;
+ *
+ * data = j_cache_get(cache, 1024);
+ * j_cache_release(cache, data);
+ * \endcode
+ *
+ * \param cache A cache.
+ * \param data  A segment returned by j_cache_get().
+ **/
 void
 j_cache_release(JCache* cache, gpointer data)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	gpointer size;
+	JCacheBlock* block;
 
 	g_return_if_fail(cache != NULL);
 	g_return_if_fail(data != NULL);
 
+	block = (JCacheBlock*)((gchar*)data - J_CACHE_HEADER_SIZE);
+
 	g_mutex_lock(cache->mutex);
 
-	if ((size = g_hash_table_lookup(cache->buffers, data)) == NULL)
+	if (block->state == J_CACHE_BLOCK_HEAP)
+	{
+		if (block->prev != NULL)
+		{
+			block->prev->next = block->next;
+		}
+		else
+		{
+			cache->heap = block->next;
+		}
+
+		if (block->next != NULL)
+		{
+			block->next->prev = block->prev;
+		}
+	}
+	else if (block->state == J_CACHE_BLOCK_USED)
+	{
+		block->state = J_CACHE_BLOCK_FREE;
+	}
+	else
 	{
+		g_mutex_unlock(cache->mutex);
 		g_warn_if_reached();
+
 		return;
 	}
 
-	g_hash_table_remove(cache->buffers, data);
+	cache->used -= block->length;
+	cache->statistics.used = cache->used;
+	cache->statistics.releases++;
+
+	if (block->state == J_CACHE_BLOCK_FREE)
+	{
+		j_cache_ring_reclaim(cache);
+		block = NULL;
+	}
+
+	g_mutex_unlock(cache->mutex);
 
-	cache->used -= GPOINTER_TO_SIZE(size);
-	g_free(data);
+	// Heap segments can be freed without holding the lock.
+	g_free(block);
+}
 
+/**
+ * Returns the cache's usage statistics.
+ *
+ * \code
+ * JCache* cache;
+ * JCacheStatistics statistics;
+ *
+ * j_cache_get_statistics(cache, &statistics);
+ * \endcode
+ *
+ * \param cache      A cache.
+ * \param statistics The statistics.
+ **/
+void
+j_cache_get_statistics(JCache* cache, JCacheStatistics* statistics)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_if_fail(cache != NULL);
+	g_return_if_fail(statistics != NULL);
+
+	g_mutex_lock(cache->mutex);
+	*statistics = cache->statistics;
 	g_mutex_unlock(cache->mutex);
 }
 
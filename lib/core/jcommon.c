@@ -142,6 +142,7 @@ j_fini(void)
 
 	trace = j_trace_enter(G_STRFUNC, NULL);
 
+	j_batch_fini();
 	j_operation_cache_fini();
 	j_background_operation_fini();
 	j_connection_pool_fini();
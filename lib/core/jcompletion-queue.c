@@ -0,0 +1,533 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2020 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <errno.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#else
+#include <fcntl.h>
+#include <glib-unix.h>
+#endif
+
+#include <jcompletion-queue.h>
+#include <jcompletion-queue-internal.h>
+
+#include <jbatch.h>
+#include <jtrace.h>
+
+/**
+ * \defgroup JCompletionQueue Completion Queue
+ *
+ * A completion queue collects batches that have been executed using j_batch_execute_queued().
+ * Completed batches can be retrieved without blocking, so a single thread can keep many batches in flight.
+ * The queue's file descriptor is readable while completed batches are available; it can be polled together with other file descriptors.
+ * Alternatively, j_completion_queue_source_new() integrates the queue into a GMainContext.
+ *
+ * The file descriptor holds one token per completed batch.
+ * On Linux, this is a semaphore eventfd; elsewhere, a pipe with one byte per batch is used.
+ *
+ * @{
+ **/
+
+struct JCompletionQueueEntry
+{
+	JBatch* batch;
+	gboolean ret;
+};
+
+typedef struct JCompletionQueueEntry JCompletionQueueEntry;
+
+/**
+ * A completion queue.
+ **/
+struct JCompletionQueue
+{
+	/**
+	 * The completed batches.
+	 * Contains #JCompletionQueueEntry elements.
+	 **/
+	GQueue* entries;
+
+	GMutex mutex;
+	GCond cond;
+
+	/**
+	 * The file descriptors used for signaling.
+	 * Both are the same if an eventfd is used.
+	 **/
+	gint read_fd;
+	gint write_fd;
+
+	/**
+	 * The reference count.
+	 **/
+	gint ref_count;
+};
+
+struct JCompletionQueueSource
+{
+	GSource source;
+
+	JCompletionQueue* queue;
+	JBatchAsyncCallback callback;
+	gpointer user_data;
+};
+
+typedef struct JCompletionQueueSource JCompletionQueueSource;
+
+/**
+ * Adds a token to the queue's file descriptor.
+ * The queue's mutex has to be held.
+ *
+ * \private
+ *
+ * \param queue A queue.
+ **/
+static void
+j_completion_queue_signal(JCompletionQueue* queue)
+{
+	J_TRACE_FUNCTION(NULL);
+
+#ifdef __linux__
+	guint64 value = 1;
+#else
+	gchar value = 1;
+#endif
+
+	while (write(queue->write_fd, &value, sizeof(value)) < 0)
+	{
+		if (errno != EINTR)
+		{
+			g_critical("Could not signal completion queue: %s", g_strerror(errno));
+			break;
+		}
+	}
+}
+
+/**
+ * Removes a token from the queue's file descriptor.
+ * The queue's mutex has to be held.
+ *
+ * \private
+ *
+ * \param queue A queue.
+ **/
+static void
+j_completion_queue_consume(JCompletionQueue* queue)
+{
+	J_TRACE_FUNCTION(NULL);
+
+#ifdef __linux__
+	guint64 value;
+#else
+	gchar value;
+#endif
+
+	while (read(queue->read_fd, &value, sizeof(value)) < 0)
+	{
+		if (errno != EINTR)
+		{
+			g_critical("Could not consume completion queue token: %s", g_strerror(errno));
+			break;
+		}
+	}
+}
+
+/**
+ * Removes the first completed batch from the queue.
+ * The queue's mutex has to be held.
+ *
+ * \private
+ *
+ * \param queue A queue.
+ * \param ret   Returns the batch's result.
+ *
+ * \return The batch, NULL if no batch has completed.
+ **/
+static JBatch*
+j_completion_queue_pop_locked(JCompletionQueue* queue, gboolean* ret)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JCompletionQueueEntry* entry;
+	JBatch* batch;
+
+	entry = g_queue_pop_head(queue->entries);
+
+	if (entry == NULL)
+	{
+		return NULL;
+	}
+
+	j_completion_queue_consume(queue);
+
+	batch = entry->batch;
+
+	if (ret != NULL)
+	{
+		*ret = entry->ret;
+	}
+
+	g_slice_free(JCompletionQueueEntry, entry);
+
+	return batch;
+}
+
+static gboolean
+j_completion_queue_source_dispatch(GSource* source, GSourceFunc callback, gpointer user_data)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JCompletionQueueSource* queue_source = (JCompletionQueueSource*)source;
+
+	JBatch* batch;
+	gboolean ret;
+
+	(void)callback;
+	(void)user_data;
+
+	while ((batch = j_completion_queue_pop(queue_source->queue, &ret)) != NULL)
+	{
+		if (queue_source->callback != NULL)
+		{
+			queue_source->callback(batch, ret, queue_source->user_data);
+		}
+
+		j_batch_unref(batch);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+j_completion_queue_source_finalize(GSource* source)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JCompletionQueueSource* queue_source = (JCompletionQueueSource*)source;
+
+	j_completion_queue_unref(queue_source->queue);
+}
+
+static GSourceFuncs j_completion_queue_source_funcs = {
+	NULL,
+	NULL,
+	j_completion_queue_source_dispatch,
+	j_completion_queue_source_finalize,
+	NULL,
+	NULL
+};
+
+/**
+ * Creates a new completion queue.
+ *
+ * \code
+ * JCompletionQueue* queue;
+ *
+ * queue = j_completion_queue_new();
+ * \endcode
+ *
+ * \return A new completion queue. Should be freed with j_completion_queue_unref().
+ **/
+JCompletionQueue*
+j_completion_queue_new(void)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JCompletionQueue* queue;
+
+	queue = g_slice_new(JCompletionQueue);
+	queue->entries = g_queue_new();
+	g_mutex_init(&(queue->mutex));
+	g_cond_init(&(queue->cond));
+	queue->ref_count = 1;
+
+#ifdef __linux__
+	queue->read_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK | EFD_SEMAPHORE);
+	queue->write_fd = queue->read_fd;
+
+	if (queue->read_fd == -1)
+	{
+		g_critical("Could not create completion queue: %s", g_strerror(errno));
+	}
+#else
+	{
+		gint fds[2];
+		GError* error = NULL;
+
+		if (g_unix_open_pipe(fds, FD_CLOEXEC, &error) && g_unix_set_fd_nonblocking(fds[0], TRUE, &error))
+		{
+			queue->read_fd = fds[0];
+			queue->write_fd = fds[1];
+		}
+		else
+		{
+			g_critical("Could not create completion queue: %s", error->message);
+			g_error_free(error);
+
+			queue->read_fd = -1;
+			queue->write_fd = -1;
+		}
+	}
+#endif
+
+	return queue;
+}
+
+/**
+ * Increases a completion queue's reference count.
+ *
+ * \code
+ * \endcode
+ *
+ * \param queue A completion queue.
+ *
+ * \return The completion queue.
+ **/
+JCompletionQueue*
+j_completion_queue_ref(JCompletionQueue* queue)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(queue != NULL, NULL);
+
+	g_atomic_int_inc(&(queue->ref_count));
+
+	return queue;
+}
+
+/**
+ * Decreases a completion queue's reference count.
+ * When the reference count reaches zero, frees the memory allocated for the queue.
+ * Batches that are still queued are released.
+ *
+ * \code
+ * \endcode
+ *
+ * \param queue A completion queue.
+ **/
+void
+j_completion_queue_unref(JCompletionQueue* queue)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_if_fail(queue != NULL);
+
+	if (g_atomic_int_dec_and_test(&(queue->ref_count)))
+	{
+		JCompletionQueueEntry* entry;
+
+		while ((entry = g_queue_pop_head(queue->entries)) != NULL)
+		{
+			j_batch_unref(entry->batch);
+			g_slice_free(JCompletionQueueEntry, entry);
+		}
+
+		if (queue->write_fd != queue->read_fd && queue->write_fd != -1)
+		{
+			close(queue->write_fd);
+		}
+
+		if (queue->read_fd != -1)
+		{
+			close(queue->read_fd);
+		}
+
+		g_queue_free(queue->entries);
+		g_cond_clear(&(queue->cond));
+		g_mutex_clear(&(queue->mutex));
+
+		g_slice_free(JCompletionQueue, queue);
+	}
+}
+
+/**
+ * Returns a completion queue's file descriptor.
+ * The file descriptor becomes readable when a batch has completed and must only be polled, not read.
+ *
+ * \code
+ * \endcode
+ *
+ * \param queue A completion queue.
+ *
+ * \return A file descriptor.
+ **/
+gint
+j_completion_queue_get_fd(JCompletionQueue* queue)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(queue != NULL, -1);
+
+	return queue->read_fd;
+}
+
+/**
+ * Removes a completed batch from a completion queue without blocking.
+ *
+ * \code
+ * JBatch* batch;
+ * gboolean ret;
+ *
+ * while ((batch = j_completion_queue_pop(queue, &ret)) != NULL)
+ * {
+ *   ...
+ *   j_batch_unref(batch);
+ * }
+ * \endcode
+ *
+ * \param queue A completion queue.
+ * \param ret   Returns whether the batch has been executed successfully, can be NULL.
+ *
+ * \return A batch, NULL if no batch has completed. Should be freed with j_batch_unref().
+ **/
+JBatch*
+j_completion_queue_pop(JCompletionQueue* queue, gboolean* ret)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JBatch* batch;
+
+	g_return_val_if_fail(queue != NULL, NULL);
+
+	g_mutex_lock(&(queue->mutex));
+	batch = j_completion_queue_pop_locked(queue, ret);
+	g_mutex_unlock(&(queue->mutex));
+
+	return batch;
+}
+
+/**
+ * Removes a completed batch from a completion queue.
+ * Blocks until a batch has completed.
+ *
+ * \code
+ * \endcode
+ *
+ * \param queue A completion queue.
+ * \param ret   Returns whether the batch has been executed successfully, can be NULL.
+ *
+ * \return A batch. Should be freed with j_batch_unref().
+ **/
+JBatch*
+j_completion_queue_wait(JCompletionQueue* queue, gboolean* ret)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JBatch* batch;
+
+	g_return_val_if_fail(queue != NULL, NULL);
+
+	g_mutex_lock(&(queue->mutex));
+
+	while ((batch = j_completion_queue_pop_locked(queue, ret)) == NULL)
+	{
+		g_cond_wait(&(queue->cond), &(queue->mutex));
+	}
+
+	g_mutex_unlock(&(queue->mutex));
+
+	return batch;
+}
+
+/**
+ * Creates a source that handles a completion queue's batches in a GMainContext.
+ * The callback is called in the context's thread for every completed batch.
+ * The batches are released after the callback returns.
+ *
+ * \code
+ * GSource* source;
+ *
+ * source = j_completion_queue_source_new(queue, on_batch_completed, NULL);
+ * g_source_attach(source, NULL);
+ * \endcode
+ *
+ * \param queue     A completion queue.
+ * \param callback  A callback.
+ * \param user_data The data to pass to the callback.
+ *
+ * \return A new source. Should be freed with g_source_unref().
+ **/
+GSource*
+j_completion_queue_source_new(JCompletionQueue* queue, JBatchAsyncCallback callback, gpointer user_data)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	GSource* source;
+	JCompletionQueueSource* queue_source;
+
+	g_return_val_if_fail(queue != NULL, NULL);
+
+	source = g_source_new(&j_completion_queue_source_funcs, sizeof(JCompletionQueueSource));
+	g_source_set_name(source, "JCompletionQueue");
+
+	queue_source = (JCompletionQueueSource*)source;
+	queue_source->queue = j_completion_queue_ref(queue);
+	queue_source->callback = callback;
+	queue_source->user_data = user_data;
+	g_source_add_unix_fd(source, queue->read_fd, G_IO_IN);
+
+	return source;
+}
+
+/* Internal */
+
+/**
+ * Adds a completed batch to a completion queue.
+ *
+ * \private
+ *
+ * \param queue A completion queue.
+ * \param batch A batch.
+ * \param ret   Whether the batch has been executed successfully.
+ **/
+void
+j_completion_queue_push(JCompletionQueue* queue, JBatch* batch, gboolean ret)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JCompletionQueueEntry* entry;
+
+	g_return_if_fail(queue != NULL);
+	g_return_if_fail(batch != NULL);
+
+	entry = g_slice_new(JCompletionQueueEntry);
+	entry->batch = j_batch_ref(batch);
+	entry->ret = ret;
+
+	// The token is written while holding the mutex, so that tokens and entries always match.
+	g_mutex_lock(&(queue->mutex));
+	g_queue_push_tail(queue->entries, entry);
+	j_completion_queue_signal(queue);
+	g_cond_signal(&(queue->cond));
+	g_mutex_unlock(&(queue->mutex));
+}
+
+/**
+ * @}
+ **/
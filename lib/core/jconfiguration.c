@@ -29,6 +29,7 @@
 #include <jconfiguration.h>
 
 #include <jbackend.h>
+#include <jplacement.h>
 #include <jtrace.h>
 
 /**
@@ -142,6 +143,45 @@ struct JConfiguration
 	guint32 max_connections;
 	guint64 stripe_size;
 
+	/**
+	 * The maximum number of operations and the maximum payload size of a single message sent for a batch.
+	 * Larger groups of operations are split into several messages.
+	 */
+	guint32 max_batch_operations;
+	guint64 max_batch_size;
+
+	/**
+	 * The percentile of a server's latencies after which object reads are hedged, 0 if hedging is disabled.
+	 * The percentage of object reads that may be hedged.
+	 */
+	guint32 hedge_percentile;
+	guint32 hedge_budget;
+
+	/**
+	 * The placements used to map keys to servers.
+	 */
+	struct
+	{
+		JPlacement* object;
+		JPlacement* kv;
+		JPlacement* db;
+	} placement;
+
+	/**
+	 * Whether clients connect to servers on the same host using local sockets.
+	 */
+	gboolean local_sockets;
+
+	/**
+	 * The directory containing the servers' local sockets.
+	 */
+	gchar* local_socket_directory;
+
+	/**
+	 * The libfabric provider used for bulk data transfers, NULL if libfabric is not used.
+	 */
+	gchar* fabric_provider;
+
 	/**
 	 * The reference count.
 	 */
@@ -285,12 +325,36 @@ j_configuration_new_for_data(GKeyFile* key_file)
 	guint64 max_operation_size;
 	guint32 max_connections;
 	guint64 stripe_size;
+	guint32 max_batch_operations;
+	guint64 max_batch_size;
+	guint32 hedge_percentile;
+	guint32 hedge_budget;
+	g_autofree gchar* placement = NULL;
+	JPlacementType placement_type = J_PLACEMENT_MODULO;
+	guint32 placement_virtual_nodes;
+	gboolean local_sockets = TRUE;
+	gchar* local_socket_directory;
+	gchar* fabric_provider;
 
 	g_return_val_if_fail(key_file != NULL, FALSE);
 
 	max_operation_size = g_key_file_get_uint64(key_file, "core", "max-operation-size", NULL);
+	fabric_provider = g_key_file_get_string(key_file, "core", "fabric-provider", NULL);
+	local_socket_directory = g_key_file_get_string(key_file, "core", "local-socket-directory", NULL);
 	max_connections = g_key_file_get_integer(key_file, "clients", "max-connections", NULL);
 	stripe_size = g_key_file_get_uint64(key_file, "clients", "stripe-size", NULL);
+	max_batch_operations = g_key_file_get_integer(key_file, "clients", "max-batch-operations", NULL);
+	max_batch_size = g_key_file_get_uint64(key_file, "clients", "max-batch-size", NULL);
+	hedge_percentile = g_key_file_get_integer(key_file, "clients", "hedge-percentile", NULL);
+	hedge_budget = g_key_file_get_integer(key_file, "clients", "hedge-budget", NULL);
+	placement = g_key_file_get_string(key_file, "clients", "placement", NULL);
+	placement_virtual_nodes = g_key_file_get_integer(key_file, "clients", "placement-virtual-nodes", NULL);
+
+	if (g_key_file_has_key(key_file, "clients", "local-sockets", NULL))
+	{
+		local_sockets = g_key_file_get_boolean(key_file, "clients", "local-sockets", NULL);
+	}
+
 	servers_object = g_key_file_get_string_list(key_file, "servers", "object", NULL, NULL);
 	servers_kv = g_key_file_get_string_list(key_file, "servers", "kv", NULL, NULL);
 	servers_db = g_key_file_get_string_list(key_file, "servers", "db", NULL, NULL);
@@ -315,7 +379,10 @@ j_configuration_new_for_data(GKeyFile* key_file)
 	    || kv_path == NULL
 	    || db_backend == NULL
 	    || db_component == NULL
-	    || db_path == NULL)
+	    || db_path == NULL
+	    || hedge_percentile > 100
+	    || hedge_budget > 100
+	    || (placement != NULL && !j_placement_type_from_string(placement, &placement_type)))
 	{
 		g_free(db_backend);
 		g_free(db_component);
@@ -329,6 +396,8 @@ j_configuration_new_for_data(GKeyFile* key_file)
 		g_strfreev(servers_object);
 		g_strfreev(servers_kv);
 		g_strfreev(servers_db);
+		g_free(fabric_provider);
+		g_free(local_socket_directory);
 
 		return NULL;
 	}
@@ -352,6 +421,16 @@ j_configuration_new_for_data(GKeyFile* key_file)
 	configuration->max_operation_size = max_operation_size;
 	configuration->max_connections = max_connections;
 	configuration->stripe_size = stripe_size;
+	configuration->max_batch_operations = max_batch_operations;
+	configuration->max_batch_size = max_batch_size;
+	configuration->hedge_percentile = hedge_percentile;
+	configuration->hedge_budget = hedge_budget;
+	configuration->placement.object = j_placement_new(placement_type, configuration->servers.object_len, placement_virtual_nodes);
+	configuration->placement.kv = j_placement_new(placement_type, configuration->servers.kv_len, placement_virtual_nodes);
+	configuration->placement.db = j_placement_new(placement_type, configuration->servers.db_len, placement_virtual_nodes);
+	configuration->local_sockets = local_sockets;
+	configuration->local_socket_directory = local_socket_directory;
+	configuration->fabric_provider = fabric_provider;
 	configuration->ref_count = 1;
 
 	if (configuration->max_operation_size == 0)
@@ -369,6 +448,27 @@ j_configuration_new_for_data(GKeyFile* key_file)
 		configuration->stripe_size = 4 * 1024 * 1024;
 	}
 
+	if (configuration->max_batch_operations == 0)
+	{
+		configuration->max_batch_operations = 10000;
+	}
+
+	if (configuration->max_batch_size == 0)
+	{
+		configuration->max_batch_size = 64 * 1024 * 1024;
+	}
+
+	if (configuration->hedge_budget == 0)
+	{
+		configuration->hedge_budget = 5;
+	}
+
+	if (configuration->local_socket_directory == NULL)
+	{
+		// Do not use g_get_tmp_dir(), it depends on the environment of the client or server.
+		configuration->local_socket_directory = g_strdup("/tmp");
+	}
+
 	return configuration;
 }
 
@@ -431,6 +531,13 @@ j_configuration_unref(JConfiguration* configuration)
 		g_strfreev(configuration->servers.kv);
 		g_strfreev(configuration->servers.db);
 
+		j_placement_free(configuration->placement.object);
+		j_placement_free(configuration->placement.kv);
+		j_placement_free(configuration->placement.db);
+
+		g_free(configuration->fabric_provider);
+		g_free(configuration->local_socket_directory);
+
 		g_slice_free(JConfiguration, configuration);
 	}
 }
@@ -482,6 +589,36 @@ j_configuration_get_server_count(JConfiguration* configuration, JBackendType bac
 	return 0;
 }
 
+/**
+ * Returns the placement used to map keys to servers.
+ *
+ * \param configuration A configuration.
+ * \param backend       A backend type.
+ *
+ * \return A placement.
+ **/
+JPlacement*
+j_configuration_get_placement(JConfiguration* configuration, JBackendType backend)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(configuration != NULL, NULL);
+
+	switch (backend)
+	{
+		case J_BACKEND_TYPE_OBJECT:
+			return configuration->placement.object;
+		case J_BACKEND_TYPE_KV:
+			return configuration->placement.kv;
+		case J_BACKEND_TYPE_DB:
+			return configuration->placement.db;
+		default:
+			g_assert_not_reached();
+	}
+
+	return NULL;
+}
+
 gchar const*
 j_configuration_get_backend(JConfiguration* configuration, JBackendType backend)
 {
@@ -578,6 +715,76 @@ j_configuration_get_stripe_size(JConfiguration* configuration)
 	return configuration->stripe_size;
 }
 
+guint32
+j_configuration_get_max_batch_operations(JConfiguration* configuration)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->max_batch_operations;
+}
+
+guint64
+j_configuration_get_max_batch_size(JConfiguration* configuration)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->max_batch_size;
+}
+
+guint32
+j_configuration_get_hedge_percentile(JConfiguration* configuration)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->hedge_percentile;
+}
+
+guint32
+j_configuration_get_hedge_budget(JConfiguration* configuration)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->hedge_budget;
+}
+
+gboolean
+j_configuration_get_local_sockets(JConfiguration* configuration)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(configuration != NULL, FALSE);
+
+	return configuration->local_sockets;
+}
+
+gchar const*
+j_configuration_get_local_socket_directory(JConfiguration* configuration)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(configuration != NULL, NULL);
+
+	return configuration->local_socket_directory;
+}
+
+gchar const*
+j_configuration_get_fabric_provider(JConfiguration* configuration)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(configuration != NULL, NULL);
+
+	return configuration->fabric_provider;
+}
+
 /**
  * @}
  **/
@@ -26,10 +26,13 @@
 #include <glib-object.h>
 #include <gio/gio.h>
 
+#include <string.h>
+
 #include <jconnection-pool.h>
 #include <jconnection-pool-internal.h>
 
 #include <jbackend.h>
+#include <jfabric.h>
 #include <jhelper.h>
 #include <jhelper-internal.h>
 #include <jmessage.h>
@@ -43,10 +46,98 @@
  * @{
  **/
 
+/**
+ * The time in microseconds after which a connection's latency is considered outdated.
+ **/
+#define J_CONNECTION_POOL_LATENCY_AGE G_USEC_PER_SEC
+
+/**
+ * The number of buckets in a server's latency histogram.
+ * There are four buckets per power of two, the last one covers latencies of more than an hour.
+ **/
+#define J_CONNECTION_POOL_LATENCY_BUCKETS 128
+
+/**
+ * The number of latencies after which a server's latency histogram is aged by halving all buckets.
+ **/
+#define J_CONNECTION_POOL_LATENCY_SAMPLES 1024
+
+/**
+ * The number of latencies required before percentiles are reported.
+ **/
+#define J_CONNECTION_POOL_LATENCY_SAMPLES_MIN 16
+
+struct JConnectionPoolQueue;
+
+/**
+ * A pooled connection.
+ **/
+struct JConnectionPoolConnection
+{
+	/**
+	 * The connection.
+	 **/
+	GSocketConnection* connection;
+
+	/**
+	 * The queue the connection belongs to.
+	 **/
+	struct JConnectionPoolQueue* queue;
+
+	/**
+	 * The number of threads currently using the connection.
+	 **/
+	guint users;
+
+	/**
+	 * The moving average of the connection's round-trip latency in microseconds, 0 if unknown.
+	 **/
+	gint64 latency;
+
+	/**
+	 * The monotonic time #latency was last updated at.
+	 **/
+	gint64 latency_time;
+};
+
+typedef struct JConnectionPoolConnection JConnectionPoolConnection;
+
+/**
+ * The connections to a single server.
+ * Connections are multiplexed, that is, multiple threads can use the same connection concurrently.
+ **/
 struct JConnectionPoolQueue
 {
-	GAsyncQueue* queue;
+	/**
+	 * Protects the remaining members.
+	 **/
+	GMutex mutex;
+
+	/**
+	 * Signaled whenever a connection has been established.
+	 **/
+	GCond cond;
+
+	/**
+	 * The established connections.
+	 * Contains JConnectionPoolConnection elements.
+	 **/
+	GPtrArray* connections;
+
+	/**
+	 * The number of connections, including those currently being established.
+	 **/
 	guint count;
+
+	/**
+	 * The histogram of the server's recent round-trip latencies.
+	 **/
+	guint32 latencies[J_CONNECTION_POOL_LATENCY_BUCKETS];
+
+	/**
+	 * The number of latencies in #latencies.
+	 **/
+	guint32 latencies_count;
 };
 
 typedef struct JConnectionPoolQueue JConnectionPoolQueue;
@@ -64,12 +155,56 @@ struct JConnectionPool
 	guint kv_len;
 	guint db_len;
 	guint max_count;
+
+	/**
+	 * The fabric used for bulk data transfers, NULL if only sockets are used.
+	 **/
+	JFabric* fabric;
 };
 
 typedef struct JConnectionPool JConnectionPool;
 
 static JConnectionPool* j_connection_pool = NULL;
 
+static GQuark
+j_connection_pool_connection_quark(void)
+{
+	return g_quark_from_static_string("julea-connection-pool-connection");
+}
+
+static void
+j_connection_pool_queue_init(JConnectionPoolQueue* queue)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_mutex_init(&(queue->mutex));
+	g_cond_init(&(queue->cond));
+	queue->connections = g_ptr_array_new();
+	queue->count = 0;
+	memset(queue->latencies, 0, sizeof(queue->latencies));
+	queue->latencies_count = 0;
+}
+
+static void
+j_connection_pool_queue_fini(JConnectionPoolQueue* queue)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	for (guint i = 0; i < queue->connections->len; i++)
+	{
+		JConnectionPoolConnection* pool_connection = g_ptr_array_index(queue->connections, i);
+
+		g_io_stream_close(G_IO_STREAM(pool_connection->connection), NULL, NULL);
+		g_object_unref(pool_connection->connection);
+
+		g_slice_free(JConnectionPoolConnection, pool_connection);
+	}
+
+	g_ptr_array_free(queue->connections, TRUE);
+	g_cond_clear(&(queue->cond));
+	g_mutex_clear(&(queue->mutex));
+}
+
 void
 j_connection_pool_init(JConfiguration* configuration)
 {
@@ -88,23 +223,26 @@ j_connection_pool_init(JConfiguration* configuration)
 	pool->db_len = j_configuration_get_server_count(configuration, J_BACKEND_TYPE_DB);
 	pool->db_queues = g_new(JConnectionPoolQueue, pool->db_len);
 	pool->max_count = j_configuration_get_max_connections(configuration);
+	pool->fabric = NULL;
+
+	if (j_configuration_get_fabric_provider(configuration) != NULL)
+	{
+		pool->fabric = j_fabric_new(j_configuration_get_fabric_provider(configuration), NULL);
+	}
 
 	for (guint i = 0; i < pool->object_len; i++)
 	{
-		pool->object_queues[i].queue = g_async_queue_new();
-		pool->object_queues[i].count = 0;
+		j_connection_pool_queue_init(&(pool->object_queues[i]));
 	}
 
 	for (guint i = 0; i < pool->kv_len; i++)
 	{
-		pool->kv_queues[i].queue = g_async_queue_new();
-		pool->kv_queues[i].count = 0;
+		j_connection_pool_queue_init(&(pool->kv_queues[i]));
 	}
 
 	for (guint i = 0; i < pool->db_len; i++)
 	{
-		pool->db_queues[i].queue = g_async_queue_new();
-		pool->db_queues[i].count = 0;
+		j_connection_pool_queue_init(&(pool->db_queues[i]));
 	}
 
 	g_atomic_pointer_set(&j_connection_pool, pool);
@@ -124,41 +262,23 @@ j_connection_pool_fini(void)
 
 	for (guint i = 0; i < pool->object_len; i++)
 	{
-		GSocketConnection* connection;
-
-		while ((connection = g_async_queue_try_pop(pool->object_queues[i].queue)) != NULL)
-		{
-			g_io_stream_close(G_IO_STREAM(connection), NULL, NULL);
-			g_object_unref(connection);
-		}
-
-		g_async_queue_unref(pool->object_queues[i].queue);
+		j_connection_pool_queue_fini(&(pool->object_queues[i]));
 	}
 
 	for (guint i = 0; i < pool->kv_len; i++)
 	{
-		GSocketConnection* connection;
-
-		while ((connection = g_async_queue_try_pop(pool->kv_queues[i].queue)) != NULL)
-		{
-			g_io_stream_close(G_IO_STREAM(connection), NULL, NULL);
-			g_object_unref(connection);
-		}
-
-		g_async_queue_unref(pool->kv_queues[i].queue);
+		j_connection_pool_queue_fini(&(pool->kv_queues[i]));
 	}
 
 	for (guint i = 0; i < pool->db_len; i++)
 	{
-		GSocketConnection* connection;
-
-		while ((connection = g_async_queue_try_pop(pool->db_queues[i].queue)) != NULL)
-		{
-			g_io_stream_close(G_IO_STREAM(connection), NULL, NULL);
-			g_object_unref(connection);
-		}
+		j_connection_pool_queue_fini(&(pool->db_queues[i]));
+	}
 
-		g_async_queue_unref(pool->db_queues[i].queue);
+	// All fabric connections have been freed together with their socket connections.
+	if (pool->fabric != NULL)
+	{
+		j_fabric_free(pool->fabric);
 	}
 
 	j_configuration_unref(pool->configuration);
@@ -170,104 +290,385 @@ j_connection_pool_fini(void)
 	g_slice_free(JConnectionPool, pool);
 }
 
+/**
+ * Connects to a server on the local host using its local socket.
+ *
+ * \private
+ *
+ * \param client A socket client.
+ * \param server A server.
+ *
+ * \return A connection, NULL if the server is not on the local host or the connection failed.
+ **/
 static GSocketConnection*
-j_connection_pool_pop_internal(GAsyncQueue* queue, guint* count, gchar const* server)
+j_connection_pool_connect_local(GSocketClient* client, gchar const* server)
 {
 	J_TRACE_FUNCTION(NULL);
 
 	GSocketConnection* connection;
+	g_autoptr(GSocketConnectable) server_address = NULL;
+	g_autoptr(GSocketAddress) address = NULL;
+	g_autofree gchar* path = NULL;
 
-	g_return_val_if_fail(queue != NULL, NULL);
-	g_return_val_if_fail(count != NULL, NULL);
+	if (!j_configuration_get_local_sockets(j_connection_pool->configuration))
+	{
+		return NULL;
+	}
+
+	server_address = g_network_address_parse(server, 4711, NULL);
+
+	if (server_address == NULL || !j_helper_is_local_host(g_network_address_get_hostname(G_NETWORK_ADDRESS(server_address))))
+	{
+		return NULL;
+	}
+
+	path = j_helper_get_local_socket_path(j_configuration_get_local_socket_directory(j_connection_pool->configuration), g_network_address_get_port(G_NETWORK_ADDRESS(server_address)));
+	address = j_helper_local_socket_address_new(path);
+
+	if (address == NULL)
+	{
+		return NULL;
+	}
 
-	connection = g_async_queue_try_pop(queue);
+	// Older servers do not provide a local socket, fall back to TCP silently.
+	connection = g_socket_client_connect(client, G_SOCKET_CONNECTABLE(address), NULL, NULL);
 
 	if (connection != NULL)
 	{
-		return connection;
+		g_debug("Connected to %s using local socket %s.", server, path);
 	}
 
-	if ((guint)g_atomic_int_get(count) < j_connection_pool->max_count)
+	return connection;
+}
+
+/**
+ * Establishes an additional fabric connection to a server.
+ * The fabric connection is attached to the socket connection and used for bulk data transfers.
+ * Must only be called for servers that have announced a fabric, older servers do not answer the request.
+ * If the server cannot use the fabric after all, only the socket connection is used.
+ *
+ * \private
+ *
+ * \param connection A connection.
+ **/
+static void
+j_connection_pool_connect_fabric(GSocketConnection* connection)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JFabricConnection* fabric_connection;
+	g_autoptr(JMessage) message = NULL;
+	g_autoptr(JMessage) reply = NULL;
+	g_autoptr(JMessage) confirm = NULL;
+	g_autoptr(JMessage) confirm_reply = NULL;
+	gconstpointer address;
+	guint64 token;
+	guint32 format;
+	guint32 length;
+
+	message = j_message_new(J_MESSAGE_FABRIC, 0);
+	j_message_send(message, connection);
+
+	reply = j_message_new_reply(message);
+	j_message_receive(reply, connection);
+
+	if (j_message_get_count(reply) == 0)
+	{
+		return;
+	}
+
+	format = j_message_get_4(reply);
+	length = j_message_get_4(reply);
+	address = j_message_get_n(reply, length);
+	token = j_message_get_8(reply);
+
+	fabric_connection = j_fabric_connect(j_connection_pool->fabric, format, address, length, token);
+
+	if (fabric_connection == NULL)
+	{
+		return;
+	}
+
+	// The server only uses the fabric connection after it has been confirmed.
+	confirm = j_message_new(J_MESSAGE_FABRIC, sizeof(guint64));
+	j_message_add_operation(confirm, sizeof(guint64));
+	j_message_append_8(confirm, &token);
+	j_message_send(confirm, connection);
+
+	confirm_reply = j_message_new_reply(confirm);
+	j_message_receive(confirm_reply, connection);
+
+	if (j_message_get_count(confirm_reply) == 1 && j_message_get_1(confirm_reply))
+	{
+		j_fabric_connection_set(connection, fabric_connection);
+	}
+	else
+	{
+		j_fabric_connection_free(fabric_connection);
+	}
+}
+
+static GSocketConnection*
+j_connection_pool_connect(gchar const* server)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	GSocketConnection* connection;
+	GError* error = NULL;
+	g_autoptr(GSocketClient) client = NULL;
+
+	g_autoptr(JMessage) message = NULL;
+	g_autoptr(JMessage) reply = NULL;
+
+	guint op_count;
+	gboolean fabric = FALSE;
+
+	client = g_socket_client_new();
+	connection = j_connection_pool_connect_local(client, server);
+
+	if (connection == NULL)
+	{
+		connection = g_socket_client_connect_to_host(client, server, 4711, NULL, &error);
+	}
+
+	if (error != NULL)
 	{
-		if ((guint)g_atomic_int_add(count, 1) < j_connection_pool->max_count)
+		g_critical("%s", error->message);
+		g_error_free(error);
+	}
+
+	if (connection == NULL)
+	{
+		g_critical("Can not connect to %s.", server);
+		return NULL;
+	}
+
+	j_helper_set_nodelay(connection, TRUE);
+
+	message = j_message_new(J_MESSAGE_PING, 0);
+	j_message_send(message, connection);
+
+	reply = j_message_new_reply(message);
+	j_message_receive(reply, connection);
+
+	op_count = j_message_get_count(reply);
+
+	for (guint i = 0; i < op_count; i++)
+	{
+		gchar const* backend;
+
+		backend = j_message_get_string(reply);
+
+		if (g_strcmp0(backend, "object") == 0)
+		{
+			//g_print("Server has object backend.\n");
+		}
+		else if (g_strcmp0(backend, "kv") == 0)
 		{
-			GError* error = NULL;
-			g_autoptr(GSocketClient) client = NULL;
+			//g_print("Server has kv backend.\n");
+		}
+		else if (g_strcmp0(backend, "db") == 0)
+		{
+			//g_print("Server has db backend.\n");
+		}
+		else if (g_strcmp0(backend, "fabric") == 0)
+		{
+			fabric = TRUE;
+		}
+	}
 
-			g_autoptr(JMessage) message = NULL;
-			g_autoptr(JMessage) reply = NULL;
+	if (j_connection_pool->fabric != NULL && fabric)
+	{
+		j_connection_pool_connect_fabric(connection);
+	}
 
-			guint op_count;
+	j_message_multiplex_init(connection);
 
-			client = g_socket_client_new();
-			connection = g_socket_client_connect_to_host(client, server, 4711, NULL, &error);
+	return connection;
+}
 
-			if (error != NULL)
-			{
-				g_critical("%s", error->message);
-				g_error_free(error);
-			}
+static GSocketConnection*
+j_connection_pool_pop_internal(JConnectionPoolQueue* queue, gchar const* server)
+{
+	J_TRACE_FUNCTION(NULL);
 
-			if (connection == NULL)
-			{
-				g_critical("Can not connect to %s [%d].", server, g_atomic_int_get(count));
-			}
+	JConnectionPoolConnection* pool_connection;
+	GSocketConnection* connection = NULL;
 
-			j_helper_set_nodelay(connection, TRUE);
+	g_return_val_if_fail(queue != NULL, NULL);
 
-			message = j_message_new(J_MESSAGE_PING, 0);
-			j_message_send(message, connection);
+	g_mutex_lock(&(queue->mutex));
 
-			reply = j_message_new_reply(message);
-			j_message_receive(reply, connection);
+	while (TRUE)
+	{
+		JConnectionPoolConnection* least_used = NULL;
 
-			op_count = j_message_get_count(reply);
+		for (guint i = 0; i < queue->connections->len; i++)
+		{
+			JConnectionPoolConnection* current = g_ptr_array_index(queue->connections, i);
 
-			for (guint i = 0; i < op_count; i++)
+			if (least_used == NULL || current->users < least_used->users)
 			{
-				gchar const* backend;
-
-				backend = j_message_get_string(reply);
-
-				if (g_strcmp0(backend, "object") == 0)
-				{
-					//g_print("Server has object backend.\n");
-				}
-				else if (g_strcmp0(backend, "kv") == 0)
-				{
-					//g_print("Server has kv backend.\n");
-				}
-				else if (g_strcmp0(backend, "db") == 0)
-				{
-					//g_print("Server has db backend.\n");
-				}
+				least_used = current;
 			}
 		}
-		else
+
+		// Prefer idle connections, then establish new ones and finally share busy ones.
+		if (least_used != NULL && (least_used->users == 0 || queue->count >= j_connection_pool->max_count))
 		{
-			g_atomic_int_add(count, -1);
+			least_used->users++;
+			connection = least_used->connection;
+			break;
 		}
+
+		if (queue->count < j_connection_pool->max_count)
+		{
+			queue->count++;
+			break;
+		}
+
+		// All connections are still being established.
+		g_cond_wait(&(queue->cond), &(queue->mutex));
 	}
 
+	g_mutex_unlock(&(queue->mutex));
+
 	if (connection != NULL)
 	{
 		return connection;
 	}
 
-	connection = g_async_queue_pop(queue);
+	connection = j_connection_pool_connect(server);
+
+	g_mutex_lock(&(queue->mutex));
+
+	if (connection != NULL)
+	{
+		pool_connection = g_slice_new(JConnectionPoolConnection);
+		pool_connection->connection = connection;
+		pool_connection->queue = queue;
+		pool_connection->users = 1;
+		pool_connection->latency = 0;
+		pool_connection->latency_time = 0;
+
+		// Allows finding the pooled connection when recording latencies.
+		g_object_set_qdata(G_OBJECT(connection), j_connection_pool_connection_quark(), pool_connection);
+
+		g_ptr_array_add(queue->connections, pool_connection);
+	}
+	else
+	{
+		queue->count--;
+	}
+
+	g_cond_broadcast(&(queue->cond));
+	g_mutex_unlock(&(queue->mutex));
 
 	return connection;
 }
 
 static void
-j_connection_pool_push_internal(GAsyncQueue* queue, GSocketConnection* connection)
+j_connection_pool_push_internal(JConnectionPoolQueue* queue, GSocketConnection* connection)
 {
 	J_TRACE_FUNCTION(NULL);
 
 	g_return_if_fail(queue != NULL);
 	g_return_if_fail(connection != NULL);
 
-	g_async_queue_push(queue, connection);
+	g_mutex_lock(&(queue->mutex));
+
+	for (guint i = 0; i < queue->connections->len; i++)
+	{
+		JConnectionPoolConnection* pool_connection = g_ptr_array_index(queue->connections, i);
+
+		if (pool_connection->connection == connection)
+		{
+			pool_connection->users--;
+			break;
+		}
+	}
+
+	g_mutex_unlock(&(queue->mutex));
+}
+
+/**
+ * Returns the histogram bucket of a latency.
+ *
+ * \private
+ *
+ * \param latency A latency in microseconds.
+ *
+ * \return The bucket.
+ **/
+static guint
+j_connection_pool_latency_bucket(gint64 latency)
+{
+	guint octave;
+
+	latency = CLAMP(latency, 1, G_MAXUINT32);
+
+	if (latency < 4)
+	{
+		return latency;
+	}
+
+	octave = g_bit_storage(latency) - 1;
+
+	// Buckets 0 to 3 cover the latencies below 4, afterwards the two bits following the most significant one select the bucket.
+	return MIN((octave - 1) * 4 + ((latency >> (octave - 2)) & 3), J_CONNECTION_POOL_LATENCY_BUCKETS - 1);
+}
+
+/**
+ * Returns the lower bound of a histogram bucket.
+ *
+ * \private
+ *
+ * \param bucket A bucket.
+ *
+ * \return The lowest latency in the bucket.
+ **/
+static gint64
+j_connection_pool_latency_bucket_bound(guint bucket)
+{
+	if (bucket < 4)
+	{
+		return bucket;
+	}
+
+	return (gint64)(4 + bucket % 4) << (bucket / 4 - 1);
+}
+
+/**
+ * Returns the queue for a server.
+ *
+ * \private
+ *
+ * \param backend A backend type.
+ * \param index   A server index.
+ *
+ * \return The queue, NULL if the index is invalid.
+ **/
+static JConnectionPoolQueue*
+j_connection_pool_get_queue(JBackendType backend, guint index)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	switch (backend)
+	{
+		case J_BACKEND_TYPE_OBJECT:
+			g_return_val_if_fail(index < j_connection_pool->object_len, NULL);
+			return &(j_connection_pool->object_queues[index]);
+		case J_BACKEND_TYPE_KV:
+			g_return_val_if_fail(index < j_connection_pool->kv_len, NULL);
+			return &(j_connection_pool->kv_queues[index]);
+		case J_BACKEND_TYPE_DB:
+			g_return_val_if_fail(index < j_connection_pool->db_len, NULL);
+			return &(j_connection_pool->db_queues[index]);
+		default:
+			g_assert_not_reached();
+	}
+
+	return NULL;
 }
 
 gpointer
@@ -281,13 +682,13 @@ j_connection_pool_pop(JBackendType backend, guint index)
 	{
 		case J_BACKEND_TYPE_OBJECT:
 			g_return_val_if_fail(index < j_connection_pool->object_len, NULL);
-			return j_connection_pool_pop_internal(j_connection_pool->object_queues[index].queue, &(j_connection_pool->object_queues[index].count), j_configuration_get_server(j_connection_pool->configuration, J_BACKEND_TYPE_OBJECT, index));
+			return j_connection_pool_pop_internal(&(j_connection_pool->object_queues[index]), j_configuration_get_server(j_connection_pool->configuration, J_BACKEND_TYPE_OBJECT, index));
 		case J_BACKEND_TYPE_KV:
 			g_return_val_if_fail(index < j_connection_pool->kv_len, NULL);
-			return j_connection_pool_pop_internal(j_connection_pool->kv_queues[index].queue, &(j_connection_pool->kv_queues[index].count), j_configuration_get_server(j_connection_pool->configuration, J_BACKEND_TYPE_KV, index));
+			return j_connection_pool_pop_internal(&(j_connection_pool->kv_queues[index]), j_configuration_get_server(j_connection_pool->configuration, J_BACKEND_TYPE_KV, index));
 		case J_BACKEND_TYPE_DB:
 			g_return_val_if_fail(index < j_connection_pool->db_len, NULL);
-			return j_connection_pool_pop_internal(j_connection_pool->db_queues[index].queue, &(j_connection_pool->db_queues[index].count), j_configuration_get_server(j_connection_pool->configuration, J_BACKEND_TYPE_DB, index));
+			return j_connection_pool_pop_internal(&(j_connection_pool->db_queues[index]), j_configuration_get_server(j_connection_pool->configuration, J_BACKEND_TYPE_DB, index));
 		default:
 			g_assert_not_reached();
 	}
@@ -307,21 +708,291 @@ j_connection_pool_push(JBackendType backend, guint index, gpointer connection)
 	{
 		case J_BACKEND_TYPE_OBJECT:
 			g_return_if_fail(index < j_connection_pool->object_len);
-			j_connection_pool_push_internal(j_connection_pool->object_queues[index].queue, connection);
+			j_connection_pool_push_internal(&(j_connection_pool->object_queues[index]), connection);
 			break;
 		case J_BACKEND_TYPE_KV:
 			g_return_if_fail(index < j_connection_pool->kv_len);
-			j_connection_pool_push_internal(j_connection_pool->kv_queues[index].queue, connection);
+			j_connection_pool_push_internal(&(j_connection_pool->kv_queues[index]), connection);
 			break;
 		case J_BACKEND_TYPE_DB:
 			g_return_if_fail(index < j_connection_pool->db_len);
-			j_connection_pool_push_internal(j_connection_pool->db_queues[index].queue, connection);
+			j_connection_pool_push_internal(&(j_connection_pool->db_queues[index]), connection);
 			break;
 		default:
 			g_assert_not_reached();
 	}
 }
 
+/**
+ * Returns the load of a server as seen by this client.
+ * Can be used to choose between servers storing the same data.
+ *
+ * \code
+ * gint64 latency;
+ * guint queue_depth;
+ *
+ * j_connection_pool_get_load(J_BACKEND_TYPE_OBJECT, 0, &latency, &queue_depth);
+ * \endcode
+ *
+ * \param backend     A backend type.
+ * \param index       A server index.
+ * \param latency     Returns the average round-trip latency in microseconds, 0 if unknown or outdated.
+ * \param queue_depth Returns the number of operations currently using connections to the server.
+ **/
+void
+j_connection_pool_get_load(JBackendType backend, guint index, gint64* latency, guint* queue_depth)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JConnectionPoolQueue* queue;
+	gint64 now;
+	gint64 latency_sum = 0;
+	guint latency_count = 0;
+	guint users = 0;
+
+	g_return_if_fail(j_connection_pool != NULL);
+	g_return_if_fail(latency != NULL);
+	g_return_if_fail(queue_depth != NULL);
+
+	*latency = 0;
+	*queue_depth = 0;
+
+	queue = j_connection_pool_get_queue(backend, index);
+	g_return_if_fail(queue != NULL);
+
+	now = g_get_monotonic_time();
+
+	g_mutex_lock(&(queue->mutex));
+
+	for (guint i = 0; i < queue->connections->len; i++)
+	{
+		JConnectionPoolConnection* pool_connection = g_ptr_array_index(queue->connections, i);
+
+		// Old latencies are ignored, so that servers that have been avoided because they were slow are tried again.
+		if (pool_connection->latency > 0 && now - pool_connection->latency_time < J_CONNECTION_POOL_LATENCY_AGE)
+		{
+			latency_sum += pool_connection->latency;
+			latency_count++;
+		}
+
+		users += pool_connection->users;
+	}
+
+	// Connections that are still being established are also waited for.
+	users += queue->count - queue->connections->len;
+
+	g_mutex_unlock(&(queue->mutex));
+
+	if (latency_count > 0)
+	{
+		*latency = latency_sum / latency_count;
+	}
+
+	*queue_depth = users;
+}
+
+/**
+ * Returns a percentile of a server's recent round-trip latencies as seen by this client.
+ * Can be used to decide when a request is taking unusually long.
+ *
+ * \code
+ * gint64 p95;
+ *
+ * p95 = j_connection_pool_get_latency_percentile(J_BACKEND_TYPE_OBJECT, 0, 95);
+ * \endcode
+ *
+ * \param backend    A backend type.
+ * \param index      A server index.
+ * \param percentile A percentile between 1 and 100.
+ *
+ * \return The latency in microseconds, 0 if not enough latencies are known.
+ **/
+gint64
+j_connection_pool_get_latency_percentile(JBackendType backend, guint index, guint percentile)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JConnectionPoolQueue* queue;
+	gint64 latency = 0;
+	guint64 rank;
+	guint64 seen = 0;
+
+	g_return_val_if_fail(j_connection_pool != NULL, 0);
+	g_return_val_if_fail(percentile > 0 && percentile <= 100, 0);
+
+	queue = j_connection_pool_get_queue(backend, index);
+	g_return_val_if_fail(queue != NULL, 0);
+
+	g_mutex_lock(&(queue->mutex));
+
+	if (queue->latencies_count < J_CONNECTION_POOL_LATENCY_SAMPLES_MIN)
+	{
+		goto end;
+	}
+
+	rank = ((guint64)queue->latencies_count * percentile + 99) / 100;
+
+	for (guint i = 0; i < J_CONNECTION_POOL_LATENCY_BUCKETS; i++)
+	{
+		gint64 lower;
+		gint64 upper;
+
+		if (seen + queue->latencies[i] < rank)
+		{
+			seen += queue->latencies[i];
+			continue;
+		}
+
+		lower = j_connection_pool_latency_bucket_bound(i);
+		upper = j_connection_pool_latency_bucket_bound(i + 1);
+
+		// Interpolate linearly within the bucket.
+		latency = lower + (upper - lower) * (gint64)(rank - seen) / queue->latencies[i];
+		break;
+	}
+
+end:
+	g_mutex_unlock(&(queue->mutex));
+
+	return latency;
+}
+
+/**
+ * Closes a connection instead of returning it to the pool.
+ * All outstanding requests on the connection are abandoned, which allows cancelling them.
+ *
+ * This is only possible if no other thread is using the connection at the same time.
+ *
+ * \code
+ * gpointer connection;
+ *
+ * connection = j_connection_pool_pop(J_BACKEND_TYPE_OBJECT, 0);
+ * ...
+ * if (!j_connection_pool_discard(J_BACKEND_TYPE_OBJECT, 0, connection))
+ * {
+ *   // Wait for the outstanding replies.
+ *   ...
+ *   j_connection_pool_push(J_BACKEND_TYPE_OBJECT, 0, connection);
+ * }
+ * \endcode
+ *
+ * \param backend    A backend type.
+ * \param index      A server index.
+ * \param connection A connection.
+ *
+ * \return TRUE if the connection has been closed, FALSE if it is shared with other threads and has been left untouched.
+ **/
+gboolean
+j_connection_pool_discard(JBackendType backend, guint index, gpointer connection)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JConnectionPoolQueue* queue;
+	JConnectionPoolConnection* pool_connection = NULL;
+
+	g_return_val_if_fail(j_connection_pool != NULL, FALSE);
+	g_return_val_if_fail(connection != NULL, FALSE);
+
+	queue = j_connection_pool_get_queue(backend, index);
+	g_return_val_if_fail(queue != NULL, FALSE);
+
+	g_mutex_lock(&(queue->mutex));
+
+	for (guint i = 0; i < queue->connections->len; i++)
+	{
+		JConnectionPoolConnection* current = g_ptr_array_index(queue->connections, i);
+
+		if (current->connection != connection)
+		{
+			continue;
+		}
+
+		// Other threads might be waiting for their own replies on this connection.
+		if (current->users == 1)
+		{
+			pool_connection = current;
+			g_ptr_array_remove_index_fast(queue->connections, i);
+			queue->count--;
+		}
+
+		break;
+	}
+
+	if (pool_connection != NULL)
+	{
+		// Allows waiting threads to establish a new connection.
+		g_cond_broadcast(&(queue->cond));
+	}
+
+	g_mutex_unlock(&(queue->mutex));
+
+	if (pool_connection == NULL)
+	{
+		return FALSE;
+	}
+
+	g_object_set_qdata(G_OBJECT(pool_connection->connection), j_connection_pool_connection_quark(), NULL);
+	g_io_stream_close(G_IO_STREAM(pool_connection->connection), NULL, NULL);
+	g_object_unref(pool_connection->connection);
+
+	g_slice_free(JConnectionPoolConnection, pool_connection);
+
+	return TRUE;
+}
+
+/* Internal */
+
+void
+j_connection_pool_add_latency(gpointer connection, gint64 latency)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JConnectionPoolConnection* pool_connection;
+
+	g_return_if_fail(connection != NULL);
+
+	pool_connection = g_object_get_qdata(G_OBJECT(connection), j_connection_pool_connection_quark());
+
+	// The connection is not managed by the pool.
+	if (pool_connection == NULL)
+	{
+		return;
+	}
+
+	latency = MAX(latency, 1);
+
+	g_mutex_lock(&(pool_connection->queue->mutex));
+
+	// Exponentially weighted moving average, recent latencies are weighted by 1/8.
+	if (pool_connection->latency == 0)
+	{
+		pool_connection->latency = latency;
+	}
+	else
+	{
+		pool_connection->latency += (latency - pool_connection->latency) / 8;
+	}
+
+	pool_connection->latency_time = g_get_monotonic_time();
+
+	pool_connection->queue->latencies[j_connection_pool_latency_bucket(latency)]++;
+	pool_connection->queue->latencies_count++;
+
+	// Halve all buckets regularly, so that the histogram follows changes of the server's latency.
+	if (pool_connection->queue->latencies_count >= J_CONNECTION_POOL_LATENCY_SAMPLES)
+	{
+		pool_connection->queue->latencies_count = 0;
+
+		for (guint i = 0; i < J_CONNECTION_POOL_LATENCY_BUCKETS; i++)
+		{
+			pool_connection->queue->latencies[i] /= 2;
+			pool_connection->queue->latencies_count += pool_connection->queue->latencies[i];
+		}
+	}
+
+	g_mutex_unlock(&(pool_connection->queue->mutex));
+}
+
 /**
  * @}
  **/
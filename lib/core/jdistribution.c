@@ -64,7 +64,7 @@ struct JDistribution
 	guint ref_count;
 };
 
-static JDistributionVTable j_distribution_vtables[3];
+static JDistributionVTable j_distribution_vtables[5];
 
 static JDistribution*
 j_distribution_new_common(JDistributionType type, JConfiguration* configuration)
@@ -232,6 +232,9 @@ j_distribution_check_vtables(void)
 
 		g_return_if_fail(j_distribution_vtables[i].distribution_reset != NULL);
 		g_return_if_fail(j_distribution_vtables[i].distribution_distribute != NULL);
+
+		g_return_if_fail(j_distribution_vtables[i].distribution_uses_server != NULL);
+		g_return_if_fail(j_distribution_vtables[i].distribution_get_size != NULL);
 	}
 }
 
@@ -243,6 +246,8 @@ j_distribution_init(void)
 	j_distribution_round_robin_get_vtable(&(j_distribution_vtables[J_DISTRIBUTION_ROUND_ROBIN]));
 	j_distribution_single_server_get_vtable(&(j_distribution_vtables[J_DISTRIBUTION_SINGLE_SERVER]));
 	j_distribution_weighted_get_vtable(&(j_distribution_vtables[J_DISTRIBUTION_WEIGHTED]));
+	j_distribution_erasure_get_vtable(&(j_distribution_vtables[J_DISTRIBUTION_ERASURE]));
+	j_distribution_replicated_get_vtable(&(j_distribution_vtables[J_DISTRIBUTION_REPLICATED]));
 
 	j_distribution_check_vtables();
 }
@@ -417,6 +422,180 @@ j_distribution_distribute(JDistribution* distribution, guint* index, guint64* ne
 	return j_distribution_vtables[distribution->type].distribution_distribute(distribution->distribution, index, new_length, new_offset, block_id);
 }
 
+/**
+ * Checks whether a server can hold data of an object using the distribution.
+ * Servers that cannot hold data do not have to be contacted, for example, to query an object's status.
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param index        A server index.
+ *
+ * \return TRUE if the server can hold data, FALSE otherwise.
+ **/
+gboolean
+j_distribution_uses_server(JDistribution* distribution, guint index)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(distribution != NULL, FALSE);
+
+	return j_distribution_vtables[distribution->type].distribution_uses_server(distribution->distribution, index);
+}
+
+/**
+ * Calculates an object's size based on the size of the data stored on a single server.
+ * The object's actual size is the maximum of the sizes calculated for all servers.
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param index        A server index.
+ * \param local_size   The size of the data stored on the server.
+ *
+ * \return The offset following the last byte stored on the server.
+ **/
+guint64
+j_distribution_get_size(JDistribution* distribution, guint index, guint64 local_size)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(distribution != NULL, 0);
+
+	return j_distribution_vtables[distribution->type].distribution_get_size(distribution->distribution, index, local_size);
+}
+
+/**
+ * Returns the parameters of a distribution's erasure code.
+ * Erasure-coded distributions store each stripe of data blocks together with parity blocks computed using j_reed_solomon_encode().
+ *
+ * \code
+ * guint data_blocks;
+ * guint parity_blocks;
+ * guint64 block_size;
+ *
+ * if (j_distribution_get_erasure_code(distribution, &data_blocks, &parity_blocks, &block_size))
+ * {
+ *   ...
+ * }
+ * \endcode
+ *
+ * \param distribution  A distribution.
+ * \param data_blocks   Returns the number of data blocks per stripe.
+ * \param parity_blocks Returns the number of parity blocks per stripe.
+ * \param block_size    Returns the block size.
+ *
+ * \return TRUE if the distribution uses an erasure code, FALSE otherwise.
+ **/
+gboolean
+j_distribution_get_erasure_code(JDistribution* distribution, guint* data_blocks, guint* parity_blocks, guint64* block_size)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(distribution != NULL, FALSE);
+	g_return_val_if_fail(data_blocks != NULL, FALSE);
+	g_return_val_if_fail(parity_blocks != NULL, FALSE);
+	g_return_val_if_fail(block_size != NULL, FALSE);
+
+	if (j_distribution_vtables[distribution->type].distribution_get_erasure_code == NULL)
+	{
+		return FALSE;
+	}
+
+	return j_distribution_vtables[distribution->type].distribution_get_erasure_code(distribution->distribution, data_blocks, parity_blocks, block_size);
+}
+
+/**
+ * Returns the server storing a block of every stripe.
+ * Stripe s is stored at offset s × block size on each of its servers.
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution using an erasure code.
+ * \param block        A block within the stripe, data blocks are followed by parity blocks.
+ *
+ * \return A server index.
+ **/
+guint
+j_distribution_get_erasure_server(JDistribution* distribution, guint block)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(distribution != NULL, 0);
+	g_return_val_if_fail(j_distribution_vtables[distribution->type].distribution_get_erasure_server != NULL, 0);
+
+	return j_distribution_vtables[distribution->type].distribution_get_erasure_server(distribution->distribution, block);
+}
+
+/**
+ * Returns the number of copies a distribution stores of each block.
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ *
+ * \return The number of replicas, 1 if the distribution does not replicate data.
+ **/
+guint
+j_distribution_get_replica_count(JDistribution* distribution)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(distribution != NULL, 1);
+
+	if (j_distribution_vtables[distribution->type].distribution_get_replica_count == NULL)
+	{
+		return 1;
+	}
+
+	return j_distribution_vtables[distribution->type].distribution_get_replica_count(distribution->distribution);
+}
+
+/**
+ * Returns where a replica of distributed data is stored.
+ * Replica 0 is the location returned by j_distribution_distribute().
+ *
+ * \code
+ * guint replica_index;
+ * guint64 replica_offset;
+ *
+ * for (guint i = 0; i < j_distribution_get_replica_count(distribution); i++)
+ * {
+ *   j_distribution_get_replica(distribution, i, index, offset, &replica_index, &replica_offset);
+ * }
+ * \endcode
+ *
+ * \param distribution   A distribution.
+ * \param replica        A replica, smaller than j_distribution_get_replica_count().
+ * \param index          A server index returned by j_distribution_distribute().
+ * \param offset         An offset returned by j_distribution_distribute().
+ * \param replica_index  Returns the replica's server index.
+ * \param replica_offset Returns the replica's offset.
+ **/
+void
+j_distribution_get_replica(JDistribution* distribution, guint replica, guint index, guint64 offset, guint* replica_index, guint64* replica_offset)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_if_fail(distribution != NULL);
+	g_return_if_fail(replica < j_distribution_get_replica_count(distribution));
+	g_return_if_fail(replica_index != NULL);
+	g_return_if_fail(replica_offset != NULL);
+
+	if (j_distribution_vtables[distribution->type].distribution_get_replica == NULL)
+	{
+		*replica_index = index;
+		*replica_offset = offset;
+		return;
+	}
+
+	j_distribution_vtables[distribution->type].distribution_get_replica(distribution->distribution, replica, index, offset, replica_index, replica_offset);
+}
+
 /**
  * @}
  **/
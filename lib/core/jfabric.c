@@ -0,0 +1,1294 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2020 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_LIBFABRIC
+#include <rdma/fabric.h>
+#include <rdma/fi_cm.h>
+#include <rdma/fi_domain.h>
+#include <rdma/fi_endpoint.h>
+#include <rdma/fi_eq.h>
+#include <rdma/fi_errno.h>
+#include <rdma/fi_rma.h>
+#endif
+
+#include <jfabric.h>
+
+#include <jtrace.h>
+
+/**
+ * \defgroup JFabric Fabric
+ *
+ * Data structures and functions for transferring data using libfabric.
+ *
+ * Clients and servers still exchange all messages using their socket connections.
+ * If both sides support libfabric, an additional fabric connection is attached to the socket connection.
+ * It is used to transfer bulk data using remote memory access (RMA) without copying it through the socket.
+ * Clients only register their buffers, all RMA operations are initiated by the server.
+ * To avoid registering memory for every operation, clients stage small transfers through a pool of registered bounce buffers.
+ *
+ * @{
+ **/
+
+#ifdef HAVE_LIBFABRIC
+#define J_FABRIC_VERSION FI_VERSION(1, 5)
+#endif
+
+/**
+ * The size of a bounce buffer.
+ * Larger transfers register the caller's memory, which amortizes the cost of the registration.
+ **/
+#define J_FABRIC_BOUNCE_SIZE (1024 * 1024)
+
+/**
+ * The maximum number of bounce buffers per fabric.
+ * If all of them are in use, the caller's memory is registered instead.
+ **/
+#define J_FABRIC_BOUNCE_COUNT 64
+
+/**
+ * A fabric domain.
+ **/
+struct JFabric
+{
+#ifdef HAVE_LIBFABRIC
+	struct fi_info* info;
+	struct fid_fabric* fabric;
+	struct fid_domain* domain;
+
+	/**
+	 * The event queue and passive endpoint of a listening fabric, NULL otherwise.
+	 **/
+	struct fid_eq* eq;
+	struct fid_pep* pep;
+
+	/**
+	 * Protects the connections and the bounce buffers.
+	 **/
+	GMutex mutex;
+
+	/**
+	 * The connections created by j_fabric_wait_request().
+	 **/
+	GHashTable* connections;
+
+	/**
+	 * The unused bounce buffers.
+	 * Contains #JFabricMemory elements.
+	 **/
+	GQueue bounce;
+
+	/**
+	 * The number of bounce buffers that have been allocated.
+	 **/
+	guint bounce_count;
+#endif
+};
+
+/**
+ * A fabric connection.
+ **/
+struct JFabricConnection
+{
+	JFabric* fabric;
+
+#ifdef HAVE_LIBFABRIC
+	struct fid_ep* ep;
+	struct fid_cq* cq;
+
+	/**
+	 * The connection's own event queue, NULL if the fabric's event queue is used.
+	 **/
+	struct fid_eq* eq;
+
+	/**
+	 * The maximum size of a single RMA operation.
+	 **/
+	guint64 max_size;
+#endif
+
+	GMutex mutex;
+	GCond cond;
+
+	gboolean connected;
+	gboolean closed;
+};
+
+/**
+ * A registered memory region.
+ **/
+struct JFabricMemory
+{
+#ifdef HAVE_LIBFABRIC
+	struct fid_mr* mr;
+#endif
+
+	gpointer data;
+	guint64 address;
+
+	/**
+	 * The fabric a bounce buffer belongs to, NULL if the memory has been registered directly.
+	 **/
+	JFabric* fabric;
+
+	/**
+	 * The caller's memory staged through a bounce buffer.
+	 **/
+	gpointer source;
+};
+
+static GQuark
+j_fabric_connection_quark(void)
+{
+	return g_quark_from_static_string("julea-fabric-connection");
+}
+
+#ifdef HAVE_LIBFABRIC
+static struct fi_info*
+j_fabric_hints_new(gchar const* provider)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	struct fi_info* hints;
+
+	hints = fi_allocinfo();
+
+	if (hints == NULL)
+	{
+		return NULL;
+	}
+
+	hints->caps = FI_MSG | FI_RMA;
+	hints->mode = FI_CONTEXT;
+	hints->ep_attr->type = FI_EP_MSG;
+	hints->domain_attr->mr_mode = FI_MR_LOCAL | FI_MR_VIRT_ADDR | FI_MR_ALLOCATED | FI_MR_PROV_KEY;
+
+	// fi_freeinfo() uses free(), so we have to use the system allocator.
+	if (provider != NULL)
+	{
+		hints->fabric_attr->prov_name = strdup(provider);
+	}
+
+	return hints;
+}
+
+static JFabricConnection*
+j_fabric_connection_new(JFabric* fabric, struct fi_info* info, struct fid_eq* eq)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JFabricConnection* connection;
+	struct fi_cq_attr cq_attr = { 0 };
+	gint ret;
+
+	connection = g_slice_new0(JFabricConnection);
+	connection->fabric = fabric;
+	connection->max_size = info->ep_attr->max_msg_size;
+	g_mutex_init(&(connection->mutex));
+	g_cond_init(&(connection->cond));
+
+	cq_attr.format = FI_CQ_FORMAT_CONTEXT;
+	cq_attr.wait_obj = FI_WAIT_UNSPEC;
+
+	if ((ret = fi_cq_open(fabric->domain, &cq_attr, &(connection->cq), NULL)) != 0
+	    || (ret = fi_endpoint(fabric->domain, info, &(connection->ep), connection)) != 0
+	    || (ret = fi_ep_bind(connection->ep, &(eq->fid), 0)) != 0
+	    || (ret = fi_ep_bind(connection->ep, &(connection->cq->fid), FI_TRANSMIT | FI_RECV)) != 0
+	    || (ret = fi_enable(connection->ep)) != 0)
+	{
+		g_warning("Could not create fabric endpoint: %s", fi_strerror(-ret));
+		j_fabric_connection_free(connection);
+
+		return NULL;
+	}
+
+	return connection;
+}
+
+static gboolean
+j_fabric_connection_complete(JFabricConnection* connection, struct fi_context* context)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	struct fi_cq_entry entry;
+	gssize ret;
+
+	while (TRUE)
+	{
+		ret = fi_cq_sread(connection->cq, &entry, 1, NULL, -1);
+
+		if (ret == -FI_EAGAIN)
+		{
+			continue;
+		}
+
+		if (ret == -FI_EAVAIL)
+		{
+			struct fi_cq_err_entry error = { 0 };
+
+			fi_cq_readerr(connection->cq, &error, 0);
+			g_warning("Fabric operation failed: %s", fi_strerror(error.err));
+
+			return FALSE;
+		}
+
+		if (ret < 0)
+		{
+			g_warning("Could not wait for fabric operation: %s", fi_strerror(-ret));
+
+			return FALSE;
+		}
+
+		// Operations are synchronous, so there can not be any other completions.
+		g_warn_if_fail(entry.op_context == context);
+
+		return TRUE;
+	}
+}
+
+static gboolean
+j_fabric_connection_rma(JFabricConnection* connection, JFabricMemory* memory, guint64 length, guint64 address, guint64 key, gboolean write)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	guint64 done = 0;
+
+	while (done < length)
+	{
+		struct fi_context context;
+		guint64 size;
+		gssize ret;
+
+		size = MIN(length - done, connection->max_size);
+
+		do
+		{
+			if (write)
+			{
+				ret = fi_write(connection->ep, (gchar*)memory->data + done, size, fi_mr_desc(memory->mr), 0, address + done, key, &context);
+			}
+			else
+			{
+				ret = fi_read(connection->ep, (gchar*)memory->data + done, size, fi_mr_desc(memory->mr), 0, address + done, key, &context);
+			}
+		} while (ret == -FI_EAGAIN);
+
+		if (ret != 0)
+		{
+			g_warning("Could not start fabric operation: %s", fi_strerror(-ret));
+
+			return FALSE;
+		}
+
+		if (!j_fabric_connection_complete(connection, &context))
+		{
+			return FALSE;
+		}
+
+		done += size;
+	}
+
+	return TRUE;
+}
+#endif
+
+/**
+ * Returns whether JULEA has been built with libfabric support.
+ *
+ * \return TRUE if libfabric is supported, FALSE otherwise.
+ **/
+gboolean
+j_fabric_is_supported(void)
+{
+#ifdef HAVE_LIBFABRIC
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
+/**
+ * Opens a fabric domain.
+ *
+ * \code
+ * JFabric* fabric;
+ *
+ * fabric = j_fabric_new("sockets", NULL);
+ * \endcode
+ *
+ * \param provider The libfabric provider, NULL to let libfabric choose.
+ * \param node     The node to listen on, NULL if the fabric will only be used to connect to others.
+ *
+ * \return A new fabric that should be freed with j_fabric_free(), NULL if an error occurred.
+ **/
+JFabric*
+j_fabric_new(gchar const* provider, gchar const* node)
+{
+	J_TRACE_FUNCTION(NULL);
+
+#ifdef HAVE_LIBFABRIC
+	JFabric* fabric;
+	struct fi_info* hints;
+	gint ret;
+
+	hints = j_fabric_hints_new(provider);
+
+	if (hints == NULL)
+	{
+		return NULL;
+	}
+
+	fabric = g_slice_new0(JFabric);
+	g_mutex_init(&(fabric->mutex));
+	fabric->connections = g_hash_table_new(NULL, NULL);
+	g_queue_init(&(fabric->bounce));
+
+	ret = fi_getinfo(J_FABRIC_VERSION, node, NULL, (node != NULL) ? FI_SOURCE : 0, hints, &(fabric->info));
+	fi_freeinfo(hints);
+
+	if (ret != 0)
+	{
+		g_warning("Could not find fabric provider %s: %s", (provider != NULL) ? provider : "(any)", fi_strerror(-ret));
+		j_fabric_free(fabric);
+
+		return NULL;
+	}
+
+	if ((ret = fi_fabric(fabric->info->fabric_attr, &(fabric->fabric), NULL)) != 0
+	    || (ret = fi_domain(fabric->fabric, fabric->info, &(fabric->domain), NULL)) != 0)
+	{
+		g_warning("Could not open fabric domain: %s", fi_strerror(-ret));
+		j_fabric_free(fabric);
+
+		return NULL;
+	}
+
+	if (node != NULL)
+	{
+		struct fi_eq_attr eq_attr = { 0 };
+
+		eq_attr.wait_obj = FI_WAIT_UNSPEC;
+		eq_attr.flags = FI_WRITE;
+
+		if ((ret = fi_eq_open(fabric->fabric, &eq_attr, &(fabric->eq), NULL)) != 0
+		    || (ret = fi_passive_ep(fabric->fabric, fabric->info, &(fabric->pep), NULL)) != 0
+		    || (ret = fi_pep_bind(fabric->pep, &(fabric->eq->fid), 0)) != 0
+		    || (ret = fi_listen(fabric->pep)) != 0)
+		{
+			g_warning("Could not listen on fabric: %s", fi_strerror(-ret));
+			j_fabric_free(fabric);
+
+			return NULL;
+		}
+	}
+
+	g_debug("Using fabric provider %s.", fabric->info->fabric_attr->prov_name);
+
+	return fabric;
+#else
+	(void)provider;
+	(void)node;
+
+	g_warning("JULEA has been built without libfabric support.");
+
+	return NULL;
+#endif
+}
+
+/**
+ * Frees a fabric.
+ * All connections have to be freed and all memory regions have to be released before.
+ *
+ * \param fabric A fabric.
+ **/
+void
+j_fabric_free(JFabric* fabric)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_if_fail(fabric != NULL);
+
+#ifdef HAVE_LIBFABRIC
+	{
+		JFabricMemory* memory;
+
+		while ((memory = g_queue_pop_head(&(fabric->bounce))) != NULL)
+		{
+			gpointer data = memory->data;
+
+			j_fabric_memory_deregister(memory);
+			g_free(data);
+		}
+	}
+
+	if (fabric->pep != NULL)
+	{
+		fi_close(&(fabric->pep->fid));
+	}
+
+	if (fabric->eq != NULL)
+	{
+		fi_close(&(fabric->eq->fid));
+	}
+
+	if (fabric->domain != NULL)
+	{
+		fi_close(&(fabric->domain->fid));
+	}
+
+	if (fabric->fabric != NULL)
+	{
+		fi_close(&(fabric->fabric->fid));
+	}
+
+	if (fabric->info != NULL)
+	{
+		fi_freeinfo(fabric->info);
+	}
+
+	g_hash_table_unref(fabric->connections);
+	g_mutex_clear(&(fabric->mutex));
+#endif
+
+	g_slice_free(JFabric, fabric);
+}
+
+/**
+ * Returns the address a listening fabric can be connected to.
+ *
+ * \param fabric  A fabric.
+ * \param format  Returns the address format.
+ * \param address Returns the address, should be freed with g_free().
+ * \param length  Returns the address length.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+j_fabric_get_address(JFabric* fabric, guint32* format, gpointer* address, gsize* length)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(fabric != NULL, FALSE);
+	g_return_val_if_fail(format != NULL, FALSE);
+	g_return_val_if_fail(address != NULL, FALSE);
+	g_return_val_if_fail(length != NULL, FALSE);
+
+#ifdef HAVE_LIBFABRIC
+	{
+		size_t size = 0;
+		gint ret;
+
+		g_return_val_if_fail(fabric->pep != NULL, FALSE);
+
+		// The first call only determines the address length.
+		fi_getname(&(fabric->pep->fid), NULL, &size);
+
+		*address = g_malloc0(size);
+		ret = fi_getname(&(fabric->pep->fid), *address, &size);
+
+		if (ret != 0)
+		{
+			g_warning("Could not get fabric address: %s", fi_strerror(-ret));
+			g_free(*address);
+			*address = NULL;
+
+			return FALSE;
+		}
+
+		*format = fabric->info->addr_format;
+		*length = size;
+	}
+
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
+/**
+ * Waits for a connection request on a listening fabric.
+ * Other connection events are handled internally.
+ *
+ * \param fabric A fabric.
+ * \param token  Returns the token sent by the client.
+ *
+ * \return A new connection that has to be accepted with j_fabric_connection_accept(), NULL if the fabric has been interrupted using j_fabric_interrupt().
+ **/
+JFabricConnection*
+j_fabric_wait_request(JFabric* fabric, guint64* token)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(fabric != NULL, NULL);
+	g_return_val_if_fail(token != NULL, NULL);
+
+#ifdef HAVE_LIBFABRIC
+	g_return_val_if_fail(fabric->eq != NULL, NULL);
+
+	while (TRUE)
+	{
+		JFabricConnection* connection;
+		// The connection request is followed by the token.
+		union
+		{
+			struct fi_eq_cm_entry entry;
+			guint8 data[sizeof(struct fi_eq_cm_entry) + sizeof(guint64)];
+		} event_data;
+		guint32 event;
+		gssize ret;
+
+		memset(&event_data, 0, sizeof(event_data));
+
+		ret = fi_eq_sread(fabric->eq, &event, &event_data, sizeof(event_data), -1, 0);
+
+		if (ret == -FI_EAGAIN)
+		{
+			continue;
+		}
+
+		if (ret == -FI_EAVAIL)
+		{
+			struct fi_eq_err_entry error = { 0 };
+
+			fi_eq_readerr(fabric->eq, &error, 0);
+			g_debug("Fabric connection failed: %s", fi_strerror(error.err));
+
+			g_mutex_lock(&(fabric->mutex));
+
+			connection = (error.fid != NULL) ? error.fid->context : NULL;
+
+			// Errors can also be reported for the passive endpoint, which does not have a connection.
+			if (connection != NULL && g_hash_table_contains(fabric->connections, connection))
+			{
+				g_mutex_lock(&(connection->mutex));
+				connection->closed = TRUE;
+				g_cond_broadcast(&(connection->cond));
+				g_mutex_unlock(&(connection->mutex));
+			}
+
+			g_mutex_unlock(&(fabric->mutex));
+
+			continue;
+		}
+
+		if (ret < 0)
+		{
+			g_warning("Could not wait for fabric events: %s", fi_strerror(-ret));
+
+			return NULL;
+		}
+
+		switch (event)
+		{
+			case FI_CONNREQ:
+				if ((gsize)ret < sizeof(event_data))
+				{
+					g_debug("Rejecting fabric connection without token.");
+					fi_reject(fabric->pep, event_data.entry.info->handle, NULL, 0);
+					fi_freeinfo(event_data.entry.info);
+					break;
+				}
+
+				connection = j_fabric_connection_new(fabric, event_data.entry.info, fabric->eq);
+				fi_freeinfo(event_data.entry.info);
+
+				if (connection != NULL)
+				{
+					g_mutex_lock(&(fabric->mutex));
+					g_hash_table_add(fabric->connections, connection);
+					g_mutex_unlock(&(fabric->mutex));
+
+					memcpy(token, event_data.entry.data, sizeof(guint64));
+
+					return connection;
+				}
+
+				break;
+			case FI_CONNECTED:
+			case FI_SHUTDOWN:
+				g_mutex_lock(&(fabric->mutex));
+
+				connection = event_data.entry.fid->context;
+
+				// The connection might have been freed already.
+				if (g_hash_table_contains(fabric->connections, connection))
+				{
+					g_mutex_lock(&(connection->mutex));
+
+					if (event == FI_CONNECTED)
+					{
+						connection->connected = TRUE;
+					}
+					else
+					{
+						connection->closed = TRUE;
+					}
+
+					g_cond_broadcast(&(connection->cond));
+					g_mutex_unlock(&(connection->mutex));
+				}
+
+				g_mutex_unlock(&(fabric->mutex));
+
+				break;
+			case FI_NOTIFY:
+				return NULL;
+			default:
+				break;
+		}
+	}
+#else
+	return NULL;
+#endif
+}
+
+/**
+ * Interrupts j_fabric_wait_request().
+ *
+ * \param fabric A fabric.
+ **/
+void
+j_fabric_interrupt(JFabric* fabric)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_if_fail(fabric != NULL);
+
+#ifdef HAVE_LIBFABRIC
+	{
+		struct fi_eq_entry entry = { 0 };
+
+		g_return_if_fail(fabric->eq != NULL);
+
+		fi_eq_write(fabric->eq, FI_NOTIFY, &entry, sizeof(entry), 0);
+	}
+#endif
+}
+
+/**
+ * Connects to a listening fabric.
+ *
+ * \param fabric  A fabric.
+ * \param format  The address format.
+ * \param address The address.
+ * \param length  The address length.
+ * \param token   A token that allows the server to match the connection.
+ *
+ * \return A new connection that should be freed with j_fabric_connection_free(), NULL if an error occurred.
+ **/
+JFabricConnection*
+j_fabric_connect(JFabric* fabric, guint32 format, gconstpointer address, gsize length, guint64 token)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(fabric != NULL, NULL);
+	g_return_val_if_fail(address != NULL, NULL);
+
+#ifdef HAVE_LIBFABRIC
+	{
+		JFabricConnection* connection = NULL;
+		struct fi_eq_attr eq_attr = { 0 };
+		struct fi_eq_cm_entry entry;
+		struct fi_info* hints;
+		struct fi_info* info = NULL;
+		struct fid_eq* eq = NULL;
+		guint32 event;
+		gssize ret;
+
+		hints = j_fabric_hints_new(fabric->info->fabric_attr->prov_name);
+		hints->addr_format = format;
+		hints->dest_addr = malloc(length);
+		hints->dest_addrlen = length;
+		memcpy(hints->dest_addr, address, length);
+		hints->fabric_attr->name = strdup(fabric->info->fabric_attr->name);
+		hints->domain_attr->name = strdup(fabric->info->domain_attr->name);
+
+		ret = fi_getinfo(J_FABRIC_VERSION, NULL, NULL, 0, hints, &info);
+		fi_freeinfo(hints);
+
+		if (ret != 0)
+		{
+			g_warning("Could not resolve fabric address: %s", fi_strerror(-ret));
+			goto error;
+		}
+
+		eq_attr.wait_obj = FI_WAIT_UNSPEC;
+
+		if ((ret = fi_eq_open(fabric->fabric, &eq_attr, &eq, NULL)) != 0)
+		{
+			g_warning("Could not create fabric event queue: %s", fi_strerror(-ret));
+			goto error;
+		}
+
+		connection = j_fabric_connection_new(fabric, info, eq);
+
+		if (connection == NULL)
+		{
+			goto error;
+		}
+
+		connection->eq = eq;
+		eq = NULL;
+
+		if ((ret = fi_connect(connection->ep, info->dest_addr, &token, sizeof(token))) != 0)
+		{
+			g_warning("Could not connect to fabric: %s", fi_strerror(-ret));
+			goto error;
+		}
+
+		do
+		{
+			ret = fi_eq_sread(connection->eq, &event, &entry, sizeof(entry), -1, 0);
+		} while (ret == -FI_EAGAIN);
+
+		if (ret < 0 || event != FI_CONNECTED)
+		{
+			g_warning("Could not connect to fabric: %s", (ret < 0) ? fi_strerror(-ret) : "Unexpected event");
+			goto error;
+		}
+
+		connection->connected = TRUE;
+
+		fi_freeinfo(info);
+
+		return connection;
+
+	error:
+		if (connection != NULL)
+		{
+			j_fabric_connection_free(connection);
+		}
+
+		if (eq != NULL)
+		{
+			fi_close(&(eq->fid));
+		}
+
+		if (info != NULL)
+		{
+			fi_freeinfo(info);
+		}
+
+		return NULL;
+	}
+#else
+	(void)format;
+	(void)length;
+	(void)token;
+
+	return NULL;
+#endif
+}
+
+/**
+ * Accepts a connection returned by j_fabric_wait_request().
+ *
+ * \param connection A connection.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+j_fabric_connection_accept(JFabricConnection* connection)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(connection != NULL, FALSE);
+
+#ifdef HAVE_LIBFABRIC
+	{
+		gint ret;
+
+		ret = fi_accept(connection->ep, NULL, 0);
+
+		if (ret != 0)
+		{
+			g_warning("Could not accept fabric connection: %s", fi_strerror(-ret));
+
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
+/**
+ * Waits for an accepted connection to be established.
+ *
+ * \param connection A connection.
+ *
+ * \return TRUE if the connection is usable, FALSE if it has been closed.
+ **/
+gboolean
+j_fabric_connection_wait(JFabricConnection* connection)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret;
+
+	g_return_val_if_fail(connection != NULL, FALSE);
+
+	g_mutex_lock(&(connection->mutex));
+
+	while (!connection->connected && !connection->closed)
+	{
+		g_cond_wait(&(connection->cond), &(connection->mutex));
+	}
+
+	ret = !connection->closed;
+
+	g_mutex_unlock(&(connection->mutex));
+
+	return ret;
+}
+
+/**
+ * Closes and frees a connection.
+ *
+ * \param connection A connection.
+ **/
+void
+j_fabric_connection_free(JFabricConnection* connection)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_if_fail(connection != NULL);
+
+#ifdef HAVE_LIBFABRIC
+	g_mutex_lock(&(connection->fabric->mutex));
+	g_hash_table_remove(connection->fabric->connections, connection);
+	g_mutex_unlock(&(connection->fabric->mutex));
+
+	if (connection->ep != NULL)
+	{
+		if (connection->connected)
+		{
+			fi_shutdown(connection->ep, 0);
+		}
+
+		fi_close(&(connection->ep->fid));
+	}
+
+	if (connection->cq != NULL)
+	{
+		fi_close(&(connection->cq->fid));
+	}
+
+	if (connection->eq != NULL)
+	{
+		fi_close(&(connection->eq->fid));
+	}
+#endif
+
+	g_cond_clear(&(connection->cond));
+	g_mutex_clear(&(connection->mutex));
+
+	g_slice_free(JFabricConnection, connection);
+}
+
+/**
+ * Returns the fabric connection attached to a socket connection.
+ *
+ * \param connection A socket connection.
+ *
+ * \return A fabric connection, NULL if none is attached.
+ **/
+JFabricConnection*
+j_fabric_connection_get(GSocketConnection* connection)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(connection != NULL, NULL);
+
+	return g_object_get_qdata(G_OBJECT(connection), j_fabric_connection_quark());
+}
+
+/**
+ * Attaches a fabric connection to a socket connection.
+ * The fabric connection is freed together with the socket connection.
+ *
+ * \param connection        A socket connection.
+ * \param fabric_connection A fabric connection, NULL to free the attached one.
+ **/
+void
+j_fabric_connection_set(GSocketConnection* connection, JFabricConnection* fabric_connection)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_if_fail(connection != NULL);
+
+	g_object_set_qdata_full(G_OBJECT(connection), j_fabric_connection_quark(), fabric_connection, (GDestroyNotify)j_fabric_connection_free);
+}
+
+/**
+ * Reads remote memory into a local memory region.
+ *
+ * \param connection A connection.
+ * \param memory     A local memory region.
+ * \param length     The number of bytes to read.
+ * \param address    The remote address.
+ * \param key        The remote key.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+j_fabric_connection_read(JFabricConnection* connection, JFabricMemory* memory, guint64 length, guint64 address, guint64 key)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(connection != NULL, FALSE);
+	g_return_val_if_fail(memory != NULL, FALSE);
+
+#ifdef HAVE_LIBFABRIC
+	return j_fabric_connection_rma(connection, memory, length, address, key, FALSE);
+#else
+	(void)length;
+	(void)address;
+	(void)key;
+
+	return FALSE;
+#endif
+}
+
+/**
+ * Writes a local memory region into remote memory.
+ *
+ * \param connection A connection.
+ * \param memory     A local memory region.
+ * \param length     The number of bytes to write.
+ * \param address    The remote address.
+ * \param key        The remote key.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+j_fabric_connection_write(JFabricConnection* connection, JFabricMemory* memory, guint64 length, guint64 address, guint64 key)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(connection != NULL, FALSE);
+	g_return_val_if_fail(memory != NULL, FALSE);
+
+#ifdef HAVE_LIBFABRIC
+	return j_fabric_connection_rma(connection, memory, length, address, key, TRUE);
+#else
+	(void)length;
+	(void)address;
+	(void)key;
+
+	return FALSE;
+#endif
+}
+
+#ifdef HAVE_LIBFABRIC
+/**
+ * Registers a memory region with a fabric's domain.
+ *
+ * \private
+ *
+ * \param fabric A fabric.
+ * \param data   The memory.
+ * \param length The memory's length.
+ * \param remote Whether the memory will be accessed remotely or only used for local operations.
+ *
+ * \return A memory region, NULL if an error occurred.
+ **/
+static JFabricMemory*
+j_fabric_memory_register_domain(JFabric* fabric, gconstpointer data, guint64 length, gboolean remote)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JFabricMemory* memory;
+	guint64 access;
+	gint ret;
+
+	access = (remote) ? (FI_REMOTE_READ | FI_REMOTE_WRITE) : (FI_READ | FI_WRITE);
+
+	memory = g_slice_new(JFabricMemory);
+	// Remotely accessed memory is not modified locally, so it may be constant.
+	memory->data = (gpointer)(guintptr)data;
+	// Without virtual addressing, remote addresses are offsets into the memory region.
+	memory->address = (fabric->info->domain_attr->mr_mode & FI_MR_VIRT_ADDR) ? (guint64)(guintptr)data : 0;
+	memory->fabric = NULL;
+	memory->source = NULL;
+
+	ret = fi_mr_reg(fabric->domain, data, length, access, 0, 0, 0, &(memory->mr), NULL);
+
+	if (ret != 0)
+	{
+		g_warning("Could not register memory: %s", fi_strerror(-ret));
+		g_slice_free(JFabricMemory, memory);
+
+		return NULL;
+	}
+
+	return memory;
+}
+#endif
+
+/**
+ * Registers a memory region.
+ *
+ * \param connection A connection.
+ * \param data       The memory.
+ * \param length     The memory's length.
+ * \param remote     Whether the memory will be accessed remotely or only used for local operations.
+ *
+ * \return A memory region that should be deregistered with j_fabric_memory_deregister(), NULL if an error occurred.
+ **/
+JFabricMemory*
+j_fabric_memory_register(JFabricConnection* connection, gconstpointer data, guint64 length, gboolean remote)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(connection != NULL, NULL);
+	g_return_val_if_fail(data != NULL, NULL);
+
+#ifdef HAVE_LIBFABRIC
+	return j_fabric_memory_register_domain(connection->fabric, data, length, remote);
+#else
+	(void)length;
+	(void)remote;
+
+	return NULL;
+#endif
+}
+
+/**
+ * Deregisters a memory region.
+ *
+ * \param memory A memory region.
+ **/
+void
+j_fabric_memory_deregister(JFabricMemory* memory)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_if_fail(memory != NULL);
+
+#ifdef HAVE_LIBFABRIC
+	fi_close(&(memory->mr->fid));
+#endif
+
+	g_slice_free(JFabricMemory, memory);
+}
+
+/**
+ * Provides a memory region that can be accessed remotely for a transfer.
+ * Small transfers use one of the fabric's registered bounce buffers, larger ones register the memory directly.
+ *
+ * \code
+ * JFabricMemory* memory;
+ *
+ * memory = j_fabric_memory_acquire(connection, data, length, FALSE);
+ * // Let the server write into the memory region.
+ * j_fabric_memory_copy_back(memory, 0, nbytes);
+ * j_fabric_memory_release(memory);
+ * \endcode
+ *
+ * \param connection A connection.
+ * \param data       The memory.
+ * \param length     The memory's length.
+ * \param copy       Whether the memory's contents will be read remotely and have to be copied into a bounce buffer.
+ *
+ * \return A memory region that should be released with j_fabric_memory_release(), NULL if an error occurred.
+ **/
+JFabricMemory*
+j_fabric_memory_acquire(JFabricConnection* connection, gconstpointer data, guint64 length, gboolean copy)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(connection != NULL, NULL);
+	g_return_val_if_fail(data != NULL, NULL);
+
+#ifdef HAVE_LIBFABRIC
+	{
+		JFabric* fabric = connection->fabric;
+		JFabricMemory* memory = NULL;
+		gboolean allocate = FALSE;
+
+		if (length > J_FABRIC_BOUNCE_SIZE)
+		{
+			return j_fabric_memory_register_domain(fabric, data, length, TRUE);
+		}
+
+		g_mutex_lock(&(fabric->mutex));
+
+		memory = g_queue_pop_head(&(fabric->bounce));
+
+		if (memory == NULL && fabric->bounce_count < J_FABRIC_BOUNCE_COUNT)
+		{
+			fabric->bounce_count++;
+			allocate = TRUE;
+		}
+
+		g_mutex_unlock(&(fabric->mutex));
+
+		if (allocate)
+		{
+			gpointer buffer;
+
+			buffer = g_malloc(J_FABRIC_BOUNCE_SIZE);
+			memory = j_fabric_memory_register_domain(fabric, buffer, J_FABRIC_BOUNCE_SIZE, TRUE);
+
+			if (memory == NULL)
+			{
+				g_free(buffer);
+
+				g_mutex_lock(&(fabric->mutex));
+				fabric->bounce_count--;
+				g_mutex_unlock(&(fabric->mutex));
+			}
+		}
+
+		// All bounce buffers are in use, so the memory is registered directly instead of waiting for one.
+		if (memory == NULL)
+		{
+			return j_fabric_memory_register_domain(fabric, data, length, TRUE);
+		}
+
+		memory->fabric = fabric;
+		// Data written remotely is copied back into the memory, so it cannot be constant in that case.
+		memory->source = (gpointer)(guintptr)data;
+
+		if (copy)
+		{
+			memcpy(memory->data, data, length);
+		}
+
+		return memory;
+	}
+#else
+	(void)length;
+	(void)copy;
+
+	return NULL;
+#endif
+}
+
+/**
+ * Copies data that has been written remotely into a memory region back into the memory it has been acquired for.
+ * Does nothing if the memory has been registered directly.
+ *
+ * \param memory A memory region returned by j_fabric_memory_acquire().
+ * \param offset The offset of the data.
+ * \param length The length of the data.
+ **/
+void
+j_fabric_memory_copy_back(JFabricMemory* memory, guint64 offset, guint64 length)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_if_fail(memory != NULL);
+	g_return_if_fail(offset + length <= J_FABRIC_BOUNCE_SIZE || memory->source == NULL);
+
+	if (memory->source != NULL && length > 0)
+	{
+		memcpy((gchar*)memory->source + offset, (gchar*)memory->data + offset, length);
+	}
+}
+
+/**
+ * Releases a memory region returned by j_fabric_memory_acquire().
+ * Bounce buffers are returned to the fabric, other memory regions are deregistered.
+ *
+ * \param memory A memory region, NULL is ignored.
+ **/
+void
+j_fabric_memory_release(JFabricMemory* memory)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JFabric* fabric;
+
+	if (memory == NULL)
+	{
+		return;
+	}
+
+	fabric = memory->fabric;
+
+	if (fabric == NULL)
+	{
+		j_fabric_memory_deregister(memory);
+		return;
+	}
+
+#ifdef HAVE_LIBFABRIC
+	memory->source = NULL;
+
+	g_mutex_lock(&(fabric->mutex));
+	g_queue_push_head(&(fabric->bounce), memory);
+	g_mutex_unlock(&(fabric->mutex));
+#endif
+}
+
+/**
+ * Returns the address that has to be used to access a memory region remotely.
+ *
+ * \param memory A memory region.
+ *
+ * \return The address.
+ **/
+guint64
+j_fabric_memory_get_address(JFabricMemory* memory)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(memory != NULL, 0);
+
+	return memory->address;
+}
+
+/**
+ * Returns the key that has to be used to access a memory region remotely.
+ *
+ * \param memory A memory region.
+ *
+ * \return The key.
+ **/
+guint64
+j_fabric_memory_get_key(JFabricMemory* memory)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(memory != NULL, 0);
+
+#ifdef HAVE_LIBFABRIC
+	return fi_mr_key(memory->mr);
+#else
+	return 0;
+#endif
+}
+
+/**
+ * @}
+ **/
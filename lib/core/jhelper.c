@@ -28,13 +28,16 @@
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/un.h>
 
 #include <jhelper.h>
 #include <jhelper-internal.h>
 
 #include <jbackground-operation.h>
+#include <jbackground-operation-internal.h>
 #include <jsemantics.h>
 #include <jtrace.h>
 
@@ -82,6 +85,91 @@ j_helper_set_cork(GSocketConnection* connection, gboolean enable)
 	setsockopt(fd, IPPROTO_TCP, TCP_CORK, &flag, sizeof(gint));
 }
 
+/**
+ * Returns the path of a server's local socket.
+ * Servers listen on this socket in addition to TCP, so that clients on the same host can bypass the TCP stack.
+ * The path only depends on the server, so that clients running as other users or with other environments find it.
+ *
+ * \param directory The configured socket directory.
+ * \param port      The server's TCP port.
+ *
+ * \return A path. Should be freed with g_free().
+ **/
+gchar*
+j_helper_get_local_socket_path(gchar const* directory, guint16 port)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(directory != NULL, NULL);
+
+	return g_strdup_printf("%s/julea-%u.socket", directory, port);
+}
+
+/**
+ * Creates a UNIX socket address.
+ *
+ * \param path A path.
+ *
+ * \return A new address, NULL if the path is too long. Should be freed with g_object_unref().
+ **/
+GSocketAddress*
+j_helper_local_socket_address_new(gchar const* path)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	struct sockaddr_un address;
+
+	g_return_val_if_fail(path != NULL, NULL);
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+
+	if (g_strlcpy(address.sun_path, path, sizeof(address.sun_path)) >= sizeof(address.sun_path))
+	{
+		return NULL;
+	}
+
+	return g_socket_address_new_from_native(&address, sizeof(address));
+}
+
+/**
+ * Checks whether a host name refers to the local host.
+ * No name resolution is performed, only the local host name and loopback addresses are recognized.
+ *
+ * \param host A host name or address.
+ *
+ * \return TRUE if the host is the local host, FALSE otherwise.
+ **/
+gboolean
+j_helper_is_local_host(gchar const* host)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_autoptr(GInetAddress) address = NULL;
+	gchar const* host_name;
+	gsize host_len;
+
+	g_return_val_if_fail(host != NULL, FALSE);
+
+	if (g_strcmp0(host, "localhost") == 0)
+	{
+		return TRUE;
+	}
+
+	host_name = g_get_host_name();
+	host_len = strlen(host);
+
+	// Also accept the short name if the local host name is fully qualified.
+	if (g_strcmp0(host, host_name) == 0 || (strncmp(host, host_name, host_len) == 0 && host_name[host_len] == '.'))
+	{
+		return TRUE;
+	}
+
+	address = g_inet_address_new_from_string(host);
+
+	return (address != NULL && g_inet_address_get_is_loopback(address));
+}
+
 void
 j_helper_get_number_string(gchar* string, guint32 length, guint32 number)
 {
@@ -119,49 +207,31 @@ j_helper_execute_parallel(JBackgroundOperationFunc func, gpointer* data, guint l
 {
 	J_TRACE_FUNCTION(NULL);
 
-	JBackgroundOperation** operations;
+	g_autofree gpointer* operation_data = NULL;
+	g_autofree guint* indices = NULL;
 	guint data_count = 0;
 
-	operations = g_new(JBackgroundOperation*, length);
+	operation_data = g_new(gpointer, length);
+	indices = g_new(guint, length);
 
 	for (guint i = 0; i < length; i++)
 	{
-		operations[i] = NULL;
-
 		if (data[i] != NULL)
 		{
+			operation_data[data_count] = data[i];
+			indices[data_count] = i;
 			data_count++;
 		}
 	}
 
-	for (guint i = 0; i < length; i++)
-	{
-		if (data[i] == NULL)
-		{
-			continue;
-		}
+	// The calling thread executes the first operation itself.
+	j_background_operation_execute_all(func, operation_data, data_count);
 
-		if (data_count > 1)
-		{
-			operations[i] = j_background_operation_new(func, data[i]);
-		}
-		else
-		{
-			data[i] = func(data[i]);
-		}
-	}
-
-	for (guint i = 0; i < length; i++)
+	for (guint i = 0; i < data_count; i++)
 	{
-		if (operations[i] != NULL)
-		{
-			data[i] = j_background_operation_wait(operations[i]);
-			j_background_operation_unref(operations[i]);
-		}
+		data[indices[i]] = operation_data[i];
 	}
 
-	g_free(operations);
-
 	return TRUE;
 }
 
@@ -25,12 +25,21 @@
 #include <glib.h>
 #include <gio/gio.h>
 
+#include <errno.h>
 #include <math.h>
 #include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#else
+#include <fcntl.h>
+#include <glib-unix.h>
+#endif
 
 #include <jmessage.h>
 
-#include <jhelper-internal.h>
+#include <jconnection-pool-internal.h>
 #include <jlist.h>
 #include <jlist-iterator.h>
 #include <jsemantics.h>
@@ -86,6 +95,24 @@ struct JMessageData
 
 typedef struct JMessageData JMessageData;
 
+/**
+ * A full segment of a message's body.
+ **/
+struct JMessageSegment
+{
+	/**
+	 * The data.
+	 **/
+	gchar* data;
+
+	/**
+	 * The data length.
+	 **/
+	gsize length;
+};
+
+typedef struct JMessageSegment JMessageSegment;
+
 /**
  * A message header.
  **/
@@ -116,12 +143,108 @@ struct JMessageHeader
 	 * The operation count.
 	 **/
 	guint32 op_count;
+
+	/**
+	 * The length of the additional data following the body.
+	 * Allows reading complete messages without knowing their operations.
+	 **/
+	guint64 send_length;
 };
 #pragma pack()
 
 typedef struct JMessageHeader JMessageHeader;
 
-G_STATIC_ASSERT(sizeof(JMessageHeader) == 5 * sizeof(guint32));
+G_STATIC_ASSERT(sizeof(JMessageHeader) == 5 * sizeof(guint32) + sizeof(guint64));
+
+/**
+ * A file descriptor that wakes up a fan-out.
+ * Other threads signal it when they have read a reply for one of the fan-out's messages or stop reading from a connection.
+ * On Linux, this is an eventfd; elsewhere, a pipe is used.
+ **/
+struct JMessageWakeup
+{
+	/**
+	 * The file descriptors used for signaling.
+	 * Both are the same if an eventfd is used.
+	 **/
+	gint read_fd;
+	gint write_fd;
+
+	/**
+	 * Whether the file descriptor has been signaled but not consumed yet.
+	 * A single token is enough to wake up the fan-out.
+	 **/
+	gint signaled;
+
+	/**
+	 * The reference count.
+	 * Slots and connections can outlive their fan-out.
+	 **/
+	gint ref_count;
+};
+
+typedef struct JMessageWakeup JMessageWakeup;
+
+/**
+ * The replies received for a message on a multiplexed connection.
+ **/
+struct JMessageMultiplexSlot
+{
+	/**
+	 * The wakeup of the fan-out waiting for the replies, NULL if the message has not been sent by a fan-out.
+	 **/
+	JMessageWakeup* wakeup;
+
+	/**
+	 * The replies that have been read by other threads but not yet received by the message's sender.
+	 * Contains JMessage elements.
+	 **/
+	GQueue replies;
+};
+
+typedef struct JMessageMultiplexSlot JMessageMultiplexSlot;
+
+/**
+ * Multiplexing state of a connection.
+ * Allows multiple threads to have messages in flight on the same connection.
+ **/
+struct JMessageMultiplex
+{
+	/**
+	 * Serializes writes so that messages are not interleaved.
+	 **/
+	GMutex send_mutex;
+
+	/**
+	 * Protects the remaining members.
+	 **/
+	GMutex mutex;
+
+	/**
+	 * Signaled whenever a reply has been read.
+	 **/
+	GCond cond;
+
+	/**
+	 * The pending messages.
+	 * Maps message IDs to JMessageMultiplexSlot elements.
+	 **/
+	GHashTable* pending;
+
+	/**
+	 * Whether a thread is currently reading from the connection.
+	 * The reader only ever reads a single complete reply at a time.
+	 **/
+	gboolean reading;
+
+	/**
+	 * The fan-outs waiting for the current reader to finish.
+	 * Contains JMessageWakeup elements.
+	 **/
+	GPtrArray* waiters;
+};
+
+typedef struct JMessageMultiplex JMessageMultiplex;
 
 /**
  * A message.
@@ -140,6 +263,7 @@ struct JMessage
 
 	/**
 	 * The data.
+	 * For outgoing messages, this is the last segment of the body.
 	 **/
 	gchar* data;
 
@@ -148,6 +272,35 @@ struct JMessage
 	 **/
 	gchar* current;
 
+	/**
+	 * The current position within the additional data of received replies.
+	 * The additional data follows the body in #data.
+	 **/
+	gchar* send_current;
+
+	/**
+	 * The connection the additional data of a received reply still has to be read from.
+	 * NULL if the additional data has been buffered in #data or there is none left.
+	 **/
+	gpointer send_connection;
+
+	/**
+	 * The number of bytes of additional data that are left in #send_connection's stream.
+	 **/
+	guint64 send_remaining;
+
+	/**
+	 * The number of bytes of the header and body that have been received by j_message_receive_nonblocking().
+	 **/
+	gsize received;
+
+	/**
+	 * The full segments preceding #data.
+	 * Outgoing messages grow by adding segments, so that appended data never has to be copied.
+	 * Contains JMessageSegment elements, NULL if the body consists of a single segment.
+	 **/
+	GArray* segments;
+
 	/**
 	 * The list of additional data to send in j_message_write().
 	 * Contains JMessageData elements.
@@ -160,6 +313,13 @@ struct JMessage
 	 **/
 	JMessage* original_message;
 
+	/**
+	 * The multiplexed connections the message has been registered on.
+	 * The message's slots are released once it is freed.
+	 * Contains GSocketConnection elements.
+	 **/
+	GSList* connections;
+
 	/**
 	 * The reference count.
 	 **/
@@ -167,39 +327,137 @@ struct JMessage
 };
 
 /**
- * Returns a message's length.
- *
- * \private
- *
- * \code
- * \endcode
- *
- * \param message A message.
- *
- * \return The message's length.
+ * A message sent as part of a fan-out.
  **/
-static gsize
-j_message_length(JMessage const* message)
+struct JMessageFanoutEntry
 {
-	J_TRACE_FUNCTION(NULL);
+	/**
+	 * The message.
+	 **/
+	JMessage* message;
 
-	guint32 length;
+	/**
+	 * The connection to send the message on.
+	 **/
+	gpointer connection;
 
-	length = message->header.length;
+	/**
+	 * The function to call for each reply, NULL if no reply is expected.
+	 **/
+	JMessageReplyFunc func;
 
-	return GUINT32_FROM_LE(length);
-}
+	/**
+	 * The function to call once the entry has been completed, NULL if none.
+	 **/
+	JMessageDoneFunc done;
+
+	/**
+	 * The data to pass to #func and #done.
+	 **/
+	gpointer data;
+
+	/**
+	 * The reply, reused for all replies to #message.
+	 **/
+	JMessage* reply;
+
+	/**
+	 * Whether the message has been sent.
+	 **/
+	gboolean sent;
+
+	/**
+	 * Whether the entry is still waiting for replies.
+	 **/
+	gboolean pending;
+
+	/**
+	 * The monotonic time the message was sent at.
+	 **/
+	gint64 start;
+};
+
+typedef struct JMessageFanoutEntry JMessageFanoutEntry;
+
+/**
+ * A set of messages that are sent to multiple connections and whose replies are handled by a single thread.
+ **/
+struct JMessageFanout
+{
+	/**
+	 * The messages.
+	 * Contains JMessageFanoutEntry elements.
+	 **/
+	GArray* entries;
+
+	/**
+	 * Polled together with the connections, so that replies read by other threads are noticed immediately.
+	 **/
+	JMessageWakeup* wakeup;
+
+	/**
+	 * Whether j_message_fanout_wakeup() has been called since the fan-out last returned early.
+	 **/
+	gint interrupted;
+};
+
+static gint j_message_next_id = 0;
+
+/**
+ * The maximum size of a newly allocated segment, unless a single operation requires more.
+ **/
+#define J_MESSAGE_SEGMENT_SIZE_MAX (1024 * 1024)
+
+/**
+ * The maximum number of unused messages per thread.
+ **/
+#define J_MESSAGE_CACHE_LENGTH_MAX 32
+
+/**
+ * The maximum buffer size of unused messages.
+ * Messages with larger buffers are freed instead of being reused.
+ **/
+#define J_MESSAGE_CACHE_SIZE_MAX (64 * 1024)
 
 static void
-j_message_data_free(gpointer data)
+j_message_cache_free(gpointer data)
 {
-	J_TRACE_FUNCTION(NULL);
+	GQueue* cache = data;
+	JMessage* message;
 
-	g_slice_free(JMessageData, data);
+	while ((message = g_queue_pop_head(cache)) != NULL)
+	{
+		j_list_unref(message->send_list);
+		g_free(message->data);
+		g_slice_free(JMessage, message);
+	}
+
+	g_queue_free(cache);
 }
 
 /**
- * Checks whether it is possible to append data to a message.
+ * Every thread keeps a number of unused messages, including their buffers.
+ **/
+static GPrivate j_message_cache = G_PRIVATE_INIT(j_message_cache_free);
+
+static GQueue*
+j_message_cache_get_thread(void)
+{
+	GQueue* cache;
+
+	cache = g_private_get(&j_message_cache);
+
+	if (G_UNLIKELY(cache == NULL))
+	{
+		cache = g_queue_new();
+		g_private_set(&j_message_cache, cache);
+	}
+
+	return cache;
+}
+
+/**
+ * Returns a message's length.
  *
  * \private
  *
@@ -207,628 +465,2540 @@ j_message_data_free(gpointer data)
  * \endcode
  *
  * \param message A message.
- * \param length  A length.
  *
- * \return TRUE if it is possible, FALSE otherwise.
+ * \return The message's length.
  **/
-static gboolean
-j_message_can_append(JMessage const* message, gsize length)
+static gsize
+j_message_length(JMessage const* message)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	return (message->current + length <= message->data + message->size);
+	guint32 length;
+
+	length = message->header.length;
+
+	return GUINT32_FROM_LE(length);
 }
 
 /**
- * Checks whether it is possible to get data from a message.
+ * Returns the length of a message's additional data.
  *
  * \private
  *
- * \code
- * \endcode
- *
  * \param message A message.
- * \param length  A length.
  *
- * \return TRUE if it is possible, FALSE otherwise.
+ * \return The additional data's length.
  **/
-static gboolean
-j_message_can_get(JMessage const* message, gsize length)
+static guint64
+j_message_send_length(JMessage const* message)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	return (message->current + length <= message->data + j_message_length(message));
+	guint64 send_length;
+
+	send_length = message->header.send_length;
+
+	return GUINT64_FROM_LE(send_length);
 }
 
 static void
-j_message_extend(JMessage* message, gsize length)
+j_message_data_free(gpointer data)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	gsize factor = 1;
-	gsize current_length;
-	gsize position;
-	guint32 count;
-
-	if (length == 0)
-	{
-		return;
-	}
+	g_slice_free(JMessageData, data);
+}
 
-	current_length = j_message_length(message);
+static void
+j_message_segments_free(JMessage* message)
+{
+	J_TRACE_FUNCTION(NULL);
 
-	if (current_length + length <= message->size)
+	if (message->segments == NULL)
 	{
 		return;
 	}
 
-	count = j_message_get_count(message);
-
-	if (count > 10)
+	for (guint i = 0; i < message->segments->len; i++)
 	{
-		factor = pow(10, floor(log10(count)));
+		g_free(g_array_index(message->segments, JMessageSegment, i).data);
 	}
 
-	message->size += length * factor;
-
-	position = message->current - message->data;
-	message->data = g_realloc(message->data, message->size);
-	message->current = message->data + position;
+	g_array_unref(message->segments);
+	message->segments = NULL;
 }
 
-static void
-j_message_ensure_size(JMessage* message, gsize length)
+/**
+ * Returns the length of a message's last segment, that is, the data in #data.
+ *
+ * \private
+ *
+ * \param message A message.
+ *
+ * \return The length.
+ **/
+static gsize
+j_message_data_length(JMessage const* message)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	gsize position;
+	gsize length;
 
-	if (length <= message->size)
+	length = j_message_length(message);
+
+	if (message->segments != NULL)
 	{
-		return;
+		for (guint i = 0; i < message->segments->len; i++)
+		{
+			length -= g_array_index(message->segments, JMessageSegment, i).length;
+		}
 	}
 
-	message->size = length;
-
-	position = message->current - message->data;
-	message->data = g_realloc(message->data, message->size);
-	message->current = message->data + position;
+	return length;
 }
 
 /**
- * Creates a new message.
+ * Allocates a message, reusing an unused one if possible.
  *
- * \code
- * \endcode
+ * \private
  *
- * \param op_type An operation type.
- * \param length  A length.
+ * \param length The minimum buffer size.
  *
- * \return A new message. Should be freed with j_message_unref().
+ * \return A message.
  **/
-JMessage*
-j_message_new(JMessageType op_type, gsize length)
+static JMessage*
+j_message_alloc(gsize length)
 {
 	J_TRACE_FUNCTION(NULL);
 
 	JMessage* message;
-	guint32 rand;
 
-	//g_return_val_if_fail(op_type != J_MESSAGE_NONE, NULL);
-
-	length = MAX(256, length);
-	rand = g_random_int();
+	message = g_queue_pop_head(j_message_cache_get_thread());
+
+	if (message != NULL)
+	{
+		if (message->size < length)
+		{
+			// The old contents do not have to be preserved.
+			g_free(message->data);
+			message->size = length;
+			message->data = g_malloc(message->size);
+		}
+	}
+	else
+	{
+		message = g_slice_new(JMessage);
+		message->size = length;
+		message->data = g_malloc(message->size);
+		message->send_list = j_list_new(j_message_data_free);
+	}
 
-	message = g_slice_new(JMessage);
-	message->size = length;
-	message->data = g_malloc(message->size);
 	message->current = message->data;
-	message->send_list = j_list_new(j_message_data_free);
+	message->send_current = NULL;
+	message->send_connection = NULL;
+	message->send_remaining = 0;
+	message->received = 0;
+	message->segments = NULL;
 	message->original_message = NULL;
+	message->connections = NULL;
 	message->ref_count = 1;
 
-	message->header.length = GUINT32_TO_LE(0);
-	message->header.id = GUINT32_TO_LE(rand);
-	message->header.semantics = GUINT32_TO_LE(0);
-	message->header.op_type = GUINT32_TO_LE(op_type);
-	message->header.op_count = GUINT32_TO_LE(0);
+	return message;
+}
+
+/**
+ * Creates a new wakeup.
+ *
+ * \private
+ *
+ * \return A new wakeup. Should be freed with j_message_wakeup_unref().
+ **/
+static JMessageWakeup*
+j_message_wakeup_new(void)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JMessageWakeup* wakeup;
+
+	wakeup = g_slice_new(JMessageWakeup);
+	wakeup->signaled = FALSE;
+	wakeup->ref_count = 1;
+
+#ifdef __linux__
+	wakeup->read_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	wakeup->write_fd = wakeup->read_fd;
+
+	if (wakeup->read_fd == -1)
+	{
+		g_critical("Could not create fan-out wakeup: %s", g_strerror(errno));
+	}
+#else
+	{
+		gint fds[2];
+		GError* error = NULL;
+
+		if (g_unix_open_pipe(fds, FD_CLOEXEC, &error) && g_unix_set_fd_nonblocking(fds[0], TRUE, &error))
+		{
+			wakeup->read_fd = fds[0];
+			wakeup->write_fd = fds[1];
+		}
+		else
+		{
+			g_critical("Could not create fan-out wakeup: %s", error->message);
+			g_error_free(error);
+
+			wakeup->read_fd = -1;
+			wakeup->write_fd = -1;
+		}
+	}
+#endif
+
+	return wakeup;
+}
+
+static JMessageWakeup*
+j_message_wakeup_ref(JMessageWakeup* wakeup)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_atomic_int_inc(&(wakeup->ref_count));
+
+	return wakeup;
+}
+
+static void
+j_message_wakeup_unref(gpointer data)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JMessageWakeup* wakeup = data;
+
+	if (g_atomic_int_dec_and_test(&(wakeup->ref_count)))
+	{
+		if (wakeup->read_fd != -1)
+		{
+			close(wakeup->read_fd);
+		}
+
+		if (wakeup->write_fd != wakeup->read_fd)
+		{
+			close(wakeup->write_fd);
+		}
+
+		g_slice_free(JMessageWakeup, wakeup);
+	}
+}
+
+/**
+ * Signals a wakeup.
+ * Can be called from any thread.
+ *
+ * \private
+ *
+ * \param wakeup A wakeup.
+ **/
+static void
+j_message_wakeup_signal(JMessageWakeup* wakeup)
+{
+	J_TRACE_FUNCTION(NULL);
+
+#ifdef __linux__
+	guint64 value = 1;
+#else
+	gchar value = 1;
+#endif
+
+	// The fan-out has not noticed the previous signal yet.
+	if (!g_atomic_int_compare_and_exchange(&(wakeup->signaled), FALSE, TRUE))
+	{
+		return;
+	}
+
+	while (write(wakeup->write_fd, &value, sizeof(value)) < 0)
+	{
+		if (errno != EINTR)
+		{
+			g_critical("Could not signal fan-out wakeup: %s", g_strerror(errno));
+			break;
+		}
+	}
+}
+
+/**
+ * Consumes a wakeup's signal.
+ * The caller has to check for replies afterwards, signals arriving in the meantime might have been dropped.
+ *
+ * \private
+ *
+ * \param wakeup A wakeup.
+ **/
+static void
+j_message_wakeup_consume(JMessageWakeup* wakeup)
+{
+	J_TRACE_FUNCTION(NULL);
+
+#ifdef __linux__
+	guint64 value;
+#else
+	gchar value;
+#endif
+
+	while (read(wakeup->read_fd, &value, sizeof(value)) < 0)
+	{
+		if (errno != EINTR)
+		{
+			// The file descriptor is non-blocking and might not have been signaled at all.
+			if (errno != EAGAIN)
+			{
+				g_critical("Could not consume fan-out wakeup: %s", g_strerror(errno));
+			}
+
+			break;
+		}
+	}
+
+	g_atomic_int_set(&(wakeup->signaled), FALSE);
+}
+
+static void
+j_message_multiplex_slot_free(gpointer data)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JMessageMultiplexSlot* slot = data;
+	JMessage* reply;
+
+	while ((reply = g_queue_pop_head(&(slot->replies))) != NULL)
+	{
+		j_message_unref(reply);
+	}
+
+	if (slot->wakeup != NULL)
+	{
+		j_message_wakeup_unref(slot->wakeup);
+	}
+
+	g_slice_free(JMessageMultiplexSlot, slot);
+}
+
+static void
+j_message_multiplex_free(gpointer data)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JMessageMultiplex* multiplex = data;
+
+	g_hash_table_unref(multiplex->pending);
+	g_ptr_array_unref(multiplex->waiters);
+
+	g_cond_clear(&(multiplex->cond));
+	g_mutex_clear(&(multiplex->mutex));
+	g_mutex_clear(&(multiplex->send_mutex));
+
+	g_slice_free(JMessageMultiplex, multiplex);
+}
+
+static JMessageMultiplex*
+j_message_multiplex_get(gpointer connection)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	return g_object_get_qdata(G_OBJECT(connection), g_quark_from_static_string("j-message-multiplex"));
+}
+
+/**
+ * Gives up reading from a multiplexed connection and wakes up the threads and fan-outs waiting for it.
+ * The multiplexing state's mutex has to be held.
+ *
+ * \private
+ *
+ * \param multiplex The connection's multiplexing state.
+ **/
+static void
+j_message_multiplex_stop_reading(JMessageMultiplex* multiplex)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	multiplex->reading = FALSE;
+	g_cond_broadcast(&(multiplex->cond));
+
+	for (guint i = 0; i < multiplex->waiters->len; i++)
+	{
+		j_message_wakeup_signal(g_ptr_array_index(multiplex->waiters, i));
+	}
+
+	g_ptr_array_set_size(multiplex->waiters, 0);
+}
+
+/**
+ * Releases a message's slots on all multiplexed connections it has been registered on.
+ * Replies that have not been received yet are discarded.
+ *
+ * \private
+ *
+ * \param message A message.
+ **/
+static void
+j_message_multiplex_release(JMessage* message)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	for (GSList* link = message->connections; link != NULL; link = link->next)
+	{
+		JMessageMultiplex* multiplex;
+
+		multiplex = j_message_multiplex_get(link->data);
+
+		g_mutex_lock(&(multiplex->mutex));
+		g_hash_table_remove(multiplex->pending, GUINT_TO_POINTER(message->header.id));
+		g_mutex_unlock(&(multiplex->mutex));
+	}
+
+	g_slist_free_full(message->connections, g_object_unref);
+	message->connections = NULL;
+}
+
+/**
+ * Finishes receiving a reply's additional data.
+ * Additional data that has not been received is discarded, so that the next reply can be read.
+ * If the connection is multiplexed, other threads are allowed to read from it again afterwards.
+ *
+ * \private
+ *
+ * \param message A reply message.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+static gboolean
+j_message_finish_send(JMessage* message)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = TRUE;
+
+	JMessageMultiplex* multiplex;
+	GInputStream* stream;
+	GError* error = NULL;
+
+	if (message->send_connection == NULL)
+	{
+		return TRUE;
+	}
+
+	stream = g_io_stream_get_input_stream(G_IO_STREAM(message->send_connection));
+
+	while (message->send_remaining > 0)
+	{
+		gssize nbytes;
+
+		nbytes = g_input_stream_skip(stream, MIN(message->send_remaining, G_MAXSSIZE), NULL, &error);
+
+		if (nbytes <= 0)
+		{
+			ret = FALSE;
+			break;
+		}
+
+		message->send_remaining -= nbytes;
+	}
+
+	if (error != NULL)
+	{
+		g_critical("%s", error->message);
+		g_error_free(error);
+	}
+
+	multiplex = j_message_multiplex_get(message->send_connection);
+
+	if (multiplex != NULL)
+	{
+		g_mutex_lock(&(multiplex->mutex));
+		j_message_multiplex_stop_reading(multiplex);
+		g_mutex_unlock(&(multiplex->mutex));
+	}
+
+	g_clear_object(&(message->send_connection));
+	message->send_remaining = 0;
+
+	return ret;
+}
+
+/**
+ * Checks whether it is possible to append data to a message.
+ *
+ * \private
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ * \param length  A length.
+ *
+ * \return TRUE if it is possible, FALSE otherwise.
+ **/
+static gboolean
+j_message_can_append(JMessage const* message, gsize length)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	return (message->current + length <= message->data + message->size);
+}
+
+/**
+ * Checks whether it is possible to get data from a message.
+ *
+ * \private
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ * \param length  A length.
+ *
+ * \return TRUE if it is possible, FALSE otherwise.
+ **/
+static gboolean
+j_message_can_get(JMessage const* message, gsize length)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	return (message->current + length <= message->data + j_message_length(message));
+}
+
+/**
+ * Makes sure that a number of bytes can be appended to a message.
+ * If the current segment is too small, a new one is started, so already appended data is never copied.
+ *
+ * \private
+ *
+ * \param message A message.
+ * \param length  A length.
+ **/
+static void
+j_message_extend(JMessage* message, gsize length)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JMessageSegment segment;
+	gsize factor = 1;
+	gsize size;
+	guint32 count;
+
+	if (length == 0)
+	{
+		return;
+	}
+
+	if (j_message_can_append(message, length))
+	{
+		return;
+	}
+
+	count = j_message_get_count(message);
+
+	if (count > 10)
+	{
+		factor = pow(10, floor(log10(count)));
+	}
+
+	// Grow geometrically to keep the number of segments small.
+	size = MAX(length * factor, MIN(2 * message->size, J_MESSAGE_SEGMENT_SIZE_MAX));
+	size = MAX(size, length);
+
+	if (message->segments == NULL)
+	{
+		message->segments = g_array_new(FALSE, FALSE, sizeof(JMessageSegment));
+	}
+
+	segment.data = message->data;
+	segment.length = message->current - message->data;
+	g_array_append_val(message->segments, segment);
+
+	message->size = size;
+	message->data = g_malloc(message->size);
+	message->current = message->data;
+}
+
+static void
+j_message_ensure_size(JMessage* message, gsize length)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gsize position;
+
+	// Received messages always consist of a single segment.
+	j_message_segments_free(message);
+
+	if (length <= message->size)
+	{
+		return;
+	}
+
+	message->size = length;
+
+	position = message->current - message->data;
+	message->data = g_realloc(message->data, message->size);
+	message->current = message->data + position;
+}
+
+/**
+ * Creates a new message.
+ *
+ * \code
+ * \endcode
+ *
+ * \param op_type An operation type.
+ * \param length  A length.
+ *
+ * \return A new message. Should be freed with j_message_unref().
+ **/
+JMessage*
+j_message_new(JMessageType op_type, gsize length)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JMessage* message;
+	guint32 id;
+
+	//g_return_val_if_fail(op_type != J_MESSAGE_NONE, NULL);
+
+	length = MAX(256, length);
+	// IDs have to be unique among the messages in flight on a multiplexed connection.
+	id = g_atomic_int_add(&j_message_next_id, 1);
+
+	message = j_message_alloc(length);
+
+	message->header.length = GUINT32_TO_LE(0);
+	message->header.id = GUINT32_TO_LE(id);
+	message->header.semantics = GUINT32_TO_LE(0);
+	message->header.op_type = GUINT32_TO_LE(op_type);
+	message->header.op_count = GUINT32_TO_LE(0);
+	message->header.send_length = GUINT64_TO_LE(0);
+
+	return message;
+}
+
+/**
+ * Creates a new reply message.
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ *
+ * \return A new reply message. Should be freed with j_message_unref().
+ **/
+JMessage*
+j_message_new_reply(JMessage* message)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JMessage* reply;
+
+	g_return_val_if_fail(message != NULL, NULL);
+
+	reply = j_message_alloc(256);
+	reply->original_message = j_message_ref(message);
+
+	reply->header.length = GUINT32_TO_LE(0);
+	reply->header.id = message->header.id;
+	reply->header.semantics = GUINT32_TO_LE(0);
+	reply->header.op_type = message->header.op_type;
+	reply->header.op_count = GUINT32_TO_LE(0);
+	reply->header.send_length = GUINT64_TO_LE(0);
+
+	return reply;
+}
+
+/**
+ * Increases a message's reference count.
+ *
+ * \code
+ * JMessage* m;
+ *
+ * j_message_ref(m);
+ * \endcode
+ *
+ * \param message A message.
+ *
+ * \return #message.
+ **/
+JMessage*
+j_message_ref(JMessage* message)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(message != NULL, NULL);
+
+	g_atomic_int_inc(&(message->ref_count));
+
+	return message;
+}
+
+/**
+ * Decreases a message's reference count.
+ * When the reference count reaches zero, frees the memory allocated for the message.
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ **/
+void
+j_message_unref(JMessage* message)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_if_fail(message != NULL);
+
+	if (g_atomic_int_dec_and_test(&(message->ref_count)))
+	{
+		if (message->original_message != NULL)
+		{
+			j_message_unref(message->original_message);
+		}
+
+		// The connection might be shared, so it has to be left at the start of the next reply.
+		j_message_finish_send(message);
+		// Other threads must not queue replies for the message anymore, its ID is never reused.
+		j_message_multiplex_release(message);
+		j_message_segments_free(message);
+
+		if (message->size <= J_MESSAGE_CACHE_SIZE_MAX)
+		{
+			GQueue* cache;
+
+			cache = j_message_cache_get_thread();
+
+			if (cache->length < J_MESSAGE_CACHE_LENGTH_MAX)
+			{
+				j_list_delete_all(message->send_list);
+				g_queue_push_head(cache, message);
+
+				return;
+			}
+		}
+
+		j_list_unref(message->send_list);
+		g_free(message->data);
+
+		g_slice_free(JMessage, message);
+	}
+}
+
+/**
+ * Returns a message's type.
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ *
+ * \return The message's operation type.
+ **/
+JMessageType
+j_message_get_type(JMessage const* message)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JMessageType op_type;
+
+	g_return_val_if_fail(message != NULL, J_MESSAGE_NONE);
+
+	op_type = message->header.op_type;
+	op_type = GUINT32_FROM_LE(op_type);
+
+	return op_type;
+}
+
+/**
+ * Returns a message's count.
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ *
+ * \return The message's operation count.
+ **/
+guint32
+j_message_get_count(JMessage const* message)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	guint32 op_count;
+
+	g_return_val_if_fail(message != NULL, 0);
+
+	op_count = message->header.op_count;
+	op_count = GUINT32_FROM_LE(op_count);
+
+	return op_count;
+}
+
+/**
+ * Appends 1 byte to a message.
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ * \param data    Data to append.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+j_message_append_1(JMessage* message, gconstpointer data)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	guint32 new_length;
+
+	g_return_val_if_fail(message != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(j_message_can_append(message, 1), FALSE);
+
+	*(message->current) = *((gchar const*)data);
+	message->current += 1;
+
+	new_length = j_message_length(message) + 1;
+	message->header.length = GUINT32_TO_LE(new_length);
+
+	return TRUE;
+}
+
+/**
+ * Appends 4 bytes to a message.
+ * The bytes are converted to little endian automatically.
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ * \param data    Data to append.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+j_message_append_4(JMessage* message, gconstpointer data)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gint32 new_data;
+	guint32 new_length;
+
+	g_return_val_if_fail(message != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(j_message_can_append(message, 4), FALSE);
+
+	new_data = GINT32_TO_LE(*((gint32 const*)data));
+	memcpy(message->current, &new_data, 4);
+	message->current += 4;
+
+	new_length = j_message_length(message) + 4;
+	message->header.length = GUINT32_TO_LE(new_length);
+
+	return TRUE;
+}
+
+/**
+ * Appends 8 bytes to a message.
+ * The bytes are converted to little endian automatically.
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ * \param data    Data to append.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+j_message_append_8(JMessage* message, gconstpointer data)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gint64 new_data;
+	guint32 new_length;
+
+	g_return_val_if_fail(message != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(j_message_can_append(message, 8), FALSE);
+
+	new_data = GINT64_TO_LE(*((gint64 const*)data));
+	memcpy(message->current, &new_data, 8);
+	message->current += 8;
+
+	new_length = j_message_length(message) + 8;
+	message->header.length = GUINT32_TO_LE(new_length);
+
+	return TRUE;
+}
+
+/**
+ * Appends a number of bytes to a message.
+ *
+ * \code
+ * gchar* str = "Hello world!";
+ * ...
+ * j_message_append_n(message, str, strlen(str) + 1);
+ * \endcode
+ *
+ * \param message A message.
+ * \param data    Data to append.
+ * \param length  Length of data.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+j_message_append_n(JMessage* message, gconstpointer data, gsize length)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	guint32 new_length;
+
+	g_return_val_if_fail(message != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(j_message_can_append(message, length), FALSE);
+
+	memcpy(message->current, data, length);
+	message->current += length;
+
+	new_length = j_message_length(message) + length;
+	message->header.length = GUINT32_TO_LE(new_length);
+
+	return TRUE;
+}
+
+/**
+ * Appends a string to a message.
+ *
+ * \code
+ * gchar* str = "Hello world!";
+ * ...
+ * j_message_append_string(message, str);
+ * \endcode
+ *
+ * \param message A message.
+ * \param str     String to append.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+j_message_append_string(JMessage* message, gchar const* str)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(message != NULL, FALSE);
+	g_return_val_if_fail(str != NULL, FALSE);
+
+	return j_message_append_n(message, str, strlen(str) + 1);
+}
+
+/**
+ * Gets 1 byte from a message.
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ *
+ * \return A character.
+ **/
+gchar
+j_message_get_1(JMessage* message)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gchar ret;
+
+	g_return_val_if_fail(message != NULL, '\0');
+	g_return_val_if_fail(j_message_can_get(message, 1), '\0');
+
+	ret = *((gchar const*)(message->current));
+	message->current += 1;
+
+	return ret;
+}
+
+/**
+ * Gets 4 bytes from a message.
+ * The bytes are converted from little endian automatically.
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ *
+ * \return A 4-bytes integer.
+ **/
+gint32
+j_message_get_4(JMessage* message)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gint32 ret;
+
+	g_return_val_if_fail(message != NULL, 0);
+	g_return_val_if_fail(j_message_can_get(message, 4), 0);
+
+	memcpy(&ret, message->current, 4);
+	ret = GINT32_FROM_LE(ret);
+	message->current += 4;
+
+	return ret;
+}
+
+/**
+ * Gets 8 bytes from a message.
+ * The bytes are converted from little endian automatically.
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ *
+ * \return An 8-bytes integer.
+ **/
+gint64
+j_message_get_8(JMessage* message)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gint64 ret;
+
+	g_return_val_if_fail(message != NULL, 0);
+	g_return_val_if_fail(j_message_can_get(message, 8), 0);
+
+	memcpy(&ret, message->current, 8);
+	ret = GINT64_FROM_LE(ret);
+	message->current += 8;
+
+	return ret;
+}
+
+/**
+ * Gets n bytes from a message.
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ *
+ * \return A pointer to the data.
+ **/
+gpointer
+j_message_get_n(JMessage* message, gsize length)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gpointer ret;
+
+	g_return_val_if_fail(message != NULL, NULL);
+	g_return_val_if_fail(j_message_can_get(message, length), NULL);
+
+	ret = message->current;
+	message->current += length;
+
+	return ret;
+}
+
+/**
+ * Gets a string from a message.
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ *
+ * \return A string.
+ **/
+gchar const*
+j_message_get_string(JMessage* message)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gchar const* ret;
+
+	g_return_val_if_fail(message != NULL, NULL);
+
+	ret = message->current;
+	message->current += strlen(ret) + 1;
+
+	return ret;
+}
+
+/**
+ * Gets additional data from a reply.
+ * The additional data has been sent using j_message_add_send() or j_message_add_send_length().
+ * If it has not been buffered yet, the remaining additional data is read into the reply first.
+ * Use j_message_receive_send() to avoid this copy.
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A reply message.
+ * \param length  A length.
+ *
+ * \return The data, NULL if the reply does not contain enough additional data.
+ **/
+gconstpointer
+j_message_get_send(JMessage* message, guint64 length)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gconstpointer ret;
+
+	g_return_val_if_fail(message != NULL, NULL);
+
+	if (message->send_connection != NULL)
+	{
+		GInputStream* stream;
+		GError* error = NULL;
+		gsize bytes_read;
+		gsize offset;
+
+		stream = g_io_stream_get_input_stream(G_IO_STREAM(message->send_connection));
+		offset = j_message_length(message) + j_message_send_length(message) - message->send_remaining;
+
+		j_message_ensure_size(message, j_message_length(message) + j_message_send_length(message));
+
+		if (!g_input_stream_read_all(stream, message->data + offset, message->send_remaining, &bytes_read, NULL, &error) || bytes_read != message->send_remaining)
+		{
+			if (error != NULL)
+			{
+				g_critical("%s", error->message);
+				g_error_free(error);
+			}
+
+			message->send_remaining = 0;
+			j_message_finish_send(message);
+
+			return NULL;
+		}
+
+		message->send_current = message->data + offset;
+		message->send_remaining = 0;
+		j_message_finish_send(message);
+	}
+
+	g_return_val_if_fail(message->send_current != NULL, NULL);
+	g_return_val_if_fail(message->send_current + length <= message->data + j_message_length(message) + j_message_send_length(message), NULL);
+
+	ret = message->send_current;
+	message->send_current += length;
+
+	return ret;
+}
+
+/**
+ * Receives additional data from a reply into a buffer.
+ * The additional data is read from the connection directly into the buffer if possible,
+ * so that large replies do not have to be buffered in the reply first.
+ *
+ * On multiplexed connections, other threads cannot read from the connection until all additional data has been received,
+ * the reply is received again or the reply is freed.
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A reply message.
+ * \param data    A buffer.
+ * \param length  The number of bytes to receive.
+ *
+ * \return TRUE on success, FALSE if an error occurred or the reply does not contain enough additional data.
+ **/
+gboolean
+j_message_receive_send(JMessage* message, gpointer data, guint64 length)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = FALSE;
+
+	GInputStream* stream;
+	GError* error = NULL;
+	gsize bytes_read;
+
+	g_return_val_if_fail(message != NULL, FALSE);
+	g_return_val_if_fail(data != NULL || length == 0, FALSE);
+
+	if (message->send_connection == NULL)
+	{
+		gconstpointer send;
+
+		// The reply has been read by another thread, so its additional data has been buffered.
+		send = j_message_get_send(message, length);
+
+		if (send == NULL)
+		{
+			return FALSE;
+		}
+
+		memcpy(data, send, length);
+
+		return TRUE;
+	}
+
+	g_return_val_if_fail(length <= message->send_remaining, FALSE);
+
+	stream = g_io_stream_get_input_stream(G_IO_STREAM(message->send_connection));
+
+	if (!g_input_stream_read_all(stream, data, length, &bytes_read, NULL, &error) || bytes_read != length)
+	{
+		// The connection is unusable, there is no point in skipping the rest.
+		message->send_remaining = 0;
+		goto end;
+	}
+
+	message->send_remaining -= length;
+	ret = TRUE;
+
+end:
+	if (error != NULL)
+	{
+		g_critical("%s", error->message);
+		g_error_free(error);
+	}
+
+	if (message->send_remaining == 0)
+	{
+		j_message_finish_send(message);
+	}
+
+	return ret;
+}
+
+/**
+ * Writes a message to a socket.
+ * Header, body and additional data are sent using scatter-gather I/O,
+ * so that small messages only require a single system call.
+ *
+ * \private
+ *
+ * \param message A message.
+ * \param socket_ A socket.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+static gboolean
+j_message_send_vectors(JMessage* message, GSocket* socket_)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	// Linux does not allow more vectors per call (UIO_MAXIOV).
+	guint const max_vectors = 1024;
+
+	gboolean ret = FALSE;
+
+	g_autoptr(JListIterator) iterator = NULL;
+	g_autofree GOutputVector* vectors = NULL;
+	GOutputVector* current;
+	GError* error = NULL;
+	guint segments_len;
+	guint vectors_len;
+	guint i = 1;
+
+	segments_len = (message->segments != NULL) ? message->segments->len : 0;
+	vectors_len = 2 + segments_len + j_list_length(message->send_list);
+	vectors = g_new(GOutputVector, vectors_len);
+
+	vectors[0].buffer = &(message->header);
+	vectors[0].size = sizeof(JMessageHeader);
+
+	for (guint j = 0; j < segments_len; j++)
+	{
+		JMessageSegment* segment = &g_array_index(message->segments, JMessageSegment, j);
+
+		vectors[i].buffer = segment->data;
+		vectors[i].size = segment->length;
+		i++;
+	}
+
+	vectors[i].buffer = message->data;
+	vectors[i].size = j_message_data_length(message);
+	i++;
+
+	iterator = j_list_iterator_new(message->send_list);
+
+	while (j_list_iterator_next(iterator))
+	{
+		JMessageData* message_data = j_list_iterator_get(iterator);
+
+		vectors[i].buffer = message_data->data;
+		vectors[i].size = message_data->length;
+		i++;
+	}
+
+	current = vectors;
+
+	while (vectors_len > 0)
+	{
+		gssize bytes_written;
+
+		bytes_written = g_socket_send_message(socket_, NULL, current, MIN(vectors_len, max_vectors), NULL, 0, 0, NULL, &error);
+
+		if (bytes_written < 0)
+		{
+			goto end;
+		}
+
+		// Skip the vectors that have been written completely and continue after short writes.
+		while (vectors_len > 0 && (gsize)bytes_written >= current->size)
+		{
+			bytes_written -= current->size;
+			current++;
+			vectors_len--;
+		}
+
+		if (vectors_len > 0 && bytes_written > 0)
+		{
+			current->buffer = (gchar const*)current->buffer + bytes_written;
+			current->size -= bytes_written;
+		}
+	}
+
+	ret = TRUE;
+
+end:
+	if (error != NULL)
+	{
+		g_critical("%s", error->message);
+		g_error_free(error);
+	}
+
+	return ret;
+}
+
+/**
+ * Reads a message header from the network.
+ *
+ * \private
+ *
+ * \param header A header.
+ * \param stream A network stream.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+static gboolean
+j_message_read_header(JMessageHeader* header, GInputStream* stream)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = FALSE;
+
+	GError* error = NULL;
+	gsize bytes_read;
+
+	if (!g_input_stream_read_all(stream, header, sizeof(JMessageHeader), &bytes_read, NULL, &error) || bytes_read != sizeof(JMessageHeader))
+	{
+		goto end;
+	}
+
+	ret = TRUE;
+
+end:
+	if (error != NULL)
+	{
+		g_critical("%s", error->message);
+		g_error_free(error);
+	}
+
+	return ret;
+}
+
+/**
+ * Reads a message body from the network.
+ * The message's header has to be set already.
+ *
+ * \private
+ *
+ * \param message A message.
+ * \param stream  A network stream.
+ * \param send    Whether to read the additional data following the body, too.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+static gboolean
+j_message_read_body(JMessage* message, GInputStream* stream, gboolean send)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = FALSE;
+
+	GError* error = NULL;
+	gsize bytes_read;
+	gsize length;
+
+	length = j_message_length(message);
+
+	if (send)
+	{
+		length += j_message_send_length(message);
+	}
+
+	j_message_ensure_size(message, length);
+
+	if (!g_input_stream_read_all(stream, message->data, length, &bytes_read, NULL, &error) || bytes_read != length)
+	{
+		goto end;
+	}
+
+	message->current = message->data;
+	message->send_current = (send) ? message->data + j_message_length(message) : NULL;
+
+	if (message->original_message != NULL)
+	{
+		g_assert(message->header.id == message->original_message->header.id);
+	}
+
+	ret = TRUE;
+
+end:
+	if (error != NULL)
+	{
+		g_critical("%s", error->message);
+		g_error_free(error);
+	}
+
+	return ret;
+}
+
+/**
+ * Looks up a message's slot, registering the message if necessary.
+ * The multiplexing state's mutex has to be held.
+ *
+ * \private
+ *
+ * \param multiplex  The connection's multiplexing state.
+ * \param connection The connection.
+ * \param message    A message that is not a reply.
+ *
+ * \return The slot.
+ **/
+static JMessageMultiplexSlot*
+j_message_multiplex_register(JMessageMultiplex* multiplex, gpointer connection, JMessage* message)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JMessageMultiplexSlot* slot;
+
+	slot = g_hash_table_lookup(multiplex->pending, GUINT_TO_POINTER(message->header.id));
+
+	if (slot == NULL)
+	{
+		slot = g_slice_new(JMessageMultiplexSlot);
+		slot->wakeup = NULL;
+		g_queue_init(&(slot->replies));
+
+		g_hash_table_insert(multiplex->pending, GUINT_TO_POINTER(message->header.id), slot);
+
+		// The slot is released together with the message, see j_message_multiplex_release().
+		if (g_slist_find(message->connections, connection) == NULL)
+		{
+			message->connections = g_slist_prepend(message->connections, g_object_ref(connection));
+		}
+	}
+
+	return slot;
+}
+
+/**
+ * Moves a reply that has been read by another thread into a message.
+ * The buffers are swapped, so that no data has to be copied.
+ *
+ * \private
+ *
+ * \param message A message.
+ * \param reply   The reply.
+ **/
+static void
+j_message_take(JMessage* message, JMessage* reply)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gchar* data;
+	gsize size;
+
+	// Received messages always consist of a single segment.
+	j_message_segments_free(message);
+
+	data = message->data;
+	size = message->size;
+
+	message->header = reply->header;
+	message->data = reply->data;
+	message->size = reply->size;
+	message->current = message->data;
+	message->send_current = message->data + j_message_length(message);
+
+	reply->data = data;
+	reply->size = size;
+	reply->current = reply->data;
+	reply->send_current = NULL;
+}
+
+/**
+ * Reads a reply from a multiplexed connection.
+ *
+ * Only one thread reads from the connection at a time and it always reads a complete reply.
+ * Replies for other messages are read including their additional data, queued in their slots and their senders are woken up.
+ * The additional data of the message's own reply is left in the stream, so that it can be received directly into its destination.
+ * The reader gives up the connection after every reply, or once the own reply's additional data has been received, see j_message_finish_send().
+ *
+ * \private
+ *
+ * \param message    A reply message.
+ * \param multiplex  The connection's multiplexing state.
+ * \param connection A connection.
+ * \param block      Whether to wait for the reply. Otherwise, only replies that are already available are received.
+ * \param received   Returns whether the reply has been received.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+static gboolean
+j_message_receive_multiplexed(JMessage* message, JMessageMultiplex* multiplex, gpointer connection, gboolean block, gboolean* received)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = TRUE;
+
+	JMessageMultiplexSlot* slot;
+	GInputStream* stream;
+	GSocket* socket_;
+
+	*received = FALSE;
+
+	stream = g_io_stream_get_input_stream(G_IO_STREAM(connection));
+	socket_ = g_socket_connection_get_socket(connection);
+
+	// The reply might be reused, which only works if the previous one has been read completely.
+	if (!j_message_finish_send(message))
+	{
+		return FALSE;
+	}
+
+	g_mutex_lock(&(multiplex->mutex));
+
+	// The message has usually been registered by j_message_send() already.
+	slot = j_message_multiplex_register(multiplex, connection, message->original_message);
+
+	while (!*received)
+	{
+		JMessageMultiplexSlot* owner;
+		JMessageHeader header;
+		JMessage* reply;
+
+		reply = g_queue_pop_head(&(slot->replies));
+
+		if (reply != NULL)
+		{
+			j_message_take(message, reply);
+			j_message_unref(reply);
+
+			*received = TRUE;
+			break;
+		}
+
+		if (multiplex->reading)
+		{
+			if (!block)
+			{
+				break;
+			}
+
+			g_cond_wait(&(multiplex->cond), &(multiplex->mutex));
+			continue;
+		}
+
+		// Do not wait for replies that might take a long time to arrive.
+		if (!block && !g_socket_condition_check(socket_, G_IO_IN))
+		{
+			break;
+		}
+
+		multiplex->reading = TRUE;
+
+		// Other threads still have to be able to register their messages and check their slots while we are reading.
+		g_mutex_unlock(&(multiplex->mutex));
+
+		ret = j_message_read_header(&header, stream);
+
+		if (ret)
+		{
+			if (header.id == message->header.id)
+			{
+				message->header = header;
+				ret = j_message_read_body(message, stream, FALSE);
+			}
+			else
+			{
+				reply = j_message_alloc(256);
+				reply->header = header;
+				ret = j_message_read_body(reply, stream, TRUE);
+			}
+		}
+
+		g_mutex_lock(&(multiplex->mutex));
+
+		if (ret && reply == NULL && j_message_send_length(message) > 0)
+		{
+			// Keep reading from the connection until the additional data has been received.
+			message->send_connection = g_object_ref(connection);
+			message->send_remaining = j_message_send_length(message);
+
+			*received = TRUE;
+			break;
+		}
+
+		j_message_multiplex_stop_reading(multiplex);
+
+		if (!ret)
+		{
+			if (reply != NULL)
+			{
+				j_message_unref(reply);
+			}
+
+			break;
+		}
+
+		if (reply == NULL)
+		{
+			*received = TRUE;
+			break;
+		}
+
+		owner = g_hash_table_lookup(multiplex->pending, GUINT_TO_POINTER(header.id));
+
+		if (owner == NULL)
+		{
+			// The reply has been read completely, so the connection remains usable.
+			g_critical("Discarding unexpected reply %u.", GUINT32_FROM_LE(header.id));
+			j_message_unref(reply);
+			continue;
+		}
+
+		g_queue_push_tail(&(owner->replies), reply);
+
+		// Fan-outs do not wait on the condition.
+		if (owner->wakeup != NULL)
+		{
+			j_message_wakeup_signal(owner->wakeup);
+		}
+	}
+
+	g_mutex_unlock(&(multiplex->mutex));
+
+	return ret;
+}
+
+/**
+ * Enables multiplexing for a connection.
+ *
+ * Afterwards, multiple threads can use the connection concurrently.
+ * Replies are matched to their messages using the message ID and can arrive in any order.
+ * Replies that have not been received are discarded once their message is freed.
+ *
+ * \code
+ * \endcode
+ *
+ * \param connection A connection.
+ **/
+void
+j_message_multiplex_init(gpointer connection)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JMessageMultiplex* multiplex;
+
+	g_return_if_fail(connection != NULL);
+	g_return_if_fail(j_message_multiplex_get(connection) == NULL);
+
+	multiplex = g_slice_new(JMessageMultiplex);
+	g_mutex_init(&(multiplex->send_mutex));
+	g_mutex_init(&(multiplex->mutex));
+	g_cond_init(&(multiplex->cond));
+	multiplex->pending = g_hash_table_new_full(NULL, NULL, NULL, j_message_multiplex_slot_free);
+	multiplex->reading = FALSE;
+	multiplex->waiters = g_ptr_array_new_with_free_func(j_message_wakeup_unref);
+
+	g_object_set_qdata_full(G_OBJECT(connection), g_quark_from_static_string("j-message-multiplex"), multiplex, j_message_multiplex_free);
+}
+
+/**
+ * Reads a message from the network.
+ *
+ * The additional data following a message is left in the stream, so that it can be received directly into its destination.
+ * For replies, it can be received using j_message_receive_send() or j_message_get_send().
+ * If the connection is multiplexed, waits for the reply belonging to the message's original message.
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ * \parem stream  A network stream.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+j_message_receive(JMessage* message, gpointer connection)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JMessageMultiplex* multiplex;
+	GInputStream* stream;
+	gboolean received;
+
+	g_return_val_if_fail(message != NULL, FALSE);
+	g_return_val_if_fail(connection != NULL, FALSE);
+
+	multiplex = j_message_multiplex_get(connection);
+	stream = g_io_stream_get_input_stream(G_IO_STREAM(connection));
+
+	if (message->original_message == NULL)
+	{
+		return j_message_read(message, stream);
+	}
+
+	if (multiplex != NULL)
+	{
+		return j_message_receive_multiplexed(message, multiplex, connection, TRUE, &received);
+	}
+
+	if (!j_message_finish_send(message) || !j_message_read_header(&(message->header), stream))
+	{
+		return FALSE;
+	}
+
+	if (!j_message_read_body(message, stream, FALSE))
+	{
+		return FALSE;
+	}
+
+	if (j_message_send_length(message) > 0)
+	{
+		message->send_connection = g_object_ref(connection);
+		message->send_remaining = j_message_send_length(message);
+	}
+
+	return TRUE;
+}
+
+/**
+ * Reads as much of a message from the network as is available without blocking.
+ * Can be called repeatedly until the message is complete.
+ * Like j_message_receive(), the additional data following the message is left in the stream.
+ *
+ * \code
+ * \endcode
+ *
+ * \param message    A message.
+ * \param connection A connection.
+ * \param complete   Returns whether the message is complete.
+ *
+ * \return TRUE on success, FALSE if an error occurred or the connection has been closed.
+ **/
+gboolean
+j_message_receive_nonblocking(JMessage* message, gpointer connection, gboolean* complete)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = FALSE;
+
+	GSocket* socket_;
+	GError* error = NULL;
+
+	g_return_val_if_fail(message != NULL, FALSE);
+	g_return_val_if_fail(connection != NULL, FALSE);
+	g_return_val_if_fail(complete != NULL, FALSE);
+
+	*complete = FALSE;
+
+	socket_ = g_socket_connection_get_socket(connection);
+
+	while (TRUE)
+	{
+		gchar* buffer;
+		gsize length;
+		gssize nbytes;
+
+		if (message->received < sizeof(JMessageHeader))
+		{
+			buffer = (gchar*)&(message->header) + message->received;
+			length = sizeof(JMessageHeader) - message->received;
+		}
+		else
+		{
+			gsize body_received;
+
+			body_received = message->received - sizeof(JMessageHeader);
+
+			if (body_received == 0)
+			{
+				j_message_ensure_size(message, j_message_length(message));
+			}
+
+			if (body_received == j_message_length(message))
+			{
+				message->current = message->data;
+				message->send_current = NULL;
+				message->received = 0;
+
+				*complete = TRUE;
+				ret = TRUE;
+				break;
+			}
+
+			buffer = message->data + body_received;
+			length = j_message_length(message) - body_received;
+		}
+
+		nbytes = g_socket_receive_with_blocking(socket_, buffer, length, FALSE, NULL, &error);
+
+		if (nbytes < 0)
+		{
+			if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
+			{
+				g_clear_error(&error);
+				ret = TRUE;
+			}
+
+			break;
+		}
+		else if (nbytes == 0)
+		{
+			break;
+		}
+
+		message->received += nbytes;
+	}
 
-	return message;
+	if (error != NULL)
+	{
+		g_critical("%s", error->message);
+		g_error_free(error);
+	}
+
+	return ret;
 }
 
 /**
- * Creates a new reply message.
+ * Writes a message to the network.
  *
  * \code
  * \endcode
  *
  * \param message A message.
+ * \parem stream  A network stream.
  *
- * \return A new reply message. Should be freed with j_message_unref().
+ * \return TRUE on success, FALSE if an error occurred.
  **/
-JMessage*
-j_message_new_reply(JMessage* message)
+gboolean
+j_message_send(JMessage* message, gpointer connection)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	JMessage* reply;
+	gboolean ret;
 
-	g_return_val_if_fail(message != NULL, NULL);
+	JMessageMultiplex* multiplex;
 
-	reply = g_slice_new(JMessage);
-	reply->size = 256;
-	reply->data = g_malloc(reply->size);
-	reply->current = reply->data;
-	reply->send_list = j_list_new(j_message_data_free);
-	reply->original_message = j_message_ref(message);
-	reply->ref_count = 1;
+	g_return_val_if_fail(message != NULL, FALSE);
+	g_return_val_if_fail(connection != NULL, FALSE);
 
-	reply->header.length = GUINT32_TO_LE(0);
-	reply->header.id = message->header.id;
-	reply->header.semantics = GUINT32_TO_LE(0);
-	reply->header.op_type = message->header.op_type;
-	reply->header.op_count = GUINT32_TO_LE(0);
+	multiplex = j_message_multiplex_get(connection);
 
-	return reply;
-}
+	if (multiplex != NULL)
+	{
+		// Register the message before sending it, the reply might be read by another thread.
+		if (message->original_message == NULL)
+		{
+			g_mutex_lock(&(multiplex->mutex));
+			j_message_multiplex_register(multiplex, connection, message);
+			g_mutex_unlock(&(multiplex->mutex));
+		}
 
-/**
- * Increases a message's reference count.
- *
- * \code
- * JMessage* m;
- *
- * j_message_ref(m);
- * \endcode
- *
- * \param message A message.
- *
- * \return #message.
- **/
-JMessage*
-j_message_ref(JMessage* message)
-{
-	J_TRACE_FUNCTION(NULL);
+		g_mutex_lock(&(multiplex->send_mutex));
+	}
 
-	g_return_val_if_fail(message != NULL, NULL);
+	ret = j_message_send_vectors(message, g_socket_connection_get_socket(connection));
 
-	g_atomic_int_inc(&(message->ref_count));
+	if (multiplex != NULL)
+	{
+		g_mutex_unlock(&(multiplex->send_mutex));
+	}
 
-	return message;
+	return ret;
 }
 
 /**
- * Decreases a message's reference count.
- * When the reference count reaches zero, frees the memory allocated for the message.
+ * Checks whether another thread has already read a reply for a message.
+ * The reply has been removed from the socket in this case, so polling the socket would not notice it.
+ * Instead, the wakeup is signaled when another thread reads the next reply or stops reading from the connection.
  *
- * \code
- * \endcode
+ * \private
  *
- * \param message A message.
+ * \param connection A connection.
+ * \param message    A reply message.
+ * \param wakeup     The fan-out's wakeup.
+ * \param reading    Returns whether another thread is currently reading from the connection.
+ *
+ * \return TRUE if a reply is waiting, FALSE otherwise.
  **/
-void
-j_message_unref(JMessage* message)
+static gboolean
+j_message_multiplex_has_reply(gpointer connection, JMessage* message, JMessageWakeup* wakeup, gboolean* reading)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	g_return_if_fail(message != NULL);
+	JMessageMultiplex* multiplex;
+	JMessageMultiplexSlot* slot;
+	gboolean ret;
 
-	if (g_atomic_int_dec_and_test(&(message->ref_count)))
+	*reading = FALSE;
+
+	multiplex = j_message_multiplex_get(connection);
+
+	if (multiplex == NULL)
 	{
-		if (message->original_message != NULL)
-		{
-			j_message_unref(message->original_message);
-		}
+		return FALSE;
+	}
 
-		if (message->send_list != NULL)
-		{
-			j_list_unref(message->send_list);
-		}
+	g_mutex_lock(&(multiplex->mutex));
 
-		g_free(message->data);
+	slot = g_hash_table_lookup(multiplex->pending, GUINT_TO_POINTER(message->header.id));
+	ret = (slot != NULL && !g_queue_is_empty(&(slot->replies)));
+	*reading = multiplex->reading;
 
-		g_slice_free(JMessage, message);
+	if (slot != NULL && slot->wakeup == NULL)
+	{
+		slot->wakeup = j_message_wakeup_ref(wakeup);
+	}
+
+	if (!ret && *reading && !g_ptr_array_find(multiplex->waiters, wakeup, NULL))
+	{
+		g_ptr_array_add(multiplex->waiters, j_message_wakeup_ref(wakeup));
 	}
+
+	g_mutex_unlock(&(multiplex->mutex));
+
+	return ret;
 }
 
 /**
- * Returns a message's type.
- *
- * \code
- * \endcode
+ * Forgets about a message on a multiplexed connection before the message is freed.
+ * Other messages, including those sent by the same thread, are not affected.
  *
- * \param message A message.
+ * \private
  *
- * \return The message's operation type.
+ * \param connection A connection.
+ * \param message    A message.
  **/
-JMessageType
-j_message_get_type(JMessage const* message)
+static void
+j_message_multiplex_forget(gpointer connection, JMessage* message)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	JMessageType op_type;
+	JMessageMultiplex* multiplex;
+	GSList* link;
 
-	g_return_val_if_fail(message != NULL, J_MESSAGE_NONE);
+	multiplex = j_message_multiplex_get(connection);
 
-	op_type = message->header.op_type;
-	op_type = GUINT32_FROM_LE(op_type);
+	if (multiplex == NULL)
+	{
+		return;
+	}
 
-	return op_type;
+	g_mutex_lock(&(multiplex->mutex));
+	g_hash_table_remove(multiplex->pending, GUINT_TO_POINTER(message->header.id));
+	g_mutex_unlock(&(multiplex->mutex));
+
+	link = g_slist_find(message->connections, connection);
+
+	if (link != NULL)
+	{
+		message->connections = g_slist_delete_link(message->connections, link);
+		g_object_unref(connection);
+	}
 }
 
 /**
- * Returns a message's count.
- *
- * \code
- * \endcode
+ * Completes a fan-out entry that does not expect any further replies.
  *
- * \param message A message.
+ * \private
  *
- * \return The message's operation count.
+ * \param entry An entry.
+ * \param ret   Whether the entry has been successful.
  **/
-guint32
-j_message_get_count(JMessage const* message)
+static void
+j_message_fanout_complete(JMessageFanoutEntry* entry, gboolean ret)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	guint32 op_count;
-
-	g_return_val_if_fail(message != NULL, 0);
-
-	op_count = message->header.op_count;
-	op_count = GUINT32_FROM_LE(op_count);
-
-	return op_count;
+	if (entry->done != NULL)
+	{
+		entry->done(ret, entry->data);
+	}
 }
 
 /**
- * Appends 1 byte to a message.
+ * Receives and handles a single reply of a fan-out entry.
+ * Never waits for replies on multiplexed connections, which might currently be read by other threads.
  *
- * \code
- * \endcode
+ * \private
  *
- * \param message A message.
- * \param data    Data to append.
+ * \param entry An entry.
  *
  * \return TRUE on success, FALSE if an error occurred.
  **/
-gboolean
-j_message_append_1(JMessage* message, gconstpointer data)
+static gboolean
+j_message_fanout_receive(JMessageFanoutEntry* entry)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	guint32 new_length;
+	JMessageMultiplex* multiplex;
+	gboolean received = TRUE;
+	gboolean ret;
 
-	g_return_val_if_fail(message != NULL, FALSE);
-	g_return_val_if_fail(data != NULL, FALSE);
-	g_return_val_if_fail(j_message_can_append(message, 1), FALSE);
+	multiplex = j_message_multiplex_get(entry->connection);
 
-	*(message->current) = *((gchar const*)data);
-	message->current += 1;
+	if (multiplex != NULL)
+	{
+		ret = j_message_receive_multiplexed(entry->reply, multiplex, entry->connection, FALSE, &received);
+	}
+	else
+	{
+		// The connection is not shared, so we can wait for the reply.
+		ret = j_message_receive(entry->reply, entry->connection);
+	}
 
-	new_length = j_message_length(message) + 1;
-	message->header.length = GUINT32_TO_LE(new_length);
+	if (ret && !received)
+	{
+		return TRUE;
+	}
 
-	return TRUE;
+	entry->pending = FALSE;
+
+	if (ret)
+	{
+		entry->pending = entry->func(entry->reply, entry->connection, entry->data);
+		// Additional data the function did not receive is discarded, so that the connection can be read again.
+		ret = j_message_finish_send(entry->reply);
+		entry->pending = entry->pending && ret;
+	}
+
+	if (!entry->pending)
+	{
+		if (ret)
+		{
+			// Allows choosing between servers depending on how fast they answer.
+			j_connection_pool_add_latency(entry->connection, g_get_monotonic_time() - entry->start);
+		}
+
+		j_message_multiplex_forget(entry->connection, entry->message);
+		j_message_fanout_complete(entry, ret);
+	}
+
+	return ret;
 }
 
 /**
- * Appends 4 bytes to a message.
- * The bytes are converted to little endian automatically.
+ * Creates a new fan-out.
+ *
+ * A fan-out sends messages to multiple connections and handles their replies in the order they arrive.
+ * All of this happens in the calling thread, which waits for all connections at once.
+ * This allows contacting many servers without requiring one thread per server.
  *
  * \code
  * \endcode
  *
- * \param message A message.
- * \param data    Data to append.
- *
- * \return TRUE on success, FALSE if an error occurred.
+ * \return A new fan-out. Should be freed with j_message_fanout_free().
  **/
-gboolean
-j_message_append_4(JMessage* message, gconstpointer data)
+JMessageFanout*
+j_message_fanout_new(void)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	gint32 new_data;
-	guint32 new_length;
-
-	g_return_val_if_fail(message != NULL, FALSE);
-	g_return_val_if_fail(data != NULL, FALSE);
-	g_return_val_if_fail(j_message_can_append(message, 4), FALSE);
-
-	new_data = GINT32_TO_LE(*((gint32 const*)data));
-	memcpy(message->current, &new_data, 4);
-	message->current += 4;
+	JMessageFanout* fanout;
 
-	new_length = j_message_length(message) + 4;
-	message->header.length = GUINT32_TO_LE(new_length);
+	fanout = g_slice_new(JMessageFanout);
+	fanout->entries = g_array_new(FALSE, FALSE, sizeof(JMessageFanoutEntry));
+	fanout->wakeup = j_message_wakeup_new();
+	fanout->interrupted = FALSE;
 
-	return TRUE;
+	return fanout;
 }
 
 /**
- * Appends 8 bytes to a message.
- * The bytes are converted to little endian automatically.
+ * Frees a fan-out.
  *
  * \code
  * \endcode
  *
- * \param message A message.
- * \param data    Data to append.
- *
- * \return TRUE on success, FALSE if an error occurred.
+ * \param fanout A fan-out.
  **/
-gboolean
-j_message_append_8(JMessage* message, gconstpointer data)
+void
+j_message_fanout_free(JMessageFanout* fanout)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	gint64 new_data;
-	guint32 new_length;
+	g_return_if_fail(fanout != NULL);
 
-	g_return_val_if_fail(message != NULL, FALSE);
-	g_return_val_if_fail(data != NULL, FALSE);
-	g_return_val_if_fail(j_message_can_append(message, 8), FALSE);
+	for (guint i = 0; i < fanout->entries->len; i++)
+	{
+		JMessageFanoutEntry* entry = &g_array_index(fanout->entries, JMessageFanoutEntry, i);
 
-	new_data = GINT64_TO_LE(*((gint64 const*)data));
-	memcpy(message->current, &new_data, 8);
-	message->current += 8;
+		if (entry->reply != NULL)
+		{
+			j_message_unref(entry->reply);
+		}
 
-	new_length = j_message_length(message) + 8;
-	message->header.length = GUINT32_TO_LE(new_length);
+		j_message_unref(entry->message);
+	}
 
-	return TRUE;
+	g_array_unref(fanout->entries);
+	j_message_wakeup_unref(fanout->wakeup);
+	g_slice_free(JMessageFanout, fanout);
 }
 
 /**
- * Appends a number of bytes to a message.
+ * Adds a message to a fan-out.
+ * Each connection must only be used once per fan-out.
  *
  * \code
- * gchar* str = "Hello world!";
- * ...
- * j_message_append_n(message, str, strlen(str) + 1);
  * \endcode
  *
- * \param message A message.
- * \param data    Data to append.
- * \param length  Length of data.
- *
- * \return TRUE on success, FALSE if an error occurred.
+ * \param fanout     A fan-out.
+ * \param message    A message.
+ * \param connection The connection to send the message on.
+ * \param func       The function to call for each reply, NULL if no reply is expected.
+ * \param data       The data to pass to func.
  **/
-gboolean
-j_message_append_n(JMessage* message, gconstpointer data, gsize length)
+void
+j_message_fanout_add(JMessageFanout* fanout, JMessage* message, gpointer connection, JMessageReplyFunc func, gpointer data)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	guint32 new_length;
-
-	g_return_val_if_fail(message != NULL, FALSE);
-	g_return_val_if_fail(data != NULL, FALSE);
-	g_return_val_if_fail(j_message_can_append(message, length), FALSE);
-
-	memcpy(message->current, data, length);
-	message->current += length;
-
-	new_length = j_message_length(message) + length;
-	message->header.length = GUINT32_TO_LE(new_length);
-
-	return TRUE;
+	j_message_fanout_add_full(fanout, message, connection, func, NULL, data);
 }
 
 /**
- * Appends a string to a message.
+ * Adds a message to a fan-out and gets notified once it has been completed.
+ * In contrast to j_message_fanout_add(), multiplexed connections can be used for several messages,
+ * as long as j_message_fanout_is_pending() and j_message_fanout_cancel() are only used with NULL or other connections.
  *
  * \code
- * gchar* str = "Hello world!";
- * ...
- * j_message_append_string(message, str);
  * \endcode
  *
- * \param message A message.
- * \param str     String to append.
- *
- * \return TRUE on success, FALSE if an error occurred.
- **/
-gboolean
-j_message_append_string(JMessage* message, gchar const* str)
+ * \param fanout     A fan-out.
+ * \param message    A message.
+ * \param connection The connection to send the message on.
+ * \param func       The function to call for each reply, NULL if no reply is expected.
+ * \param done       The function to call once the message has been sent and all replies have been handled, NULL if none.
+ * \param data       The data to pass to func and done.
+ **/
+void
+j_message_fanout_add_full(JMessageFanout* fanout, JMessage* message, gpointer connection, JMessageReplyFunc func, JMessageDoneFunc done, gpointer data)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	g_return_val_if_fail(message != NULL, FALSE);
-	g_return_val_if_fail(str != NULL, FALSE);
+	JMessageFanoutEntry entry;
 
-	return j_message_append_n(message, str, strlen(str) + 1);
+	g_return_if_fail(fanout != NULL);
+	g_return_if_fail(message != NULL);
+	g_return_if_fail(connection != NULL);
+
+	entry.message = j_message_ref(message);
+	entry.connection = connection;
+	entry.func = func;
+	entry.done = done;
+	entry.data = data;
+	entry.reply = NULL;
+	entry.sent = FALSE;
+	entry.pending = FALSE;
+	entry.start = 0;
+
+	g_array_append_val(fanout->entries, entry);
 }
 
 /**
- * Gets 1 byte from a message.
+ * Executes a fan-out, possibly returning early.
  *
- * \code
- * \endcode
+ * \private
  *
- * \param message A message.
+ * \param fanout   A fan-out.
+ * \param deadline The monotonic time to return at, -1 to wait without a deadline.
+ * \param early    Whether to return as soon as an entry has been completed.
  *
- * \return A character.
+ * \return TRUE on success, FALSE if an error occurred.
  **/
-gchar
-j_message_get_1(JMessage* message)
+static gboolean
+j_message_fanout_execute_internal(JMessageFanout* fanout, gint64 deadline, gboolean early)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	gchar ret;
+	gboolean ret = TRUE;
+	gboolean completed = FALSE;
 
-	g_return_val_if_fail(message != NULL, '\0');
-	g_return_val_if_fail(j_message_can_get(message, 1), '\0');
+	g_autofree GPollFD* fds = NULL;
+	g_autofree JMessageFanoutEntry** polled = NULL;
 
-	ret = *((gchar const*)(message->current));
-	message->current += 1;
+	for (guint i = 0; i < fanout->entries->len; i++)
+	{
+		JMessageFanoutEntry* entry = &g_array_index(fanout->entries, JMessageFanoutEntry, i);
+
+		if (entry->sent)
+		{
+			continue;
+		}
+
+		entry->sent = TRUE;
+		entry->start = g_get_monotonic_time();
+
+		if (!j_message_send(entry->message, entry->connection))
+		{
+			j_message_multiplex_forget(entry->connection, entry->message);
+			j_message_fanout_complete(entry, FALSE);
+			ret = FALSE;
+			continue;
+		}
+
+		if (entry->func != NULL)
+		{
+			entry->reply = j_message_new_reply(entry->message);
+			entry->pending = TRUE;
+		}
+		else
+		{
+			// No reply will arrive, so the message does not have to be kept around until the connection is returned.
+			j_message_multiplex_forget(entry->connection, entry->message);
+			j_message_fanout_complete(entry, TRUE);
+		}
+	}
+
+	// One additional file descriptor for the wakeup.
+	fds = g_new(GPollFD, fanout->entries->len + 1);
+	polled = g_new(JMessageFanoutEntry*, fanout->entries->len + 1);
+
+	while (!(early && completed))
+	{
+		gboolean handled = FALSE;
+		guint fds_len = 0;
+		guint waiting = 0;
+		gint poll_timeout = -1;
+		gint ready;
+
+		for (guint i = 0; i < fanout->entries->len; i++)
+		{
+			JMessageFanoutEntry* entry = &g_array_index(fanout->entries, JMessageFanoutEntry, i);
+			gboolean reading;
+
+			if (!entry->pending)
+			{
+				continue;
+			}
+
+			if (j_message_multiplex_has_reply(entry->connection, entry->reply, fanout->wakeup, &reading))
+			{
+				ret = j_message_fanout_receive(entry) && ret;
+				completed = completed || !entry->pending;
+				handled = TRUE;
+				continue;
+			}
+
+			// The connection is readable until the other thread has read its reply, polling it would spin.
+			// The wakeup is signaled once the other thread is done.
+			if (reading)
+			{
+				waiting++;
+				continue;
+			}
+
+			fds[fds_len].fd = g_socket_get_fd(g_socket_connection_get_socket(entry->connection));
+			fds[fds_len].events = G_IO_IN;
+			fds[fds_len].revents = 0;
+			polled[fds_len] = entry;
+			fds_len++;
+		}
+
+		if (handled)
+		{
+			continue;
+		}
+
+		if (fds_len == 0 && waiting == 0)
+		{
+			break;
+		}
+
+		// Replies read by other threads do not make the connections readable.
+		if (fanout->wakeup->read_fd != -1)
+		{
+			fds[fds_len].fd = fanout->wakeup->read_fd;
+			fds[fds_len].events = G_IO_IN;
+			fds[fds_len].revents = 0;
+			polled[fds_len] = NULL;
+			fds_len++;
+		}
+
+		if (deadline >= 0)
+		{
+			gint64 remaining;
+
+			remaining = deadline - g_get_monotonic_time();
+
+			if (remaining <= 0)
+			{
+				break;
+			}
+
+			// Round up, otherwise we would spin during the last millisecond.
+			poll_timeout = MIN(G_MAXINT, (remaining + 999) / 1000);
+		}
+
+		// j_message_fanout_wakeup() sets the flag before signaling, so later calls still interrupt the poll.
+		if (early && g_atomic_int_compare_and_exchange(&(fanout->interrupted), TRUE, FALSE))
+		{
+			break;
+		}
+
+		ready = g_poll(fds, fds_len, poll_timeout);
+
+		if (ready < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			g_critical("Could not poll connections: %s", g_strerror(errno));
+			ret = FALSE;
+			break;
+		}
+
+		for (guint i = 0; i < fds_len && ready > 0; i++)
+		{
+			if (fds[i].revents == 0)
+			{
+				continue;
+			}
+
+			ready--;
+
+			// The entries are checked for replies again in the next iteration.
+			if (polled[i] == NULL)
+			{
+				j_message_wakeup_consume(fanout->wakeup);
+				continue;
+			}
+
+			// Errors and hang-ups are noticed while receiving.
+			ret = j_message_fanout_receive(polled[i]) && ret;
+			completed = completed || !polled[i]->pending;
+		}
+	}
 
 	return ret;
 }
 
 /**
- * Gets 4 bytes from a message.
- * The bytes are converted from little endian automatically.
+ * Executes a fan-out.
+ *
+ * First, all messages are sent.
+ * Afterwards, the connections are polled and replies are handled as soon as they arrive.
+ * The reply function is called until it does not expect any more replies.
  *
  * \code
  * \endcode
  *
- * \param message A message.
+ * \param fanout A fan-out.
  *
- * \return A 4-bytes integer.
+ * \return TRUE on success, FALSE if an error occurred.
  **/
-gint32
-j_message_get_4(JMessage* message)
+gboolean
+j_message_fanout_execute(JMessageFanout* fanout)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	gint32 ret;
-
-	g_return_val_if_fail(message != NULL, 0);
-	g_return_val_if_fail(j_message_can_get(message, 4), 0);
-
-	memcpy(&ret, message->current, 4);
-	ret = GINT32_FROM_LE(ret);
-	message->current += 4;
+	g_return_val_if_fail(fanout != NULL, FALSE);
 
-	return ret;
+	return j_message_fanout_execute_internal(fanout, -1, FALSE);
 }
 
 /**
- * Gets 8 bytes from a message.
- * The bytes are converted from little endian automatically.
+ * Executes a fan-out for a limited time.
+ *
+ * Sends all messages that have not been sent yet and handles replies like j_message_fanout_execute().
+ * Returns as soon as an entry has been completed, all entries have been completed, the deadline has passed or j_message_fanout_wakeup() has been called.
+ * Can be called repeatedly, for instance after adding further messages to the fan-out.
  *
  * \code
+ * while (j_message_fanout_is_pending(fanout, NULL))
+ * {
+ *   ret = j_message_fanout_execute_until(fanout, deadline) && ret;
+ * }
  * \endcode
  *
- * \param message A message.
+ * \param fanout   A fan-out.
+ * \param deadline The monotonic time to return at, -1 to wait without a deadline.
  *
- * \return An 8-bytes integer.
+ * \return TRUE on success, FALSE if an error occurred.
  **/
-gint64
-j_message_get_8(JMessage* message)
+gboolean
+j_message_fanout_execute_until(JMessageFanout* fanout, gint64 deadline)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	gint64 ret;
-
-	g_return_val_if_fail(message != NULL, 0);
-	g_return_val_if_fail(j_message_can_get(message, 8), 0);
-
-	memcpy(&ret, message->current, 8);
-	ret = GINT64_FROM_LE(ret);
-	message->current += 8;
+	g_return_val_if_fail(fanout != NULL, FALSE);
 
-	return ret;
+	return j_message_fanout_execute_internal(fanout, deadline, TRUE);
 }
 
 /**
- * Gets n bytes from a message.
+ * Makes a fan-out that is waiting in j_message_fanout_execute_until() return.
+ * Can be called from any thread, for instance to have further messages added to the fan-out without waiting for a deadline.
+ * If the fan-out is not waiting, the next call to j_message_fanout_execute_until() returns once it would block.
  *
  * \code
  * \endcode
  *
- * \param message A message.
- *
- * \return A pointer to the data.
+ * \param fanout A fan-out.
  **/
-gpointer
-j_message_get_n(JMessage* message, gsize length)
+void
+j_message_fanout_wakeup(JMessageFanout* fanout)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	gpointer ret;
-
-	g_return_val_if_fail(message != NULL, NULL);
-	g_return_val_if_fail(j_message_can_get(message, length), NULL);
-
-	ret = message->current;
-	message->current += length;
+	g_return_if_fail(fanout != NULL);
 
-	return ret;
+	g_atomic_int_set(&(fanout->interrupted), TRUE);
+	j_message_wakeup_signal(fanout->wakeup);
 }
 
 /**
- * Gets a string from a message.
+ * Checks whether a fan-out is still waiting for replies.
  *
  * \code
  * \endcode
  *
- * \param message A message.
+ * \param fanout     A fan-out.
+ * \param connection A connection, NULL to check all connections.
  *
- * \return A string.
+ * \return TRUE if the connection's entry is still pending, FALSE otherwise. If connection is NULL, TRUE if any entry is still pending.
  **/
-gchar const*
-j_message_get_string(JMessage* message)
+gboolean
+j_message_fanout_is_pending(JMessageFanout* fanout, gpointer connection)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	gchar const* ret;
+	g_return_val_if_fail(fanout != NULL, FALSE);
 
-	g_return_val_if_fail(message != NULL, NULL);
+	for (guint i = 0; i < fanout->entries->len; i++)
+	{
+		JMessageFanoutEntry* entry = &g_array_index(fanout->entries, JMessageFanoutEntry, i);
 
-	ret = message->current;
-	message->current += strlen(ret) + 1;
+		if (connection != NULL && entry->connection != connection)
+		{
+			continue;
+		}
 
-	return ret;
+		// Unsent entries will become pending once the fan-out is executed.
+		if (entry->pending || (!entry->sent && entry->func != NULL))
+		{
+			return TRUE;
+		}
+	}
+
+	return FALSE;
 }
 
 /**
- * Reads a message from the network.
+ * Cancels a fan-out's entry.
+ * The fan-out stops waiting for the entry's replies.
+ *
+ * The connection itself is not touched and may already have been closed.
+ * The caller has to make sure that nobody else receives the outstanding replies, usually by closing the connection.
  *
  * \code
+ * if (j_connection_pool_discard(J_BACKEND_TYPE_OBJECT, index, connection))
+ * {
+ *   j_message_fanout_cancel(fanout, connection);
+ * }
  * \endcode
  *
- * \param message A message.
- * \parem stream  A network stream.
- *
- * \return TRUE on success, FALSE if an error occurred.
+ * \param fanout     A fan-out.
+ * \param connection The entry's connection.
  **/
-gboolean
-j_message_receive(JMessage* message, gpointer connection)
+void
+j_message_fanout_cancel(JMessageFanout* fanout, gpointer connection)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	GInputStream* stream;
+	g_return_if_fail(fanout != NULL);
+	g_return_if_fail(connection != NULL);
 
-	g_return_val_if_fail(message != NULL, FALSE);
-	g_return_val_if_fail(connection != NULL, FALSE);
+	for (guint i = 0; i < fanout->entries->len; i++)
+	{
+		JMessageFanoutEntry* entry = &g_array_index(fanout->entries, JMessageFanoutEntry, i);
 
-	stream = g_io_stream_get_input_stream(G_IO_STREAM(connection));
-	return j_message_read(message, stream);
+		if (entry->connection == connection)
+		{
+			gboolean completed;
+
+			completed = (entry->sent && !entry->pending);
+
+			entry->sent = TRUE;
+			entry->pending = FALSE;
+
+			if (!completed)
+			{
+				j_message_fanout_complete(entry, FALSE);
+			}
+		}
+	}
 }
 
 /**
- * Writes a message to the network.
+ * Removes all completed entries from a fan-out.
+ * This allows using a single fan-out for an unbounded number of messages, for instance in an event loop.
+ * Must not be called while the fan-out is being executed.
  *
  * \code
  * \endcode
  *
- * \param message A message.
- * \parem stream  A network stream.
- *
- * \return TRUE on success, FALSE if an error occurred.
+ * \param fanout A fan-out.
  **/
-gboolean
-j_message_send(JMessage* message, gpointer connection)
+void
+j_message_fanout_prune(JMessageFanout* fanout)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	gboolean ret;
+	guint len = 0;
 
-	GOutputStream* stream;
+	g_return_if_fail(fanout != NULL);
 
-	g_return_val_if_fail(message != NULL, FALSE);
-	g_return_val_if_fail(connection != NULL, FALSE);
+	for (guint i = 0; i < fanout->entries->len; i++)
+	{
+		JMessageFanoutEntry* entry = &g_array_index(fanout->entries, JMessageFanoutEntry, i);
 
-	j_helper_set_cork(connection, TRUE);
+		if (entry->sent && !entry->pending)
+		{
+			if (entry->reply != NULL)
+			{
+				j_message_unref(entry->reply);
+			}
 
-	stream = g_io_stream_get_output_stream(G_IO_STREAM(connection));
-	ret = j_message_write(message, stream);
+			j_message_unref(entry->message);
+			continue;
+		}
 
-	j_helper_set_cork(connection, FALSE);
+		if (i != len)
+		{
+			g_array_index(fanout->entries, JMessageFanoutEntry, len) = *entry;
+		}
 
-	return ret;
+		len++;
+	}
+
+	g_array_set_size(fanout->entries, len);
 }
 
 /**
@@ -847,43 +3017,15 @@ j_message_read(JMessage* message, GInputStream* stream)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	gboolean ret = FALSE;
-
-	GError* error = NULL;
-	gsize bytes_read;
-
 	g_return_val_if_fail(message != NULL, FALSE);
 	g_return_val_if_fail(stream != NULL, FALSE);
 
-	if (!g_input_stream_read_all(stream, &(message->header), sizeof(JMessageHeader), &bytes_read, NULL, &error) || bytes_read != sizeof(JMessageHeader))
-	{
-		goto end;
-	}
-
-	j_message_ensure_size(message, j_message_length(message));
-
-	if (!g_input_stream_read_all(stream, message->data, j_message_length(message), &bytes_read, NULL, &error) || bytes_read != j_message_length(message))
-	{
-		goto end;
-	}
-
-	message->current = message->data;
-
-	if (message->original_message != NULL)
-	{
-		g_assert(message->header.id == message->original_message->header.id);
-	}
-
-	ret = TRUE;
-
-end:
-	if (error != NULL)
+	if (!j_message_read_header(&(message->header), stream))
 	{
-		g_critical("%s", error->message);
-		g_error_free(error);
+		return FALSE;
 	}
 
-	return ret;
+	return j_message_read_body(message, stream, FALSE);
 }
 
 /**
@@ -916,7 +3058,20 @@ j_message_write(JMessage* message, GOutputStream* stream)
 		goto end;
 	}
 
-	if (!g_output_stream_write_all(stream, message->data, j_message_length(message), &bytes_written, NULL, &error) || bytes_written != j_message_length(message))
+	if (message->segments != NULL)
+	{
+		for (guint i = 0; i < message->segments->len; i++)
+		{
+			JMessageSegment* segment = &g_array_index(message->segments, JMessageSegment, i);
+
+			if (!g_output_stream_write_all(stream, segment->data, segment->length, &bytes_written, NULL, &error) || bytes_written != segment->length)
+			{
+				goto end;
+			}
+		}
+	}
+
+	if (!g_output_stream_write_all(stream, message->data, j_message_data_length(message), &bytes_written, NULL, &error) || bytes_written != j_message_data_length(message))
 	{
 		goto end;
 	}
@@ -976,6 +3131,31 @@ j_message_add_send(JMessage* message, gconstpointer data, guint64 length)
 	message_data->length = length;
 
 	j_list_append(message->send_list, message_data);
+
+	j_message_add_send_length(message, length);
+}
+
+/**
+ * Announces additional data that is sent separately, for instance, using sendfile().
+ * The data has to be written to the connection directly after sending the message.
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ * \param length  A length.
+ **/
+void
+j_message_add_send_length(JMessage* message, guint64 length)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	guint64 new_send_length;
+
+	g_return_if_fail(message != NULL);
+
+	new_send_length = j_message_send_length(message) + length;
+	message->header.send_length = GUINT64_TO_LE(new_send_length);
 }
 
 /**
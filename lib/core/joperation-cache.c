@@ -28,8 +28,6 @@
 
 #include <jbackground-operation-internal.h>
 #include <jcache.h>
-#include <jlist.h>
-#include <jlist-iterator.h>
 #include <jbatch.h>
 #include <jbatch-internal.h>
 #include <joperation-internal.h>
@@ -40,9 +38,20 @@
 /**
  * \defgroup JOperationCache Operation Cache
  *
+ * The operation cache executes batches with eventual persistency in the background.
+ * The payloads of cached operations are copied into the cache, so the caller can reuse its buffers immediately.
+ * Cached batches are executed in order by a single thread.
+ * If the cache is full, callers have to wait until enough cached batches have been executed.
+ * Uncached operations that work on the same resources as cached ones have to wait until the cached ones have been executed.
+ *
  * @{
  **/
 
+/**
+ * The alignment of the payloads within the cache.
+ **/
+#define J_OPERATION_CACHE_ALIGNMENT 8
+
 /**
  * An operation cache.
  */
@@ -53,6 +62,11 @@ struct JOperationCache
 	 */
 	JCache* cache;
 
+	/**
+	 * The size of #cache.
+	 */
+	guint64 size;
+
 	/**
 	 * The queue of operations.
 	 */
@@ -64,17 +78,27 @@ struct JOperationCache
 	GThread* thread;
 
 	/**
-	 * Whether #thread is currently working.
+	 * The number of cached operations per key.
+	 */
+	GHashTable* keys;
+
+	/**
+	 * The number of cached batches that have not been executed yet.
+	 */
+	guint pending;
+
+	/**
+	 * The number of cached batches that have been executed.
 	 */
-	gboolean working;
+	guint64 completed;
 
 	/**
-	 * The mutex for #working.
+	 * The mutex for #keys, #pending and #completed.
 	 */
 	GMutex mutex[1];
 
 	/**
-	 * The condition for #working.
+	 * The condition for #keys, #pending and #completed.
 	 */
 	GCond cond[1];
 };
@@ -91,6 +115,102 @@ typedef struct JCachedBatch JCachedBatch;
 
 static JOperationCache* j_operation_cache = NULL;
 
+static guint64
+j_operation_cache_align(guint64 size)
+{
+	return (size + J_OPERATION_CACHE_ALIGNMENT - 1) / J_OPERATION_CACHE_ALIGNMENT * J_OPERATION_CACHE_ALIGNMENT;
+}
+
+/**
+ * Updates the number of cached operations per key.
+ * The cache's mutex has to be held.
+ *
+ * \private
+ *
+ * \param cache  An operation cache.
+ * \param batch  A batch.
+ * \param add    Whether the batch's operations are added or removed.
+ **/
+static void
+j_operation_cache_update_keys(JOperationCache* cache, JBatch* batch, gboolean add)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	GArray* operations;
+
+	operations = j_batch_get_operations(batch);
+
+	for (guint i = 0; i < operations->len; i++)
+	{
+		JOperation* operation = &g_array_index(operations, JOperation, i);
+		guint count;
+
+		count = GPOINTER_TO_UINT(g_hash_table_lookup(cache->keys, operation->key));
+
+		if (add)
+		{
+			count++;
+		}
+		else
+		{
+			count--;
+		}
+
+		if (count > 0)
+		{
+			g_hash_table_insert(cache->keys, g_strdup(operation->key), GUINT_TO_POINTER(count));
+		}
+		else
+		{
+			g_hash_table_remove(cache->keys, operation->key);
+		}
+	}
+}
+
+/**
+ * Checks whether a batch conflicts with cached operations.
+ * The cache's mutex has to be held.
+ *
+ * \private
+ *
+ * \param cache An operation cache.
+ * \param batch A batch.
+ *
+ * \return TRUE if the batch has to wait for cached operations, FALSE otherwise.
+ **/
+static gboolean
+j_operation_cache_conflicts(JOperationCache* cache, JBatch* batch)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	GArray* operations;
+
+	if (cache->pending == 0)
+	{
+		return FALSE;
+	}
+
+	if (j_semantics_get(j_batch_get_semantics(batch), J_SEMANTICS_ORDERING) == J_SEMANTICS_ORDERING_STRICT)
+	{
+		return TRUE;
+	}
+
+	operations = j_batch_get_operations(batch);
+
+	for (guint i = 0; i < operations->len; i++)
+	{
+		JOperation* operation = &g_array_index(operations, JOperation, i);
+
+		// Operations without a key could depend on anything.
+		if (operation->key == NULL || g_hash_table_contains(cache->keys, operation->key))
+		{
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
 static gpointer
 j_operation_cache_thread(gpointer data)
 {
@@ -107,97 +227,92 @@ j_operation_cache_thread(gpointer data)
 			return NULL;
 		}
 
-		j_batch_execute_internal(cached_batch->batch);
-
-		j_batch_unref(cached_batch->batch);
-		j_cache_release(j_operation_cache->cache, cached_batch->data);
-		g_slice_free(JCachedBatch, cached_batch);
+		if (!j_batch_execute_internal(cached_batch->batch))
+		{
+			g_warning("Cached batch could not be executed successfully.");
+		}
 
 		g_mutex_lock(cache->mutex);
 
-		cache->working = (g_async_queue_length(cache->queue) > 0);
+		j_operation_cache_update_keys(cache, cached_batch->batch, FALSE);
+
+		g_mutex_unlock(cache->mutex);
+
+		j_batch_unref(cached_batch->batch);
 
-		if (!cache->working)
+		if (cached_batch->data != NULL)
 		{
-			g_cond_signal(cache->cond);
+			j_cache_release(cache->cache, cached_batch->data);
 		}
 
+		g_slice_free(JCachedBatch, cached_batch);
+
+		// The memory has to be released before waiting callers are woken up.
+		g_mutex_lock(cache->mutex);
+
+		cache->pending--;
+		cache->completed++;
+		g_cond_broadcast(cache->cond);
+
 		g_mutex_unlock(cache->mutex);
 	}
 
 	return NULL;
 }
 
-static gboolean
-j_operation_cache_test(JOperation* operation)
+/**
+ * Gets memory for cached payloads, waiting until enough cached batches have been executed if necessary.
+ *
+ * \private
+ *
+ * \param cache An operation cache.
+ * \param size  The required size.
+ *
+ * \return A buffer, NULL if the memory will not become available.
+ **/
+static gpointer
+j_operation_cache_get_buffer(JOperationCache* cache, guint64 size)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	gboolean ret = FALSE;
-
-	(void)operation;
+	gpointer buffer;
 
-	/* FIXME
-	switch (operation->type)
+	if (size > cache->size)
 	{
-		case J_OPERATION_COLLECTION_CREATE:
-		case J_OPERATION_COLLECTION_DELETE:
-		case J_OPERATION_ITEM_CREATE:
-		case J_OPERATION_ITEM_DELETE:
-		case J_OPERATION_ITEM_WRITE:
-			ret = TRUE;
-			break;
-
-		case J_OPERATION_COLLECTION_GET:
-		case J_OPERATION_ITEM_GET:
-		case J_OPERATION_ITEM_GET_STATUS:
-		case J_OPERATION_ITEM_READ:
-			ret = FALSE;
-			break;
-
-		case J_OPERATION_NONE:
-		default:
-			g_warn_if_reached();
+		return NULL;
 	}
-	*/
 
-	return ret;
-}
+	while (TRUE)
+	{
+		guint64 completed;
 
-static guint64
-j_operation_cache_get_required_size(JOperation* operation)
-{
-	J_TRACE_FUNCTION(NULL);
+		g_mutex_lock(cache->mutex);
+		completed = cache->completed;
+		g_mutex_unlock(cache->mutex);
 
-	guint64 ret = 0;
+		if ((buffer = j_cache_get(cache->cache, size)) != NULL)
+		{
+			break;
+		}
 
-	(void)operation;
+		g_mutex_lock(cache->mutex);
 
-	/* FIXME
-	switch (operation->type)
-	{
-		case J_OPERATION_ITEM_WRITE:
-			ret = operation->item_write.length;
+		// No memory will be released if there are no cached batches left.
+		if (cache->pending == 0 && cache->completed == completed)
+		{
+			g_mutex_unlock(cache->mutex);
 			break;
+		}
 
-		case J_OPERATION_COLLECTION_CREATE:
-		case J_OPERATION_COLLECTION_DELETE:
-		case J_OPERATION_ITEM_CREATE:
-		case J_OPERATION_ITEM_DELETE:
-		case J_OPERATION_COLLECTION_GET:
-		case J_OPERATION_ITEM_GET:
-		case J_OPERATION_ITEM_GET_STATUS:
-		case J_OPERATION_ITEM_READ:
-			ret = 0;
-			break;
+		while (cache->completed == completed)
+		{
+			g_cond_wait(cache->cond, cache->mutex);
+		}
 
-		case J_OPERATION_NONE:
-		default:
-			g_warn_if_reached();
+		g_mutex_unlock(cache->mutex);
 	}
-	*/
 
-	return ret;
+	return buffer;
 }
 
 void
@@ -210,14 +325,18 @@ j_operation_cache_init(void)
 	g_return_if_fail(j_operation_cache == NULL);
 
 	cache = g_slice_new(JOperationCache);
-	cache->cache = j_cache_new(50 * 1024 * 1024);
+	cache->size = 50 * 1024 * 1024;
+	cache->cache = j_cache_new(cache->size);
 	cache->queue = g_async_queue_new_full(NULL);
-	cache->thread = g_thread_new("JOperationCache", j_operation_cache_thread, cache);
-	cache->working = FALSE;
+	cache->keys = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	cache->pending = 0;
+	cache->completed = 0;
 
 	g_mutex_init(cache->mutex);
 	g_cond_init(cache->cond);
 
+	cache->thread = g_thread_new("JOperationCache", j_operation_cache_thread, cache);
+
 	g_atomic_pointer_set(&j_operation_cache, cache);
 }
 
@@ -240,6 +359,7 @@ j_operation_cache_fini(void)
 	g_thread_join(cache->thread);
 
 	g_async_queue_unref(cache->queue);
+	g_hash_table_unref(cache->keys);
 	j_cache_free(cache->cache);
 
 	g_cond_clear(cache->cond);
@@ -248,6 +368,11 @@ j_operation_cache_fini(void)
 	g_slice_free(JOperationCache, cache);
 }
 
+/**
+ * Waits until all cached batches have been executed.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
 gboolean
 j_operation_cache_flush(void)
 {
@@ -257,7 +382,7 @@ j_operation_cache_flush(void)
 
 	g_mutex_lock(j_operation_cache->mutex);
 
-	while (j_operation_cache->working)
+	while (j_operation_cache->pending > 0)
 	{
 		g_cond_wait(j_operation_cache->cond, j_operation_cache->mutex);
 	}
@@ -267,89 +392,105 @@ j_operation_cache_flush(void)
 	return ret;
 }
 
+/**
+ * Waits until all cached operations the batch depends on have been executed.
+ * This makes sure that reads return data written by cached operations.
+ *
+ * \param batch A batch.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
 gboolean
-j_operation_cache_add(JBatch* batch)
+j_operation_cache_flush_batch(JBatch* batch)
 {
 	J_TRACE_FUNCTION(NULL);
 
 	gboolean ret = TRUE;
+
+	g_return_val_if_fail(batch != NULL, FALSE);
+
+	g_mutex_lock(j_operation_cache->mutex);
+
+	// Cached batches are executed in order, so the conflicting ones will eventually be gone.
+	while (j_operation_cache_conflicts(j_operation_cache, batch))
+	{
+		g_cond_wait(j_operation_cache->cond, j_operation_cache->mutex);
+	}
+
+	g_mutex_unlock(j_operation_cache->mutex);
+
+	return ret;
+}
+
+/**
+ * Adds a batch to the cache.
+ * On success, the batch's operations are moved into the cache and the batch is empty afterwards.
+ *
+ * \param batch A batch.
+ *
+ * \return TRUE if the batch has been cached, FALSE if it has to be executed by the caller.
+ **/
+gboolean
+j_operation_cache_add(JBatch* batch)
+{
+	J_TRACE_FUNCTION(NULL);
+
 	JCachedBatch* cached_batch;
-	JList* operations;
-	JListIterator* iterator;
-	gboolean can_cache = TRUE;
+	GArray* operations;
 	gchar* data;
-	gpointer buffer;
+	gpointer buffer = NULL;
 	guint64 required_size = 0;
 
+	g_return_val_if_fail(batch != NULL, FALSE);
+
 	operations = j_batch_get_operations(batch);
-	iterator = j_list_iterator_new(operations);
 
-	while (j_list_iterator_next(iterator))
+	for (guint i = 0; i < operations->len; i++)
 	{
-		JOperation* operation = j_list_iterator_get(iterator);
-
-		can_cache = j_operation_cache_test(operation) && can_cache;
+		JOperation* operation = &g_array_index(operations, JOperation, i);
 
-		if (!can_cache)
+		// Operations without a key cannot be checked for conflicts.
+		if (operation->cache_func == NULL || operation->key == NULL)
 		{
-			ret = FALSE;
-			break;
+			return FALSE;
 		}
 
-		required_size += j_operation_cache_get_required_size(operation);
-	}
-
-	j_list_iterator_free(iterator);
-
-	// FIXME never cleared
-	if ((buffer = j_cache_get(j_operation_cache->cache, required_size)) == NULL)
-	{
-		ret = FALSE;
+		required_size += j_operation_cache_align(operation->cache_func(operation->data, NULL));
 	}
 
-	if (!ret)
+	if (required_size > 0 && (buffer = j_operation_cache_get_buffer(j_operation_cache, required_size)) == NULL)
 	{
 		return FALSE;
 	}
 
 	data = buffer;
-	iterator = j_list_iterator_new(operations);
 
-	while (j_list_iterator_next(iterator))
+	for (guint i = 0; i < operations->len; i++)
 	{
-		/* FIXME
-		JOperation* operation = j_list_iterator_get(iterator);
+		JOperation* operation = &g_array_index(operations, JOperation, i);
 
-		if (operation->type == J_OPERATION_ITEM_WRITE)
+		if (operation->cache_func(operation->data, NULL) > 0)
 		{
-			memcpy(data, operation->item_write.data, operation->item_write.length);
-
-			operation->item_write.data = data;
-			*(operation->item_write.bytes_written) += operation->item_write.length;
-			operation->item_write.bytes_written = NULL;
-
-			data += operation->item_write.length;
+			data += j_operation_cache_align(operation->cache_func(operation->data, data));
 		}
-		*/
-		(void)data;
 	}
 
-	j_list_iterator_free(iterator);
-
-	if (!ret)
-	{
-		return FALSE;
-	}
-
-	g_mutex_lock(j_operation_cache->mutex);
-	j_operation_cache->working = TRUE;
-	g_mutex_unlock(j_operation_cache->mutex);
-
 	cached_batch = g_slice_new(JCachedBatch);
 	cached_batch->batch = j_batch_new_from_batch(batch);
 	cached_batch->data = buffer;
 
+	g_mutex_lock(j_operation_cache->mutex);
+
+	j_operation_cache_update_keys(j_operation_cache, cached_batch->batch, TRUE);
+	j_operation_cache->pending++;
+
+	g_mutex_unlock(j_operation_cache->mutex);
+
 	g_async_queue_push(j_operation_cache->queue, cached_batch);
 
-	return ret;
+	return TRUE;
 }
+
+/**
+ * @}
+ **/
@@ -40,7 +40,7 @@
  * \code
  * \endcode
  *
- * \return A new operation. Should be freed with j_operation_free().
+ * \return A new operation. Should be added to a batch using j_batch_add(), which takes ownership of it.
  **/
 JOperation*
 j_operation_new(void)
@@ -54,6 +54,10 @@ j_operation_new(void)
 	operation->data = NULL;
 	operation->exec_func = NULL;
 	operation->free_func = NULL;
+	operation->cache_func = NULL;
+	operation->submit_func = NULL;
+	operation->complete_func = NULL;
+	operation->size = 0;
 
 	return operation;
 }
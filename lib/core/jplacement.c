@@ -0,0 +1,455 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2020 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <stdlib.h>
+
+#include <jplacement.h>
+
+#include <jhelper.h>
+#include <jtrace.h>
+
+/**
+ * \defgroup JPlacement Placement
+ *
+ * A placement maps keys, such as key-value keys and object names, to servers.
+ * All clients have to use the same placement, otherwise they will not find each other's data.
+ *
+ * - #J_PLACEMENT_MODULO uses the key's hash modulo the number of servers. Changing the number of servers moves almost all keys.
+ * - #J_PLACEMENT_JUMP uses jump consistent hashing. Adding a server moves about 1/N of the keys, but servers can only be added or removed at the end of the list.
+ * - #J_PLACEMENT_RENDEZVOUS uses highest random weight hashing. Adding or removing any server moves about 1/N of the keys.
+ * - #J_PLACEMENT_RING uses a consistent hashing ring with virtual nodes. Adding or removing any server moves about 1/N of the keys.
+ *
+ * Servers are identified by their index in the configuration, so reordering the list of servers moves keys regardless of the placement.
+ *
+ * @{
+ **/
+
+/**
+ * The default number of virtual nodes per server for #J_PLACEMENT_RING.
+ **/
+#define J_PLACEMENT_VIRTUAL_NODES 128
+
+struct JPlacementPoint
+{
+	guint64 hash;
+	guint32 index;
+};
+
+typedef struct JPlacementPoint JPlacementPoint;
+
+/**
+ * A placement.
+ **/
+struct JPlacement
+{
+	JPlacementType type;
+
+	guint32 server_count;
+
+	/**
+	 * The servers' seeds for #J_PLACEMENT_RENDEZVOUS.
+	 **/
+	guint64* seeds;
+
+	/**
+	 * The ring's points for #J_PLACEMENT_RING, sorted by their hashes.
+	 **/
+	JPlacementPoint* points;
+	guint32 points_len;
+};
+
+/**
+ * Mixes the bits of a value.
+ * This is the finalizer of SplitMix64.
+ *
+ * \private
+ *
+ * \param value A value.
+ *
+ * \return The mixed value.
+ **/
+static guint64
+j_placement_mix(guint64 value)
+{
+	value ^= value >> 30;
+	value *= G_GUINT64_CONSTANT(0xbf58476d1ce4e5b9);
+	value ^= value >> 27;
+	value *= G_GUINT64_CONSTANT(0x94d049bb133111eb);
+	value ^= value >> 31;
+
+	return value;
+}
+
+/**
+ * Hashes a key.
+ * Uses 64-bit FNV-1a, followed by j_placement_mix() to spread similar keys.
+ *
+ * \private
+ *
+ * \param key A key.
+ *
+ * \return The key's hash.
+ **/
+static guint64
+j_placement_hash(gchar const* key)
+{
+	guint64 hash = G_GUINT64_CONSTANT(0xcbf29ce484222325);
+
+	for (guchar const* c = (guchar const*)key; *c != '\0'; c++)
+	{
+		hash ^= *c;
+		hash *= G_GUINT64_CONSTANT(0x100000001b3);
+	}
+
+	return j_placement_mix(hash);
+}
+
+static gint
+j_placement_point_compare(gconstpointer a, gconstpointer b)
+{
+	JPlacementPoint const* point_a = a;
+	JPlacementPoint const* point_b = b;
+
+	if (point_a->hash < point_b->hash)
+	{
+		return -1;
+	}
+	else if (point_a->hash > point_b->hash)
+	{
+		return 1;
+	}
+
+	// Ties are broken deterministically, so that all clients build the same ring.
+	if (point_a->index < point_b->index)
+	{
+		return -1;
+	}
+	else if (point_a->index > point_b->index)
+	{
+		return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Jump consistent hashing, as described by Lamping and Veach.
+ *
+ * \private
+ *
+ * \param hash         A key's hash.
+ * \param server_count The number of servers.
+ *
+ * \return A server index.
+ **/
+static guint32
+j_placement_get_index_jump(guint64 hash, guint32 server_count)
+{
+	gint64 b = -1;
+	gint64 j = 0;
+
+	while (j < server_count)
+	{
+		b = j;
+		hash = hash * G_GUINT64_CONSTANT(2862933555777941757) + 1;
+		j = (b + 1) * ((gdouble)(G_GINT64_CONSTANT(1) << 31) / (gdouble)((hash >> 33) + 1));
+	}
+
+	return b;
+}
+
+/**
+ * Rendezvous or highest random weight hashing.
+ * Each server's weight is derived from the key's hash and the server's seed, the server with the highest weight is chosen.
+ *
+ * \private
+ *
+ * \param placement A placement.
+ * \param hash      A key's hash.
+ *
+ * \return A server index.
+ **/
+static guint32
+j_placement_get_index_rendezvous(JPlacement* placement, guint64 hash)
+{
+	guint32 index = 0;
+	guint64 max_weight = 0;
+
+	for (guint32 i = 0; i < placement->server_count; i++)
+	{
+		guint64 weight;
+
+		weight = j_placement_mix(hash ^ placement->seeds[i]);
+
+		if (i == 0 || weight > max_weight)
+		{
+			index = i;
+			max_weight = weight;
+		}
+	}
+
+	return index;
+}
+
+/**
+ * Consistent hashing using a ring.
+ * The key is assigned to the server owning the first point at or after the key's hash.
+ *
+ * \private
+ *
+ * \param placement A placement.
+ * \param hash      A key's hash.
+ *
+ * \return A server index.
+ **/
+static guint32
+j_placement_get_index_ring(JPlacement* placement, guint64 hash)
+{
+	guint32 low = 0;
+	guint32 high = placement->points_len;
+
+	while (low < high)
+	{
+		guint32 middle = low + (high - low) / 2;
+
+		if (placement->points[middle].hash < hash)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+
+	// Wrap around to the first point.
+	if (low == placement->points_len)
+	{
+		low = 0;
+	}
+
+	return placement->points[low].index;
+}
+
+/**
+ * Creates a new placement.
+ *
+ * \code
+ * g_autoptr(JPlacement) placement = NULL;
+ *
+ * placement = j_placement_new(J_PLACEMENT_RING, 4, 0);
+ * \endcode
+ *
+ * \param type          A placement type.
+ * \param server_count  The number of servers.
+ * \param virtual_nodes The number of virtual nodes per server for #J_PLACEMENT_RING, 0 for the default.
+ *
+ * \return A new placement. Should be freed with j_placement_free().
+ **/
+JPlacement*
+j_placement_new(JPlacementType type, guint32 server_count, guint32 virtual_nodes)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JPlacement* placement;
+
+	g_return_val_if_fail(server_count > 0, NULL);
+
+	if (virtual_nodes == 0)
+	{
+		virtual_nodes = J_PLACEMENT_VIRTUAL_NODES;
+	}
+
+	placement = g_slice_new(JPlacement);
+	placement->type = type;
+	placement->server_count = server_count;
+	placement->seeds = NULL;
+	placement->points = NULL;
+	placement->points_len = 0;
+
+	switch (type)
+	{
+		case J_PLACEMENT_RENDEZVOUS:
+			placement->seeds = g_new(guint64, server_count);
+
+			for (guint32 i = 0; i < server_count; i++)
+			{
+				placement->seeds[i] = j_placement_mix(G_GUINT64_CONSTANT(0x9e3779b97f4a7c15) * (i + 1));
+			}
+
+			break;
+		case J_PLACEMENT_RING:
+			placement->points_len = server_count * virtual_nodes;
+			placement->points = g_new(JPlacementPoint, placement->points_len);
+
+			for (guint32 i = 0; i < server_count; i++)
+			{
+				for (guint32 j = 0; j < virtual_nodes; j++)
+				{
+					JPlacementPoint* point = &(placement->points[i * virtual_nodes + j]);
+
+					point->hash = j_placement_mix(G_GUINT64_CONSTANT(0x9e3779b97f4a7c15) + (((guint64)i << 32) | j));
+					point->index = i;
+				}
+			}
+
+			qsort(placement->points, placement->points_len, sizeof(JPlacementPoint), j_placement_point_compare);
+
+			break;
+		case J_PLACEMENT_MODULO:
+		case J_PLACEMENT_JUMP:
+			break;
+		default:
+			g_assert_not_reached();
+	}
+
+	return placement;
+}
+
+/**
+ * Frees the memory allocated for a placement.
+ *
+ * \param placement A placement.
+ **/
+void
+j_placement_free(JPlacement* placement)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_if_fail(placement != NULL);
+
+	g_free(placement->seeds);
+	g_free(placement->points);
+
+	g_slice_free(JPlacement, placement);
+}
+
+/**
+ * Parses a placement type.
+ *
+ * \param str  A string, one of "modulo", "jump", "rendezvous" or "ring".
+ * \param type Returns the placement type.
+ *
+ * \return TRUE if the string is a valid placement type, FALSE otherwise.
+ **/
+gboolean
+j_placement_type_from_string(gchar const* str, JPlacementType* type)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(str != NULL, FALSE);
+	g_return_val_if_fail(type != NULL, FALSE);
+
+	if (g_strcmp0(str, "modulo") == 0)
+	{
+		*type = J_PLACEMENT_MODULO;
+	}
+	else if (g_strcmp0(str, "jump") == 0)
+	{
+		*type = J_PLACEMENT_JUMP;
+	}
+	else if (g_strcmp0(str, "rendezvous") == 0)
+	{
+		*type = J_PLACEMENT_RENDEZVOUS;
+	}
+	else if (g_strcmp0(str, "ring") == 0)
+	{
+		*type = J_PLACEMENT_RING;
+	}
+	else
+	{
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * Returns a placement's type.
+ *
+ * \param placement A placement.
+ *
+ * \return The placement type.
+ **/
+JPlacementType
+j_placement_get_type(JPlacement* placement)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(placement != NULL, J_PLACEMENT_MODULO);
+
+	return placement->type;
+}
+
+/**
+ * Returns the server a key is placed on.
+ *
+ * \code
+ * guint32 index;
+ *
+ * index = j_placement_get_index(j_configuration_get_placement(configuration, J_BACKEND_TYPE_KV), "key");
+ * \endcode
+ *
+ * \param placement A placement.
+ * \param key       A key.
+ *
+ * \return The server's index.
+ **/
+guint32
+j_placement_get_index(JPlacement* placement, gchar const* key)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	guint32 index = 0;
+
+	g_return_val_if_fail(placement != NULL, 0);
+	g_return_val_if_fail(key != NULL, 0);
+
+	switch (placement->type)
+	{
+		case J_PLACEMENT_MODULO:
+			// Keeps the placement of earlier versions.
+			index = j_helper_hash(key) % placement->server_count;
+			break;
+		case J_PLACEMENT_JUMP:
+			index = j_placement_get_index_jump(j_placement_hash(key), placement->server_count);
+			break;
+		case J_PLACEMENT_RENDEZVOUS:
+			index = j_placement_get_index_rendezvous(placement, j_placement_hash(key));
+			break;
+		case J_PLACEMENT_RING:
+			index = j_placement_get_index_ring(placement, j_placement_hash(key));
+			break;
+		default:
+			g_assert_not_reached();
+	}
+
+	return index;
+}
+
+/**
+ * @}
+ **/
@@ -0,0 +1,578 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2020 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <string.h>
+
+#ifdef HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+#include <jreed-solomon.h>
+
+#include <jtrace.h>
+
+/**
+ * \defgroup JReedSolomon Reed-Solomon
+ *
+ * A systematic Reed-Solomon code over GF(2^8).
+ * k data blocks are stored unmodified and m parity blocks are computed from them.
+ * Any k of the k+m blocks are sufficient to reconstruct the data blocks.
+ *
+ * The parity rows of the coding matrix form a Cauchy matrix, which makes every square submatrix invertible.
+ * Blocks are multiplied by constants using SSSE3 or AVX2 nibble tables if supported by the CPU.
+ *
+ * @{
+ **/
+
+/**
+ * The size of the segments blocks are processed in.
+ * All blocks' segments should fit into the cache at the same time.
+ **/
+#define J_REED_SOLOMON_SEGMENT_SIZE (16 * 1024)
+
+/**
+ * A Reed-Solomon code.
+ **/
+struct JReedSolomon
+{
+	guint data_blocks;
+	guint parity_blocks;
+
+	/**
+	 * The parity rows of the coding matrix.
+	 * Contains parity_blocks × data_blocks elements.
+	 **/
+	guint8* matrix;
+};
+
+typedef void (*JReedSolomonMulAddFunc)(guint8*, guint8 const*, guint8, gsize);
+
+static guint8 j_reed_solomon_exp[512];
+static guint8 j_reed_solomon_log[256];
+
+/**
+ * The products of all elements.
+ **/
+static guint8 j_reed_solomon_mul_table[256][256];
+
+/**
+ * The products of all elements with the low and high nibbles of all bytes.
+ **/
+static guint8 j_reed_solomon_nibble_table[256][2][16] __attribute__((aligned(16)));
+
+static JReedSolomonMulAddFunc j_reed_solomon_mul_add = NULL;
+
+static guint8
+j_reed_solomon_mul(guint8 a, guint8 b)
+{
+	if (a == 0 || b == 0)
+	{
+		return 0;
+	}
+
+	return j_reed_solomon_exp[j_reed_solomon_log[a] + j_reed_solomon_log[b]];
+}
+
+static guint8
+j_reed_solomon_inv(guint8 a)
+{
+	g_return_val_if_fail(a != 0, 0);
+
+	return j_reed_solomon_exp[255 - j_reed_solomon_log[a]];
+}
+
+/**
+ * Multiplies a block by a constant and adds the result to another block.
+ *
+ * \private
+ *
+ * \param dst    The destination block.
+ * \param src    The source block.
+ * \param c      A constant.
+ * \param length The blocks' length.
+ **/
+static void
+j_reed_solomon_mul_add_scalar(guint8* dst, guint8 const* src, guint8 c, gsize length)
+{
+	guint8 const* table = j_reed_solomon_mul_table[c];
+
+	for (gsize i = 0; i < length; i++)
+	{
+		dst[i] ^= table[src[i]];
+	}
+}
+
+#ifdef HAVE_X86_SIMD
+/**
+ * Multiplies a block by a constant and adds the result to another block.
+ * Uses PSHUFB to look up the products of the low and high nibbles of 16 bytes at a time.
+ *
+ * \private
+ *
+ * \param dst    The destination block.
+ * \param src    The source block.
+ * \param c      A constant.
+ * \param length The blocks' length.
+ **/
+__attribute__((target("ssse3")))
+static void
+j_reed_solomon_mul_add_ssse3(guint8* dst, guint8 const* src, guint8 c, gsize length)
+{
+	__m128i const mask = _mm_set1_epi8(0x0f);
+	__m128i const low = _mm_load_si128((__m128i const*)j_reed_solomon_nibble_table[c][0]);
+	__m128i const high = _mm_load_si128((__m128i const*)j_reed_solomon_nibble_table[c][1]);
+
+	gsize i = 0;
+
+	for (; i + 16 <= length; i += 16)
+	{
+		__m128i s;
+		__m128i d;
+
+		s = _mm_loadu_si128((__m128i const*)(src + i));
+		d = _mm_loadu_si128((__m128i const*)(dst + i));
+
+		d = _mm_xor_si128(d, _mm_shuffle_epi8(low, _mm_and_si128(s, mask)));
+		d = _mm_xor_si128(d, _mm_shuffle_epi8(high, _mm_and_si128(_mm_srli_epi64(s, 4), mask)));
+
+		_mm_storeu_si128((__m128i*)(dst + i), d);
+	}
+
+	j_reed_solomon_mul_add_scalar(dst + i, src + i, c, length - i);
+}
+
+/**
+ * Multiplies a block by a constant and adds the result to another block.
+ * Uses VPSHUFB to look up the products of the low and high nibbles of 32 bytes at a time.
+ *
+ * \private
+ *
+ * \param dst    The destination block.
+ * \param src    The source block.
+ * \param c      A constant.
+ * \param length The blocks' length.
+ **/
+__attribute__((target("avx2")))
+static void
+j_reed_solomon_mul_add_avx2(guint8* dst, guint8 const* src, guint8 c, gsize length)
+{
+	__m256i const mask = _mm256_set1_epi8(0x0f);
+	__m256i const low = _mm256_broadcastsi128_si256(_mm_load_si128((__m128i const*)j_reed_solomon_nibble_table[c][0]));
+	__m256i const high = _mm256_broadcastsi128_si256(_mm_load_si128((__m128i const*)j_reed_solomon_nibble_table[c][1]));
+
+	gsize i = 0;
+
+	for (; i + 32 <= length; i += 32)
+	{
+		__m256i s;
+		__m256i d;
+
+		s = _mm256_loadu_si256((__m256i const*)(src + i));
+		d = _mm256_loadu_si256((__m256i const*)(dst + i));
+
+		d = _mm256_xor_si256(d, _mm256_shuffle_epi8(low, _mm256_and_si256(s, mask)));
+		d = _mm256_xor_si256(d, _mm256_shuffle_epi8(high, _mm256_and_si256(_mm256_srli_epi64(s, 4), mask)));
+
+		_mm256_storeu_si256((__m256i*)(dst + i), d);
+	}
+
+	j_reed_solomon_mul_add_scalar(dst + i, src + i, c, length - i);
+}
+#endif
+
+/**
+ * Initializes the tables and selects the fastest implementation supported by the CPU.
+ *
+ * \private
+ **/
+static void
+j_reed_solomon_init(void)
+{
+	static gsize initialized = 0;
+
+	if (g_once_init_enter(&initialized))
+	{
+		guint x = 1;
+
+		// 0x11d is the primitive polynomial x^8 + x^4 + x^3 + x^2 + 1.
+		for (guint i = 0; i < 255; i++)
+		{
+			j_reed_solomon_exp[i] = x;
+			j_reed_solomon_exp[i + 255] = x;
+			j_reed_solomon_log[x] = i;
+
+			x <<= 1;
+
+			if (x & 0x100)
+			{
+				x ^= 0x11d;
+			}
+		}
+
+		for (guint a = 0; a < 256; a++)
+		{
+			for (guint b = 0; b < 256; b++)
+			{
+				j_reed_solomon_mul_table[a][b] = j_reed_solomon_mul(a, b);
+			}
+
+			for (guint b = 0; b < 16; b++)
+			{
+				j_reed_solomon_nibble_table[a][0][b] = j_reed_solomon_mul(a, b);
+				j_reed_solomon_nibble_table[a][1][b] = j_reed_solomon_mul(a, b << 4);
+			}
+		}
+
+		j_reed_solomon_mul_add = j_reed_solomon_mul_add_scalar;
+
+#ifdef HAVE_X86_SIMD
+		__builtin_cpu_init();
+
+		if (__builtin_cpu_supports("avx2"))
+		{
+			j_reed_solomon_mul_add = j_reed_solomon_mul_add_avx2;
+		}
+		else if (__builtin_cpu_supports("ssse3"))
+		{
+			j_reed_solomon_mul_add = j_reed_solomon_mul_add_ssse3;
+		}
+#endif
+
+		g_once_init_leave(&initialized, 1);
+	}
+}
+
+/**
+ * Inverts a square matrix using Gauss-Jordan elimination.
+ *
+ * \private
+ *
+ * \param matrix  A matrix, will be modified.
+ * \param inverse Returns the inverse matrix.
+ * \param n       The number of rows and columns.
+ *
+ * \return TRUE if the matrix is invertible, FALSE otherwise.
+ **/
+static gboolean
+j_reed_solomon_invert(guint8* matrix, guint8* inverse, guint n)
+{
+	memset(inverse, 0, n * n);
+
+	for (guint i = 0; i < n; i++)
+	{
+		inverse[i * n + i] = 1;
+	}
+
+	for (guint col = 0; col < n; col++)
+	{
+		guint pivot = col;
+		guint8 factor;
+
+		while (pivot < n && matrix[pivot * n + col] == 0)
+		{
+			pivot++;
+		}
+
+		if (pivot == n)
+		{
+			return FALSE;
+		}
+
+		if (pivot != col)
+		{
+			for (guint i = 0; i < n; i++)
+			{
+				guint8 tmp;
+
+				tmp = matrix[pivot * n + i];
+				matrix[pivot * n + i] = matrix[col * n + i];
+				matrix[col * n + i] = tmp;
+
+				tmp = inverse[pivot * n + i];
+				inverse[pivot * n + i] = inverse[col * n + i];
+				inverse[col * n + i] = tmp;
+			}
+		}
+
+		factor = j_reed_solomon_inv(matrix[col * n + col]);
+
+		for (guint i = 0; i < n; i++)
+		{
+			matrix[col * n + i] = j_reed_solomon_mul(matrix[col * n + i], factor);
+			inverse[col * n + i] = j_reed_solomon_mul(inverse[col * n + i], factor);
+		}
+
+		for (guint row = 0; row < n; row++)
+		{
+			if (row == col || matrix[row * n + col] == 0)
+			{
+				continue;
+			}
+
+			factor = matrix[row * n + col];
+
+			for (guint i = 0; i < n; i++)
+			{
+				matrix[row * n + i] ^= j_reed_solomon_mul(matrix[col * n + i], factor);
+				inverse[row * n + i] ^= j_reed_solomon_mul(inverse[col * n + i], factor);
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+ * Creates a new Reed-Solomon code.
+ *
+ * \code
+ * g_autoptr(JReedSolomon) rs = NULL;
+ *
+ * rs = j_reed_solomon_new(4, 2);
+ * \endcode
+ *
+ * \param data_blocks   The number of data blocks.
+ * \param parity_blocks The number of parity blocks.
+ *
+ * \return A new Reed-Solomon code. Should be freed with j_reed_solomon_free().
+ **/
+JReedSolomon*
+j_reed_solomon_new(guint data_blocks, guint parity_blocks)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JReedSolomon* rs;
+
+	g_return_val_if_fail(data_blocks > 0, NULL);
+	g_return_val_if_fail(data_blocks + parity_blocks <= 256, NULL);
+
+	j_reed_solomon_init();
+
+	rs = g_slice_new(JReedSolomon);
+	rs->data_blocks = data_blocks;
+	rs->parity_blocks = parity_blocks;
+	rs->matrix = g_new(guint8, parity_blocks * data_blocks);
+
+	// Cauchy matrix with x_i = data_blocks + i and y_j = j, all elements are distinct.
+	for (guint i = 0; i < parity_blocks; i++)
+	{
+		for (guint j = 0; j < data_blocks; j++)
+		{
+			rs->matrix[i * data_blocks + j] = j_reed_solomon_inv((data_blocks + i) ^ j);
+		}
+	}
+
+	return rs;
+}
+
+/**
+ * Frees the memory allocated for a Reed-Solomon code.
+ *
+ * \param rs A Reed-Solomon code.
+ **/
+void
+j_reed_solomon_free(JReedSolomon* rs)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_if_fail(rs != NULL);
+
+	g_free(rs->matrix);
+
+	g_slice_free(JReedSolomon, rs);
+}
+
+/**
+ * Computes the parity blocks for the given data blocks.
+ *
+ * \code
+ * gconstpointer data[4];
+ * gpointer parity[2];
+ *
+ * j_reed_solomon_encode(rs, data, parity, 1024);
+ * \endcode
+ *
+ * \param rs     A Reed-Solomon code.
+ * \param data   The data blocks.
+ * \param parity Buffers for the parity blocks, will be overwritten.
+ * \param length The blocks' length.
+ **/
+void
+j_reed_solomon_encode(JReedSolomon* rs, gconstpointer const* data, gpointer* parity, gsize length)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_if_fail(rs != NULL);
+	g_return_if_fail(data != NULL);
+	g_return_if_fail(parity != NULL || rs->parity_blocks == 0);
+
+	for (guint i = 0; i < rs->parity_blocks; i++)
+	{
+		memset(parity[i], 0, length);
+	}
+
+	for (gsize offset = 0; offset < length; offset += J_REED_SOLOMON_SEGMENT_SIZE)
+	{
+		gsize segment_length = MIN(J_REED_SOLOMON_SEGMENT_SIZE, length - offset);
+
+		for (guint i = 0; i < rs->parity_blocks; i++)
+		{
+			guint8* dst = (guint8*)parity[i] + offset;
+
+			for (guint j = 0; j < rs->data_blocks; j++)
+			{
+				guint8 const* src = (guint8 const*)data[j] + offset;
+
+				j_reed_solomon_mul_add(dst, src, rs->matrix[i * rs->data_blocks + j], segment_length);
+			}
+		}
+	}
+}
+
+/**
+ * Reconstructs missing data blocks.
+ * Parity blocks are not reconstructed.
+ *
+ * \code
+ * gpointer blocks[6];
+ * gboolean available[6] = { TRUE, FALSE, TRUE, TRUE, FALSE, TRUE };
+ *
+ * j_reed_solomon_reconstruct(rs, blocks, available, 1024);
+ * \endcode
+ *
+ * \param rs        A Reed-Solomon code.
+ * \param blocks    The data blocks followed by the parity blocks. Missing data blocks will be overwritten.
+ * \param available Whether the blocks are available.
+ * \param length    The blocks' length.
+ *
+ * \return TRUE if all data blocks could be reconstructed, FALSE if too many blocks are missing.
+ **/
+gboolean
+j_reed_solomon_reconstruct(JReedSolomon* rs, gpointer* blocks, gboolean const* available, gsize length)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_autofree guint* rows = NULL;
+	g_autofree guint8* matrix = NULL;
+	g_autofree guint8* inverse = NULL;
+	guint k;
+	guint rows_len = 0;
+	gboolean missing = FALSE;
+
+	g_return_val_if_fail(rs != NULL, FALSE);
+	g_return_val_if_fail(blocks != NULL, FALSE);
+	g_return_val_if_fail(available != NULL, FALSE);
+
+	k = rs->data_blocks;
+
+	rows = g_new(guint, k);
+
+	// Prefer data blocks, their rows are unit vectors.
+	for (guint i = 0; i < k + rs->parity_blocks && rows_len < k; i++)
+	{
+		if (available[i])
+		{
+			rows[rows_len] = i;
+			rows_len++;
+		}
+		else if (i < k)
+		{
+			missing = TRUE;
+		}
+	}
+
+	if (!missing)
+	{
+		return TRUE;
+	}
+
+	if (rows_len < k)
+	{
+		return FALSE;
+	}
+
+	matrix = g_new0(guint8, k * k);
+	inverse = g_new(guint8, k * k);
+
+	for (guint i = 0; i < k; i++)
+	{
+		if (rows[i] < k)
+		{
+			matrix[i * k + rows[i]] = 1;
+		}
+		else
+		{
+			memcpy(matrix + i * k, rs->matrix + (rows[i] - k) * k, k);
+		}
+	}
+
+	if (!j_reed_solomon_invert(matrix, inverse, k))
+	{
+		return FALSE;
+	}
+
+	for (guint i = 0; i < k; i++)
+	{
+		if (!available[i])
+		{
+			memset(blocks[i], 0, length);
+		}
+	}
+
+	for (gsize offset = 0; offset < length; offset += J_REED_SOLOMON_SEGMENT_SIZE)
+	{
+		gsize segment_length = MIN(J_REED_SOLOMON_SEGMENT_SIZE, length - offset);
+
+		for (guint i = 0; i < k; i++)
+		{
+			guint8* dst;
+
+			if (available[i])
+			{
+				continue;
+			}
+
+			dst = (guint8*)blocks[i] + offset;
+
+			for (guint j = 0; j < k; j++)
+			{
+				guint8 const* src = (guint8 const*)blocks[rows[j]] + offset;
+				guint8 c = inverse[i * k + j];
+
+				if (c != 0)
+				{
+					j_reed_solomon_mul_add(dst, src, c, segment_length);
+				}
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+ * @}
+ **/
@@ -25,6 +25,8 @@
 #include <glib.h>
 
 #include <jstatistics.h>
+
+#include <jhelper.h>
 #include <jtrace.h>
 
 /**
@@ -82,6 +84,16 @@ struct JStatistics
 	 * The number of sent bytes.
 	 **/
 	guint64 bytes_sent;
+
+	/**
+	 * The number of reads that have been hedged.
+	 **/
+	guint64 hedged_reads;
+
+	/**
+	 * The number of hedged reads that have been answered by the hedge first.
+	 **/
+	guint64 hedged_reads_won;
 };
 
 static gchar const*
@@ -107,12 +119,47 @@ j_statistics_get_type_name(JStatisticsType type)
 			return "bytes_received";
 		case J_STATISTICS_BYTES_SENT:
 			return "bytes_sent";
+		case J_STATISTICS_HEDGED_READS:
+			return "hedged_reads";
+		case J_STATISTICS_HEDGED_READS_WON:
+			return "hedged_reads_won";
 		default:
 			g_warn_if_reached();
 			return NULL;
 	}
 }
 
+/**
+ * Returns the statistics collected by the client library, for example about hedged reads.
+ *
+ * \code
+ * guint64 hedged_reads;
+ *
+ * hedged_reads = j_statistics_get(j_statistics(), J_STATISTICS_HEDGED_READS);
+ * \endcode
+ *
+ * \return The statistics.
+ **/
+JStatistics*
+j_statistics(void)
+{
+	static JStatistics* statistics = NULL;
+
+	if (g_atomic_pointer_get(&statistics) == NULL)
+	{
+		JStatistics* new_statistics;
+
+		new_statistics = j_statistics_new(FALSE);
+
+		if (!g_atomic_pointer_compare_and_exchange(&statistics, NULL, new_statistics))
+		{
+			j_statistics_free(new_statistics);
+		}
+	}
+
+	return statistics;
+}
+
 /**
  * Creates a new statistics.
  *
@@ -143,6 +190,8 @@ j_statistics_new(gboolean trace)
 	statistics->bytes_written = 0;
 	statistics->bytes_received = 0;
 	statistics->bytes_sent = 0;
+	statistics->hedged_reads = 0;
+	statistics->hedged_reads_won = 0;
 
 	return statistics;
 }
@@ -167,6 +216,17 @@ j_statistics_free(JStatistics* statistics)
 	g_slice_free(JStatistics, statistics);
 }
 
+/**
+ * Returns a statistics' value.
+ *
+ * \code
+ * \endcode
+ *
+ * \param statistics A statistics.
+ * \param type       A type.
+ *
+ * \return The value.
+ **/
 guint64
 j_statistics_get(JStatistics* statistics, JStatisticsType type)
 {
@@ -202,6 +262,12 @@ j_statistics_get(JStatistics* statistics, JStatisticsType type)
 		case J_STATISTICS_BYTES_SENT:
 			value = statistics->bytes_sent;
 			break;
+		case J_STATISTICS_HEDGED_READS:
+			value = statistics->hedged_reads;
+			break;
+		case J_STATISTICS_HEDGED_READS_WON:
+			value = statistics->hedged_reads_won;
+			break;
 		default:
 			g_warn_if_reached();
 			break;
@@ -210,6 +276,17 @@ j_statistics_get(JStatistics* statistics, JStatisticsType type)
 	return value;
 }
 
+/**
+ * Adds to a statistics' value.
+ * Can be called from multiple threads concurrently.
+ *
+ * \code
+ * \endcode
+ *
+ * \param statistics A statistics.
+ * \param type       A type.
+ * \param value      The value to add.
+ **/
 void
 j_statistics_add(JStatistics* statistics, JStatisticsType type, guint64 value)
 {
@@ -220,28 +297,34 @@ j_statistics_add(JStatistics* statistics, JStatisticsType type, guint64 value)
 	switch (type)
 	{
 		case J_STATISTICS_FILES_CREATED:
-			statistics->files_created += value;
+			j_helper_atomic_add(&(statistics->files_created), value);
 			break;
 		case J_STATISTICS_FILES_DELETED:
-			statistics->files_deleted += value;
+			j_helper_atomic_add(&(statistics->files_deleted), value);
 			break;
 		case J_STATISTICS_FILES_STATED:
-			statistics->files_stated += value;
+			j_helper_atomic_add(&(statistics->files_stated), value);
 			break;
 		case J_STATISTICS_SYNC:
-			statistics->sync_count += value;
+			j_helper_atomic_add(&(statistics->sync_count), value);
 			break;
 		case J_STATISTICS_BYTES_READ:
-			statistics->bytes_read += value;
+			j_helper_atomic_add(&(statistics->bytes_read), value);
 			break;
 		case J_STATISTICS_BYTES_WRITTEN:
-			statistics->bytes_written += value;
+			j_helper_atomic_add(&(statistics->bytes_written), value);
 			break;
 		case J_STATISTICS_BYTES_RECEIVED:
-			statistics->bytes_received += value;
+			j_helper_atomic_add(&(statistics->bytes_received), value);
 			break;
 		case J_STATISTICS_BYTES_SENT:
-			statistics->bytes_sent += value;
+			j_helper_atomic_add(&(statistics->bytes_sent), value);
+			break;
+		case J_STATISTICS_HEDGED_READS:
+			j_helper_atomic_add(&(statistics->hedged_reads), value);
+			break;
+		case J_STATISTICS_HEDGED_READS_WON:
+			j_helper_atomic_add(&(statistics->hedged_reads_won), value);
 			break;
 		default:
 			g_warn_if_reached();
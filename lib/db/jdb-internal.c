@@ -66,6 +66,7 @@ j_backend_db_func_exec(JList* operations, JSemantics* semantics, JMessageType ty
 	JBackend* db_backend = j_db_get_backend();
 	gpointer batch = NULL;
 	GError* error = NULL;
+	guint32 index = 0;
 
 	if (db_backend == NULL)
 	{
@@ -120,7 +121,13 @@ j_backend_db_func_exec(JList* operations, JSemantics* semantics, JMessageType ty
 	}
 	else
 	{
-		db_connection = j_connection_pool_pop(J_BACKEND_TYPE_DB, 0);
+		// Operations are only combined if they belong to the same namespace, which determines the server.
+		if (data != NULL)
+		{
+			index = j_placement_get_index(j_configuration_get_placement(j_configuration(), J_BACKEND_TYPE_DB), data->in_param[0].ptr);
+		}
+
+		db_connection = j_connection_pool_pop(J_BACKEND_TYPE_DB, index);
 		j_message_send(message, db_connection);
 		reply = j_message_new_reply(message);
 		j_message_receive(reply, db_connection);
@@ -132,7 +139,7 @@ j_backend_db_func_exec(JList* operations, JSemantics* semantics, JMessageType ty
 			ret = j_backend_operation_from_message(reply, data->out_param, data->out_param_count) && ret;
 		}
 
-		j_connection_pool_push(J_BACKEND_TYPE_DB, 0, db_connection);
+		j_connection_pool_push(J_BACKEND_TYPE_DB, index, db_connection);
 	}
 
 	return ret;
@@ -84,6 +84,12 @@ struct JKV
 	 **/
 	gchar* key;
 
+	/**
+	 * Identifies the namespace on the pair's server in batches, see #JOperation.
+	 * All operations in a namespace are sent to the server together.
+	 **/
+	gchar* operation_key;
+
 	/**
 	 * The reference count.
 	 **/
@@ -160,8 +166,6 @@ j_kv_put_free(gpointer data)
 	{
 		operation->put.value_destroy(operation->put.value);
 	}
-
-	g_slice_free(JKVOperation, operation);
 }
 
 static void
@@ -182,28 +186,61 @@ j_kv_get_free(gpointer data)
 	JKVOperation* operation = data;
 
 	j_kv_unref(operation->get.kv);
+}
+
+static guint64
+j_kv_put_cache(gpointer data, gpointer buffer)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JKVOperation* operation = data;
 
-	g_slice_free(JKVOperation, operation);
+	// The operation already owns its value.
+	if (operation->put.value_destroy != NULL)
+	{
+		return 0;
+	}
+
+	if (buffer != NULL)
+	{
+		memcpy(buffer, operation->put.value, operation->put.value_len);
+		operation->put.value = buffer;
+	}
+
+	return operation->put.value_len;
 }
 
-static gboolean
-j_kv_put_exec(JList* operations, JSemantics* semantics)
+static guint64
+j_kv_delete_cache(gpointer data, gpointer buffer)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	gboolean ret = TRUE;
+	(void)data;
+	(void)buffer;
+
+	return 0;
+}
+
+/**
+ * Creates the message for put operations.
+ *
+ * \private
+ *
+ * \param operations The operations.
+ * \param semantics  The semantics.
+ * \param index      Returns the server index.
+ *
+ * \return A new message.
+ **/
+static JMessage*
+j_kv_put_message(JList* operations, JSemantics* semantics, guint32* index)
+{
+	J_TRACE_FUNCTION(NULL);
 
-	JBackend* kv_backend;
 	g_autoptr(JListIterator) it = NULL;
-	g_autoptr(JMessage) message = NULL;
-	JSemanticsSafety safety;
+	JMessage* message;
 	gchar const* namespace;
-	gpointer kv_batch = NULL;
 	gsize namespace_len;
-	guint32 index;
-
-	g_return_val_if_fail(operations != NULL, FALSE);
-	g_return_val_if_fail(semantics != NULL, FALSE);
 
 	{
 		JKVOperation* kop;
@@ -213,60 +250,328 @@ j_kv_put_exec(JList* operations, JSemantics* semantics)
 
 		namespace = kop->put.kv->namespace;
 		namespace_len = strlen(namespace) + 1;
-		index = kop->put.kv->index;
+		*index = kop->put.kv->index;
 	}
 
-	safety = j_semantics_get(semantics, J_SEMANTICS_SAFETY);
+	/**
+	 * Force safe semantics to make the server send a reply.
+	 * Otherwise, nasty races can occur when using unsafe semantics:
+	 * - The client creates the item and sends its first write.
+	 * - The client sends another operation using another connection from the pool.
+	 * - The second operation is executed first and fails because the item does not exist.
+	 * This does not completely eliminate all races but fixes the common case of create, write, write, ...
+	 **/
+	message = j_message_new(J_MESSAGE_KV_PUT, namespace_len);
+	j_message_set_semantics(message, semantics);
+	j_message_append_n(message, namespace, namespace_len);
+
 	it = j_list_iterator_new(operations);
-	kv_backend = j_kv_get_backend();
 
-	if (kv_backend != NULL)
+	while (j_list_iterator_next(it))
 	{
-		ret = j_backend_kv_batch_start(kv_backend, namespace, semantics, &kv_batch);
+		JKVOperation* kop = j_list_iterator_get(it);
+		gsize key_len;
+
+		key_len = strlen(kop->put.kv->key) + 1;
+
+		j_message_add_operation(message, key_len + 4 + kop->put.value_len);
+		j_message_append_n(message, kop->put.kv->key, key_len);
+		j_message_append_4(message, &(kop->put.value_len));
+		j_message_append_n(message, kop->put.value, kop->put.value_len);
 	}
-	else
+
+	return message;
+}
+
+/**
+ * Creates the message for delete operations.
+ *
+ * \private
+ *
+ * \param operations The operations.
+ * \param semantics  The semantics.
+ * \param index      Returns the server index.
+ *
+ * \return A new message.
+ **/
+static JMessage*
+j_kv_delete_message(JList* operations, JSemantics* semantics, guint32* index)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_autoptr(JListIterator) it = NULL;
+	JMessage* message;
+	gchar const* namespace;
+	gsize namespace_len;
+
 	{
-		/**
-		 * Force safe semantics to make the server send a reply.
-		 * Otherwise, nasty races can occur when using unsafe semantics:
-		 * - The client creates the item and sends its first write.
-		 * - The client sends another operation using another connection from the pool.
-		 * - The second operation is executed first and fails because the item does not exist.
-		 * This does not completely eliminate all races but fixes the common case of create, write, write, ...
-		 **/
-		message = j_message_new(J_MESSAGE_KV_PUT, namespace_len);
-		j_message_set_semantics(message, semantics);
-		j_message_append_n(message, namespace, namespace_len);
+		JKV* object;
+
+		object = j_list_get_first(operations);
+		g_assert(object != NULL);
+
+		namespace = object->namespace;
+		namespace_len = strlen(namespace) + 1;
+		*index = object->index;
 	}
 
+	message = j_message_new(J_MESSAGE_KV_DELETE, namespace_len);
+	j_message_set_semantics(message, semantics);
+	j_message_append_n(message, namespace, namespace_len);
+
+	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		JKV* kv = j_list_iterator_get(it);
+		gsize key_len;
+
+		key_len = strlen(kv->key) + 1;
+
+		j_message_add_operation(message, key_len);
+		j_message_append_n(message, kv->key, key_len);
+	}
+
+	return message;
+}
+
+/**
+ * Creates the message for get operations.
+ *
+ * \private
+ *
+ * \param operations The operations.
+ * \param semantics  The semantics.
+ * \param index      Returns the server index.
+ *
+ * \return A new message.
+ **/
+static JMessage*
+j_kv_get_message(JList* operations, JSemantics* semantics, guint32* index)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_autoptr(JListIterator) it = NULL;
+	JMessage* message;
+	gchar const* namespace;
+	gsize namespace_len;
+
+	{
+		JKVOperation* kop;
+
+		kop = j_list_get_first(operations);
+		g_assert(kop != NULL);
+
+		namespace = kop->get.kv->namespace;
+		namespace_len = strlen(namespace) + 1;
+		*index = kop->get.kv->index;
+	}
+
+	/**
+	 * Force safe semantics to make the server send a reply.
+	 * Otherwise, nasty races can occur when using unsafe semantics:
+	 * - The client creates the item and sends its first write.
+	 * - The client sends another operation using another connection from the pool.
+	 * - The second operation is executed first and fails because the item does not exist.
+	 * This does not completely eliminate all races but fixes the common case of create, write, write, ...
+	 **/
+	message = j_message_new(J_MESSAGE_KV_GET, namespace_len);
+	j_message_set_semantics(message, semantics);
+	j_message_append_n(message, namespace, namespace_len);
+
+	it = j_list_iterator_new(operations);
+
 	while (j_list_iterator_next(it))
 	{
 		JKVOperation* kop = j_list_iterator_get(it);
+		gsize key_len;
 
-		if (kv_backend != NULL)
-		{
-			ret = j_backend_kv_put(kv_backend, kv_batch, kop->put.kv->key, kop->put.value, kop->put.value_len) && ret;
-		}
-		else
+		key_len = strlen(kop->get.kv->key) + 1;
+
+		j_message_add_operation(message, key_len);
+		j_message_append_n(message, kop->get.kv->key, key_len);
+	}
+
+	return message;
+}
+
+/**
+ * Handles the reply to put or delete operations.
+ *
+ * \private
+ *
+ * \param operations The operations.
+ * \param reply      The reply, NULL if none has been requested.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+static gboolean
+j_kv_modify_complete(JList* operations, JMessage* reply)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	(void)operations;
+	(void)reply;
+
+	/* FIXME do something with reply */
+
+	return TRUE;
+}
+
+/**
+ * Handles the reply to get operations.
+ *
+ * \private
+ *
+ * \param operations The operations.
+ * \param reply      The reply.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+static gboolean
+j_kv_get_complete(JList* operations, JMessage* reply)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = TRUE;
+
+	g_autoptr(JListIterator) iter = NULL;
+
+	g_return_val_if_fail(reply != NULL, FALSE);
+
+	iter = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(iter))
+	{
+		JKVOperation* kop = j_list_iterator_get(iter);
+		guint32 len;
+
+		len = j_message_get_4(reply);
+		ret = (len > 0) && ret;
+
+		if (len > 0)
 		{
-			gsize key_len;
+			gconstpointer data;
 
-			key_len = strlen(kop->put.kv->key) + 1;
+			data = j_message_get_n(reply, len);
+
+			if (kop->get.func != NULL)
+			{
+				gpointer value;
 
-			j_message_add_operation(message, key_len + 4 + kop->put.value_len);
-			j_message_append_n(message, kop->put.kv->key, key_len);
-			j_message_append_4(message, &(kop->put.value_len));
-			j_message_append_n(message, kop->put.value, kop->put.value_len);
+				// data belongs to the message, create a copy for the callback
+				value = g_memdup(data, len);
+				kop->get.func(value, len, kop->get.data);
+			}
+			else
+			{
+				*(kop->get.value) = g_memdup(data, len);
+				*(kop->get.value_len) = len;
+			}
 		}
 	}
 
+	return ret;
+}
+
+static JMessage*
+j_kv_put_submit(JList* operations, JSemantics* semantics, JBackendType* backend, guint32* index, gboolean* reply)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JSemanticsSafety safety;
+
+	if (j_kv_get_backend() != NULL)
+	{
+		return NULL;
+	}
+
+	safety = j_semantics_get(semantics, J_SEMANTICS_SAFETY);
+
+	*backend = J_BACKEND_TYPE_KV;
+	*reply = (safety == J_SEMANTICS_SAFETY_NETWORK || safety == J_SEMANTICS_SAFETY_STORAGE);
+
+	return j_kv_put_message(operations, semantics, index);
+}
+
+static JMessage*
+j_kv_delete_submit(JList* operations, JSemantics* semantics, JBackendType* backend, guint32* index, gboolean* reply)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JSemanticsSafety safety;
+
+	if (j_kv_get_backend() != NULL)
+	{
+		return NULL;
+	}
+
+	safety = j_semantics_get(semantics, J_SEMANTICS_SAFETY);
+
+	*backend = J_BACKEND_TYPE_KV;
+	*reply = (safety == J_SEMANTICS_SAFETY_NETWORK || safety == J_SEMANTICS_SAFETY_STORAGE);
+
+	return j_kv_delete_message(operations, semantics, index);
+}
+
+static JMessage*
+j_kv_get_submit(JList* operations, JSemantics* semantics, JBackendType* backend, guint32* index, gboolean* reply)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	if (j_kv_get_backend() != NULL)
+	{
+		return NULL;
+	}
+
+	*backend = J_BACKEND_TYPE_KV;
+	*reply = TRUE;
+
+	return j_kv_get_message(operations, semantics, index);
+}
+
+static gboolean
+j_kv_put_exec(JList* operations, JSemantics* semantics)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = TRUE;
+
+	JBackend* kv_backend;
+	g_autoptr(JMessage) message = NULL;
+	JSemanticsSafety safety;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	safety = j_semantics_get(semantics, J_SEMANTICS_SAFETY);
+	kv_backend = j_kv_get_backend();
+
 	if (kv_backend != NULL)
 	{
+		g_autoptr(JListIterator) it = NULL;
+		JKVOperation* first = j_list_get_first(operations);
+		gpointer kv_batch = NULL;
+
+		ret = j_backend_kv_batch_start(kv_backend, first->put.kv->namespace, semantics, &kv_batch);
+
+		it = j_list_iterator_new(operations);
+
+		while (j_list_iterator_next(it))
+		{
+			JKVOperation* kop = j_list_iterator_get(it);
+
+			ret = j_backend_kv_put(kv_backend, kv_batch, kop->put.kv->key, kop->put.value, kop->put.value_len) && ret;
+		}
+
 		ret = j_backend_kv_batch_execute(kv_backend, kv_batch) && ret;
 	}
 	else
 	{
 		gpointer kv_connection;
+		guint32 index;
+
+		message = j_kv_put_message(operations, semantics, &index);
 
 		kv_connection = j_connection_pool_pop(J_BACKEND_TYPE_KV, index);
 		j_message_send(message, kv_connection);
@@ -278,7 +583,7 @@ j_kv_put_exec(JList* operations, JSemantics* semantics)
 			reply = j_message_new_reply(message);
 			j_message_receive(reply, kv_connection);
 
-			/* FIXME do something with reply */
+			ret = j_kv_modify_complete(operations, reply) && ret;
 		}
 
 		j_connection_pool_push(J_BACKEND_TYPE_KV, index, kv_connection);
@@ -295,69 +600,40 @@ j_kv_delete_exec(JList* operations, JSemantics* semantics)
 	gboolean ret = TRUE;
 
 	JBackend* kv_backend;
-	g_autoptr(JListIterator) it = NULL;
 	g_autoptr(JMessage) message = NULL;
 	JSemanticsSafety safety;
-	gchar const* namespace;
-	gpointer kv_batch = NULL;
-	gsize namespace_len;
-	guint32 index;
 
 	g_return_val_if_fail(operations != NULL, FALSE);
 	g_return_val_if_fail(semantics != NULL, FALSE);
 
-	{
-		JKV* object;
-
-		object = j_list_get_first(operations);
-		g_assert(object != NULL);
-
-		namespace = object->namespace;
-		namespace_len = strlen(namespace) + 1;
-		index = object->index;
-	}
-
 	safety = j_semantics_get(semantics, J_SEMANTICS_SAFETY);
-	it = j_list_iterator_new(operations);
 	kv_backend = j_kv_get_backend();
 
 	if (kv_backend != NULL)
 	{
-		ret = j_backend_kv_batch_start(kv_backend, namespace, semantics, &kv_batch);
-	}
-	else
-	{
-		message = j_message_new(J_MESSAGE_KV_DELETE, namespace_len);
-		j_message_set_semantics(message, semantics);
-		j_message_append_n(message, namespace, namespace_len);
-	}
+		g_autoptr(JListIterator) it = NULL;
+		JKV* first = j_list_get_first(operations);
+		gpointer kv_batch = NULL;
 
-	while (j_list_iterator_next(it))
-	{
-		JKV* kv = j_list_iterator_get(it);
+		ret = j_backend_kv_batch_start(kv_backend, first->namespace, semantics, &kv_batch);
 
-		if (kv_backend != NULL)
-		{
-			ret = j_backend_kv_delete(kv_backend, kv_batch, kv->key) && ret;
-		}
-		else
-		{
-			gsize key_len;
+		it = j_list_iterator_new(operations);
 
-			key_len = strlen(kv->key) + 1;
+		while (j_list_iterator_next(it))
+		{
+			JKV* kv = j_list_iterator_get(it);
 
-			j_message_add_operation(message, key_len);
-			j_message_append_n(message, kv->key, key_len);
+			ret = j_backend_kv_delete(kv_backend, kv_batch, kv->key) && ret;
 		}
-	}
 
-	if (kv_backend != NULL)
-	{
 		ret = j_backend_kv_batch_execute(kv_backend, kv_batch) && ret;
 	}
 	else
 	{
 		gpointer kv_connection;
+		guint32 index;
+
+		message = j_kv_delete_message(operations, semantics, &index);
 
 		kv_connection = j_connection_pool_pop(J_BACKEND_TYPE_KV, index);
 		j_message_send(message, kv_connection);
@@ -369,7 +645,7 @@ j_kv_delete_exec(JList* operations, JSemantics* semantics)
 			reply = j_message_new_reply(message);
 			j_message_receive(reply, kv_connection);
 
-			/* FIXME do something with reply */
+			ret = j_kv_modify_complete(operations, reply) && ret;
 		}
 
 		j_connection_pool_push(J_BACKEND_TYPE_KV, index, kv_connection);
@@ -386,55 +662,27 @@ j_kv_get_exec(JList* operations, JSemantics* semantics)
 	gboolean ret = TRUE;
 
 	JBackend* kv_backend;
-	g_autoptr(JListIterator) it = NULL;
 	g_autoptr(JMessage) message = NULL;
-	gchar const* namespace;
-	gpointer kv_batch = NULL;
-	gsize namespace_len;
-	guint32 index;
 
 	g_return_val_if_fail(operations != NULL, FALSE);
 	g_return_val_if_fail(semantics != NULL, FALSE);
 
-	{
-		JKVOperation* kop;
-
-		kop = j_list_get_first(operations);
-		g_assert(kop != NULL);
-
-		namespace = kop->get.kv->namespace;
-		namespace_len = strlen(namespace) + 1;
-		index = kop->get.kv->index;
-	}
-
-	it = j_list_iterator_new(operations);
 	kv_backend = j_kv_get_backend();
 
 	if (kv_backend != NULL)
 	{
-		ret = j_backend_kv_batch_start(kv_backend, namespace, semantics, &kv_batch);
-	}
-	else
-	{
-		/**
-		 * Force safe semantics to make the server send a reply.
-		 * Otherwise, nasty races can occur when using unsafe semantics:
-		 * - The client creates the item and sends its first write.
-		 * - The client sends another operation using another connection from the pool.
-		 * - The second operation is executed first and fails because the item does not exist.
-		 * This does not completely eliminate all races but fixes the common case of create, write, write, ...
-		 **/
-		message = j_message_new(J_MESSAGE_KV_GET, namespace_len);
-		j_message_set_semantics(message, semantics);
-		j_message_append_n(message, namespace, namespace_len);
-	}
+		g_autoptr(JListIterator) it = NULL;
+		JKVOperation* first = j_list_get_first(operations);
+		gpointer kv_batch = NULL;
 
-	while (j_list_iterator_next(it))
-	{
-		JKVOperation* kop = j_list_iterator_get(it);
+		ret = j_backend_kv_batch_start(kv_backend, first->get.kv->namespace, semantics, &kv_batch);
+
+		it = j_list_iterator_new(operations);
 
-		if (kv_backend != NULL)
+		while (j_list_iterator_next(it))
 		{
+			JKVOperation* kop = j_list_iterator_get(it);
+
 			if (kop->get.func != NULL)
 			{
 				gpointer value;
@@ -453,26 +701,16 @@ j_kv_get_exec(JList* operations, JSemantics* semantics)
 				ret = j_backend_kv_get(kv_backend, kv_batch, kop->get.kv->key, kop->get.value, kop->get.value_len) && ret;
 			}
 		}
-		else
-		{
-			gsize key_len;
-
-			key_len = strlen(kop->get.kv->key) + 1;
-
-			j_message_add_operation(message, key_len);
-			j_message_append_n(message, kop->get.kv->key, key_len);
-		}
-	}
 
-	if (kv_backend != NULL)
-	{
 		ret = j_backend_kv_batch_execute(kv_backend, kv_batch) && ret;
 	}
 	else
 	{
-		g_autoptr(JListIterator) iter = NULL;
 		g_autoptr(JMessage) reply = NULL;
 		gpointer kv_connection;
+		guint32 index;
+
+		message = j_kv_get_message(operations, semantics, &index);
 
 		kv_connection = j_connection_pool_pop(J_BACKEND_TYPE_KV, index);
 		j_message_send(message, kv_connection);
@@ -480,37 +718,7 @@ j_kv_get_exec(JList* operations, JSemantics* semantics)
 		reply = j_message_new_reply(message);
 		j_message_receive(reply, kv_connection);
 
-		iter = j_list_iterator_new(operations);
-
-		while (j_list_iterator_next(iter))
-		{
-			JKVOperation* kop = j_list_iterator_get(iter);
-			guint32 len;
-
-			len = j_message_get_4(reply);
-			ret = (len > 0) && ret;
-
-			if (len > 0)
-			{
-				gconstpointer data;
-
-				data = j_message_get_n(reply, len);
-
-				if (kop->get.func != NULL)
-				{
-					gpointer value;
-
-					// data belongs to the message, create a copy for the callback
-					value = g_memdup(data, len);
-					kop->get.func(value, len, kop->get.data);
-				}
-				else
-				{
-					*(kop->get.value) = g_memdup(data, len);
-					*(kop->get.value_len) = len;
-				}
-			}
-		}
+		ret = j_kv_get_complete(operations, reply) && ret;
 
 		j_connection_pool_push(J_BACKEND_TYPE_KV, index, kv_connection);
 	}
@@ -544,9 +752,10 @@ j_kv_new(gchar const* namespace, gchar const* key)
 	g_return_val_if_fail(key != NULL, NULL);
 
 	kv = g_slice_new(JKV);
-	kv->index = j_helper_hash(key) % j_configuration_get_server_count(configuration, J_BACKEND_TYPE_KV);
+	kv->index = j_placement_get_index(j_configuration_get_placement(configuration, J_BACKEND_TYPE_KV), key);
 	kv->namespace = g_strdup(namespace);
 	kv->key = g_strdup(key);
+	kv->operation_key = g_strdup_printf("%u/%s", kv->index, namespace);
 	kv->ref_count = 1;
 
 	return kv;
@@ -582,6 +791,7 @@ j_kv_new_for_index(guint32 index, gchar const* namespace, gchar const* key)
 	kv->index = index;
 	kv->namespace = g_strdup(namespace);
 	kv->key = g_strdup(key);
+	kv->operation_key = g_strdup_printf("%u/%s", kv->index, namespace);
 	kv->ref_count = 1;
 
 	return kv;
@@ -630,6 +840,7 @@ j_kv_unref(JKV* kv)
 
 	if (g_atomic_int_dec_and_test(&(kv->ref_count)))
 	{
+		g_free(kv->operation_key);
 		g_free(kv->key);
 		g_free(kv->namespace);
 
@@ -657,18 +868,21 @@ j_kv_put(JKV* kv, gpointer value, guint32 value_len, GDestroyNotify value_destro
 
 	g_return_if_fail(kv != NULL);
 
-	kop = g_slice_new(JKVOperation);
+	kop = j_batch_allocate(batch, sizeof(JKVOperation));
 	kop->put.kv = j_kv_ref(kv);
 	kop->put.value = value;
 	kop->put.value_len = value_len;
 	kop->put.value_destroy = value_destroy;
 
 	operation = j_operation_new();
-	// FIXME key = index + namespace
-	operation->key = kv;
+	operation->key = kv->operation_key;
 	operation->data = kop;
 	operation->exec_func = j_kv_put_exec;
+	operation->submit_func = j_kv_put_submit;
+	operation->complete_func = j_kv_modify_complete;
 	operation->free_func = j_kv_put_free;
+	operation->cache_func = j_kv_put_cache;
+	operation->size = value_len;
 
 	j_batch_add(batch, operation);
 }
@@ -692,10 +906,13 @@ j_kv_delete(JKV* kv, JBatch* batch)
 	g_return_if_fail(kv != NULL);
 
 	operation = j_operation_new();
-	operation->key = kv;
+	operation->key = kv->operation_key;
 	operation->data = j_kv_ref(kv);
 	operation->exec_func = j_kv_delete_exec;
+	operation->submit_func = j_kv_delete_submit;
+	operation->complete_func = j_kv_modify_complete;
 	operation->free_func = j_kv_delete_free;
+	operation->cache_func = j_kv_delete_cache;
 
 	j_batch_add(batch, operation);
 }
@@ -719,7 +936,7 @@ j_kv_get(JKV* kv, gpointer* value, guint32* value_len, JBatch* batch)
 
 	g_return_if_fail(kv != NULL);
 
-	kop = g_slice_new(JKVOperation);
+	kop = j_batch_allocate(batch, sizeof(JKVOperation));
 	kop->get.kv = j_kv_ref(kv);
 	kop->get.value = value;
 	kop->get.value_len = value_len;
@@ -727,9 +944,11 @@ j_kv_get(JKV* kv, gpointer* value, guint32* value_len, JBatch* batch)
 	kop->get.data = NULL;
 
 	operation = j_operation_new();
-	operation->key = kv;
+	operation->key = kv->operation_key;
 	operation->data = kop;
 	operation->exec_func = j_kv_get_exec;
+	operation->submit_func = j_kv_get_submit;
+	operation->complete_func = j_kv_get_complete;
 	operation->free_func = j_kv_get_free;
 
 	j_batch_add(batch, operation);
@@ -755,7 +974,7 @@ j_kv_get_callback(JKV* kv, JKVGetFunc func, gpointer data, JBatch* batch)
 	g_return_if_fail(kv != NULL);
 	g_return_if_fail(func != NULL);
 
-	kop = g_slice_new(JKVOperation);
+	kop = j_batch_allocate(batch, sizeof(JKVOperation));
 	kop->get.kv = j_kv_ref(kv);
 	kop->get.value = NULL;
 	kop->get.value_len = NULL;
@@ -763,9 +982,11 @@ j_kv_get_callback(JKV* kv, JKVGetFunc func, gpointer data, JBatch* batch)
 	kop->get.data = data;
 
 	operation = j_operation_new();
-	operation->key = kv;
+	operation->key = kv->operation_key;
 	operation->data = kop;
 	operation->exec_func = j_kv_get_exec;
+	operation->submit_func = j_kv_get_submit;
+	operation->complete_func = j_kv_get_complete;
 	operation->free_func = j_kv_get_free;
 
 	j_batch_add(batch, operation);
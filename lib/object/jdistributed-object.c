@@ -40,8 +40,57 @@
  * @{
  **/
 
+struct JDistributedObjectReadBuffer
+{
+	gchar* data;
+	guint64* bytes_read;
+
+	/**
+	 * The buffer's length, its server, its offset on the server and its block.
+	 * For replicated objects, the server and offset are the ones of the first replica.
+	 * Used to reconstruct or reread the buffer's data if the server fails.
+	 **/
+	guint64 length;
+	guint32 index;
+	guint64 offset;
+	guint64 block_id;
+
+	/**
+	 * The number of bytes received for this buffer.
+	 **/
+	guint64 nbytes;
+};
+
+typedef struct JDistributedObjectReadBuffer JDistributedObjectReadBuffer;
+
+/**
+ * A stripe of an erasure-coded object that is being written.
+ **/
+struct JDistributedObjectStripe
+{
+	guint64 id;
+
+	/**
+	 * The stripe's data blocks, either the written data or #buffer.
+	 **/
+	gchar const* data;
+
+	/**
+	 * A copy of the stripe's data blocks, NULL if the written data covers the whole stripe.
+	 * Large enough to hold the parity blocks, too.
+	 **/
+	gchar* buffer;
+
+	/**
+	 * The stripe's parity blocks.
+	 **/
+	gchar* parity;
+};
+
+typedef struct JDistributedObjectStripe JDistributedObjectStripe;
+
 /**
- * Data for background operations.
+ * Data for background operations and replies.
  */
 struct JDistributedObjectBackgroundData
 {
@@ -50,6 +99,17 @@ struct JDistributedObjectBackgroundData
 	JList* operations;
 	JSemantics* semantics;
 
+	/**
+	 * The connection to use, NULL if one should be taken from the pool.
+	 */
+	gpointer connection;
+
+	/**
+	 * The memory regions acquired for the fabric connection, NULL if the fabric is not used.
+	 * Contains one #JFabricMemory element per operation, NULL for operations without one.
+	 */
+	GPtrArray* memories;
+
 	/**
 	 * The union for read and write parts.
 	 */
@@ -65,6 +125,27 @@ struct JDistributedObjectBackgroundData
 			 * Contains #JDistributedObjectReadBuffer elements.
 			 */
 			JList* buffers;
+
+			/**
+			 * The iterator over #buffers.
+			 * Replies are received incrementally, so the position has to be kept between them.
+			 */
+			JListIterator* iterator;
+
+			/**
+			 * The buffer currently being filled, NULL if the next one should be taken from #iterator.
+			 */
+			JDistributedObjectReadBuffer* buffer;
+
+			/**
+			 * The number of bytes already written into #buffer.
+			 */
+			guint64 buffer_offset;
+
+			/**
+			 * The number of operations that have been answered completely.
+			 */
+			guint32 operations_done;
 		} read;
 
 		/**
@@ -79,13 +160,72 @@ struct JDistributedObjectBackgroundData
 
 typedef struct JDistributedObjectBackgroundData JDistributedObjectBackgroundData;
 
-struct JDistributedObjectReadBuffer
+/**
+ * A hedged read, that is, a duplicate request for the buffers of a slow server sent to other servers.
+ */
+struct JDistributedObjectHedge
 {
-	gchar* data;
-	guint64* bytes_read;
+	/**
+	 * The slow server.
+	 */
+	guint32 index;
+
+	/**
+	 * The slow server's buffers.
+	 * Contains #JDistributedObjectReadBuffer elements.
+	 */
+	JList* buffers;
+
+	/**
+	 * The requests sent to other servers, indexed by server.
+	 * Servers without a message are not used.
+	 */
+	JDistributedObjectBackgroundData* background_data;
+	guint32 server_count;
+
+	/**
+	 * The buffers requested from other servers.
+	 * For replicated objects, these are the slow server's buffers in the same order.
+	 * For erasure-coded objects, these are the available blocks of #stripes.
+	 */
+	JDistributedObjectReadBuffer* retries;
+
+	/**
+	 * Counts the bytes received for #retries, which are accounted for once the hedge has won.
+	 */
+	guint64 bytes_read;
+
+	/**
+	 * The data and parity blocks of the stripes affected by the slow server, NULL for replicated objects.
+	 */
+	gchar* stripes;
+
+	/**
+	 * The ids of the stripes in #stripes.
+	 */
+	GArray* stripe_ids;
+
+	/**
+	 * Whether the stripes' blocks are requested, indexed by block.
+	 */
+	gboolean* available;
 };
 
-typedef struct JDistributedObjectReadBuffer JDistributedObjectReadBuffer;
+typedef struct JDistributedObjectHedge JDistributedObjectHedge;
+
+/**
+ * The maximum number of hedged reads that can be saved up.
+ * Limits bursts of hedged reads after long periods without any.
+ **/
+#define J_DISTRIBUTED_OBJECT_HEDGE_BURST 10.0
+
+/**
+ * The number of hedged reads that may currently be issued.
+ * Every read earns a fraction of a hedged read according to the configured budget.
+ **/
+static gdouble j_distributed_object_hedge_tokens = 0.0;
+
+G_LOCK_DEFINE_STATIC(j_distributed_object_hedge_tokens);
 
 struct JDistributedObjectOperation
 {
@@ -135,6 +275,11 @@ struct JDistributedObject
 	 **/
 	gchar* name;
 
+	/**
+	 * Identifies the object in batches, see #JOperation.
+	 **/
+	gchar* operation_key;
+
 	JDistribution* distribution;
 
 	/**
@@ -171,8 +316,6 @@ j_distributed_object_status_free(gpointer data)
 	JDistributedObjectOperation* operation = data;
 
 	j_distributed_object_unref(operation->status.object);
-
-	g_slice_free(JDistributedObjectOperation, operation);
 }
 
 static void
@@ -183,8 +326,6 @@ j_distributed_object_read_free(gpointer data)
 	JDistributedObjectOperation* operation = data;
 
 	j_distributed_object_unref(operation->read.object);
-
-	g_slice_free(JDistributedObjectOperation, operation);
 }
 
 static void
@@ -195,8 +336,126 @@ j_distributed_object_write_free(gpointer data)
 	JDistributedObjectOperation* operation = data;
 
 	j_distributed_object_unref(operation->write.object);
+}
+
+static guint64
+j_distributed_object_create_cache(gpointer data, gpointer buffer)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	(void)data;
+	(void)buffer;
+
+	return 0;
+}
+
+static guint64
+j_distributed_object_delete_cache(gpointer data, gpointer buffer)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	(void)data;
+	(void)buffer;
+
+	return 0;
+}
+
+static guint64
+j_distributed_object_write_cache(gpointer data, gpointer buffer)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributedObjectOperation* operation = data;
+	guint64 size;
+
+	// The cached operation gets its own counter because the caller's one is updated right away.
+	size = sizeof(guint64) + operation->write.length;
+
+	if (buffer != NULL)
+	{
+		guint64* bytes_written = buffer;
+		gchar* new_data = (gchar*)buffer + sizeof(guint64);
+
+		memcpy(new_data, operation->write.data, operation->write.length);
+		j_helper_atomic_add(operation->write.bytes_written, operation->write.length);
+
+		*bytes_written = 0;
+		operation->write.data = new_data;
+		operation->write.bytes_written = bytes_written;
+	}
+
+	return size;
+}
+
+/**
+ * Creates the array of acquired memory regions for a connection.
+ *
+ * \private
+ *
+ * \param connection A connection.
+ *
+ * \return A new array, NULL if the connection does not use a fabric.
+ **/
+static GPtrArray*
+j_distributed_object_new_memories(gpointer connection)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	if (j_fabric_connection_get(connection) == NULL)
+	{
+		return NULL;
+	}
 
-	g_slice_free(JDistributedObjectOperation, operation);
+	return g_ptr_array_new_with_free_func((GDestroyNotify)j_fabric_memory_release);
+}
+
+/**
+ * Acquires registered memory for an operation and appends the operation to a message.
+ * The server accesses the memory directly using the fabric connection.
+ *
+ * \private
+ *
+ * \param message    A message.
+ * \param connection A connection.
+ * \param memories   The operations' memory regions.
+ * \param data       The operation's memory.
+ * \param length     The operation's length.
+ * \param offset     The operation's offset.
+ * \param copy       Whether the server reads the memory.
+ *
+ * \return TRUE on success, FALSE if the memory could not be registered.
+ **/
+static gboolean
+j_distributed_object_append_memory(JMessage* message, gpointer connection, GPtrArray* memories, gconstpointer data, guint64 length, guint64 offset, gboolean copy)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JFabricMemory* memory = NULL;
+	guint64 address = 0;
+	guint64 key = 0;
+
+	if (length > 0)
+	{
+		memory = j_fabric_memory_acquire(j_fabric_connection_get(connection), data, length, copy);
+	}
+
+	if (memory != NULL)
+	{
+		address = j_fabric_memory_get_address(memory);
+		key = j_fabric_memory_get_key(memory);
+	}
+
+	// The memory regions are indexed by operation, so read data can be copied back.
+	g_ptr_array_add(memories, memory);
+
+	// Operations that could not be registered fail on the server.
+	j_message_add_operation(message, 4 * sizeof(guint64));
+	j_message_append_8(message, &length);
+	j_message_append_8(message, &offset);
+	j_message_append_8(message, &address);
+	j_message_append_8(message, &key);
+
+	return (length == 0 || memory != NULL);
 }
 
 /**
@@ -286,199 +545,1612 @@ j_distributed_object_delete_background_operation(gpointer data)
 }
 
 /**
- * Executes write operations in a background operation.
+ * Handles a reply to a read message.
  *
  * \private
  *
- * \param data Background data.
+ * \param reply      The reply.
+ * \param connection The connection.
+ * \param data       Background data.
  *
- * \return #data.
+ * \return TRUE if more replies are expected, FALSE otherwise.
  **/
-static gpointer
-j_distributed_object_read_background_operation(gpointer data)
+static gboolean
+j_distributed_object_read_reply(JMessage* reply, gpointer connection, gpointer data)
 {
 	J_TRACE_FUNCTION(NULL);
 
 	JDistributedObjectBackgroundData* background_data = data;
 
-	g_autoptr(JListIterator) it = NULL;
-	g_autoptr(JMessage) reply = NULL;
-	gpointer object_connection;
-	guint32 operations_done;
-	guint32 operation_count;
-
-	object_connection = j_connection_pool_pop(J_BACKEND_TYPE_OBJECT, background_data->index);
-	j_message_send(background_data->message, object_connection);
+	guint32 reply_operation_count;
 
-	reply = j_message_new_reply(background_data->message);
+	(void)connection;
 
-	operations_done = 0;
-	operation_count = j_message_get_count(background_data->message);
-
-	it = j_list_iterator_new(background_data->read.buffers);
+	reply_operation_count = j_message_get_count(reply);
 
 	/**
-	 * This extra loop is necessary because the server might send multiple
-	 * replies per message. The same reply object can be used to receive
-	 * multiple times.
+	 * The server streams its reply as multiple fragments.
+	 * An operation can span multiple fragments and replies, so the data is consumed incrementally.
 	 */
-	while (operations_done < operation_count)
+	for (guint i = 0; i < reply_operation_count; i++)
 	{
-		guint32 reply_operation_count;
+		JDistributedObjectReadBuffer* buffer;
+		guint64 nbytes;
+		gchar last;
 
-		j_message_receive(reply, object_connection);
+		if (background_data->read.buffer == NULL)
+		{
+			if (!j_list_iterator_next(background_data->read.iterator))
+			{
+				break;
+			}
 
-		reply_operation_count = j_message_get_count(reply);
+			background_data->read.buffer = j_list_iterator_get(background_data->read.iterator);
+			background_data->read.buffer_offset = 0;
+		}
 
-		for (guint i = 0; i < reply_operation_count && j_list_iterator_next(it); i++)
-		{
-			JDistributedObjectReadBuffer* buffer = j_list_iterator_get(it);
-			gchar* read_data = buffer->data;
-			guint64* bytes_read = buffer->bytes_read;
+		buffer = background_data->read.buffer;
 
-			guint64 nbytes;
+		nbytes = j_message_get_8(reply);
+		last = j_message_get_1(reply);
 
-			nbytes = j_message_get_8(reply);
-			j_helper_atomic_add(bytes_read, nbytes);
+		// Data transferred using the fabric has already been written into the buffer or a bounce buffer.
+		if (nbytes > 0 && background_data->memories != NULL)
+		{
+			JFabricMemory* memory = g_ptr_array_index(background_data->memories, background_data->read.operations_done);
 
-			if (nbytes > 0)
+			if (memory != NULL)
 			{
-				GInputStream* input;
+				j_fabric_memory_copy_back(memory, background_data->read.buffer_offset, nbytes);
+			}
 
-				input = g_io_stream_get_input_stream(G_IO_STREAM(object_connection));
-				g_input_stream_read_all(input, read_data, nbytes, NULL, NULL, NULL);
+			background_data->read.buffer_offset += nbytes;
+		}
+		else if (nbytes > 0)
+		{
+			// The data is received directly into the buffer, the operation remains incomplete on errors.
+			if (!j_message_receive_send(reply, buffer->data + background_data->read.buffer_offset, nbytes))
+			{
+				return FALSE;
 			}
 
-			g_slice_free(JDistributedObjectReadBuffer, buffer);
+			background_data->read.buffer_offset += nbytes;
 		}
 
-		operations_done += reply_operation_count;
+		j_helper_atomic_add(buffer->bytes_read, nbytes);
+		buffer->nbytes += nbytes;
+
+		if (last)
+		{
+			background_data->read.buffer = NULL;
+			background_data->read.operations_done++;
+		}
 	}
 
-	j_message_unref(background_data->message);
+	return (background_data->read.operations_done < j_message_get_count(background_data->message));
+}
 
-	j_connection_pool_push(J_BACKEND_TYPE_OBJECT, background_data->index, object_connection);
+/**
+ * Handles a reply to a write message.
+ *
+ * \private
+ *
+ * \param reply      The reply.
+ * \param connection The connection.
+ * \param data       Background data.
+ *
+ * \return FALSE, there is only a single reply.
+ **/
+static gboolean
+j_distributed_object_write_reply(JMessage* reply, gpointer connection, gpointer data)
+{
+	J_TRACE_FUNCTION(NULL);
 
-	j_list_unref(background_data->read.buffers);
+	JDistributedObjectBackgroundData* background_data = data;
 
-	g_slice_free(JDistributedObjectBackgroundData, background_data);
+	g_autoptr(JListIterator) it = NULL;
 
-	return NULL;
+	(void)connection;
+
+	it = j_list_iterator_new(background_data->write.bytes_written);
+
+	while (j_list_iterator_next(it))
+	{
+		guint64* bytes_written = j_list_iterator_get(it);
+		guint64 nbytes;
+
+		nbytes = j_message_get_8(reply);
+		j_helper_atomic_add(bytes_written, nbytes);
+	}
+
+	return FALSE;
 }
 
 /**
- * Executes write operations in a background operation.
+ * Handles a reply to a status message.
  *
  * \private
  *
- * \param data Background data.
+ * \param reply      The reply.
+ * \param connection The connection.
+ * \param data       Background data.
  *
- * \return #data.
+ * \return FALSE, there is only a single reply.
  **/
-static gpointer
-j_distributed_object_write_background_operation(gpointer data)
+static gboolean
+j_distributed_object_status_reply(JMessage* reply, gpointer connection, gpointer data)
 {
 	J_TRACE_FUNCTION(NULL);
 
 	JDistributedObjectBackgroundData* background_data = data;
 
-	JSemanticsSafety safety;
+	g_autoptr(JListIterator) it = NULL;
 
-	gpointer object_connection;
+	(void)connection;
 
-	safety = j_semantics_get(background_data->semantics, J_SEMANTICS_SAFETY);
-	object_connection = j_connection_pool_pop(J_BACKEND_TYPE_OBJECT, background_data->index);
-	j_message_send(background_data->message, object_connection);
+	it = j_list_iterator_new(background_data->operations);
 
-	if (safety == J_SEMANTICS_SAFETY_NETWORK || safety == J_SEMANTICS_SAFETY_STORAGE)
+	while (j_list_iterator_next(it))
 	{
-		g_autoptr(JListIterator) it = NULL;
-		g_autoptr(JMessage) reply = NULL;
-		guint64 nbytes;
-
-		reply = j_message_new_reply(background_data->message);
-		j_message_receive(reply, object_connection);
+		JDistributedObjectOperation* operation = j_list_iterator_get(it);
+		gint64* modification_time = operation->status.modification_time;
+		guint64* size = operation->status.size;
+		gint64 modification_time_;
+		guint64 size_;
 
-		it = j_list_iterator_new(background_data->write.bytes_written);
+		modification_time_ = j_message_get_8(reply);
+		size_ = j_message_get_8(reply);
 
-		while (j_list_iterator_next(it))
+		// All replies are handled by the thread executing the fanout, so the results can be merged without atomic operations.
+		if (modification_time != NULL)
 		{
-			guint64* bytes_written = j_list_iterator_get(it);
+			*modification_time = MAX(*modification_time, modification_time_);
+		}
 
-			nbytes = j_message_get_8(reply);
-			j_helper_atomic_add(bytes_written, nbytes);
+		if (size != NULL)
+		{
+			*size = MAX(*size, j_distribution_get_size(operation->status.object->distribution, background_data->index, size_));
 		}
 	}
 
-	j_message_unref(background_data->message);
+	return FALSE;
+}
 
-	j_connection_pool_push(J_BACKEND_TYPE_OBJECT, background_data->index, object_connection);
+static void
+j_distributed_object_stripe_free(gpointer data)
+{
+	J_TRACE_FUNCTION(NULL);
 
-	j_list_unref(background_data->write.bytes_written);
+	JDistributedObjectStripe* stripe = data;
 
-	g_slice_free(JDistributedObjectBackgroundData, background_data);
+	g_free(stripe->buffer);
+	g_free(stripe->parity);
 
-	return NULL;
+	g_slice_free(JDistributedObjectStripe, stripe);
 }
 
 /**
- * Executes status operations in a background operation.
+ * Reads buffers from multiple servers in parallel.
  *
  * \private
  *
- * \param data Background data.
- *
- * \return #data.
+ * \param object    An object.
+ * \param semantics Semantics.
+ * \param lists     The buffers to read, indexed by server, NULL for servers that should not be contacted. Each buffer is read at its offset.
+ * \param failed    Set for servers that could not be reached or did not answer completely, indexed by server.
  **/
-static gpointer
-j_distributed_object_status_background_operation(gpointer data)
+static void
+j_distributed_object_read_servers(JDistributedObject* object, JSemantics* semantics, JList** lists, gboolean* failed)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	JDistributedObjectBackgroundData* background_data = data;
+	g_autoptr(JMessageFanout) fanout = NULL;
+	g_autofree JDistributedObjectBackgroundData* background_data = NULL;
+	gsize namespace_len;
+	gsize name_len;
+	guint32 server_count;
 
-	g_autoptr(JListIterator) it = NULL;
-	g_autoptr(JMessage) reply = NULL;
-	gpointer object_connection;
+	server_count = j_configuration_get_server_count(j_configuration(), J_BACKEND_TYPE_OBJECT);
 
-	object_connection = j_connection_pool_pop(J_BACKEND_TYPE_OBJECT, background_data->index);
-	j_message_send(background_data->message, object_connection);
+	fanout = j_message_fanout_new();
+	background_data = g_new0(JDistributedObjectBackgroundData, server_count);
+
+	namespace_len = strlen(object->namespace) + 1;
+	name_len = strlen(object->name) + 1;
+
+	for (guint i = 0; i < server_count; i++)
+	{
+		JDistributedObjectBackgroundData* data = &(background_data[i]);
+		g_autoptr(JListIterator) buffer_it = NULL;
+		gboolean registered = TRUE;
+
+		if (lists[i] == NULL)
+		{
+			continue;
+		}
+
+		data->connection = j_connection_pool_pop(J_BACKEND_TYPE_OBJECT, i);
+
+		if (data->connection == NULL)
+		{
+			failed[i] = TRUE;
+			continue;
+		}
+
+		data->index = i;
+		data->message = j_message_new(J_MESSAGE_OBJECT_READ, namespace_len + name_len);
+		data->operations = NULL;
+		data->semantics = semantics;
+		data->memories = j_distributed_object_new_memories(data->connection);
+		data->read.buffers = lists[i];
+		data->read.iterator = j_list_iterator_new(lists[i]);
+		data->read.buffer = NULL;
+		data->read.buffer_offset = 0;
+		data->read.operations_done = 0;
+
+		j_message_set_semantics(data->message, semantics);
+		j_message_append_n(data->message, object->namespace, namespace_len);
+		j_message_append_n(data->message, object->name, name_len);
+
+		buffer_it = j_list_iterator_new(lists[i]);
+
+		while (j_list_iterator_next(buffer_it))
+		{
+			JDistributedObjectReadBuffer* buffer = j_list_iterator_get(buffer_it);
+
+			if (data->memories != NULL)
+			{
+				registered = j_distributed_object_append_memory(data->message, data->connection, data->memories, buffer->data, buffer->length, buffer->offset, FALSE) && registered;
+			}
+			else
+			{
+				j_message_add_operation(data->message, sizeof(guint64) + sizeof(guint64));
+				j_message_append_8(data->message, &(buffer->length));
+				j_message_append_8(data->message, &(buffer->offset));
+			}
+		}
+
+		// The server is treated as failed if its memory could not be registered.
+		if (registered)
+		{
+			j_message_fanout_add(fanout, data->message, data->connection, j_distributed_object_read_reply, data);
+		}
+	}
+
+	j_message_fanout_execute(fanout);
+
+	for (guint i = 0; i < server_count; i++)
+	{
+		JDistributedObjectBackgroundData* data = &(background_data[i]);
+
+		if (data->message == NULL)
+		{
+			continue;
+		}
+
+		if (data->read.operations_done < j_message_get_count(data->message))
+		{
+			failed[i] = TRUE;
+		}
+
+		j_list_iterator_free(data->read.iterator);
+
+		if (data->memories != NULL)
+		{
+			g_ptr_array_unref(data->memories);
+		}
+
+		j_message_unref(data->message);
+		j_connection_pool_push(J_BACKEND_TYPE_OBJECT, i, data->connection);
+	}
+}
+
+/**
+ * Reads whole blocks of an erasure-coded stripe.
+ *
+ * \private
+ *
+ * \param object    An object.
+ * \param semantics Semantics.
+ * \param stripe    A stripe.
+ * \param blocks    Buffers for the stripe's data blocks followed by its parity blocks.
+ * \param available Returns whether the blocks could be read.
+ * \param first     The first block to read.
+ * \param last      The block following the last block to read.
+ * \param failed    Whether servers are known to have failed, indexed by server. May be NULL.
+ **/
+static void
+j_distributed_object_read_blocks(JDistributedObject* object, JSemantics* semantics, guint64 stripe, gchar** blocks, gboolean* available, guint first, guint last, gboolean const* failed)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_autofree JList** lists = NULL;
+	g_autofree JDistributedObjectReadBuffer* buffers = NULL;
+	g_autofree gboolean* unavailable = NULL;
+	guint64 block_size;
+	guint64 bytes_read = 0;
+	guint32 server_count;
+	guint data_blocks;
+	guint parity_blocks;
+
+	j_distribution_get_erasure_code(object->distribution, &data_blocks, &parity_blocks, &block_size);
+	server_count = j_configuration_get_server_count(j_configuration(), J_BACKEND_TYPE_OBJECT);
+
+	lists = g_new0(JList*, server_count);
+	buffers = g_new(JDistributedObjectReadBuffer, last - first);
+	unavailable = g_new0(gboolean, server_count);
+
+	// Each block of a stripe is stored on a different server.
+	for (guint i = first; i < last; i++)
+	{
+		JDistributedObjectReadBuffer* buffer = &(buffers[i - first]);
+		guint32 index;
+
+		index = j_distribution_get_erasure_server(object->distribution, i);
+		available[i] = FALSE;
+
+		if (failed != NULL && failed[index])
+		{
+			continue;
+		}
+
+		buffer->data = blocks[i];
+		buffer->bytes_read = &bytes_read;
+		buffer->length = block_size;
+		buffer->index = index;
+		buffer->offset = stripe * block_size;
+		// The block is only needed to reconstruct the buffers of read operations.
+		buffer->block_id = 0;
+		buffer->nbytes = 0;
+
+		lists[index] = j_list_new(NULL);
+		j_list_append(lists[index], buffer);
+	}
+
+	j_distributed_object_read_servers(object, semantics, lists, unavailable);
+
+	for (guint i = first; i < last; i++)
+	{
+		guint32 index;
+
+		index = j_distribution_get_erasure_server(object->distribution, i);
+
+		if (lists[index] == NULL)
+		{
+			continue;
+		}
+
+		available[i] = !unavailable[index];
+	}
+
+	for (guint i = 0; i < server_count; i++)
+	{
+		if (lists[i] != NULL)
+		{
+			j_list_unref(lists[i]);
+		}
+	}
+}
+
+/**
+ * Reads an erasure-coded stripe.
+ * Only the data blocks are read, unless some of them are missing and have to be reconstructed.
+ *
+ * \private
+ *
+ * \param object    An object.
+ * \param semantics Semantics.
+ * \param rs        The object's Reed-Solomon code.
+ * \param stripe    A stripe.
+ * \param buffer    A buffer large enough for the stripe's data and parity blocks. Returns the data blocks.
+ * \param failed    Whether servers are known to have failed, indexed by server. May be NULL.
+ *
+ * \return TRUE if all data blocks could be read or reconstructed, FALSE otherwise.
+ **/
+static gboolean
+j_distributed_object_read_stripe(JDistributedObject* object, JSemantics* semantics, JReedSolomon* rs, guint64 stripe, gchar* buffer, gboolean const* failed)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_autofree gchar** blocks = NULL;
+	g_autofree gboolean* available = NULL;
+	guint64 block_size;
+	guint data_blocks;
+	guint parity_blocks;
+	gboolean missing = FALSE;
+
+	j_distribution_get_erasure_code(object->distribution, &data_blocks, &parity_blocks, &block_size);
+
+	blocks = g_new(gchar*, data_blocks + parity_blocks);
+	available = g_new(gboolean, data_blocks + parity_blocks);
+
+	// Blocks beyond the end of the object are read partially or not at all, they are treated as zeros.
+	memset(buffer, 0, (data_blocks + parity_blocks) * block_size);
+
+	for (guint i = 0; i < data_blocks + parity_blocks; i++)
+	{
+		blocks[i] = buffer + (i * block_size);
+	}
+
+	j_distributed_object_read_blocks(object, semantics, stripe, blocks, available, 0, data_blocks, failed);
+
+	for (guint i = 0; i < data_blocks; i++)
+	{
+		missing = missing || !available[i];
+	}
+
+	if (!missing)
+	{
+		return TRUE;
+	}
+
+	j_distributed_object_read_blocks(object, semantics, stripe, blocks, available, data_blocks, data_blocks + parity_blocks, failed);
+
+	return j_reed_solomon_reconstruct(rs, (gpointer*)blocks, available, block_size);
+}
+
+/**
+ * Updates the stripes affected by a write to an erasure-coded object.
+ * Stripes that are only partially overwritten are read first, so that their parity can be recomputed.
+ *
+ * \private
+ *
+ * \param object    An object.
+ * \param semantics Semantics.
+ * \param rs        The object's Reed-Solomon code.
+ * \param stripes   The stripes affected by previous writes.
+ * \param data      The written data.
+ * \param length    The written data's length.
+ * \param offset    The written data's offset.
+ *
+ * \return TRUE on success, FALSE if a stripe could not be read.
+ **/
+static gboolean
+j_distributed_object_update_stripes(JDistributedObject* object, JSemantics* semantics, JReedSolomon* rs, GHashTable* stripes, gconstpointer data, guint64 length, guint64 offset)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = TRUE;
+
+	guint64 block_size;
+	guint64 stripe_size;
+	guint data_blocks;
+	guint parity_blocks;
+
+	if (length == 0)
+	{
+		return TRUE;
+	}
+
+	j_distribution_get_erasure_code(object->distribution, &data_blocks, &parity_blocks, &block_size);
+	stripe_size = data_blocks * block_size;
+
+	for (guint64 i = offset / stripe_size; i <= (offset + length - 1) / stripe_size; i++)
+	{
+		JDistributedObjectStripe* stripe;
+		guint64 stripe_offset;
+		guint64 begin;
+		guint64 end;
+
+		stripe_offset = i * stripe_size;
+		begin = MAX(offset, stripe_offset);
+		end = MIN(offset + length, stripe_offset + stripe_size);
+
+		stripe = g_hash_table_lookup(stripes, &i);
+
+		if (stripe == NULL)
+		{
+			stripe = g_slice_new(JDistributedObjectStripe);
+			stripe->id = i;
+			stripe->data = NULL;
+			stripe->buffer = NULL;
+			stripe->parity = NULL;
+
+			g_hash_table_insert(stripes, &(stripe->id), stripe);
+
+			if (begin == stripe_offset && end == stripe_offset + stripe_size)
+			{
+				// The whole stripe is overwritten, so the old data is not needed.
+				stripe->data = (gchar const*)data + (stripe_offset - offset);
+				continue;
+			}
+
+			stripe->buffer = g_malloc((data_blocks + parity_blocks) * block_size);
+			stripe->data = stripe->buffer;
+
+			// FIXME This is not atomic, concurrent writes to the same stripe can result in inconsistent parity.
+			ret = j_distributed_object_read_stripe(object, semantics, rs, i, stripe->buffer, NULL) && ret;
+		}
+		else if (stripe->buffer == NULL)
+		{
+			// The stripe still refers to another write's data.
+			stripe->buffer = g_malloc((data_blocks + parity_blocks) * block_size);
+			memcpy(stripe->buffer, stripe->data, stripe_size);
+			stripe->data = stripe->buffer;
+		}
+
+		memcpy(stripe->buffer + (begin - stripe_offset), (gchar const*)data + (begin - offset), end - begin);
+	}
+
+	return ret;
+}
+
+static gint
+j_distributed_object_read_buffer_compare(gconstpointer a, gconstpointer b)
+{
+	JDistributedObjectReadBuffer const* buffer_a = *(JDistributedObjectReadBuffer* const*)a;
+	JDistributedObjectReadBuffer const* buffer_b = *(JDistributedObjectReadBuffer* const*)b;
+
+	if (buffer_a->block_id < buffer_b->block_id)
+	{
+		return -1;
+	}
+	else if (buffer_a->block_id > buffer_b->block_id)
+	{
+		return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Reconstructs the data of read buffers whose servers have failed.
+ * Each affected stripe is read from the remaining servers and decoded once.
+ *
+ * \private
+ *
+ * \param object    An object.
+ * \param semantics Semantics.
+ * \param rs        The object's Reed-Solomon code.
+ * \param buffers   The buffers to reconstruct, will be freed.
+ * \param failed    Whether servers have failed, indexed by server.
+ *
+ * \return TRUE if all buffers could be reconstructed, FALSE otherwise.
+ **/
+static gboolean
+j_distributed_object_reconstruct_buffers(JDistributedObject* object, JSemantics* semantics, JReedSolomon* rs, GPtrArray* buffers, gboolean const* failed)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = TRUE;
+
+	g_autofree gchar* stripe_buffer = NULL;
+	guint64 block_size;
+	guint64 current_stripe = G_MAXUINT64;
+	guint data_blocks;
+	guint parity_blocks;
+	gboolean stripe_ret = FALSE;
+
+	j_distribution_get_erasure_code(object->distribution, &data_blocks, &parity_blocks, &block_size);
+
+	stripe_buffer = g_malloc((data_blocks + parity_blocks) * block_size);
+	g_ptr_array_sort(buffers, j_distributed_object_read_buffer_compare);
+
+	for (guint i = 0; i < buffers->len; i++)
+	{
+		JDistributedObjectReadBuffer* buffer = g_ptr_array_index(buffers, i);
+		guint64 stripe;
+
+		stripe = buffer->block_id / data_blocks;
+
+		if (stripe != current_stripe)
+		{
+			stripe_ret = j_distributed_object_read_stripe(object, semantics, rs, stripe, stripe_buffer, failed);
+			current_stripe = stripe;
+		}
+
+		if (stripe_ret)
+		{
+			gchar const* block;
+
+			block = stripe_buffer + ((buffer->block_id % data_blocks) * block_size);
+			memcpy(buffer->data, block + (buffer->offset % block_size), buffer->length);
+
+			// The failed server's size is unknown, so reconstructed buffers are always complete.
+			j_helper_atomic_add(buffer->bytes_read, buffer->length - buffer->nbytes);
+		}
+
+		ret = stripe_ret && ret;
+
+		g_slice_free(JDistributedObjectReadBuffer, buffer);
+	}
+
+	return ret;
+}
+
+/**
+ * Chooses the replica to read a block from.
+ * Replicas on servers with a low latency and few outstanding operations are preferred, so that reads are spread across the servers.
+ * Servers without a recent latency are preferred over all others, so that they are measured.
+ *
+ * \private
+ *
+ * \param object         An object.
+ * \param index          The server index of the block's first replica.
+ * \param offset         The offset of the block's first replica.
+ * \param latencies      The servers' latencies as returned by j_connection_pool_get_load().
+ * \param loads          The servers' numbers of outstanding operations. Incremented for the chosen server.
+ * \param excluded       Whether servers must not be used, indexed by server. May be NULL.
+ * \param replica_index  Returns the chosen replica's server index.
+ * \param replica_offset Returns the chosen replica's offset.
+ *
+ * \return TRUE if a replica has been chosen, FALSE if all replicas are excluded.
+ **/
+static gboolean
+j_distributed_object_choose_replica(JDistributedObject* object, guint32 index, guint64 offset, gint64 const* latencies, guint* loads, gboolean const* excluded, guint32* replica_index, guint64* replica_offset)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = FALSE;
+	guint64 best_score = G_MAXUINT64;
+	guint replica_count;
+
+	replica_count = j_distribution_get_replica_count(object->distribution);
+
+	for (guint i = 0; i < replica_count; i++)
+	{
+		guint candidate_index;
+		guint64 candidate_offset;
+		guint64 score;
+
+		j_distribution_get_replica(object->distribution, i, index, offset, &candidate_index, &candidate_offset);
+
+		if (excluded != NULL && excluded[candidate_index])
+		{
+			continue;
+		}
+
+		// Ties are broken in favor of earlier replicas.
+		score = (guint64)(latencies[candidate_index] + 1) * (loads[candidate_index] + 1);
+
+		if (score < best_score)
+		{
+			best_score = score;
+			*replica_index = candidate_index;
+			*replica_offset = candidate_offset;
+			ret = TRUE;
+		}
+	}
+
+	if (ret)
+	{
+		loads[*replica_index]++;
+	}
+
+	return ret;
+}
+
+/**
+ * Reads buffers whose servers have failed from other replicas.
+ * Each round, the buffers are read from the best remaining replicas until all of them have been read or all replicas have failed.
+ *
+ * \private
+ *
+ * \param object    An object.
+ * \param semantics Semantics.
+ * \param buffers   The buffers to read, will be freed.
+ * \param failed    Whether servers have failed, indexed by server. Updated with servers that fail while reading.
+ * \param latencies The servers' latencies as returned by j_connection_pool_get_load().
+ * \param loads     The servers' numbers of outstanding operations.
+ *
+ * \return TRUE if all buffers could be read, FALSE otherwise.
+ **/
+static gboolean
+j_distributed_object_read_replicas(JDistributedObject* object, JSemantics* semantics, GPtrArray* buffers, gboolean* failed, gint64 const* latencies, guint* loads)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = TRUE;
+
+	g_autofree JList** lists = NULL;
+	g_autofree JDistributedObjectReadBuffer* retries = NULL;
+	guint64 bytes_read = 0;
+	guint32 server_count;
+
+	server_count = j_configuration_get_server_count(j_configuration(), J_BACKEND_TYPE_OBJECT);
+
+	lists = g_new(JList*, server_count);
+	retries = g_new(JDistributedObjectReadBuffer, buffers->len);
+
+	// Each round excludes the servers that failed, so there are at most as many rounds as replicas.
+	while (buffers->len > 0)
+	{
+		guint remaining = 0;
+
+		for (guint i = 0; i < server_count; i++)
+		{
+			lists[i] = NULL;
+		}
+
+		for (guint i = 0; i < buffers->len; i++)
+		{
+			JDistributedObjectReadBuffer* buffer = g_ptr_array_index(buffers, i);
+			JDistributedObjectReadBuffer* retry = &(retries[i]);
+
+			// Retries count their bytes separately, so that bytes already received for the buffer are not counted twice.
+			retry->data = buffer->data;
+			retry->bytes_read = &bytes_read;
+			retry->length = buffer->length;
+			retry->block_id = buffer->block_id;
+			retry->nbytes = 0;
+
+			if (!j_distributed_object_choose_replica(object, buffer->index, buffer->offset, latencies, loads, failed, &(retry->index), &(retry->offset)))
+			{
+				retry->data = NULL;
+				continue;
+			}
+
+			if (lists[retry->index] == NULL)
+			{
+				lists[retry->index] = j_list_new(NULL);
+			}
+
+			j_list_append(lists[retry->index], retry);
+		}
+
+		j_distributed_object_read_servers(object, semantics, lists, failed);
+
+		for (guint i = 0; i < buffers->len; i++)
+		{
+			JDistributedObjectReadBuffer* buffer = g_ptr_array_index(buffers, i);
+			JDistributedObjectReadBuffer* retry = &(retries[i]);
+
+			if (retry->data == NULL)
+			{
+				// All replicas have failed.
+				ret = FALSE;
+			}
+			else if (failed[retry->index])
+			{
+				g_ptr_array_index(buffers, remaining) = buffer;
+				remaining++;
+				continue;
+			}
+			else if (retry->nbytes > buffer->nbytes)
+			{
+				j_helper_atomic_add(buffer->bytes_read, retry->nbytes - buffer->nbytes);
+			}
+
+			g_slice_free(JDistributedObjectReadBuffer, buffer);
+		}
+
+		g_ptr_array_set_size(buffers, remaining);
+
+		for (guint i = 0; i < server_count; i++)
+		{
+			if (lists[i] != NULL)
+			{
+				j_list_unref(lists[i]);
+			}
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * Earns hedged reads for reads sent to servers.
+ *
+ * \private
+ *
+ * \param reads The number of reads.
+ **/
+static void
+j_distributed_object_hedge_earn(guint reads)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gdouble budget;
+
+	budget = j_configuration_get_hedge_budget(j_configuration()) / 100.0;
+
+	G_LOCK(j_distributed_object_hedge_tokens);
+	j_distributed_object_hedge_tokens = MIN(j_distributed_object_hedge_tokens + (reads * budget), J_DISTRIBUTED_OBJECT_HEDGE_BURST);
+	G_UNLOCK(j_distributed_object_hedge_tokens);
+}
+
+/**
+ * Spends a hedged read if the budget allows it.
+ *
+ * \private
+ *
+ * \return TRUE if a read may be hedged, FALSE otherwise.
+ **/
+static gboolean
+j_distributed_object_hedge_spend(void)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = FALSE;
+
+	G_LOCK(j_distributed_object_hedge_tokens);
+
+	if (j_distributed_object_hedge_tokens >= 1.0)
+	{
+		j_distributed_object_hedge_tokens -= 1.0;
+		ret = TRUE;
+	}
+
+	G_UNLOCK(j_distributed_object_hedge_tokens);
+
+	return ret;
+}
+
+/**
+ * Frees a hedge.
+ * Connections that have not been discarded are returned to the pool.
+ *
+ * \private
+ *
+ * \param hedge A hedge.
+ **/
+static void
+j_distributed_object_hedge_free(JDistributedObjectHedge* hedge)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	for (guint i = 0; i < hedge->server_count; i++)
+	{
+		JDistributedObjectBackgroundData* data = &(hedge->background_data[i]);
+
+		if (data->read.iterator != NULL)
+		{
+			j_list_iterator_free(data->read.iterator);
+		}
+
+		if (data->read.buffers != NULL)
+		{
+			j_list_unref(data->read.buffers);
+		}
+
+		if (data->message != NULL)
+		{
+			j_message_unref(data->message);
+		}
+
+		if (data->connection != NULL)
+		{
+			j_connection_pool_push(J_BACKEND_TYPE_OBJECT, i, data->connection);
+		}
+	}
+
+	if (hedge->stripe_ids != NULL)
+	{
+		g_array_unref(hedge->stripe_ids);
+	}
+
+	g_free(hedge->available);
+	g_free(hedge->stripes);
+	g_free(hedge->retries);
+	g_free(hedge->background_data);
+
+	g_slice_free(JDistributedObjectHedge, hedge);
+}
+
+/**
+ * Returns the position of a stripe in a hedge.
+ *
+ * \private
+ *
+ * \param hedge  A hedge.
+ * \param stripe A stripe.
+ *
+ * \return The stripe's position, the number of stripes if the stripe is not part of the hedge.
+ **/
+static guint
+j_distributed_object_hedge_find_stripe(JDistributedObjectHedge* hedge, guint64 stripe)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	guint i;
+
+	// Reads usually touch only a few stripes.
+	for (i = 0; i < hedge->stripe_ids->len; i++)
+	{
+		if (g_array_index(hedge->stripe_ids, guint64, i) == stripe)
+		{
+			break;
+		}
+	}
+
+	return i;
+}
+
+/**
+ * Plans the retries of a hedge for an erasure-coded object.
+ * Each affected stripe is read from data and parity blocks stored on other servers, so that it can be decoded.
+ *
+ * \private
+ *
+ * \param object An object.
+ * \param hedge  A hedge.
+ * \param busy   Whether servers are already used by the read, indexed by server.
+ *
+ * \return The number of retries, 0 if not enough servers are available.
+ **/
+static guint
+j_distributed_object_hedge_plan_stripes(JDistributedObject* object, JDistributedObjectHedge* hedge, gboolean const* busy)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_autoptr(JListIterator) buffer_it = NULL;
+	guint64 block_size;
+	guint data_blocks;
+	guint parity_blocks;
+	guint available_count = 0;
+	guint retry_count = 0;
+
+	j_distribution_get_erasure_code(object->distribution, &data_blocks, &parity_blocks, &block_size);
+
+	hedge->available = g_new0(gboolean, data_blocks + parity_blocks);
+
+	// The same blocks are used for all stripes, data blocks are preferred because they do not have to be decoded.
+	for (guint i = 0; i < data_blocks + parity_blocks && available_count < data_blocks; i++)
+	{
+		guint32 index;
+
+		index = j_distribution_get_erasure_server(object->distribution, i);
+
+		if (!busy[index])
+		{
+			hedge->available[i] = TRUE;
+			available_count++;
+		}
+	}
+
+	if (available_count < data_blocks)
+	{
+		return 0;
+	}
+
+	hedge->stripe_ids = g_array_new(FALSE, FALSE, sizeof(guint64));
+	buffer_it = j_list_iterator_new(hedge->buffers);
+
+	while (j_list_iterator_next(buffer_it))
+	{
+		JDistributedObjectReadBuffer* buffer = j_list_iterator_get(buffer_it);
+		guint64 stripe;
+
+		stripe = buffer->block_id / data_blocks;
+
+		if (j_distributed_object_hedge_find_stripe(hedge, stripe) == hedge->stripe_ids->len)
+		{
+			g_array_append_val(hedge->stripe_ids, stripe);
+		}
+	}
+
+	// Blocks beyond the end of the object are read partially or not at all, they are treated as zeros.
+	hedge->stripes = g_malloc0(hedge->stripe_ids->len * (data_blocks + parity_blocks) * block_size);
+	hedge->retries = g_new(JDistributedObjectReadBuffer, hedge->stripe_ids->len * data_blocks);
+
+	for (guint i = 0; i < hedge->stripe_ids->len; i++)
+	{
+		for (guint j = 0; j < data_blocks + parity_blocks; j++)
+		{
+			JDistributedObjectReadBuffer* retry;
+
+			if (!hedge->available[j])
+			{
+				continue;
+			}
+
+			retry = &(hedge->retries[retry_count]);
+			retry->data = hedge->stripes + (((i * (data_blocks + parity_blocks)) + j) * block_size);
+			retry->bytes_read = &(hedge->bytes_read);
+			retry->length = block_size;
+			retry->index = j_distribution_get_erasure_server(object->distribution, j);
+			retry->offset = g_array_index(hedge->stripe_ids, guint64, i) * block_size;
+			retry->block_id = 0;
+			retry->nbytes = 0;
+
+			retry_count++;
+		}
+	}
+
+	return retry_count;
+}
+
+/**
+ * Plans the retries of a hedge for a replicated object.
+ * Each buffer is read from another replica.
+ *
+ * \private
+ *
+ * \param object    An object.
+ * \param hedge     A hedge.
+ * \param busy      Whether servers are already used by the read, indexed by server.
+ * \param latencies The servers' latencies as returned by j_connection_pool_get_load().
+ * \param loads     The servers' numbers of outstanding operations.
+ *
+ * \return The number of retries, 0 if a buffer has no replica on an available server.
+ **/
+static guint
+j_distributed_object_hedge_plan_replicas(JDistributedObject* object, JDistributedObjectHedge* hedge, gboolean const* busy, gint64 const* latencies, guint* loads)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_autoptr(JListIterator) buffer_it = NULL;
+	guint retry_count = 0;
+
+	hedge->retries = g_new(JDistributedObjectReadBuffer, j_list_length(hedge->buffers));
+	buffer_it = j_list_iterator_new(hedge->buffers);
+
+	while (j_list_iterator_next(buffer_it))
+	{
+		JDistributedObjectReadBuffer* buffer = j_list_iterator_get(buffer_it);
+		JDistributedObjectReadBuffer* retry = &(hedge->retries[retry_count]);
+
+		retry->data = buffer->data;
+		retry->bytes_read = &(hedge->bytes_read);
+		retry->length = buffer->length;
+		retry->block_id = buffer->block_id;
+		retry->nbytes = 0;
+
+		if (!j_distributed_object_choose_replica(object, buffer->index, buffer->offset, latencies, loads, busy, &(retry->index), &(retry->offset)))
+		{
+			return 0;
+		}
+
+		retry_count++;
+	}
+
+	return retry_count;
+}
+
+/**
+ * Hedges the read from a slow server.
+ * The slow server's buffers are requested from other servers that are not used by the read yet.
+ * The requests are added to the read's fan-out.
+ *
+ * \private
+ *
+ * \param object    An object.
+ * \param semantics Semantics.
+ * \param index     The slow server.
+ * \param buffers   The slow server's buffers.
+ * \param fanout    The read's fan-out.
+ * \param busy      Whether servers are already used by the read, indexed by server. Updated with the servers used by the hedge.
+ * \param latencies The servers' latencies as returned by j_connection_pool_get_load(), NULL for erasure-coded objects.
+ * \param loads     The servers' numbers of outstanding operations, NULL for erasure-coded objects.
+ *
+ * \return A new hedge, NULL if the read cannot be hedged. Should be freed with j_distributed_object_hedge_free().
+ **/
+static JDistributedObjectHedge*
+j_distributed_object_hedge_new(JDistributedObject* object, JSemantics* semantics, guint32 index, JList* buffers, JMessageFanout* fanout, gboolean* busy, gint64 const* latencies, guint* loads)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributedObjectHedge* hedge;
+	gsize namespace_len;
+	gsize name_len;
+	guint retry_count;
+
+	hedge = g_slice_new(JDistributedObjectHedge);
+	hedge->index = index;
+	hedge->buffers = buffers;
+	hedge->server_count = j_configuration_get_server_count(j_configuration(), J_BACKEND_TYPE_OBJECT);
+	hedge->background_data = g_new0(JDistributedObjectBackgroundData, hedge->server_count);
+	hedge->retries = NULL;
+	hedge->bytes_read = 0;
+	hedge->stripes = NULL;
+	hedge->stripe_ids = NULL;
+	hedge->available = NULL;
+
+	if (latencies != NULL)
+	{
+		retry_count = j_distributed_object_hedge_plan_replicas(object, hedge, busy, latencies, loads);
+	}
+	else
+	{
+		retry_count = j_distributed_object_hedge_plan_stripes(object, hedge, busy);
+	}
+
+	if (retry_count == 0)
+	{
+		goto error;
+	}
+
+	for (guint i = 0; i < retry_count; i++)
+	{
+		JDistributedObjectReadBuffer* retry = &(hedge->retries[i]);
+		JDistributedObjectBackgroundData* data = &(hedge->background_data[retry->index]);
+
+		if (data->read.buffers == NULL)
+		{
+			data->read.buffers = j_list_new(NULL);
+		}
+
+		j_list_append(data->read.buffers, retry);
+	}
+
+	namespace_len = strlen(object->namespace) + 1;
+	name_len = strlen(object->name) + 1;
+
+	for (guint i = 0; i < hedge->server_count; i++)
+	{
+		JDistributedObjectBackgroundData* data = &(hedge->background_data[i]);
+		g_autoptr(JListIterator) buffer_it = NULL;
+
+		if (data->read.buffers == NULL)
+		{
+			continue;
+		}
+
+		data->connection = j_connection_pool_pop(J_BACKEND_TYPE_OBJECT, i);
+
+		// Data transferred using the fabric cannot be cancelled, so only socket connections are used.
+		if (data->connection == NULL || j_fabric_connection_get(data->connection) != NULL)
+		{
+			goto error;
+		}
+
+		data->index = i;
+		data->message = j_message_new(J_MESSAGE_OBJECT_READ, namespace_len + name_len);
+		data->operations = NULL;
+		data->semantics = semantics;
+		data->memories = NULL;
+		data->read.iterator = j_list_iterator_new(data->read.buffers);
+		data->read.buffer = NULL;
+		data->read.buffer_offset = 0;
+		data->read.operations_done = 0;
+
+		j_message_set_semantics(data->message, semantics);
+		j_message_append_n(data->message, object->namespace, namespace_len);
+		j_message_append_n(data->message, object->name, name_len);
+
+		buffer_it = j_list_iterator_new(data->read.buffers);
+
+		while (j_list_iterator_next(buffer_it))
+		{
+			JDistributedObjectReadBuffer* retry = j_list_iterator_get(buffer_it);
+
+			j_message_add_operation(data->message, sizeof(guint64) + sizeof(guint64));
+			j_message_append_8(data->message, &(retry->length));
+			j_message_append_8(data->message, &(retry->offset));
+		}
+	}
+
+	for (guint i = 0; i < hedge->server_count; i++)
+	{
+		JDistributedObjectBackgroundData* data = &(hedge->background_data[i]);
+
+		if (data->message == NULL)
+		{
+			continue;
+		}
+
+		j_message_fanout_add(fanout, data->message, data->connection, j_distributed_object_read_reply, data);
+		busy[i] = TRUE;
+	}
+
+	return hedge;
+
+error:
+	j_distributed_object_hedge_free(hedge);
+
+	return NULL;
+}
+
+/**
+ * Checks whether all of a hedge's requests have been answered completely.
+ *
+ * \private
+ *
+ * \param hedge A hedge.
+ *
+ * \return TRUE if the hedge is complete, FALSE otherwise.
+ **/
+static gboolean
+j_distributed_object_hedge_is_complete(JDistributedObjectHedge* hedge)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	for (guint i = 0; i < hedge->server_count; i++)
+	{
+		JDistributedObjectBackgroundData* data = &(hedge->background_data[i]);
+
+		if (data->message != NULL && data->read.operations_done < j_message_get_count(data->message))
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+ * Checks whether one of a hedge's requests has finished without being answered completely.
+ *
+ * \private
+ *
+ * \param hedge  A hedge.
+ * \param fanout The read's fan-out.
+ *
+ * \return TRUE if the hedge has failed, FALSE otherwise.
+ **/
+static gboolean
+j_distributed_object_hedge_has_failed(JDistributedObjectHedge* hedge, JMessageFanout* fanout)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	for (guint i = 0; i < hedge->server_count; i++)
+	{
+		JDistributedObjectBackgroundData* data = &(hedge->background_data[i]);
+
+		if (data->message == NULL || data->connection == NULL)
+		{
+			continue;
+		}
+
+		if (!j_message_fanout_is_pending(fanout, data->connection) && data->read.operations_done < j_message_get_count(data->message))
+		{
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/**
+ * Cancels a hedge's outstanding requests.
+ * Requests on connections shared with other threads cannot be cancelled and are still waited for.
+ *
+ * \private
+ *
+ * \param hedge  A hedge.
+ * \param fanout The read's fan-out.
+ **/
+static void
+j_distributed_object_hedge_cancel(JDistributedObjectHedge* hedge, JMessageFanout* fanout)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	for (guint i = 0; i < hedge->server_count; i++)
+	{
+		JDistributedObjectBackgroundData* data = &(hedge->background_data[i]);
+
+		if (data->message == NULL || data->connection == NULL || !j_message_fanout_is_pending(fanout, data->connection))
+		{
+			continue;
+		}
+
+		if (j_connection_pool_discard(J_BACKEND_TYPE_OBJECT, i, data->connection))
+		{
+			j_message_fanout_cancel(fanout, data->connection);
+			data->connection = NULL;
+		}
+	}
+}
+
+/**
+ * Completes the slow server's buffers using a hedge's data.
+ *
+ * \private
+ *
+ * \param object An object.
+ * \param rs     The object's Reed-Solomon code, NULL for replicated objects.
+ * \param hedge  A complete hedge.
+ *
+ * \return TRUE on success, FALSE if the stripes could not be decoded.
+ **/
+static gboolean
+j_distributed_object_hedge_finish(JDistributedObject* object, JReedSolomon* rs, JDistributedObjectHedge* hedge)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_autoptr(JListIterator) buffer_it = NULL;
+	guint64 block_size;
+	guint data_blocks;
+	guint parity_blocks;
+	guint i = 0;
+
+	buffer_it = j_list_iterator_new(hedge->buffers);
+
+	if (rs == NULL)
+	{
+		// The retries have been read into the buffers directly.
+		while (j_list_iterator_next(buffer_it))
+		{
+			JDistributedObjectReadBuffer* buffer = j_list_iterator_get(buffer_it);
+			JDistributedObjectReadBuffer* retry = &(hedge->retries[i]);
+
+			if (retry->nbytes > buffer->nbytes)
+			{
+				j_helper_atomic_add(buffer->bytes_read, retry->nbytes - buffer->nbytes);
+			}
+
+			i++;
+		}
+
+		return TRUE;
+	}
+
+	j_distribution_get_erasure_code(object->distribution, &data_blocks, &parity_blocks, &block_size);
+
+	for (i = 0; i < hedge->stripe_ids->len; i++)
+	{
+		g_autofree gpointer* blocks = NULL;
+
+		blocks = g_new(gpointer, data_blocks + parity_blocks);
+
+		for (guint j = 0; j < data_blocks + parity_blocks; j++)
+		{
+			blocks[j] = hedge->stripes + (((i * (data_blocks + parity_blocks)) + j) * block_size);
+		}
+
+		if (!j_reed_solomon_reconstruct(rs, blocks, hedge->available, block_size))
+		{
+			return FALSE;
+		}
+	}
+
+	while (j_list_iterator_next(buffer_it))
+	{
+		JDistributedObjectReadBuffer* buffer = j_list_iterator_get(buffer_it);
+		gchar const* block;
+		guint stripe;
+
+		stripe = j_distributed_object_hedge_find_stripe(hedge, buffer->block_id / data_blocks);
+		block = hedge->stripes + (((stripe * (data_blocks + parity_blocks)) + (buffer->block_id % data_blocks)) * block_size);
+		memcpy(buffer->data, block + (buffer->offset % block_size), buffer->length);
+
+		// Like reconstructed buffers, decoded buffers are always complete.
+		j_helper_atomic_add(buffer->bytes_read, buffer->length - buffer->nbytes);
+	}
+
+	return TRUE;
+}
+
+/**
+ * Executes a read's fan-out and hedges the requests of slow servers.
+ * A request is hedged if its server has not answered within the configured percentile of its recent latencies and the budget allows it.
+ * Whichever of the request and its hedge is answered completely first wins, the other one is cancelled.
+ *
+ * \private
+ *
+ * \param object          An object.
+ * \param semantics       Semantics.
+ * \param rs              The object's Reed-Solomon code, NULL for replicated objects.
+ * \param fanout          The read's fan-out.
+ * \param background_data The read's requests, indexed by server. Connections are set to NULL if they have been discarded.
+ * \param latencies       The servers' latencies as returned by j_connection_pool_get_load(), NULL for erasure-coded objects.
+ * \param loads           The servers' numbers of outstanding operations, NULL for erasure-coded objects.
+ * \param hedged          Returns whether a server's buffers have been read by its hedge, indexed by server.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+static gboolean
+j_distributed_object_read_hedged(JDistributedObject* object, JSemantics* semantics, JReedSolomon* rs, JMessageFanout* fanout, JDistributedObjectBackgroundData* background_data, gint64 const* latencies, guint* loads, gboolean* hedged)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = TRUE;
+
+	g_autofree JDistributedObjectHedge** hedges = NULL;
+	g_autofree gint64* deadlines = NULL;
+	g_autofree gboolean* busy = NULL;
+	g_autofree gboolean* resolved = NULL;
+	gint64 start;
+	guint32 percentile;
+	guint32 server_count;
+	guint reads = 0;
+
+	percentile = j_configuration_get_hedge_percentile(j_configuration());
+	server_count = j_configuration_get_server_count(j_configuration(), J_BACKEND_TYPE_OBJECT);
+
+	hedges = g_new0(JDistributedObjectHedge*, server_count);
+	deadlines = g_new(gint64, server_count);
+	busy = g_new(gboolean, server_count);
+	resolved = g_new0(gboolean, server_count);
+
+	start = g_get_monotonic_time();
+
+	for (guint i = 0; i < server_count; i++)
+	{
+		JDistributedObjectBackgroundData* data = &(background_data[i]);
+		gint64 delay = 0;
+
+		busy[i] = (data->message != NULL);
+		deadlines[i] = -1;
+
+		// Data transferred using the fabric is written into the buffers directly and cannot be cancelled.
+		if (data->message == NULL || data->connection == NULL || data->memories != NULL)
+		{
+			continue;
+		}
+
+		reads++;
+		delay = j_connection_pool_get_latency_percentile(J_BACKEND_TYPE_OBJECT, i, percentile);
+
+		// Servers without enough latencies are not hedged, so that the delay is not just a guess.
+		if (delay > 0)
+		{
+			deadlines[i] = start + delay;
+		}
+	}
+
+	j_distributed_object_hedge_earn(reads);
+
+	while (TRUE)
+	{
+		gint64 deadline = -1;
+		gint64 now;
+
+		for (guint i = 0; i < server_count; i++)
+		{
+			if (deadlines[i] >= 0 && (deadline < 0 || deadlines[i] < deadline))
+			{
+				deadline = deadlines[i];
+			}
+		}
+
+		ret = j_message_fanout_execute_until(fanout, deadline) && ret;
+		now = g_get_monotonic_time();
+
+		for (guint i = 0; i < server_count; i++)
+		{
+			JDistributedObjectBackgroundData* data = &(background_data[i]);
+
+			if (deadlines[i] >= 0 && now >= deadlines[i])
+			{
+				deadlines[i] = -1;
+
+				if (j_message_fanout_is_pending(fanout, data->connection) && j_distributed_object_hedge_spend())
+				{
+					hedges[i] = j_distributed_object_hedge_new(object, semantics, i, data->read.buffers, fanout, busy, latencies, loads);
+
+					if (hedges[i] != NULL)
+					{
+						j_statistics_add(j_statistics(), J_STATISTICS_HEDGED_READS, 1);
+					}
+				}
+			}
+
+			if (hedges[i] == NULL || resolved[i])
+			{
+				continue;
+			}
+
+			if (j_message_fanout_is_pending(fanout, data->connection))
+			{
+				if (j_distributed_object_hedge_is_complete(hedges[i]))
+				{
+					// The slow request is still waited for if its connection is shared, but its data is not needed anymore.
+					if (j_connection_pool_discard(J_BACKEND_TYPE_OBJECT, i, data->connection))
+					{
+						j_message_fanout_cancel(fanout, data->connection);
+						data->connection = NULL;
+					}
+
+					j_statistics_add(j_statistics(), J_STATISTICS_HEDGED_READS_WON, 1);
+					hedged[i] = TRUE;
+					resolved[i] = TRUE;
+				}
+				else if (j_distributed_object_hedge_has_failed(hedges[i], fanout))
+				{
+					j_distributed_object_hedge_cancel(hedges[i], fanout);
+					resolved[i] = TRUE;
+				}
+			}
+			else if (data->read.operations_done == j_message_get_count(data->message))
+			{
+				j_distributed_object_hedge_cancel(hedges[i], fanout);
+				resolved[i] = TRUE;
+			}
+			else if (j_distributed_object_hedge_is_complete(hedges[i]))
+			{
+				// The slow server has failed, but its hedge has already read the data.
+				hedged[i] = TRUE;
+				resolved[i] = TRUE;
+			}
+			else if (j_distributed_object_hedge_has_failed(hedges[i], fanout))
+			{
+				j_distributed_object_hedge_cancel(hedges[i], fanout);
+				resolved[i] = TRUE;
+			}
+		}
+
+		if (!j_message_fanout_is_pending(fanout, NULL))
+		{
+			break;
+		}
+	}
+
+	for (guint i = 0; i < server_count; i++)
+	{
+		if (hedges[i] == NULL)
+		{
+			continue;
+		}
+
+		if (hedged[i])
+		{
+			hedged[i] = j_distributed_object_hedge_finish(object, rs, hedges[i]);
+		}
+
+		j_distributed_object_hedge_free(hedges[i]);
+	}
+
+	return ret;
+}
+
+/**
+ * Appends a write operation to a server's message.
+ * The message is created and a connection is taken from the pool if necessary.
+ *
+ * \private
+ *
+ * \param object        An object.
+ * \param semantics     Semantics.
+ * \param index         A server index.
+ * \param messages      The servers' messages.
+ * \param bw_lists      The servers' lists of bytes_written counters.
+ * \param connections   The servers' connections.
+ * \param memories      The servers' registered memory regions.
+ * \param data          The data to write.
+ * \param length        The data's length.
+ * \param offset        The data's offset on the server.
+ * \param bytes_written A counter for the number of bytes written.
+ *
+ * \return TRUE on success, FALSE if the server could not be reached or the memory could not be registered.
+ **/
+static gboolean
+j_distributed_object_append_write(JDistributedObject* object, JSemantics* semantics, guint32 index, JMessage** messages, JList** bw_lists, gpointer* connections, GPtrArray** memories, gconstpointer data, guint64 length, guint64 offset, guint64* bytes_written)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = TRUE;
+
+	if (messages[index] == NULL && bw_lists[index] == NULL)
+	{
+		gsize namespace_len;
+		gsize name_len;
 
-	reply = j_message_new_reply(background_data->message);
-	j_message_receive(reply, object_connection);
+		namespace_len = strlen(object->namespace) + 1;
+		name_len = strlen(object->name) + 1;
 
-	it = j_list_iterator_new(background_data->operations);
+		messages[index] = j_message_new(J_MESSAGE_OBJECT_WRITE, namespace_len + name_len);
+		j_message_set_semantics(messages[index], semantics);
+		j_message_append_n(messages[index], object->namespace, namespace_len);
+		j_message_append_n(messages[index], object->name, name_len);
 
-	while (j_list_iterator_next(it))
-	{
-		JDistributedObjectOperation* operation = j_list_iterator_get(it);
-		gint64* modification_time = operation->status.modification_time;
-		guint64* size = operation->status.size;
-		gint64 modification_time_;
-		guint64 size_;
+		bw_lists[index] = j_list_new(NULL);
 
-		modification_time_ = j_message_get_8(reply);
-		size_ = j_message_get_8(reply);
+		// The connection determines whether the data is transferred using the fabric.
+		connections[index] = j_connection_pool_pop(J_BACKEND_TYPE_OBJECT, index);
 
-		if (modification_time != NULL)
+		if (connections[index] != NULL)
 		{
-			// FIXME max?
-			*modification_time = modification_time_;
+			memories[index] = j_distributed_object_new_memories(connections[index]);
 		}
+	}
 
-		if (size != NULL)
-		{
-			j_helper_atomic_add(size, size_);
-		}
+	if (connections[index] == NULL)
+	{
+		return FALSE;
 	}
 
-	j_message_unref(background_data->message);
+	if (memories[index] != NULL)
+	{
+		ret = j_distributed_object_append_memory(messages[index], connections[index], memories[index], data, length, offset, TRUE);
+	}
+	else
+	{
+		j_message_add_operation(messages[index], sizeof(guint64) + sizeof(guint64));
+		j_message_append_8(messages[index], &length);
+		j_message_append_8(messages[index], &offset);
+		j_message_add_send(messages[index], data, length);
+	}
 
-	j_connection_pool_push(J_BACKEND_TYPE_OBJECT, background_data->index, object_connection);
+	j_list_append(bw_lists[index], bytes_written);
 
-	g_slice_free(JDistributedObjectBackgroundData, background_data);
+	// Fake bytes_written here instead of doing another loop further down
+	if (j_semantics_get(semantics, J_SEMANTICS_SAFETY) == J_SEMANTICS_SAFETY_NONE && memories[index] == NULL)
+	{
+		j_helper_atomic_add(bytes_written, length);
+	}
 
-	return NULL;
+	return ret;
 }
 
 static gboolean
@@ -576,6 +2248,8 @@ j_distributed_object_create_exec(JList* operations, JSemantics* semantics)
 			data->message = messages[i];
 			data->operations = NULL;
 			data->semantics = semantics;
+			data->connection = NULL;
+			data->memories = NULL;
 
 			background_data[i] = data;
 		}
@@ -673,6 +2347,8 @@ j_distributed_object_delete_exec(JList* operations, JSemantics* semantics)
 			data->message = messages[i];
 			data->operations = NULL;
 			data->semantics = semantics;
+			data->connection = NULL;
+			data->memories = NULL;
 
 			background_data[i] = data;
 		}
@@ -695,11 +2371,18 @@ j_distributed_object_read_exec(JList* operations, JSemantics* semantics)
 	g_autofree JList** br_lists = NULL;
 	g_autoptr(JListIterator) it = NULL;
 	g_autofree JMessage** messages = NULL;
+	g_autofree gpointer* connections = NULL;
+	g_autofree GPtrArray** memories = NULL;
+	g_autoptr(JReedSolomon) rs = NULL;
+	g_autofree gint64* latencies = NULL;
+	g_autofree guint* loads = NULL;
+	GArray* ranges;
 	JDistributedObject* object = NULL;
 	gpointer object_handle;
 	gsize name_len = 0;
 	gsize namespace_len = 0;
 	guint32 server_count = 0;
+	guint replica_count = 1;
 
 	// FIXME
 	//JLock* lock = NULL;
@@ -715,7 +2398,25 @@ j_distributed_object_read_exec(JList* operations, JSemantics* semantics)
 		g_assert(object != NULL);
 	}
 
+	ranges = g_array_sized_new(FALSE, FALSE, sizeof(JObjectRange), j_list_length(operations));
 	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		JDistributedObjectOperation* operation = j_list_iterator_get(it);
+		JObjectRange range;
+
+		range.data = operation->read.data;
+		range.length = operation->read.length;
+		range.offset = operation->read.offset;
+		range.bytes = operation->read.bytes_read;
+		range.parts = NULL;
+		range.nbytes = 0;
+
+		g_array_append_val(ranges, range);
+	}
+
+	ranges = j_object_range_coalesce(ranges, FALSE, semantics);
 	object_backend = j_object_get_backend();
 
 	if (object_backend != NULL)
@@ -727,6 +2428,8 @@ j_distributed_object_read_exec(JList* operations, JSemantics* semantics)
 		server_count = j_configuration_get_server_count(j_configuration(), J_BACKEND_TYPE_OBJECT);
 		messages = g_new(JMessage*, server_count);
 		br_lists = g_new(JList*, server_count);
+		connections = g_new(gpointer, server_count);
+		memories = g_new(GPtrArray*, server_count);
 
 		namespace_len = strlen(object->namespace) + 1;
 		name_len = strlen(object->name) + 1;
@@ -735,6 +2438,34 @@ j_distributed_object_read_exec(JList* operations, JSemantics* semantics)
 		{
 			messages[i] = NULL;
 			br_lists[i] = NULL;
+			connections[i] = NULL;
+			memories[i] = NULL;
+		}
+
+		{
+			guint64 block_size;
+			guint data_blocks;
+			guint parity_blocks;
+
+			// Data of erasure-coded objects can be reconstructed if servers fail.
+			if (j_distribution_get_erasure_code(object->distribution, &data_blocks, &parity_blocks, &block_size) && parity_blocks > 0)
+			{
+				rs = j_reed_solomon_new(data_blocks, parity_blocks);
+			}
+		}
+
+		replica_count = j_distribution_get_replica_count(object->distribution);
+
+		// Replicated objects are read from the least loaded replicas.
+		if (replica_count > 1)
+		{
+			latencies = g_new(gint64, server_count);
+			loads = g_new(guint, server_count);
+
+			for (guint i = 0; i < server_count; i++)
+			{
+				j_connection_pool_get_load(J_BACKEND_TYPE_OBJECT, i, &(latencies[i]), &(loads[i]));
+			}
 		}
 	}
 
@@ -745,13 +2476,13 @@ j_distributed_object_read_exec(JList* operations, JSemantics* semantics)
 	}
 	*/
 
-	while (j_list_iterator_next(it))
+	for (guint i = 0; i < ranges->len; i++)
 	{
-		JDistributedObjectOperation* operation = j_list_iterator_get(it);
-		gpointer data = operation->read.data;
-		guint64 length = operation->read.length;
-		guint64 offset = operation->read.offset;
-		guint64* bytes_read = operation->read.bytes_read;
+		JObjectRange* range = &g_array_index(ranges, JObjectRange, i);
+		gpointer data = range->data;
+		guint64 length = range->length;
+		guint64 offset = range->offset;
+		guint64* bytes_read = range->bytes;
 
 		j_trace_file_begin(object->name, J_TRACE_FILE_READ);
 
@@ -776,26 +2507,53 @@ j_distributed_object_read_exec(JList* operations, JSemantics* semantics)
 			while (j_distribution_distribute(object->distribution, &index, &new_length, &new_offset, &block_id))
 			{
 				JDistributedObjectReadBuffer* buffer;
+				guint32 server_index = index;
+				guint64 server_offset = new_offset;
+
+				if (replica_count > 1)
+				{
+					j_distributed_object_choose_replica(object, index, new_offset, latencies, loads, NULL, &server_index, &server_offset);
+				}
 
-				if (messages[index] == NULL && br_lists[index] == NULL)
+				if (messages[server_index] == NULL && br_lists[server_index] == NULL)
 				{
-					messages[index] = j_message_new(J_MESSAGE_OBJECT_READ, namespace_len + name_len);
-					j_message_set_semantics(messages[index], semantics);
-					j_message_append_n(messages[index], object->namespace, namespace_len);
-					j_message_append_n(messages[index], object->name, name_len);
+					messages[server_index] = j_message_new(J_MESSAGE_OBJECT_READ, namespace_len + name_len);
+					j_message_set_semantics(messages[server_index], semantics);
+					j_message_append_n(messages[server_index], object->namespace, namespace_len);
+					j_message_append_n(messages[server_index], object->name, name_len);
+
+					br_lists[server_index] = j_list_new(NULL);
+
+					// The connection determines whether the data is transferred using the fabric.
+					connections[server_index] = j_connection_pool_pop(J_BACKEND_TYPE_OBJECT, server_index);
 
-					br_lists[index] = j_list_new(NULL);
+					if (connections[server_index] != NULL)
+					{
+						memories[server_index] = j_distributed_object_new_memories(connections[server_index]);
+					}
 				}
 
-				j_message_add_operation(messages[index], sizeof(guint64) + sizeof(guint64));
-				j_message_append_8(messages[index], &new_length);
-				j_message_append_8(messages[index], &new_offset);
+				if (memories[server_index] != NULL)
+				{
+					ret = j_distributed_object_append_memory(messages[server_index], connections[server_index], memories[server_index], new_data, new_length, server_offset, TRUE) && ret;
+				}
+				else
+				{
+					j_message_add_operation(messages[server_index], sizeof(guint64) + sizeof(guint64));
+					j_message_append_8(messages[server_index], &new_length);
+					j_message_append_8(messages[server_index], &server_offset);
+				}
 
 				buffer = g_slice_new(JDistributedObjectReadBuffer);
 				buffer->data = new_data;
 				buffer->bytes_read = bytes_read;
+				buffer->length = new_length;
+				buffer->index = index;
+				buffer->offset = new_offset;
+				buffer->block_id = block_id;
+				buffer->nbytes = 0;
 
-				j_list_append(br_lists[index], buffer);
+				j_list_append(br_lists[server_index], buffer);
 
 				/*
 				if (lock != NULL)
@@ -817,31 +2575,126 @@ j_distributed_object_read_exec(JList* operations, JSemantics* semantics)
 	}
 	else
 	{
-		g_autofree gpointer* background_data = NULL;
-
-		background_data = g_new(gpointer, server_count);
+		g_autoptr(JMessageFanout) fanout = NULL;
+		g_autoptr(GPtrArray) missing_buffers = NULL;
+		g_autofree JDistributedObjectBackgroundData* background_data = NULL;
+		g_autofree gboolean* failed = NULL;
+		g_autofree gboolean* hedged = NULL;
+		gboolean recoverable;
+		gboolean fanout_ret;
+
+		fanout = j_message_fanout_new();
+		missing_buffers = g_ptr_array_new();
+		// Data stored on failed servers can be reconstructed or read from other replicas.
+		recoverable = (rs != NULL || replica_count > 1);
+		background_data = g_new0(JDistributedObjectBackgroundData, server_count);
+		failed = g_new0(gboolean, server_count);
+		hedged = g_new0(gboolean, server_count);
 
 		for (guint i = 0; i < server_count; i++)
 		{
-			JDistributedObjectBackgroundData* data;
+			JDistributedObjectBackgroundData* data = &(background_data[i]);
 
 			if (messages[i] == NULL)
 			{
-				background_data[i] = NULL;
 				continue;
 			}
 
-			data = g_slice_new(JDistributedObjectBackgroundData);
 			data->index = i;
 			data->message = messages[i];
 			data->operations = NULL;
 			data->semantics = semantics;
+			data->connection = connections[i];
+			data->memories = memories[i];
 			data->read.buffers = br_lists[i];
+			data->read.iterator = j_list_iterator_new(br_lists[i]);
+			data->read.buffer = NULL;
+			data->read.buffer_offset = 0;
+			data->read.operations_done = 0;
 
-			background_data[i] = data;
+			if (connections[i] != NULL)
+			{
+				j_message_fanout_add(fanout, messages[i], connections[i], j_distributed_object_read_reply, data);
+			}
+		}
+
+		// The same redundancy allows hedging the reads from slow servers.
+		if (recoverable && j_configuration_get_hedge_percentile(j_configuration()) > 0)
+		{
+			fanout_ret = j_distributed_object_read_hedged(object, semantics, rs, fanout, background_data, latencies, loads, hedged);
+		}
+		else
+		{
+			fanout_ret = j_message_fanout_execute(fanout);
+		}
+
+		// Failed servers are handled below if their data can be recovered.
+		if (!recoverable)
+		{
+			ret = fanout_ret && ret;
+		}
+
+		for (guint i = 0; i < server_count; i++)
+		{
+			JDistributedObjectBackgroundData* data = &(background_data[i]);
+			g_autoptr(JListIterator) buffer_it = NULL;
+
+			if (messages[i] == NULL)
+			{
+				continue;
+			}
+
+			// Connections of slow servers are discarded if their hedge wins.
+			failed[i] = (data->connection == NULL || data->read.operations_done < j_message_get_count(messages[i]));
+
+			if (failed[i] && !recoverable)
+			{
+				ret = FALSE;
+			}
+
+			j_list_iterator_free(data->read.iterator);
+			buffer_it = j_list_iterator_new(data->read.buffers);
+
+			while (j_list_iterator_next(buffer_it))
+			{
+				JDistributedObjectReadBuffer* buffer = j_list_iterator_get(buffer_it);
+
+				if (failed[i] && recoverable && !hedged[i])
+				{
+					g_ptr_array_add(missing_buffers, buffer);
+				}
+				else
+				{
+					g_slice_free(JDistributedObjectReadBuffer, buffer);
+				}
+			}
+
+			j_list_unref(data->read.buffers);
+
+			if (data->memories != NULL)
+			{
+				g_ptr_array_unref(data->memories);
+			}
+
+			j_message_unref(data->message);
+
+			if (data->connection != NULL)
+			{
+				j_connection_pool_push(J_BACKEND_TYPE_OBJECT, i, data->connection);
+			}
 		}
 
-		j_helper_execute_parallel(j_distributed_object_read_background_operation, background_data, server_count);
+		if (missing_buffers->len > 0)
+		{
+			if (rs != NULL)
+			{
+				ret = j_distributed_object_reconstruct_buffers(object, semantics, rs, missing_buffers, failed) && ret;
+			}
+			else
+			{
+				ret = j_distributed_object_read_replicas(object, semantics, missing_buffers, failed, latencies, loads) && ret;
+			}
+		}
 	}
 
 	/*
@@ -854,6 +2707,8 @@ j_distributed_object_read_exec(JList* operations, JSemantics* semantics)
 	}
 	*/
 
+	j_object_range_complete(ranges, FALSE);
+
 	return ret;
 }
 
@@ -869,11 +2724,16 @@ j_distributed_object_write_exec(JList* operations, JSemantics* semantics)
 	g_autofree JList** bw_lists = NULL;
 	g_autoptr(JListIterator) it = NULL;
 	g_autofree JMessage** messages = NULL;
+	g_autofree gpointer* connections = NULL;
+	g_autofree GPtrArray** memories = NULL;
+	g_autoptr(JReedSolomon) rs = NULL;
+	g_autoptr(GHashTable) stripes = NULL;
+	GArray* ranges;
 	JDistributedObject* object = NULL;
 	gpointer object_handle;
-	gsize name_len = 0;
-	gsize namespace_len = 0;
 	guint32 server_count = 0;
+	guint64 redundant_bytes_written = 0;
+	guint replica_count = 1;
 
 	// FIXME
 	//JLock* lock = NULL;
@@ -889,7 +2749,25 @@ j_distributed_object_write_exec(JList* operations, JSemantics* semantics)
 		g_assert(object != NULL);
 	}
 
+	ranges = g_array_sized_new(FALSE, FALSE, sizeof(JObjectRange), j_list_length(operations));
 	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		JDistributedObjectOperation* operation = j_list_iterator_get(it);
+		JObjectRange range;
+
+		range.data = (gpointer)(guintptr)operation->write.data;
+		range.length = operation->write.length;
+		range.offset = operation->write.offset;
+		range.bytes = operation->write.bytes_written;
+		range.parts = NULL;
+		range.nbytes = 0;
+
+		g_array_append_val(ranges, range);
+	}
+
+	ranges = j_object_range_coalesce(ranges, TRUE, semantics);
 	object_backend = j_object_get_backend();
 
 	if (object_backend != NULL)
@@ -901,15 +2779,31 @@ j_distributed_object_write_exec(JList* operations, JSemantics* semantics)
 		server_count = j_configuration_get_server_count(j_configuration(), J_BACKEND_TYPE_OBJECT);
 		messages = g_new(JMessage*, server_count);
 		bw_lists = g_new(JList*, server_count);
-
-		namespace_len = strlen(object->namespace) + 1;
-		name_len = strlen(object->name) + 1;
+		connections = g_new(gpointer, server_count);
+		memories = g_new(GPtrArray*, server_count);
 
 		for (guint i = 0; i < server_count; i++)
 		{
 			messages[i] = NULL;
 			bw_lists[i] = NULL;
+			connections[i] = NULL;
+			memories[i] = NULL;
+		}
+
+		{
+			guint64 block_size;
+			guint data_blocks;
+			guint parity_blocks;
+
+			// Erasure-coded objects need their parity blocks to be updated, too.
+			if (j_distribution_get_erasure_code(object->distribution, &data_blocks, &parity_blocks, &block_size) && parity_blocks > 0)
+			{
+				rs = j_reed_solomon_new(data_blocks, parity_blocks);
+				stripes = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, j_distributed_object_stripe_free);
+			}
 		}
+
+		replica_count = j_distribution_get_replica_count(object->distribution);
 	}
 
 	/*
@@ -919,13 +2813,13 @@ j_distributed_object_write_exec(JList* operations, JSemantics* semantics)
 	}
 	*/
 
-	while (j_list_iterator_next(it))
+	for (guint i = 0; i < ranges->len; i++)
 	{
-		JDistributedObjectOperation* operation = j_list_iterator_get(it);
-		gconstpointer data = operation->write.data;
-		guint64 length = operation->write.length;
-		guint64 offset = operation->write.offset;
-		guint64* bytes_written = operation->write.bytes_written;
+		JObjectRange* range = &g_array_index(ranges, JObjectRange, i);
+		gconstpointer data = range->data;
+		guint64 length = range->length;
+		guint64 offset = range->offset;
+		guint64* bytes_written = range->bytes;
 
 		j_trace_file_begin(object->name, J_TRACE_FILE_WRITE);
 
@@ -949,23 +2843,16 @@ j_distributed_object_write_exec(JList* operations, JSemantics* semantics)
 
 			while (j_distribution_distribute(object->distribution, &index, &new_length, &new_offset, &block_id))
 			{
-				if (messages[index] == NULL && bw_lists[index] == NULL)
+				// All replicas are written in parallel, but only the first one counts towards the bytes written.
+				for (guint j = 0; j < replica_count; j++)
 				{
-					messages[index] = j_message_new(J_MESSAGE_OBJECT_WRITE, namespace_len + name_len);
-					j_message_set_semantics(messages[index], semantics);
-					j_message_append_n(messages[index], object->namespace, namespace_len);
-					j_message_append_n(messages[index], object->name, name_len);
+					guint32 replica_index;
+					guint64 replica_offset;
 
-					bw_lists[index] = j_list_new(NULL);
+					j_distribution_get_replica(object->distribution, j, index, new_offset, &replica_index, &replica_offset);
+					ret = j_distributed_object_append_write(object, semantics, replica_index, messages, bw_lists, connections, memories, new_data, new_length, replica_offset, (j == 0) ? bytes_written : &redundant_bytes_written) && ret;
 				}
 
-				j_message_add_operation(messages[index], sizeof(guint64) + sizeof(guint64));
-				j_message_append_8(messages[index], &new_length);
-				j_message_append_8(messages[index], &new_offset);
-				j_message_add_send(messages[index], new_data, new_length);
-
-				j_list_append(bw_lists[index], bytes_written);
-
 				/*
 				if (lock != NULL)
 				{
@@ -974,49 +2861,128 @@ j_distributed_object_write_exec(JList* operations, JSemantics* semantics)
 				*/
 
 				new_data += new_length;
+			}
 
-				// Fake bytes_written here instead of doing another loop further down
-				if (j_semantics_get(semantics, J_SEMANTICS_SAFETY) == J_SEMANTICS_SAFETY_NONE)
-				{
-					j_helper_atomic_add(bytes_written, new_length);
-				}
+			if (rs != NULL)
+			{
+				ret = j_distributed_object_update_stripes(object, semantics, rs, stripes, data, length, offset) && ret;
 			}
 		}
 
 		j_trace_file_end(object->name, J_TRACE_FILE_WRITE, length, offset);
 	}
 
+	if (rs != NULL)
+	{
+		GHashTableIter iter;
+		gpointer value;
+		g_autofree gconstpointer* data_pointers = NULL;
+		g_autofree gpointer* parity_pointers = NULL;
+		guint64 block_size;
+		guint data_blocks;
+		guint parity_blocks;
+
+		j_distribution_get_erasure_code(object->distribution, &data_blocks, &parity_blocks, &block_size);
+
+		data_pointers = g_new(gconstpointer, data_blocks);
+		parity_pointers = g_new(gpointer, parity_blocks);
+
+		g_hash_table_iter_init(&iter, stripes);
+
+		while (g_hash_table_iter_next(&iter, NULL, &value))
+		{
+			JDistributedObjectStripe* stripe = value;
+
+			stripe->parity = g_malloc(parity_blocks * block_size);
+
+			for (guint i = 0; i < data_blocks; i++)
+			{
+				data_pointers[i] = stripe->data + (i * block_size);
+			}
+
+			for (guint i = 0; i < parity_blocks; i++)
+			{
+				parity_pointers[i] = stripe->parity + (i * block_size);
+			}
+
+			j_reed_solomon_encode(rs, data_pointers, parity_pointers, block_size);
+
+			// Parity blocks do not count towards the bytes written.
+			for (guint i = 0; i < parity_blocks; i++)
+			{
+				guint32 index;
+
+				index = j_distribution_get_erasure_server(object->distribution, data_blocks + i);
+				ret = j_distributed_object_append_write(object, semantics, index, messages, bw_lists, connections, memories, parity_pointers[i], block_size, stripe->id * block_size, &redundant_bytes_written) && ret;
+			}
+		}
+	}
+
 	if (object_backend != NULL)
 	{
 		ret = j_backend_object_close(object_backend, object_handle) && ret;
 	}
 	else
 	{
-		g_autofree gpointer* background_data = NULL;
+		g_autoptr(JMessageFanout) fanout = NULL;
+		g_autofree JDistributedObjectBackgroundData* background_data = NULL;
+		JSemanticsSafety safety;
 
-		background_data = g_new(gpointer, server_count);
+		fanout = j_message_fanout_new();
+		background_data = g_new(JDistributedObjectBackgroundData, server_count);
+		safety = j_semantics_get(semantics, J_SEMANTICS_SAFETY);
 
 		for (guint i = 0; i < server_count; i++)
 		{
-			JDistributedObjectBackgroundData* data;
+			JDistributedObjectBackgroundData* data = &(background_data[i]);
+			JMessageReplyFunc reply_func = NULL;
 
-			if (messages[i] == NULL)
+			// Writes to unreachable servers have already failed.
+			if (messages[i] == NULL || connections[i] == NULL)
 			{
-				background_data[i] = NULL;
 				continue;
 			}
 
-			data = g_slice_new(JDistributedObjectBackgroundData);
 			data->index = i;
 			data->message = messages[i];
 			data->operations = NULL;
 			data->semantics = semantics;
+			data->connection = connections[i];
+			data->memories = memories[i];
 			data->write.bytes_written = bw_lists[i];
 
-			background_data[i] = data;
+			// The memory must not be reused before the server has read it, so fabric writes are always answered.
+			if (safety == J_SEMANTICS_SAFETY_NETWORK || safety == J_SEMANTICS_SAFETY_STORAGE || memories[i] != NULL)
+			{
+				reply_func = j_distributed_object_write_reply;
+			}
+
+			j_message_fanout_add(fanout, messages[i], connections[i], reply_func, data);
 		}
 
-		j_helper_execute_parallel(j_distributed_object_write_background_operation, background_data, server_count);
+		ret = j_message_fanout_execute(fanout) && ret;
+
+		for (guint i = 0; i < server_count; i++)
+		{
+			if (messages[i] == NULL)
+			{
+				continue;
+			}
+
+			j_list_unref(bw_lists[i]);
+
+			if (memories[i] != NULL)
+			{
+				g_ptr_array_unref(memories[i]);
+			}
+
+			j_message_unref(messages[i]);
+
+			if (connections[i] != NULL)
+			{
+				j_connection_pool_push(J_BACKEND_TYPE_OBJECT, i, connections[i]);
+			}
+		}
 	}
 
 	/*
@@ -1029,6 +2995,8 @@ j_distributed_object_write_exec(JList* operations, JSemantics* semantics)
 	}
 	*/
 
+	j_object_range_complete(ranges, TRUE);
+
 	return ret;
 }
 
@@ -1043,6 +3011,7 @@ j_distributed_object_status_exec(JList* operations, JSemantics* semantics)
 	JBackend* object_backend;
 	g_autoptr(JListIterator) it = NULL;
 	g_autofree JMessage** messages = NULL;
+	g_autofree JList** server_operations = NULL;
 	gchar const* namespace = NULL;
 	gsize namespace_len = 0;
 	guint32 server_count = 0;
@@ -1067,15 +3036,9 @@ j_distributed_object_status_exec(JList* operations, JSemantics* semantics)
 	if (object_backend == NULL)
 	{
 		server_count = j_configuration_get_server_count(j_configuration(), J_BACKEND_TYPE_OBJECT);
-		messages = g_new(JMessage*, server_count);
-
-		// FIXME use actual distribution
-		for (guint i = 0; i < server_count; i++)
-		{
-			messages[i] = j_message_new(J_MESSAGE_OBJECT_STATUS, namespace_len);
-			j_message_set_semantics(messages[i], semantics);
-			j_message_append_n(messages[i], namespace, namespace_len);
-		}
+		// Messages are only created for servers that can hold data of at least one of the objects.
+		messages = g_new0(JMessage*, server_count);
+		server_operations = g_new0(JList*, server_count);
 	}
 
 	while (j_list_iterator_next(it))
@@ -1109,36 +3072,70 @@ j_distributed_object_status_exec(JList* operations, JSemantics* semantics)
 
 			name_len = strlen(object->name) + 1;
 
-			// FIXME use actual distribution
 			for (guint i = 0; i < server_count; i++)
 			{
+				if (!j_distribution_uses_server(object->distribution, i))
+				{
+					continue;
+				}
+
+				if (messages[i] == NULL)
+				{
+					messages[i] = j_message_new(J_MESSAGE_OBJECT_STATUS, namespace_len);
+					j_message_set_semantics(messages[i], semantics);
+					j_message_append_n(messages[i], namespace, namespace_len);
+
+					server_operations[i] = j_list_new(NULL);
+				}
+
 				j_message_add_operation(messages[i], name_len);
 				j_message_append_n(messages[i], object->name, name_len);
+
+				j_list_append(server_operations[i], operation);
 			}
 		}
 	}
 
 	if (object_backend == NULL)
 	{
-		g_autofree gpointer* background_data = NULL;
+		g_autoptr(JMessageFanout) fanout = NULL;
+		g_autofree JDistributedObjectBackgroundData* background_data = NULL;
 
-		background_data = g_new(gpointer, server_count);
+		fanout = j_message_fanout_new();
+		background_data = g_new(JDistributedObjectBackgroundData, server_count);
 
-		// FIXME use actual distribution
 		for (guint i = 0; i < server_count; i++)
 		{
-			JDistributedObjectBackgroundData* data;
+			JDistributedObjectBackgroundData* data = &(background_data[i]);
+
+			if (messages[i] == NULL)
+			{
+				continue;
+			}
 
-			data = g_slice_new(JDistributedObjectBackgroundData);
 			data->index = i;
 			data->message = messages[i];
-			data->operations = operations;
+			data->operations = server_operations[i];
 			data->semantics = semantics;
+			data->connection = j_connection_pool_pop(J_BACKEND_TYPE_OBJECT, i);
+			data->memories = NULL;
 
-			background_data[i] = data;
+			j_message_fanout_add(fanout, messages[i], data->connection, j_distributed_object_status_reply, data);
 		}
 
-		j_helper_execute_parallel(j_distributed_object_status_background_operation, background_data, server_count);
+		ret = j_message_fanout_execute(fanout) && ret;
+
+		for (guint i = 0; i < server_count; i++)
+		{
+			if (messages[i] == NULL)
+			{
+				continue;
+			}
+
+			j_list_unref(server_operations[i]);
+			j_message_unref(background_data[i].message);
+			j_connection_pool_push(J_BACKEND_TYPE_OBJECT, i, background_data[i].connection);
+		}
 	}
 
 	return ret;
@@ -1174,6 +3171,7 @@ j_distributed_object_new(gchar const* namespace, gchar const* name, JDistributio
 	object = g_slice_new(JDistributedObject);
 	object->namespace = g_strdup(namespace);
 	object->name = g_strdup(name);
+	object->operation_key = g_strdup_printf("%s/%s", namespace, name);
 	object->distribution = j_distribution_ref(distribution);
 	object->ref_count = 1;
 
@@ -1223,6 +3221,7 @@ j_distributed_object_unref(JDistributedObject* object)
 
 	if (g_atomic_int_dec_and_test(&(object->ref_count)))
 	{
+		g_free(object->operation_key);
 		g_free(object->name);
 		g_free(object->namespace);
 
@@ -1255,10 +3254,11 @@ j_distributed_object_create(JDistributedObject* object, JBatch* batch)
 
 	operation = j_operation_new();
 	// FIXME key = index + namespace
-	operation->key = object;
+	operation->key = object->operation_key;
 	operation->data = j_distributed_object_ref(object);
 	operation->exec_func = j_distributed_object_create_exec;
 	operation->free_func = j_distributed_object_create_free;
+	operation->cache_func = j_distributed_object_create_cache;
 
 	j_batch_add(batch, operation);
 }
@@ -1282,10 +3282,11 @@ j_distributed_object_delete(JDistributedObject* object, JBatch* batch)
 	g_return_if_fail(object != NULL);
 
 	operation = j_operation_new();
-	operation->key = object;
+	operation->key = object->operation_key;
 	operation->data = j_distributed_object_ref(object);
 	operation->exec_func = j_distributed_object_delete_exec;
 	operation->free_func = j_distributed_object_delete_free;
+	operation->cache_func = j_distributed_object_delete_cache;
 
 	j_batch_add(batch, operation);
 }
@@ -1310,43 +3311,31 @@ j_distributed_object_read(JDistributedObject* object, gpointer data, guint64 len
 
 	JDistributedObjectOperation* iop;
 	JOperation* operation;
-	guint64 max_operation_size;
 
 	g_return_if_fail(object != NULL);
 	g_return_if_fail(data != NULL);
 	g_return_if_fail(length > 0);
 	g_return_if_fail(bytes_read != NULL);
 
-	max_operation_size = j_configuration_get_max_operation_size(j_configuration());
-
-	// Chunk operation if necessary
-	while (length > 0)
-	{
-		guint64 chunk_size;
-
-		chunk_size = MIN(length, max_operation_size);
-
-		iop = g_slice_new(JDistributedObjectOperation);
-		iop->read.object = j_distributed_object_ref(object);
-		iop->read.data = data;
-		iop->read.length = chunk_size;
-		iop->read.offset = offset;
-		iop->read.bytes_read = bytes_read;
-
-		operation = j_operation_new();
-		operation->key = object;
-		operation->data = iop;
-		operation->exec_func = j_distributed_object_read_exec;
-		operation->free_func = j_distributed_object_read_free;
+	// The batch might be flushed while adding the operation, see j_batch_set_auto_flush().
+	*bytes_read = 0;
 
-		j_batch_add(batch, operation);
+	// Reads do not have to be chunked because the server streams its replies.
+	iop = j_batch_allocate(batch, sizeof(JDistributedObjectOperation));
+	iop->read.object = j_distributed_object_ref(object);
+	iop->read.data = data;
+	iop->read.length = length;
+	iop->read.offset = offset;
+	iop->read.bytes_read = bytes_read;
 
-		data = (gchar*)data + chunk_size;
-		length -= chunk_size;
-		offset += chunk_size;
-	}
+	operation = j_operation_new();
+	operation->key = object->operation_key;
+	operation->data = iop;
+	operation->exec_func = j_distributed_object_read_exec;
+	operation->free_func = j_distributed_object_read_free;
+	operation->size = length;
 
-	*bytes_read = 0;
+	j_batch_add(batch, operation);
 }
 
 /**
@@ -1381,6 +3370,9 @@ j_distributed_object_write(JDistributedObject* object, gconstpointer data, guint
 
 	max_operation_size = j_configuration_get_max_operation_size(j_configuration());
 
+	// The batch might be flushed while adding the operations, see j_batch_set_auto_flush().
+	*bytes_written = 0;
+
 	// Chunk operation if necessary
 	while (length > 0)
 	{
@@ -1388,7 +3380,7 @@ j_distributed_object_write(JDistributedObject* object, gconstpointer data, guint
 
 		chunk_size = MIN(length, max_operation_size);
 
-		iop = g_slice_new(JDistributedObjectOperation);
+		iop = j_batch_allocate(batch, sizeof(JDistributedObjectOperation));
 		iop->write.object = j_distributed_object_ref(object);
 		iop->write.data = data;
 		iop->write.length = chunk_size;
@@ -1396,10 +3388,12 @@ j_distributed_object_write(JDistributedObject* object, gconstpointer data, guint
 		iop->write.bytes_written = bytes_written;
 
 		operation = j_operation_new();
-		operation->key = object;
+		operation->key = object->operation_key;
 		operation->data = iop;
 		operation->exec_func = j_distributed_object_write_exec;
 		operation->free_func = j_distributed_object_write_free;
+		operation->cache_func = j_distributed_object_write_cache;
+		operation->size = chunk_size;
 
 		j_batch_add(batch, operation);
 
@@ -1407,8 +3401,6 @@ j_distributed_object_write(JDistributedObject* object, gconstpointer data, guint
 		length -= chunk_size;
 		offset += chunk_size;
 	}
-
-	*bytes_written = 0;
 }
 
 /**
@@ -1430,13 +3422,13 @@ j_distributed_object_status(JDistributedObject* object, gint64* modification_tim
 
 	g_return_if_fail(object != NULL);
 
-	iop = g_slice_new(JDistributedObjectOperation);
+	iop = j_batch_allocate(batch, sizeof(JDistributedObjectOperation));
 	iop->status.object = j_distributed_object_ref(object);
 	iop->status.modification_time = modification_time;
 	iop->status.size = size;
 
 	operation = j_operation_new();
-	operation->key = object;
+	operation->key = object->operation_key;
 	operation->data = iop;
 	operation->exec_func = j_distributed_object_status_exec;
 	operation->free_func = j_distributed_object_status_free;
@@ -92,6 +92,11 @@ struct JObject
 	 **/
 	gchar* name;
 
+	/**
+	 * Identifies the object in batches, see #JOperation.
+	 **/
+	gchar* operation_key;
+
 	/**
 	 * The reference count.
 	 **/
@@ -183,8 +188,6 @@ j_object_status_free(gpointer data)
 	JObjectOperation* operation = data;
 
 	j_object_unref(operation->status.object);
-
-	g_slice_free(JObjectOperation, operation);
 }
 
 static void
@@ -195,8 +198,6 @@ j_object_read_free(gpointer data)
 	JObjectOperation* operation = data;
 
 	j_object_unref(operation->read.object);
-
-	g_slice_free(JObjectOperation, operation);
 }
 
 static void
@@ -207,8 +208,55 @@ j_object_write_free(gpointer data)
 	JObjectOperation* operation = data;
 
 	j_object_unref(operation->write.object);
+}
+
+static guint64
+j_object_create_cache(gpointer data, gpointer buffer)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	(void)data;
+	(void)buffer;
+
+	return 0;
+}
+
+static guint64
+j_object_delete_cache(gpointer data, gpointer buffer)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	(void)data;
+	(void)buffer;
+
+	return 0;
+}
+
+static guint64
+j_object_write_cache(gpointer data, gpointer buffer)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JObjectOperation* operation = data;
+	guint64 size;
+
+	// The cached operation gets its own counter because the caller's one is updated right away.
+	size = sizeof(guint64) + operation->write.length;
+
+	if (buffer != NULL)
+	{
+		guint64* bytes_written = buffer;
+		gchar* new_data = (gchar*)buffer + sizeof(guint64);
+
+		memcpy(new_data, operation->write.data, operation->write.length);
+		j_helper_atomic_add(operation->write.bytes_written, operation->write.length);
+
+		*bytes_written = 0;
+		operation->write.data = new_data;
+		operation->write.bytes_written = bytes_written;
+	}
 
-	g_slice_free(JObjectOperation, operation);
+	return size;
 }
 
 static gboolean
@@ -393,6 +441,55 @@ j_object_delete_exec(JList* operations, JSemantics* semantics)
 	return ret;
 }
 
+/**
+ * Acquires registered memory for an operation and appends the operation to a message.
+ * The server accesses the memory directly using the fabric connection.
+ *
+ * \private
+ *
+ * \param message           A message.
+ * \param fabric_connection A fabric connection.
+ * \param memories          The operations' memory regions, NULL for operations without one.
+ * \param data              The operation's memory.
+ * \param length            The operation's length.
+ * \param offset            The operation's offset.
+ * \param copy              Whether the server reads the memory.
+ *
+ * \return TRUE on success, FALSE if the memory could not be registered.
+ **/
+static gboolean
+j_object_append_memory(JMessage* message, JFabricConnection* fabric_connection, GPtrArray* memories, gconstpointer data, guint64 length, guint64 offset, gboolean copy)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JFabricMemory* memory = NULL;
+	guint64 address = 0;
+	guint64 key = 0;
+
+	if (length > 0)
+	{
+		memory = j_fabric_memory_acquire(fabric_connection, data, length, copy);
+	}
+
+	if (memory != NULL)
+	{
+		address = j_fabric_memory_get_address(memory);
+		key = j_fabric_memory_get_key(memory);
+	}
+
+	// The memory regions are indexed by operation, so read data can be copied back.
+	g_ptr_array_add(memories, memory);
+
+	// Operations that could not be registered fail on the server.
+	j_message_add_operation(message, 4 * sizeof(guint64));
+	j_message_append_8(message, &length);
+	j_message_append_8(message, &offset);
+	j_message_append_8(message, &address);
+	j_message_append_8(message, &key);
+
+	return (length == 0 || memory != NULL);
+}
+
 static gboolean
 j_object_read_exec(JList* operations, JSemantics* semantics)
 {
@@ -404,8 +501,12 @@ j_object_read_exec(JList* operations, JSemantics* semantics)
 	JBackend* object_backend;
 	JListIterator* it;
 	g_autoptr(JMessage) message = NULL;
+	g_autoptr(GPtrArray) memories = NULL;
+	GArray* ranges;
 	JObject* object;
 	gpointer object_handle;
+	gpointer object_connection = NULL;
+	JFabricConnection* fabric_connection = NULL;
 
 	// FIXME
 	//JLock* lock = NULL;
@@ -422,7 +523,27 @@ j_object_read_exec(JList* operations, JSemantics* semantics)
 		g_assert(object != NULL);
 	}
 
+	ranges = g_array_sized_new(FALSE, FALSE, sizeof(JObjectRange), j_list_length(operations));
 	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		JObjectOperation* operation = j_list_iterator_get(it);
+		JObjectRange range;
+
+		range.data = operation->read.data;
+		range.length = operation->read.length;
+		range.offset = operation->read.offset;
+		range.bytes = operation->read.bytes_read;
+		range.parts = NULL;
+		range.nbytes = 0;
+
+		g_array_append_val(ranges, range);
+	}
+
+	j_list_iterator_free(it);
+
+	ranges = j_object_range_coalesce(ranges, FALSE, semantics);
 	object_backend = j_object_get_backend();
 
 	if (object_backend != NULL)
@@ -441,6 +562,15 @@ j_object_read_exec(JList* operations, JSemantics* semantics)
 		j_message_set_semantics(message, semantics);
 		j_message_append_n(message, object->namespace, namespace_len);
 		j_message_append_n(message, object->name, name_len);
+
+		// The connection determines whether the data is transferred using the fabric.
+		object_connection = j_connection_pool_pop(J_BACKEND_TYPE_OBJECT, object->index);
+		fabric_connection = j_fabric_connection_get(object_connection);
+
+		if (fabric_connection != NULL)
+		{
+			memories = g_ptr_array_new_with_free_func((GDestroyNotify)j_fabric_memory_release);
+		}
 	}
 
 	/*
@@ -450,13 +580,13 @@ j_object_read_exec(JList* operations, JSemantics* semantics)
 	}
 	*/
 
-	while (j_list_iterator_next(it))
+	for (guint i = 0; i < ranges->len; i++)
 	{
-		JObjectOperation* operation = j_list_iterator_get(it);
-		gpointer data = operation->read.data;
-		guint64 length = operation->read.length;
-		guint64 offset = operation->read.offset;
-		guint64* bytes_read = operation->read.bytes_read;
+		JObjectRange* range = &g_array_index(ranges, JObjectRange, i);
+		gpointer data = range->data;
+		guint64 length = range->length;
+		guint64 offset = range->offset;
+		guint64* bytes_read = range->bytes;
 
 		j_trace_file_begin(object->name, J_TRACE_FILE_READ);
 
@@ -467,6 +597,10 @@ j_object_read_exec(JList* operations, JSemantics* semantics)
 			ret = j_backend_object_read(object_backend, object_handle, data, length, offset, &nbytes) && ret;
 			j_helper_atomic_add(bytes_read, nbytes);
 		}
+		else if (fabric_connection != NULL)
+		{
+			ret = j_object_append_memory(message, fabric_connection, memories, data, length, offset, FALSE) && ret;
+		}
 		else
 		{
 			j_message_add_operation(message, sizeof(guint64) + sizeof(guint64));
@@ -477,8 +611,6 @@ j_object_read_exec(JList* operations, JSemantics* semantics)
 		j_trace_file_end(object->name, J_TRACE_FILE_READ, length, offset);
 	}
 
-	j_list_iterator_free(it);
-
 	if (object_backend != NULL)
 	{
 		ret = j_backend_object_close(object_backend, object_handle) && ret;
@@ -486,11 +618,12 @@ j_object_read_exec(JList* operations, JSemantics* semantics)
 	else
 	{
 		g_autoptr(JMessage) reply = NULL;
-		gpointer object_connection;
+		JObjectRange* range = NULL;
 		guint32 operations_done;
 		guint32 operation_count;
+		guint64 range_offset = 0;
+		gboolean received = TRUE;
 
-		object_connection = j_connection_pool_pop(J_BACKEND_TYPE_OBJECT, object->index);
 		j_message_send(message, object_connection);
 
 		reply = j_message_new_reply(message);
@@ -498,46 +631,81 @@ j_object_read_exec(JList* operations, JSemantics* semantics)
 		operations_done = 0;
 		operation_count = j_message_get_count(message);
 
-		it = j_list_iterator_new(operations);
-
 		/**
-		 * This extra loop is necessary because the server might send multiple
-		 * replies per message. The same reply object can be used to receive
-		 * multiple times.
+		 * This extra loop is necessary because the server streams its reply
+		 * as multiple fragments. An operation can span multiple fragments
+		 * and replies, so the data is consumed incrementally. The same reply
+		 * object can be used to receive multiple times.
 		 */
-		while (operations_done < operation_count)
+		while (received && operations_done < operation_count)
 		{
 			guint32 reply_operation_count;
 
-			j_message_receive(reply, object_connection);
+			if (!j_message_receive(reply, object_connection))
+			{
+				ret = FALSE;
+				break;
+			}
 
 			reply_operation_count = j_message_get_count(reply);
 
-			for (guint i = 0; i < reply_operation_count && j_list_iterator_next(it); i++)
+			for (guint i = 0; i < reply_operation_count; i++)
 			{
-				JObjectOperation* operation = j_list_iterator_get(it);
-				gpointer data = operation->read.data;
-				guint64* bytes_read = operation->read.bytes_read;
-
 				guint64 nbytes;
+				gchar last;
+
+				if (range == NULL)
+				{
+					if (operations_done >= ranges->len)
+					{
+						break;
+					}
+
+					range = &g_array_index(ranges, JObjectRange, operations_done);
+					range_offset = 0;
+				}
 
 				nbytes = j_message_get_8(reply);
-				j_helper_atomic_add(bytes_read, nbytes);
+				last = j_message_get_1(reply);
 
-				if (nbytes > 0)
+				// Data transferred using the fabric has already been written into the range's memory or a bounce buffer.
+				if (nbytes > 0 && fabric_connection != NULL)
 				{
-					GInputStream* input;
+					JFabricMemory* memory = g_ptr_array_index(memories, operations_done);
 
-					input = g_io_stream_get_input_stream(G_IO_STREAM(object_connection));
-					g_input_stream_read_all(input, data, nbytes, NULL, NULL, NULL);
+					if (memory != NULL)
+					{
+						j_fabric_memory_copy_back(memory, range_offset, nbytes);
+					}
+
+					range_offset += nbytes;
 				}
-			}
+				else if (nbytes > 0)
+				{
+					gchar* data = range->data;
 
-			operations_done += reply_operation_count;
-		}
+					if (!j_message_receive_send(reply, data + range_offset, nbytes))
+					{
+						ret = FALSE;
+						received = FALSE;
+						break;
+					}
 
-		j_list_iterator_free(it);
+					range_offset += nbytes;
+				}
+
+				j_helper_atomic_add(range->bytes, nbytes);
+
+				if (last)
+				{
+					range = NULL;
+					operations_done++;
+				}
+			}
+		}
 
+		// Discards additional data that has not been received, other threads might be waiting to read from the connection.
+		g_clear_pointer(&reply, j_message_unref);
 		j_connection_pool_push(J_BACKEND_TYPE_OBJECT, object->index, object_connection);
 	}
 
@@ -551,6 +719,10 @@ j_object_read_exec(JList* operations, JSemantics* semantics)
 	}
 	*/
 
+	// Memory acquired for the fabric has to be released before the buffers of coalesced ranges are freed.
+	g_clear_pointer(&memories, g_ptr_array_unref);
+	j_object_range_complete(ranges, FALSE);
+
 	return ret;
 }
 
@@ -565,8 +737,12 @@ j_object_write_exec(JList* operations, JSemantics* semantics)
 	JBackend* object_backend;
 	JListIterator* it;
 	g_autoptr(JMessage) message = NULL;
+	g_autoptr(GPtrArray) memories = NULL;
+	GArray* ranges;
 	JObject* object;
 	gpointer object_handle;
+	gpointer object_connection = NULL;
+	JFabricConnection* fabric_connection = NULL;
 
 	// FIXME
 	//JLock* lock = NULL;
@@ -583,7 +759,27 @@ j_object_write_exec(JList* operations, JSemantics* semantics)
 		g_assert(object != NULL);
 	}
 
+	ranges = g_array_sized_new(FALSE, FALSE, sizeof(JObjectRange), j_list_length(operations));
 	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		JObjectOperation* operation = j_list_iterator_get(it);
+		JObjectRange range;
+
+		range.data = (gpointer)(guintptr)operation->write.data;
+		range.length = operation->write.length;
+		range.offset = operation->write.offset;
+		range.bytes = operation->write.bytes_written;
+		range.parts = NULL;
+		range.nbytes = 0;
+
+		g_array_append_val(ranges, range);
+	}
+
+	j_list_iterator_free(it);
+
+	ranges = j_object_range_coalesce(ranges, TRUE, semantics);
 	object_backend = j_object_get_backend();
 
 	if (object_backend != NULL)
@@ -602,6 +798,15 @@ j_object_write_exec(JList* operations, JSemantics* semantics)
 		j_message_set_semantics(message, semantics);
 		j_message_append_n(message, object->namespace, namespace_len);
 		j_message_append_n(message, object->name, name_len);
+
+		// The connection determines whether the data is transferred using the fabric.
+		object_connection = j_connection_pool_pop(J_BACKEND_TYPE_OBJECT, object->index);
+		fabric_connection = j_fabric_connection_get(object_connection);
+
+		if (fabric_connection != NULL)
+		{
+			memories = g_ptr_array_new_with_free_func((GDestroyNotify)j_fabric_memory_release);
+		}
 	}
 
 	/*
@@ -611,13 +816,13 @@ j_object_write_exec(JList* operations, JSemantics* semantics)
 	}
 	*/
 
-	while (j_list_iterator_next(it))
+	for (guint i = 0; i < ranges->len; i++)
 	{
-		JObjectOperation* operation = j_list_iterator_get(it);
-		gconstpointer data = operation->write.data;
-		guint64 length = operation->write.length;
-		guint64 offset = operation->write.offset;
-		guint64* bytes_written = operation->write.bytes_written;
+		JObjectRange* range = &g_array_index(ranges, JObjectRange, i);
+		gconstpointer data = range->data;
+		guint64 length = range->length;
+		guint64 offset = range->offset;
+		guint64* bytes_written = range->bytes;
 
 		j_trace_file_begin(object->name, J_TRACE_FILE_WRITE);
 
@@ -635,6 +840,10 @@ j_object_write_exec(JList* operations, JSemantics* semantics)
 			ret = j_backend_object_write(object_backend, object_handle, data, length, offset, &nbytes) && ret;
 			j_helper_atomic_add(bytes_written, nbytes);
 		}
+		else if (fabric_connection != NULL)
+		{
+			ret = j_object_append_memory(message, fabric_connection, memories, data, length, offset, TRUE) && ret;
+		}
 		else
 		{
 			j_message_add_operation(message, sizeof(guint64) + sizeof(guint64));
@@ -652,8 +861,6 @@ j_object_write_exec(JList* operations, JSemantics* semantics)
 		j_trace_file_end(object->name, J_TRACE_FILE_WRITE, length, offset);
 	}
 
-	j_list_iterator_free(it);
-
 	if (object_backend != NULL)
 	{
 		ret = j_backend_object_close(object_backend, object_handle) && ret;
@@ -662,13 +869,11 @@ j_object_write_exec(JList* operations, JSemantics* semantics)
 	{
 		JSemanticsSafety safety;
 
-		gpointer object_connection;
-
 		safety = j_semantics_get(semantics, J_SEMANTICS_SAFETY);
-		object_connection = j_connection_pool_pop(J_BACKEND_TYPE_OBJECT, object->index);
 		j_message_send(message, object_connection);
 
-		if (safety == J_SEMANTICS_SAFETY_NETWORK || safety == J_SEMANTICS_SAFETY_STORAGE)
+		// The memory must not be reused before the server has read it, so fabric writes are always answered.
+		if (safety == J_SEMANTICS_SAFETY_NETWORK || safety == J_SEMANTICS_SAFETY_STORAGE || fabric_connection != NULL)
 		{
 			g_autoptr(JMessage) reply = NULL;
 			guint64 nbytes;
@@ -676,18 +881,13 @@ j_object_write_exec(JList* operations, JSemantics* semantics)
 			reply = j_message_new_reply(message);
 			j_message_receive(reply, object_connection);
 
-			it = j_list_iterator_new(operations);
-
-			while (j_list_iterator_next(it))
+			for (guint i = 0; i < ranges->len; i++)
 			{
-				JObjectOperation* operation = j_list_iterator_get(it);
-				guint64* bytes_written = operation->write.bytes_written;
+				JObjectRange* range = &g_array_index(ranges, JObjectRange, i);
 
 				nbytes = j_message_get_8(reply);
-				j_helper_atomic_add(bytes_written, nbytes);
+				j_helper_atomic_add(range->bytes, nbytes);
 			}
-
-			j_list_iterator_free(it);
 		}
 
 		j_connection_pool_push(J_BACKEND_TYPE_OBJECT, object->index, object_connection);
@@ -703,6 +903,9 @@ j_object_write_exec(JList* operations, JSemantics* semantics)
 	}
 	*/
 
+	g_clear_pointer(&memories, g_ptr_array_unref);
+	j_object_range_complete(ranges, TRUE);
+
 	return ret;
 }
 
@@ -843,9 +1046,10 @@ j_object_new(gchar const* namespace, gchar const* name)
 	g_return_val_if_fail(name != NULL, NULL);
 
 	object = g_slice_new(JObject);
-	object->index = j_helper_hash(name) % j_configuration_get_server_count(configuration, J_BACKEND_TYPE_OBJECT);
+	object->index = j_placement_get_index(j_configuration_get_placement(configuration, J_BACKEND_TYPE_OBJECT), name);
 	object->namespace = g_strdup(namespace);
 	object->name = g_strdup(name);
+	object->operation_key = g_strdup_printf("%u/%s/%s", object->index, namespace, name);
 	object->ref_count = 1;
 
 	return object;
@@ -882,6 +1086,7 @@ j_object_new_for_index(guint32 index, gchar const* namespace, gchar const* name)
 	object->index = index;
 	object->namespace = g_strdup(namespace);
 	object->name = g_strdup(name);
+	object->operation_key = g_strdup_printf("%u/%s/%s", object->index, namespace, name);
 	object->ref_count = 1;
 
 	return object;
@@ -930,6 +1135,7 @@ j_object_unref(JObject* object)
 
 	if (g_atomic_int_dec_and_test(&(object->ref_count)))
 	{
+		g_free(object->operation_key);
 		g_free(object->name);
 		g_free(object->namespace);
 
@@ -960,10 +1166,11 @@ j_object_create(JObject* object, JBatch* batch)
 
 	operation = j_operation_new();
 	// FIXME key = index + namespace
-	operation->key = object;
+	operation->key = object->operation_key;
 	operation->data = j_object_ref(object);
 	operation->exec_func = j_object_create_exec;
 	operation->free_func = j_object_create_free;
+	operation->cache_func = j_object_create_cache;
 
 	j_batch_add(batch, operation);
 }
@@ -987,10 +1194,11 @@ j_object_delete(JObject* object, JBatch* batch)
 	g_return_if_fail(object != NULL);
 
 	operation = j_operation_new();
-	operation->key = object;
+	operation->key = object->operation_key;
 	operation->data = j_object_ref(object);
 	operation->exec_func = j_object_delete_exec;
 	operation->free_func = j_object_delete_free;
+	operation->cache_func = j_object_delete_cache;
 
 	j_batch_add(batch, operation);
 }
@@ -1015,43 +1223,31 @@ j_object_read(JObject* object, gpointer data, guint64 length, guint64 offset, gu
 
 	JObjectOperation* iop;
 	JOperation* operation;
-	guint64 max_operation_size;
 
 	g_return_if_fail(object != NULL);
 	g_return_if_fail(data != NULL);
 	g_return_if_fail(length > 0);
 	g_return_if_fail(bytes_read != NULL);
 
-	max_operation_size = j_configuration_get_max_operation_size(j_configuration());
-
-	// Chunk operation if necessary
-	while (length > 0)
-	{
-		guint64 chunk_size;
-
-		chunk_size = MIN(length, max_operation_size);
-
-		iop = g_slice_new(JObjectOperation);
-		iop->read.object = j_object_ref(object);
-		iop->read.data = data;
-		iop->read.length = chunk_size;
-		iop->read.offset = offset;
-		iop->read.bytes_read = bytes_read;
-
-		operation = j_operation_new();
-		operation->key = object;
-		operation->data = iop;
-		operation->exec_func = j_object_read_exec;
-		operation->free_func = j_object_read_free;
+	// The batch might be flushed while adding the operation, see j_batch_set_auto_flush().
+	*bytes_read = 0;
 
-		j_batch_add(batch, operation);
+	// Reads do not have to be chunked because the server streams its replies.
+	iop = j_batch_allocate(batch, sizeof(JObjectOperation));
+	iop->read.object = j_object_ref(object);
+	iop->read.data = data;
+	iop->read.length = length;
+	iop->read.offset = offset;
+	iop->read.bytes_read = bytes_read;
 
-		data = (gchar*)data + chunk_size;
-		length -= chunk_size;
-		offset += chunk_size;
-	}
+	operation = j_operation_new();
+	operation->key = object->operation_key;
+	operation->data = iop;
+	operation->exec_func = j_object_read_exec;
+	operation->free_func = j_object_read_free;
+	operation->size = length;
 
-	*bytes_read = 0;
+	j_batch_add(batch, operation);
 }
 
 /**
@@ -1086,6 +1282,9 @@ j_object_write(JObject* object, gconstpointer data, guint64 length, guint64 offs
 
 	max_operation_size = j_configuration_get_max_operation_size(j_configuration());
 
+	// The batch might be flushed while adding the operations, see j_batch_set_auto_flush().
+	*bytes_written = 0;
+
 	// Chunk operation if necessary
 	while (length > 0)
 	{
@@ -1093,7 +1292,7 @@ j_object_write(JObject* object, gconstpointer data, guint64 length, guint64 offs
 
 		chunk_size = MIN(length, max_operation_size);
 
-		iop = g_slice_new(JObjectOperation);
+		iop = j_batch_allocate(batch, sizeof(JObjectOperation));
 		iop->write.object = j_object_ref(object);
 		iop->write.data = data;
 		iop->write.length = chunk_size;
@@ -1101,10 +1300,12 @@ j_object_write(JObject* object, gconstpointer data, guint64 length, guint64 offs
 		iop->write.bytes_written = bytes_written;
 
 		operation = j_operation_new();
-		operation->key = object;
+		operation->key = object->operation_key;
 		operation->data = iop;
 		operation->exec_func = j_object_write_exec;
 		operation->free_func = j_object_write_free;
+		operation->cache_func = j_object_write_cache;
+		operation->size = chunk_size;
 
 		j_batch_add(batch, operation);
 
@@ -1112,8 +1313,6 @@ j_object_write(JObject* object, gconstpointer data, guint64 length, guint64 offs
 		length -= chunk_size;
 		offset += chunk_size;
 	}
-
-	*bytes_written = 0;
 }
 
 /**
@@ -1135,13 +1334,13 @@ j_object_status(JObject* object, gint64* modification_time, guint64* size, JBatc
 
 	g_return_if_fail(object != NULL);
 
-	iop = g_slice_new(JObjectOperation);
+	iop = j_batch_allocate(batch, sizeof(JObjectOperation));
 	iop->status.object = j_object_ref(object);
 	iop->status.modification_time = modification_time;
 	iop->status.size = size;
 
 	operation = j_operation_new();
-	operation->key = object;
+	operation->key = object->operation_key;
 	operation->data = iop;
 	operation->exec_func = j_object_status_exec;
 	operation->free_func = j_object_status_free;
@@ -1160,6 +1359,176 @@ j_object_get_backend(void)
 	return j_object_backend;
 }
 
+/**
+ * Coalesces consecutive ranges that are adjacent or overlapping.
+ * Only consecutive ranges are coalesced, so overlapping writes are still applied in their original order.
+ * A coalesced range uses a temporary buffer that is filled with the data to write or read into.
+ * Ranges are only coalesced if the ordering semantics are not strict and if the result does not exceed the maximum operation size.
+ *
+ * \code
+ * \endcode
+ *
+ * \param ranges    An array of #JObjectRange elements, which is consumed.
+ * \param write     Whether the ranges are written.
+ * \param semantics A semantics object.
+ *
+ * \return An array of #JObjectRange elements, which should be freed with j_object_range_complete().
+ **/
+GArray*
+j_object_range_coalesce(GArray* ranges, gboolean write, JSemantics* semantics)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	GArray* coalesced;
+	guint64 max_length;
+
+	g_return_val_if_fail(ranges != NULL, NULL);
+	g_return_val_if_fail(semantics != NULL, NULL);
+
+	if (ranges->len < 2 || j_semantics_get(semantics, J_SEMANTICS_ORDERING) == J_SEMANTICS_ORDERING_STRICT)
+	{
+		return ranges;
+	}
+
+	max_length = j_configuration_get_max_operation_size(j_configuration());
+	coalesced = g_array_sized_new(FALSE, FALSE, sizeof(JObjectRange), ranges->len);
+
+	for (guint i = 0; i < ranges->len;)
+	{
+		JObjectRange* first = &g_array_index(ranges, JObjectRange, i);
+		JObjectRange range;
+		guint64 start = first->offset;
+		guint64 end = first->offset + first->length;
+		guint count = 1;
+
+		// Extend the range as long as the following ranges touch it.
+		while (i + count < ranges->len)
+		{
+			JObjectRange* next = &g_array_index(ranges, JObjectRange, i + count);
+			guint64 new_start;
+			guint64 new_end;
+
+			if (next->offset > end || next->offset + next->length < start)
+			{
+				break;
+			}
+
+			new_start = MIN(start, next->offset);
+			new_end = MAX(end, next->offset + next->length);
+
+			if (new_end - new_start > max_length)
+			{
+				break;
+			}
+
+			start = new_start;
+			end = new_end;
+			count++;
+		}
+
+		if (count == 1)
+		{
+			g_array_append_val(coalesced, *first);
+			i++;
+
+			continue;
+		}
+
+		range.data = g_malloc(end - start);
+		range.length = end - start;
+		range.offset = start;
+		range.bytes = NULL;
+		range.parts = g_array_sized_new(FALSE, FALSE, sizeof(JObjectRange), count);
+		range.nbytes = 0;
+
+		g_array_append_vals(range.parts, first, count);
+
+		if (write)
+		{
+			// Later writes overwrite earlier ones.
+			for (guint j = 0; j < count; j++)
+			{
+				JObjectRange* part = &g_array_index(range.parts, JObjectRange, j);
+
+				memcpy((gchar*)range.data + (part->offset - start), part->data, part->length);
+			}
+		}
+
+		g_array_append_val(coalesced, range);
+		i += count;
+	}
+
+	g_array_unref(ranges);
+
+	// The array will not be resized anymore, so coalesced ranges can use their own counter.
+	for (guint i = 0; i < coalesced->len; i++)
+	{
+		JObjectRange* range = &g_array_index(coalesced, JObjectRange, i);
+
+		if (range->parts != NULL)
+		{
+			range->bytes = &(range->nbytes);
+		}
+	}
+
+	return coalesced;
+}
+
+/**
+ * Completes ranges returned by j_object_range_coalesce().
+ * The data read into coalesced ranges is copied into the original buffers and the original counters are updated.
+ *
+ * \code
+ * \endcode
+ *
+ * \param ranges An array of #JObjectRange elements, which is freed.
+ * \param write  Whether the ranges have been written.
+ **/
+void
+j_object_range_complete(GArray* ranges, gboolean write)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_if_fail(ranges != NULL);
+
+	for (guint i = 0; i < ranges->len; i++)
+	{
+		JObjectRange* range = &g_array_index(ranges, JObjectRange, i);
+		guint64 end;
+
+		if (range->parts == NULL)
+		{
+			continue;
+		}
+
+		// Only the first nbytes of the range are valid.
+		end = range->offset + range->nbytes;
+
+		for (guint j = 0; j < range->parts->len; j++)
+		{
+			JObjectRange* part = &g_array_index(range->parts, JObjectRange, j);
+			guint64 nbytes = 0;
+
+			if (end > part->offset)
+			{
+				nbytes = MIN(part->length, end - part->offset);
+			}
+
+			if (!write && nbytes > 0)
+			{
+				memcpy(part->data, (gchar*)range->data + (part->offset - range->offset), nbytes);
+			}
+
+			j_helper_atomic_add(part->bytes, nbytes);
+		}
+
+		g_array_unref(range->parts);
+		g_free(range->data);
+	}
+
+	g_array_unref(ranges);
+}
+
 /**
  * @}
  **/
@@ -0,0 +1,402 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2010-2020 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <sys/mman.h>
+
+#include <julea.h>
+
+#include "server.h"
+
+/**
+ * The buffer pool is shared by all worker threads.
+ * Buffers are grouped into size classes that are powers of two, starting at JD_BUFFER_POOL_MIN_SIZE.
+ * Handlers borrow buffers for single operations and return them as soon as possible.
+ * The total amount of allocated memory is limited; if the limit is reached, handlers have to wait until other buffers are returned.
+ * To avoid deadlocks, handlers must only wait for buffers if they do not hold any other buffers.
+ **/
+
+#define JD_BUFFER_POOL_MIN_SIZE (4 * 1024)
+#define JD_BUFFER_POOL_HUGEPAGE_SIZE (2 * 1024 * 1024)
+
+struct JdBufferPool
+{
+	GMutex mutex;
+	GCond cond;
+
+	/**
+	 * Unused buffers per size class.
+	 **/
+	GQueue* free;
+	guint free_len;
+
+	/**
+	 * The size of the largest buffer.
+	 **/
+	guint64 max_size;
+
+	/**
+	 * The maximum amount of allocated memory, 0 if unlimited.
+	 **/
+	guint64 memory_limit;
+
+	/**
+	 * The maximum amount of memory kept in unused buffers.
+	 **/
+	guint64 cache_limit;
+
+	/**
+	 * The amount of allocated memory, including unused buffers.
+	 **/
+	guint64 allocated;
+
+	/**
+	 * The amount of memory in unused buffers.
+	 **/
+	guint64 cached;
+
+	gboolean hugepages;
+};
+
+typedef struct JdBufferPool JdBufferPool;
+
+static JdBufferPool* jd_buffer_pool = NULL;
+
+static guint
+jd_buffer_pool_size_class(guint64 length)
+{
+	guint size_class = 0;
+	guint64 size = JD_BUFFER_POOL_MIN_SIZE;
+
+	while (size < length)
+	{
+		size <<= 1;
+		size_class++;
+	}
+
+	return size_class;
+}
+
+static JdBuffer*
+jd_buffer_pool_allocate(guint size_class)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JdBuffer* buffer;
+	gpointer data;
+	guint64 size;
+
+	size = (guint64)JD_BUFFER_POOL_MIN_SIZE << size_class;
+
+	// Memory returned by mmap is given back to the system as soon as the buffer is freed.
+	data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (data == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+#ifdef MADV_HUGEPAGE
+	if (jd_buffer_pool->hugepages && size >= JD_BUFFER_POOL_HUGEPAGE_SIZE)
+	{
+		madvise(data, size, MADV_HUGEPAGE);
+	}
+#endif
+
+	buffer = g_slice_new(JdBuffer);
+	buffer->data = data;
+	buffer->size = size;
+	buffer->size_class = size_class;
+	buffer->memory = NULL;
+
+	return buffer;
+}
+
+static void
+jd_buffer_pool_deallocate(JdBuffer* buffer)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	if (buffer->memory != NULL)
+	{
+		j_fabric_memory_deregister(buffer->memory);
+	}
+
+	munmap(buffer->data, buffer->size);
+	g_slice_free(JdBuffer, buffer);
+}
+
+/**
+ * Frees unused buffers until the given amount of memory is available.
+ * The pool's mutex has to be held.
+ **/
+static gboolean
+jd_buffer_pool_reclaim(guint64 size)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	if (jd_buffer_pool->memory_limit == 0)
+	{
+		return TRUE;
+	}
+
+	// Free large buffers first because they are needed less often.
+	for (guint i = jd_buffer_pool->free_len; i > 0 && jd_buffer_pool->allocated + size > jd_buffer_pool->memory_limit; i--)
+	{
+		GQueue* queue = &(jd_buffer_pool->free[i - 1]);
+
+		while (!g_queue_is_empty(queue) && jd_buffer_pool->allocated + size > jd_buffer_pool->memory_limit)
+		{
+			JdBuffer* buffer = g_queue_pop_head(queue);
+
+			jd_buffer_pool->allocated -= buffer->size;
+			jd_buffer_pool->cached -= buffer->size;
+			jd_buffer_pool_deallocate(buffer);
+		}
+	}
+
+	return (jd_buffer_pool->allocated + size <= jd_buffer_pool->memory_limit);
+}
+
+static JdBuffer*
+jd_buffer_pool_get_internal(guint64 length, gboolean wait)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JdBuffer* buffer = NULL;
+	GQueue* queue;
+	gboolean allocate = FALSE;
+	guint size_class;
+	guint64 size;
+
+	g_return_val_if_fail(jd_buffer_pool != NULL, NULL);
+	g_return_val_if_fail(length <= jd_buffer_pool->max_size, NULL);
+
+	size_class = jd_buffer_pool_size_class(length);
+	size = (guint64)JD_BUFFER_POOL_MIN_SIZE << size_class;
+	queue = &(jd_buffer_pool->free[size_class]);
+
+	g_mutex_lock(&(jd_buffer_pool->mutex));
+
+	while (TRUE)
+	{
+		buffer = g_queue_pop_head(queue);
+
+		if (buffer != NULL)
+		{
+			jd_buffer_pool->cached -= buffer->size;
+			break;
+		}
+
+		if (jd_buffer_pool_reclaim(size))
+		{
+			jd_buffer_pool->allocated += size;
+			allocate = TRUE;
+			break;
+		}
+
+		if (!wait)
+		{
+			break;
+		}
+
+		g_cond_wait(&(jd_buffer_pool->cond), &(jd_buffer_pool->mutex));
+	}
+
+	g_mutex_unlock(&(jd_buffer_pool->mutex));
+
+	// The memory has already been accounted for, so the buffer can be allocated without holding the lock.
+	if (allocate)
+	{
+		buffer = jd_buffer_pool_allocate(size_class);
+
+		if (buffer == NULL)
+		{
+			g_mutex_lock(&(jd_buffer_pool->mutex));
+			jd_buffer_pool->allocated -= size;
+			g_cond_broadcast(&(jd_buffer_pool->cond));
+			g_mutex_unlock(&(jd_buffer_pool->mutex));
+		}
+	}
+
+	return buffer;
+}
+
+/**
+ * Borrows a buffer from the pool.
+ * If the memory limit has been reached, waits until other buffers have been returned.
+ * Must not be called while holding other buffers.
+ *
+ * \param length The minimum size of the buffer.
+ *
+ * \return A buffer, NULL if memory could not be allocated.
+ **/
+JdBuffer*
+jd_buffer_pool_get(guint64 length)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	return jd_buffer_pool_get_internal(length, TRUE);
+}
+
+/**
+ * Borrows a buffer from the pool without waiting.
+ *
+ * \param length The minimum size of the buffer.
+ *
+ * \return A buffer, NULL if the memory limit has been reached.
+ **/
+JdBuffer*
+jd_buffer_pool_try_get(guint64 length)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	return jd_buffer_pool_get_internal(length, FALSE);
+}
+
+/**
+ * Returns a buffer to the pool.
+ *
+ * \param buffer A buffer.
+ **/
+void
+jd_buffer_pool_put(JdBuffer* buffer)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_if_fail(jd_buffer_pool != NULL);
+	g_return_if_fail(buffer != NULL);
+
+	g_mutex_lock(&(jd_buffer_pool->mutex));
+
+	if (jd_buffer_pool->cached + buffer->size <= jd_buffer_pool->cache_limit)
+	{
+		g_queue_push_head(&(jd_buffer_pool->free[buffer->size_class]), buffer);
+		jd_buffer_pool->cached += buffer->size;
+		buffer = NULL;
+	}
+	else
+	{
+		jd_buffer_pool->allocated -= buffer->size;
+	}
+
+	g_cond_broadcast(&(jd_buffer_pool->cond));
+	g_mutex_unlock(&(jd_buffer_pool->mutex));
+
+	if (buffer != NULL)
+	{
+		jd_buffer_pool_deallocate(buffer);
+	}
+}
+
+/**
+ * Registers a buffer for fabric operations.
+ * The registration is kept until the buffer is freed, so cached buffers only have to be registered once.
+ * All fabric connections share the same domain, so the registration can be used with any of them.
+ *
+ * \param buffer     A buffer.
+ * \param connection A fabric connection.
+ *
+ * \return The buffer's memory region, NULL if it could not be registered.
+ **/
+JFabricMemory*
+jd_buffer_pool_register(JdBuffer* buffer, JFabricConnection* connection)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(buffer != NULL, NULL);
+	g_return_val_if_fail(connection != NULL, NULL);
+
+	if (buffer->memory == NULL)
+	{
+		buffer->memory = j_fabric_memory_register(connection, buffer->data, buffer->size, FALSE);
+	}
+
+	return buffer->memory;
+}
+
+/**
+ * Initializes the buffer pool.
+ *
+ * \param max_size     The size of the largest buffer.
+ * \param memory_limit The maximum amount of allocated memory, 0 if unlimited.
+ * \param hugepages    Whether large buffers should be backed by huge pages.
+ **/
+void
+jd_buffer_pool_init(guint64 max_size, guint64 memory_limit, gboolean hugepages)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_if_fail(jd_buffer_pool == NULL);
+	g_return_if_fail(max_size > 0);
+
+	jd_buffer_pool = g_slice_new(JdBufferPool);
+	g_mutex_init(&(jd_buffer_pool->mutex));
+	g_cond_init(&(jd_buffer_pool->cond));
+	jd_buffer_pool->free_len = jd_buffer_pool_size_class(max_size) + 1;
+	jd_buffer_pool->free = g_new(GQueue, jd_buffer_pool->free_len);
+	jd_buffer_pool->max_size = max_size;
+	jd_buffer_pool->memory_limit = 0;
+	jd_buffer_pool->cache_limit = 4 * ((guint64)JD_BUFFER_POOL_MIN_SIZE << (jd_buffer_pool->free_len - 1));
+	jd_buffer_pool->allocated = 0;
+	jd_buffer_pool->cached = 0;
+	jd_buffer_pool->hugepages = hugepages;
+
+	if (memory_limit > 0)
+	{
+		// A single buffer of the largest size class always has to fit.
+		jd_buffer_pool->memory_limit = MAX(memory_limit, (guint64)JD_BUFFER_POOL_MIN_SIZE << (jd_buffer_pool->free_len - 1));
+	}
+
+	for (guint i = 0; i < jd_buffer_pool->free_len; i++)
+	{
+		g_queue_init(&(jd_buffer_pool->free[i]));
+	}
+}
+
+/**
+ * Frees the buffer pool.
+ * All buffers have to be returned before.
+ **/
+void
+jd_buffer_pool_fini(void)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_if_fail(jd_buffer_pool != NULL);
+
+	for (guint i = 0; i < jd_buffer_pool->free_len; i++)
+	{
+		JdBuffer* buffer;
+
+		while ((buffer = g_queue_pop_head(&(jd_buffer_pool->free[i]))) != NULL)
+		{
+			jd_buffer_pool_deallocate(buffer);
+		}
+	}
+
+	g_free(jd_buffer_pool->free);
+	g_cond_clear(&(jd_buffer_pool->cond));
+	g_mutex_clear(&(jd_buffer_pool->mutex));
+	g_slice_free(JdBufferPool, jd_buffer_pool);
+
+	jd_buffer_pool = NULL;
+}
@@ -0,0 +1,413 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2010-2020 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <julea.h>
+
+#include "server.h"
+
+/**
+ * The server's connections are handled by a fixed number of I/O threads and a bounded pool of worker threads.
+ * The I/O threads wait for incoming data using epoll and read messages without blocking, so partial messages do not occupy a worker.
+ * Complete messages are passed to the worker pool.
+ * A worker handles a single message before handing the connection back to its I/O thread.
+ * Additional data following a message, such as the data of object writes, is received by the worker.
+ * Connections have a receive timeout, so that clients that stop sending data cannot block a worker indefinitely.
+ * Connections are registered with EPOLLONESHOT, so at most one thread handles a connection at any time.
+ **/
+
+struct JdIOThread
+{
+	GThread* thread;
+	gint epoll_fd;
+	gint event_fd;
+};
+
+typedef struct JdIOThread JdIOThread;
+
+struct JdConnection
+{
+	GSocketConnection* connection;
+	JdIOThread* io_thread;
+	JMessage* message;
+	JStatistics* statistics;
+	gint fd;
+};
+
+typedef struct JdConnection JdConnection;
+
+static JdIOThread* jd_io_threads = NULL;
+static guint jd_io_threads_len = 0;
+static guint jd_io_threads_next = 0;
+
+static GThreadPool* jd_workers = NULL;
+
+static guint64 jd_max_operation_size = 0;
+static guint jd_timeout = 0;
+
+static GMutex jd_connections_mutex;
+static GHashTable* jd_connections = NULL;
+
+static void
+jd_connection_free(JdConnection* jd_connection)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	guint64 value;
+
+	g_mutex_lock(jd_statistics_mutex);
+
+	value = j_statistics_get(jd_connection->statistics, J_STATISTICS_FILES_CREATED);
+	j_statistics_add(jd_statistics, J_STATISTICS_FILES_CREATED, value);
+	value = j_statistics_get(jd_connection->statistics, J_STATISTICS_FILES_DELETED);
+	j_statistics_add(jd_statistics, J_STATISTICS_FILES_DELETED, value);
+	value = j_statistics_get(jd_connection->statistics, J_STATISTICS_SYNC);
+	j_statistics_add(jd_statistics, J_STATISTICS_SYNC, value);
+	value = j_statistics_get(jd_connection->statistics, J_STATISTICS_BYTES_READ);
+	j_statistics_add(jd_statistics, J_STATISTICS_BYTES_READ, value);
+	value = j_statistics_get(jd_connection->statistics, J_STATISTICS_BYTES_WRITTEN);
+	j_statistics_add(jd_statistics, J_STATISTICS_BYTES_WRITTEN, value);
+	value = j_statistics_get(jd_connection->statistics, J_STATISTICS_BYTES_RECEIVED);
+	j_statistics_add(jd_statistics, J_STATISTICS_BYTES_RECEIVED, value);
+	value = j_statistics_get(jd_connection->statistics, J_STATISTICS_BYTES_SENT);
+	j_statistics_add(jd_statistics, J_STATISTICS_BYTES_SENT, value);
+
+	g_mutex_unlock(jd_statistics_mutex);
+
+	jd_fabric_remove_connection(jd_connection->connection);
+
+	g_io_stream_close(G_IO_STREAM(jd_connection->connection), NULL, NULL);
+	g_object_unref(jd_connection->connection);
+
+	j_message_unref(jd_connection->message);
+	j_statistics_free(jd_connection->statistics);
+
+	g_slice_free(JdConnection, jd_connection);
+}
+
+/**
+ * Hands a connection back to its I/O thread.
+ *
+ * \param jd_connection A connection.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+static gboolean
+jd_connection_rearm(JdConnection* jd_connection)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	struct epoll_event event;
+
+	event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+	event.data.ptr = jd_connection;
+
+	if (epoll_ctl(jd_connection->io_thread->epoll_fd, EPOLL_CTL_MOD, jd_connection->fd, &event) == -1)
+	{
+		g_warning("Could not rearm connection: %s", g_strerror(errno));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * Removes and frees a connection that has been closed by the client or that cannot be used anymore.
+ *
+ * \param jd_connection A connection.
+ **/
+static void
+jd_connection_close(JdConnection* jd_connection)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	epoll_ctl(jd_connection->io_thread->epoll_fd, EPOLL_CTL_DEL, jd_connection->fd, NULL);
+
+	g_mutex_lock(&jd_connections_mutex);
+	g_hash_table_remove(jd_connections, jd_connection);
+	g_mutex_unlock(&jd_connections_mutex);
+
+	jd_connection_free(jd_connection);
+}
+
+static void
+jd_worker(gpointer data, gpointer user_data)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JdConnection* jd_connection = data;
+
+	(void)user_data;
+
+	jd_handle_message(jd_connection->message, jd_connection->connection, jd_max_operation_size, jd_connection->statistics);
+
+	// Connections that have timed out have been shut down and are closed by the I/O thread.
+	if (!jd_connection_rearm(jd_connection))
+	{
+		jd_connection_close(jd_connection);
+	}
+}
+
+static gpointer
+jd_io_thread(gpointer data)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JdIOThread* io_thread = data;
+
+	struct epoll_event events[64];
+
+	while (TRUE)
+	{
+		gint n;
+
+		n = epoll_wait(io_thread->epoll_fd, events, G_N_ELEMENTS(events), -1);
+
+		if (n < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			g_critical("Could not wait for events: %s", g_strerror(errno));
+			break;
+		}
+
+		for (gint i = 0; i < n; i++)
+		{
+			JdConnection* jd_connection = events[i].data.ptr;
+			gboolean complete;
+
+			// The event file descriptor is used to stop the thread.
+			if (jd_connection == NULL)
+			{
+				return NULL;
+			}
+
+			if (!j_message_receive_nonblocking(jd_connection->message, jd_connection->connection, &complete))
+			{
+				// The connection has been closed by the client.
+				jd_connection_close(jd_connection);
+				continue;
+			}
+
+			if (complete)
+			{
+				g_thread_pool_push(jd_workers, jd_connection, NULL);
+			}
+			else if (!jd_connection_rearm(jd_connection))
+			{
+				jd_connection_close(jd_connection);
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Starts the I/O and worker threads.
+ *
+ * \param io_threads         The number of I/O threads.
+ * \param workers            The maximum number of worker threads.
+ * \param max_operation_size The maximum size of a single operation.
+ * \param timeout            The number of seconds to wait for data from clients, 0 to wait indefinitely.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+jd_dispatch_init(guint io_threads, guint workers, guint64 max_operation_size, guint timeout)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	GError* error = NULL;
+
+	g_return_val_if_fail(io_threads > 0, FALSE);
+	g_return_val_if_fail(workers > 0, FALSE);
+	g_return_val_if_fail(jd_io_threads == NULL, FALSE);
+
+	jd_max_operation_size = max_operation_size;
+	jd_timeout = timeout;
+	jd_connections = g_hash_table_new(NULL, NULL);
+
+	jd_workers = g_thread_pool_new(jd_worker, NULL, workers, FALSE, &error);
+
+	if (jd_workers == NULL)
+	{
+		g_critical("%s", error->message);
+		g_error_free(error);
+
+		return FALSE;
+	}
+
+	// Writes of the workers are performed by separate threads, so that the next data can be received in the meantime.
+	if (!jd_writers_init(workers))
+	{
+		return FALSE;
+	}
+
+	jd_io_threads = g_new(JdIOThread, io_threads);
+	jd_io_threads_len = io_threads;
+
+	for (guint i = 0; i < io_threads; i++)
+	{
+		JdIOThread* io_thread = &(jd_io_threads[i]);
+		struct epoll_event event;
+
+		io_thread->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+		io_thread->event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+		if (io_thread->epoll_fd == -1 || io_thread->event_fd == -1)
+		{
+			g_critical("Could not create I/O thread: %s", g_strerror(errno));
+			return FALSE;
+		}
+
+		event.events = EPOLLIN;
+		event.data.ptr = NULL;
+		epoll_ctl(io_thread->epoll_fd, EPOLL_CTL_ADD, io_thread->event_fd, &event);
+
+		io_thread->thread = g_thread_new("julea-server-io", jd_io_thread, io_thread);
+	}
+
+	return TRUE;
+}
+
+/**
+ * Stops the I/O and worker threads and closes all remaining connections.
+ **/
+void
+jd_dispatch_fini(void)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	GHashTableIter iter;
+	gpointer key;
+
+	g_return_if_fail(jd_io_threads != NULL);
+
+	for (guint i = 0; i < jd_io_threads_len; i++)
+	{
+		guint64 value = 1;
+
+		if (write(jd_io_threads[i].event_fd, &value, sizeof(value)) != sizeof(value))
+		{
+			g_warning("Could not stop I/O thread: %s", g_strerror(errno));
+		}
+
+		g_thread_join(jd_io_threads[i].thread);
+	}
+
+	// Wait for the remaining messages to be handled.
+	g_thread_pool_free(jd_workers, FALSE, TRUE);
+	jd_workers = NULL;
+
+	jd_writers_fini();
+
+	g_hash_table_iter_init(&iter, jd_connections);
+
+	while (g_hash_table_iter_next(&iter, &key, NULL))
+	{
+		jd_connection_free(key);
+	}
+
+	g_hash_table_unref(jd_connections);
+	jd_connections = NULL;
+
+	for (guint i = 0; i < jd_io_threads_len; i++)
+	{
+		close(jd_io_threads[i].event_fd);
+		close(jd_io_threads[i].epoll_fd);
+	}
+
+	g_free(jd_io_threads);
+	jd_io_threads = NULL;
+	jd_io_threads_len = 0;
+}
+
+/**
+ * Adds a new connection.
+ * The connection is assigned to one of the I/O threads in a round-robin fashion.
+ *
+ * \param connection A connection.
+ **/
+void
+jd_dispatch_add_connection(GSocketConnection* connection)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JdConnection* jd_connection;
+	GSocket* socket_;
+	struct epoll_event event;
+	struct timeval timeout;
+	guint index;
+
+	g_return_if_fail(connection != NULL);
+	g_return_if_fail(jd_io_threads != NULL);
+
+	j_helper_set_nodelay(connection, TRUE);
+
+	socket_ = g_socket_connection_get_socket(connection);
+
+	// Applies to additional data sent and received by the workers, both using GIO and directly by backends.
+	g_socket_set_timeout(socket_, jd_timeout);
+
+	timeout.tv_sec = jd_timeout;
+	timeout.tv_usec = 0;
+	setsockopt(g_socket_get_fd(socket_), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(g_socket_get_fd(socket_), SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	index = g_atomic_int_add(&jd_io_threads_next, 1) % jd_io_threads_len;
+
+	jd_connection = g_slice_new(JdConnection);
+	jd_connection->connection = g_object_ref(connection);
+	jd_connection->io_thread = &(jd_io_threads[index]);
+	jd_connection->message = j_message_new(J_MESSAGE_NONE, 0);
+	jd_connection->statistics = j_statistics_new(TRUE);
+	jd_connection->fd = g_socket_get_fd(socket_);
+
+	g_mutex_lock(&jd_connections_mutex);
+	g_hash_table_add(jd_connections, jd_connection);
+	g_mutex_unlock(&jd_connections_mutex);
+
+	event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+	event.data.ptr = jd_connection;
+
+	if (epoll_ctl(jd_connection->io_thread->epoll_fd, EPOLL_CTL_ADD, jd_connection->fd, &event) == -1)
+	{
+		g_warning("Could not add connection: %s", g_strerror(errno));
+
+		g_mutex_lock(&jd_connections_mutex);
+		g_hash_table_remove(jd_connections, jd_connection);
+		g_mutex_unlock(&jd_connections_mutex);
+
+		jd_connection_free(jd_connection);
+	}
+}
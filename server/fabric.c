@@ -0,0 +1,307 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2020 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <julea.h>
+
+#include "server.h"
+
+/**
+ * Fabric connections are established on request of a client that is already connected using a socket.
+ * The server hands out a token together with its fabric address.
+ * The client sends the token when connecting, which allows matching the fabric connection to the socket connection.
+ * Connection requests are handled by a separate thread.
+ * After the fabric connection has been established, the client confirms it using the socket connection.
+ * Only then the fabric connection is attached to the socket connection and used for all following object messages.
+ **/
+
+struct JdFabricRequest
+{
+	GSocketConnection* connection;
+	JFabricConnection* fabric_connection;
+};
+
+typedef struct JdFabricRequest JdFabricRequest;
+
+static JFabric* jd_fabric = NULL;
+static GThread* jd_fabric_thread = NULL;
+
+static GMutex jd_fabric_mutex;
+static GHashTable* jd_fabric_requests = NULL;
+static guint64 jd_fabric_token = 0;
+
+static void
+jd_fabric_request_free(JdFabricRequest* request)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	if (request->fabric_connection != NULL)
+	{
+		j_fabric_connection_free(request->fabric_connection);
+	}
+
+	g_object_unref(request->connection);
+	g_slice_free(JdFabricRequest, request);
+}
+
+static gpointer
+jd_fabric_thread_func(gpointer data)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	(void)data;
+
+	while (TRUE)
+	{
+		JdFabricRequest* request;
+		JFabricConnection* fabric_connection;
+		guint64 token;
+
+		fabric_connection = j_fabric_wait_request(jd_fabric, &token);
+
+		if (fabric_connection == NULL)
+		{
+			break;
+		}
+
+		g_mutex_lock(&jd_fabric_mutex);
+
+		request = g_hash_table_lookup(jd_fabric_requests, &token);
+
+		if (request != NULL && request->fabric_connection == NULL)
+		{
+			if (j_fabric_connection_accept(fabric_connection))
+			{
+				request->fabric_connection = fabric_connection;
+				fabric_connection = NULL;
+			}
+		}
+		else
+		{
+			g_debug("Ignoring fabric connection with unknown token.");
+		}
+
+		g_mutex_unlock(&jd_fabric_mutex);
+
+		if (fabric_connection != NULL)
+		{
+			j_fabric_connection_free(fabric_connection);
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Starts listening for fabric connections.
+ *
+ * \param provider The libfabric provider.
+ * \param host     The host to listen on.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+jd_fabric_init(gchar const* provider, gchar const* host)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(jd_fabric == NULL, FALSE);
+
+	jd_fabric = j_fabric_new(provider, host);
+
+	if (jd_fabric == NULL)
+	{
+		return FALSE;
+	}
+
+	jd_fabric_requests = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, (GDestroyNotify)jd_fabric_request_free);
+	jd_fabric_thread = g_thread_new("julea-server-fabric", jd_fabric_thread_func, NULL);
+
+	return TRUE;
+}
+
+/**
+ * Stops listening for fabric connections.
+ * All socket connections have to be closed before.
+ **/
+void
+jd_fabric_fini(void)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	if (jd_fabric == NULL)
+	{
+		return;
+	}
+
+	j_fabric_interrupt(jd_fabric);
+	g_thread_join(jd_fabric_thread);
+	jd_fabric_thread = NULL;
+
+	g_hash_table_unref(jd_fabric_requests);
+	jd_fabric_requests = NULL;
+
+	j_fabric_free(jd_fabric);
+	jd_fabric = NULL;
+}
+
+/**
+ * Returns whether the server offers fabric connections.
+ * Clients only request a fabric connection if the server has announced it.
+ *
+ * \return TRUE if a fabric is used, FALSE otherwise.
+ **/
+gboolean
+jd_fabric_is_available(void)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	return (jd_fabric != NULL);
+}
+
+/**
+ * Handles a fabric message.
+ * A message without operations requests a new fabric connection, the reply contains the fabric address and a token.
+ * A message with a single operation containing the token confirms the connection, the reply contains whether it has been attached.
+ * If the server does not use a fabric, the reply does not contain any operations.
+ *
+ * \param message    A message.
+ * \param connection The connection the message has been received on.
+ * \param reply      A reply.
+ **/
+void
+jd_fabric_handle_message(JMessage* message, GSocketConnection* connection, JMessage* reply)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_if_fail(message != NULL);
+	g_return_if_fail(connection != NULL);
+	g_return_if_fail(reply != NULL);
+
+	if (jd_fabric == NULL)
+	{
+		return;
+	}
+
+	if (j_message_get_count(message) == 0)
+	{
+		JdFabricRequest* request;
+		g_autofree gpointer address = NULL;
+		guint64* token;
+		guint32 format;
+		guint32 address_length;
+		gsize length;
+
+		if (!j_fabric_get_address(jd_fabric, &format, &address, &length))
+		{
+			return;
+		}
+
+		request = g_slice_new(JdFabricRequest);
+		request->connection = g_object_ref(connection);
+		request->fabric_connection = NULL;
+
+		token = g_new(guint64, 1);
+
+		g_mutex_lock(&jd_fabric_mutex);
+		*token = ++jd_fabric_token;
+		g_hash_table_insert(jd_fabric_requests, token, request);
+		g_mutex_unlock(&jd_fabric_mutex);
+
+		address_length = length;
+
+		j_message_add_operation(reply, sizeof(guint32) + sizeof(guint32) + length + sizeof(guint64));
+		j_message_append_4(reply, &format);
+		j_message_append_4(reply, &address_length);
+		j_message_append_n(reply, address, length);
+		j_message_append_8(reply, token);
+	}
+	else
+	{
+		JdFabricRequest* request;
+		JFabricConnection* fabric_connection = NULL;
+		guint64 token;
+		gchar attached = FALSE;
+
+		token = j_message_get_8(message);
+
+		g_mutex_lock(&jd_fabric_mutex);
+
+		request = g_hash_table_lookup(jd_fabric_requests, &token);
+
+		if (request != NULL && request->connection == connection)
+		{
+			fabric_connection = request->fabric_connection;
+			request->fabric_connection = NULL;
+
+			g_hash_table_remove(jd_fabric_requests, &token);
+		}
+
+		g_mutex_unlock(&jd_fabric_mutex);
+
+		if (fabric_connection != NULL)
+		{
+			if (j_fabric_connection_wait(fabric_connection))
+			{
+				j_fabric_connection_set(connection, fabric_connection);
+				attached = TRUE;
+			}
+			else
+			{
+				j_fabric_connection_free(fabric_connection);
+			}
+		}
+
+		j_message_add_operation(reply, sizeof(gchar));
+		j_message_append_1(reply, &attached);
+	}
+}
+
+static gboolean
+jd_fabric_match_connection(gpointer key, gpointer value, gpointer user_data)
+{
+	JdFabricRequest* request = value;
+
+	(void)key;
+
+	return (request->connection == user_data);
+}
+
+/**
+ * Forgets all outstanding requests of a connection.
+ *
+ * \param connection A connection.
+ **/
+void
+jd_fabric_remove_connection(GSocketConnection* connection)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	if (jd_fabric == NULL)
+	{
+		return;
+	}
+
+	g_mutex_lock(&jd_fabric_mutex);
+	g_hash_table_foreach_remove(jd_fabric_requests, jd_fabric_match_connection, connection);
+	g_mutex_unlock(&jd_fabric_mutex);
+}
@@ -28,8 +28,540 @@
 
 static guint jd_thread_num = 0;
 
+/**
+ * Shuts down a connection whose additional data could not be received or sent completely, for instance, because the client has timed out.
+ * The connection is out of sync and will be closed once it is handed back to its I/O thread.
+ **/
+static void
+jd_connection_shutdown(GSocketConnection* connection)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_socket_shutdown(g_socket_connection_get_socket(connection), TRUE, TRUE, NULL);
+}
+
+/**
+ * Skips additional data.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+static gboolean
+jd_skip(GInputStream* input, guint64 length)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	while (length > 0)
+	{
+		gssize nbytes;
+
+		nbytes = g_input_stream_skip(input, MIN(length, G_MAXSSIZE), NULL, NULL);
+
+		if (nbytes <= 0)
+		{
+			return FALSE;
+		}
+
+		length -= nbytes;
+	}
+
+	return TRUE;
+}
+
+/**
+ * Replies to an object read by sending the data directly from the backend to the connection.
+ * The amount of data has to be determined in advance because the reply is sent before the data.
+ * If the client stops receiving, the connection is shut down once the timeout expires.
+ **/
+static void
+jd_object_read_send(JMessage* message, JMessage* reply, GSocketConnection* connection, gpointer object, guint32 operation_count, JStatistics* statistics)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	static gchar const zeros[4096] = { 0 };
+
+	g_autofree guint64* ranges = NULL;
+	GOutputStream* output;
+	gint64 modification_time = 0;
+	guint64 size = 0;
+	gchar const last = TRUE;
+	gint fd;
+
+	ranges = g_new(guint64, 2 * operation_count);
+
+	// FIXME return value
+	j_backend_object_status(jd_object_backend, object, &modification_time, &size);
+
+	for (guint i = 0; i < operation_count; i++)
+	{
+		guint64 length;
+		guint64 offset;
+		guint64 bytes_read = 0;
+
+		length = j_message_get_8(message);
+		offset = j_message_get_8(message);
+
+		if (offset < size)
+		{
+			bytes_read = MIN(length, size - offset);
+		}
+
+		ranges[2 * i] = bytes_read;
+		ranges[2 * i + 1] = offset;
+
+		// Each operation is answered by a single fragment.
+		j_message_add_operation(reply, sizeof(guint64) + sizeof(gchar));
+		j_message_append_8(reply, &bytes_read);
+		j_message_append_1(reply, &last);
+
+		// The data is sent directly from the backend after the reply.
+		j_message_add_send_length(reply, bytes_read);
+	}
+
+	if (!j_message_send(reply, connection))
+	{
+		jd_connection_shutdown(connection);
+		return;
+	}
+
+	fd = g_socket_get_fd(g_socket_connection_get_socket(connection));
+	output = g_io_stream_get_output_stream(G_IO_STREAM(connection));
+
+	for (guint i = 0; i < operation_count; i++)
+	{
+		guint64 bytes_sent = 0;
+
+		if (ranges[2 * i] == 0)
+		{
+			continue;
+		}
+
+		j_backend_object_send(jd_object_backend, object, fd, ranges[2 * i], ranges[2 * i + 1], &bytes_sent);
+		j_statistics_add(statistics, J_STATISTICS_BYTES_READ, bytes_sent);
+		j_statistics_add(statistics, J_STATISTICS_BYTES_SENT, bytes_sent);
+
+		// The object has been truncated in the meantime, pad the data to keep the stream consistent.
+		while (bytes_sent < ranges[2 * i])
+		{
+			gsize nbytes;
+
+			nbytes = MIN(sizeof(zeros), ranges[2 * i] - bytes_sent);
+
+			if (!g_output_stream_write_all(output, zeros, nbytes, NULL, NULL, NULL))
+			{
+				// The remaining data cannot be sent, so the client would wait for it forever.
+				jd_connection_shutdown(connection);
+				return;
+			}
+
+			bytes_sent += nbytes;
+		}
+	}
+}
+
+/**
+ * Replies to an object write by receiving the data directly from the connection into the backend.
+ **/
+static void
+jd_object_write_receive(JMessage* message, JMessage* reply, GSocketConnection* connection, gpointer object, guint32 operation_count, JStatistics* statistics)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gint fd;
+
+	fd = g_socket_get_fd(g_socket_connection_get_socket(connection));
+
+	for (guint i = 0; i < operation_count; i++)
+	{
+		guint64 length;
+		guint64 offset;
+		guint64 bytes_written = 0;
+
+		length = j_message_get_8(message);
+		offset = j_message_get_8(message);
+
+		// The backend consumes all data, even if writing fails.
+		j_backend_object_receive(jd_object_backend, object, fd, length, offset, &bytes_written);
+		j_statistics_add(statistics, J_STATISTICS_BYTES_RECEIVED, length);
+		j_statistics_add(statistics, J_STATISTICS_BYTES_WRITTEN, bytes_written);
+
+		if (reply != NULL)
+		{
+			j_message_add_operation(reply, sizeof(guint64));
+			j_message_append_8(reply, &bytes_written);
+		}
+	}
+}
+
+/**
+ * Replies to an object read by writing the data directly into the client's memory.
+ * The reply only contains the number of bytes read, which the client has to wait for before using its memory.
+ **/
+static void
+jd_object_read_fabric(JMessage* message, JMessage* reply, JFabricConnection* fabric_connection, gpointer object, guint32 operation_count, guint64 max_operation_size, JStatistics* statistics)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gchar const last = TRUE;
+
+	for (guint i = 0; i < operation_count; i++)
+	{
+		guint64 length;
+		guint64 offset;
+		guint64 address;
+		guint64 key;
+		guint64 bytes_total = 0;
+
+		length = j_message_get_8(message);
+		offset = j_message_get_8(message);
+		address = j_message_get_8(message);
+		key = j_message_get_8(message);
+
+		while (length > 0)
+		{
+			JdBuffer* buffer;
+			JFabricMemory* memory;
+			guint64 fragment_length;
+			guint64 bytes_read = 0;
+
+			fragment_length = MIN(length, max_operation_size);
+
+			// No other buffers are held, so waiting is safe.
+			buffer = jd_buffer_pool_get(fragment_length);
+
+			if (buffer == NULL)
+			{
+				break;
+			}
+
+			memory = jd_buffer_pool_register(buffer, fabric_connection);
+
+			if (memory != NULL)
+			{
+				j_backend_object_read(jd_object_backend, object, buffer->data, fragment_length, offset, &bytes_read);
+				j_statistics_add(statistics, J_STATISTICS_BYTES_READ, bytes_read);
+
+				if (bytes_read > 0 && !j_fabric_connection_write(fabric_connection, memory, bytes_read, address + bytes_total, key))
+				{
+					bytes_read = 0;
+					memory = NULL;
+				}
+			}
+
+			jd_buffer_pool_put(buffer);
+
+			j_statistics_add(statistics, J_STATISTICS_BYTES_SENT, bytes_read);
+
+			bytes_total += bytes_read;
+			length -= bytes_read;
+			offset += bytes_read;
+
+			// A short read means that the end of the object has been reached.
+			if (memory == NULL || bytes_read < fragment_length)
+			{
+				break;
+			}
+		}
+
+		// Each operation is answered by a single fragment without any data.
+		j_message_add_operation(reply, sizeof(guint64) + sizeof(gchar));
+		j_message_append_8(reply, &bytes_total);
+		j_message_append_1(reply, &last);
+	}
+}
+
+/**
+ * Replies to an object write by reading the data directly from the client's memory.
+ * The client always waits for the reply because it must not reuse its memory before.
+ **/
+static void
+jd_object_write_fabric(JMessage* message, JMessage* reply, JFabricConnection* fabric_connection, gpointer object, guint32 operation_count, guint64 max_operation_size, JStatistics* statistics)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	for (guint i = 0; i < operation_count; i++)
+	{
+		guint64 length;
+		guint64 offset;
+		guint64 address;
+		guint64 key;
+		guint64 bytes_total = 0;
+
+		length = j_message_get_8(message);
+		offset = j_message_get_8(message);
+		address = j_message_get_8(message);
+		key = j_message_get_8(message);
+
+		while (bytes_total < length)
+		{
+			JdBuffer* buffer;
+			JFabricMemory* memory;
+			guint64 fragment_length;
+			guint64 bytes_written = 0;
+
+			fragment_length = MIN(length - bytes_total, max_operation_size);
+
+			// No other buffers are held, so waiting is safe.
+			buffer = jd_buffer_pool_get(fragment_length);
+
+			if (buffer == NULL)
+			{
+				break;
+			}
+
+			memory = jd_buffer_pool_register(buffer, fabric_connection);
+
+			if (memory != NULL && j_fabric_connection_read(fabric_connection, memory, fragment_length, address + bytes_total, key))
+			{
+				j_statistics_add(statistics, J_STATISTICS_BYTES_RECEIVED, fragment_length);
+
+				j_backend_object_write(jd_object_backend, object, buffer->data, fragment_length, offset + bytes_total, &bytes_written);
+				j_statistics_add(statistics, J_STATISTICS_BYTES_WRITTEN, bytes_written);
+			}
+
+			jd_buffer_pool_put(buffer);
+
+			bytes_total += bytes_written;
+
+			if (bytes_written < fragment_length)
+			{
+				break;
+			}
+		}
+
+		j_message_add_operation(reply, sizeof(guint64));
+		j_message_append_8(reply, &bytes_total);
+	}
+}
+
+/**
+ * A write that is performed by one of the writer threads.
+ **/
+struct JdWrite
+{
+	gpointer object;
+	JdBuffer* buffer;
+	guint64 length;
+	guint64 offset;
+	guint64 bytes_written;
+
+	gboolean done;
+	GMutex mutex;
+	GCond cond;
+};
+
+typedef struct JdWrite JdWrite;
+
+static void
+jd_write_func(gpointer data, gpointer user_data)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JdWrite* jd_write = data;
+
+	(void)user_data;
+
+	j_backend_object_write(jd_object_backend, jd_write->object, jd_write->buffer->data, jd_write->length, jd_write->offset, &(jd_write->bytes_written));
+
+	g_mutex_lock(&(jd_write->mutex));
+	jd_write->done = TRUE;
+	g_cond_signal(&(jd_write->cond));
+	g_mutex_unlock(&(jd_write->mutex));
+}
+
+static GThreadPool* jd_writers = NULL;
+
+/**
+ * Starts the writer threads.
+ * Every worker has at most one write in flight, so one writer per worker is enough for writes never to wait for a thread.
+ *
+ * \param workers The maximum number of worker threads.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+jd_writers_init(guint workers)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	GError* error = NULL;
+
+	g_return_val_if_fail(workers > 0, FALSE);
+	g_return_val_if_fail(jd_writers == NULL, FALSE);
+
+	jd_writers = g_thread_pool_new(jd_write_func, NULL, workers, FALSE, &error);
+
+	if (jd_writers == NULL)
+	{
+		g_critical("%s", error->message);
+		g_error_free(error);
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * Stops the writer threads.
+ * All workers have to be stopped already.
+ **/
+void
+jd_writers_fini(void)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_if_fail(jd_writers != NULL);
+
+	g_thread_pool_free(jd_writers, FALSE, TRUE);
+	jd_writers = NULL;
+}
+
+static void
+jd_write_start(JdWrite* jd_write, gpointer object, JdBuffer* buffer, guint64 length, guint64 offset)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	jd_write->object = object;
+	jd_write->buffer = buffer;
+	jd_write->length = length;
+	jd_write->offset = offset;
+	jd_write->bytes_written = 0;
+	jd_write->done = FALSE;
+
+	g_thread_pool_push(jd_writers, jd_write, NULL);
+}
+
+/**
+ * Waits for a write to finish, adds its result to the reply and returns its buffer to the pool.
+ **/
+static void
+jd_write_finish(JdWrite* jd_write, JMessage* reply, JStatistics* statistics)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_mutex_lock(&(jd_write->mutex));
+
+	while (!jd_write->done)
+	{
+		g_cond_wait(&(jd_write->cond), &(jd_write->mutex));
+	}
+
+	g_mutex_unlock(&(jd_write->mutex));
+
+	jd_buffer_pool_put(jd_write->buffer);
+	jd_write->buffer = NULL;
+
+	j_statistics_add(statistics, J_STATISTICS_BYTES_WRITTEN, jd_write->bytes_written);
+
+	if (reply != NULL)
+	{
+		j_message_add_operation(reply, sizeof(guint64));
+		j_message_append_8(reply, &(jd_write->bytes_written));
+	}
+}
+
+/**
+ * Replies to an object write by receiving the data into buffers from the buffer pool.
+ * The next block is received while the previous one is being written by a writer thread.
+ **/
+static void
+jd_object_write_overlap(JMessage* message, JMessage* reply, GSocketConnection* connection, gpointer object, guint32 operation_count, guint64 max_operation_size, JStatistics* statistics)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	GInputStream* input;
+	JdWrite jd_write;
+	gboolean pending = FALSE;
+
+	input = g_io_stream_get_input_stream(G_IO_STREAM(connection));
+
+	g_mutex_init(&(jd_write.mutex));
+	g_cond_init(&(jd_write.cond));
+
+	for (guint i = 0; i <= operation_count; i++)
+	{
+		JdBuffer* buffer = NULL;
+		guint64 length = 0;
+		guint64 offset = 0;
+
+		if (i < operation_count)
+		{
+			length = j_message_get_8(message);
+			offset = j_message_get_8(message);
+
+			if (length <= max_operation_size)
+			{
+				// Only wait for a buffer if the pending write's buffer has been returned.
+				buffer = (pending) ? jd_buffer_pool_try_get(length) : jd_buffer_pool_get(length);
+
+				if (buffer == NULL && pending)
+				{
+					pending = FALSE;
+					jd_write_finish(&jd_write, reply, statistics);
+
+					buffer = jd_buffer_pool_get(length);
+				}
+			}
+
+			if (buffer != NULL)
+			{
+				gsize bytes_read = 0;
+
+				if (!g_input_stream_read_all(input, buffer->data, length, &bytes_read, NULL, NULL) || bytes_read != length)
+				{
+					jd_buffer_pool_put(buffer);
+					buffer = NULL;
+
+					jd_connection_shutdown(connection);
+				}
+			}
+			else
+			{
+				// Skip the data to keep the connection usable.
+				if (!jd_skip(input, length))
+				{
+					jd_connection_shutdown(connection);
+				}
+			}
+
+			j_statistics_add(statistics, J_STATISTICS_BYTES_RECEIVED, length);
+		}
+
+		if (pending)
+		{
+			pending = FALSE;
+			jd_write_finish(&jd_write, reply, statistics);
+		}
+
+		if (i == operation_count)
+		{
+			break;
+		}
+
+		if (buffer == NULL)
+		{
+			guint64 bytes_written = 0;
+
+			// FIXME return proper error
+			if (reply != NULL)
+			{
+				j_message_add_operation(reply, sizeof(guint64));
+				j_message_append_8(reply, &bytes_written);
+			}
+
+			continue;
+		}
+
+		jd_write_start(&jd_write, object, buffer, length, offset);
+		pending = TRUE;
+	}
+
+	g_cond_clear(&(jd_write.cond));
+	g_mutex_clear(&(jd_write.mutex));
+}
+
 gboolean
-jd_handle_message(JMessage* message, GSocketConnection* connection, JMemoryChunk* memory_chunk, guint64 memory_chunk_size, JStatistics* statistics)
+jd_handle_message(JMessage* message, GSocketConnection* connection, guint64 max_operation_size, JStatistics* statistics)
 {
 	J_TRACE_FUNCTION(NULL);
 
@@ -129,7 +661,10 @@ jd_handle_message(JMessage* message, GSocketConnection* connection, JMemoryChunk
 		case J_MESSAGE_OBJECT_READ:
 		{
 			JMessage* reply;
+			JFabricConnection* fabric_connection;
+			GPtrArray* buffers;
 			gpointer object;
+			guint64 reply_size = 0;
 
 			namespace = j_message_get_string(message);
 			path = j_message_get_string(message);
@@ -139,50 +674,105 @@ jd_handle_message(JMessage* message, GSocketConnection* connection, JMemoryChunk
 			// FIXME return value
 			j_backend_object_open(jd_object_backend, namespace, path, &object);
 
+			// Clients that use a fabric connection describe their memory instead of expecting the data on the socket.
+			fabric_connection = j_fabric_connection_get(connection);
+
+			if (fabric_connection != NULL)
+			{
+				jd_object_read_fabric(message, reply, fabric_connection, object, operation_count, max_operation_size, statistics);
+
+				j_backend_object_close(jd_object_backend, object);
+
+				j_message_send(reply, connection);
+				j_message_unref(reply);
+
+				break;
+			}
+
+			if (j_backend_object_supports_send(jd_object_backend))
+			{
+				jd_object_read_send(message, reply, connection, object, operation_count, statistics);
+
+				j_backend_object_close(jd_object_backend, object);
+				j_message_unref(reply);
+
+				break;
+			}
+
+			buffers = g_ptr_array_new_with_free_func((GDestroyNotify)jd_buffer_pool_put);
+
+			/**
+			 * Replies are streamed as a sequence of fragments, using at most max_operation_size bytes of buffers at a time.
+			 * Each fragment contains the number of bytes and whether it is the operation's last fragment.
+			 * Operations larger than max_operation_size are split into multiple fragments.
+			 */
 			for (i = 0; i < operation_count; i++)
 			{
-				gchar* buf;
 				guint64 length;
 				guint64 offset;
-				guint64 bytes_read = 0;
+				gchar last = FALSE;
 
 				length = j_message_get_8(message);
 				offset = j_message_get_8(message);
 
-				if (length > memory_chunk_size)
+				while (!last)
 				{
-					// FIXME return proper error
-					j_message_add_operation(reply, sizeof(guint64));
-					j_message_append_8(reply, &bytes_read);
-					continue;
-				}
+					JdBuffer* buffer = NULL;
+					guint64 fragment_length;
+					guint64 bytes_read = 0;
 
-				buf = j_memory_chunk_get(memory_chunk, length);
+					fragment_length = MIN(length, max_operation_size);
 
-				if (buf == NULL)
-				{
-					// FIXME ugly
-					j_message_send(reply, connection);
-					j_message_unref(reply);
+					if (buffers->len > 0)
+					{
+						if (reply_size + fragment_length <= max_operation_size)
+						{
+							buffer = jd_buffer_pool_try_get(fragment_length);
+						}
 
-					reply = j_message_new_reply(message);
+						if (buffer == NULL)
+						{
+							// Send the fragments collected so far and return their buffers before waiting for a new one.
+							j_message_send(reply, connection);
+							j_message_unref(reply);
+							g_ptr_array_set_size(buffers, 0);
 
-					j_memory_chunk_reset(memory_chunk);
-					buf = j_memory_chunk_get(memory_chunk, length);
-				}
+							reply = j_message_new_reply(message);
+							reply_size = 0;
+						}
+					}
 
-				j_backend_object_read(jd_object_backend, object, buf, length, offset, &bytes_read);
-				j_statistics_add(statistics, J_STATISTICS_BYTES_READ, bytes_read);
+					if (buffer == NULL)
+					{
+						buffer = jd_buffer_pool_get(fragment_length);
+					}
 
-				j_message_add_operation(reply, sizeof(guint64));
-				j_message_append_8(reply, &bytes_read);
+					if (buffer != NULL)
+					{
+						j_backend_object_read(jd_object_backend, object, buffer->data, fragment_length, offset, &bytes_read);
+						j_statistics_add(statistics, J_STATISTICS_BYTES_READ, bytes_read);
 
-				if (bytes_read > 0)
-				{
-					j_message_add_send(reply, buf, bytes_read);
-				}
+						g_ptr_array_add(buffers, buffer);
+						reply_size += fragment_length;
+					}
+
+					length -= bytes_read;
+					offset += bytes_read;
+
+					// A short read means that the end of the object has been reached.
+					last = (buffer == NULL || length == 0 || bytes_read < fragment_length);
 
-				j_statistics_add(statistics, J_STATISTICS_BYTES_SENT, bytes_read);
+					j_message_add_operation(reply, sizeof(guint64) + sizeof(gchar));
+					j_message_append_8(reply, &bytes_read);
+					j_message_append_1(reply, &last);
+
+					if (bytes_read > 0)
+					{
+						j_message_add_send(reply, buffer->data, bytes_read);
+					}
+
+					j_statistics_add(statistics, J_STATISTICS_BYTES_SENT, bytes_read);
+				}
 			}
 
 			j_backend_object_close(jd_object_backend, object);
@@ -190,15 +780,18 @@ jd_handle_message(JMessage* message, GSocketConnection* connection, JMemoryChunk
 			j_message_send(reply, connection);
 			j_message_unref(reply);
 
-			j_memory_chunk_reset(memory_chunk);
+			g_ptr_array_unref(buffers);
 		}
 		break;
 		case J_MESSAGE_OBJECT_WRITE:
 		{
 			g_autoptr(JMessage) reply = NULL;
+			JFabricConnection* fabric_connection;
 			gpointer object;
 
-			if (safety == J_SEMANTICS_SAFETY_NETWORK || safety == J_SEMANTICS_SAFETY_STORAGE)
+			fabric_connection = j_fabric_connection_get(connection);
+
+			if (safety == J_SEMANTICS_SAFETY_NETWORK || safety == J_SEMANTICS_SAFETY_STORAGE || fabric_connection != NULL)
 			{
 				reply = j_message_new_reply(message);
 			}
@@ -209,43 +802,17 @@ jd_handle_message(JMessage* message, GSocketConnection* connection, JMemoryChunk
 			// FIXME return value
 			j_backend_object_open(jd_object_backend, namespace, path, &object);
 
-			for (i = 0; i < operation_count; i++)
+			if (fabric_connection != NULL)
 			{
-				GInputStream* input;
-				gchar* buf;
-				guint64 length;
-				guint64 offset;
-				guint64 bytes_written = 0;
-
-				length = j_message_get_8(message);
-				offset = j_message_get_8(message);
-
-				if (length > memory_chunk_size)
-				{
-					// FIXME return proper error
-					j_message_add_operation(reply, sizeof(guint64));
-					j_message_append_8(reply, &bytes_written);
-					continue;
-				}
-
-				// Guaranteed to work because memory_chunk is reset below
-				buf = j_memory_chunk_get(memory_chunk, length);
-				g_assert(buf != NULL);
-
-				input = g_io_stream_get_input_stream(G_IO_STREAM(connection));
-				g_input_stream_read_all(input, buf, length, NULL, NULL, NULL);
-				j_statistics_add(statistics, J_STATISTICS_BYTES_RECEIVED, length);
-
-				j_backend_object_write(jd_object_backend, object, buf, length, offset, &bytes_written);
-				j_statistics_add(statistics, J_STATISTICS_BYTES_WRITTEN, bytes_written);
-
-				if (reply != NULL)
-				{
-					j_message_add_operation(reply, sizeof(guint64));
-					j_message_append_8(reply, &bytes_written);
-				}
-
-				j_memory_chunk_reset(memory_chunk);
+				jd_object_write_fabric(message, reply, fabric_connection, object, operation_count, max_operation_size, statistics);
+			}
+			else if (j_backend_object_supports_receive(jd_object_backend))
+			{
+				jd_object_write_receive(message, reply, connection, object, operation_count, statistics);
+			}
+			else
+			{
+				jd_object_write_overlap(message, reply, connection, object, operation_count, max_operation_size, statistics);
 			}
 
 			if (safety == J_SEMANTICS_SAFETY_STORAGE)
@@ -260,8 +827,6 @@ jd_handle_message(JMessage* message, GSocketConnection* connection, JMemoryChunk
 			{
 				j_message_send(reply, connection);
 			}
-
-			j_memory_chunk_reset(memory_chunk);
 		}
 		break;
 		case J_MESSAGE_OBJECT_STATUS:
@@ -366,6 +931,22 @@ jd_handle_message(JMessage* message, GSocketConnection* connection, JMemoryChunk
 				j_message_append_string(reply, "kv");
 			}
 
+			// Older clients ignore unknown entries, newer ones only request a fabric connection if it is announced.
+			if (jd_fabric_is_available())
+			{
+				j_message_add_operation(reply, 7);
+				j_message_append_string(reply, "fabric");
+			}
+
+			j_message_send(reply, connection);
+		}
+		break;
+		case J_MESSAGE_FABRIC:
+		{
+			g_autoptr(JMessage) reply = NULL;
+
+			reply = j_message_new_reply(message);
+			jd_fabric_handle_message(message, connection, reply);
 			j_message_send(reply, connection);
 		}
 		break;
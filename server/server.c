@@ -50,57 +50,15 @@ jd_signal(gpointer data)
 }
 
 static gboolean
-jd_on_run(GThreadedSocketService* service, GSocketConnection* connection, GObject* source_object, gpointer user_data)
+jd_on_incoming(GSocketService* service, GSocketConnection* connection, GObject* source_object, gpointer user_data)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	JMemoryChunk* memory_chunk;
-	g_autoptr(JMessage) message = NULL;
-	JStatistics* statistics;
-	guint64 memory_chunk_size;
-
 	(void)service;
 	(void)source_object;
 	(void)user_data;
 
-	j_helper_set_nodelay(connection, TRUE);
-
-	statistics = j_statistics_new(TRUE);
-	memory_chunk_size = j_configuration_get_max_operation_size(jd_configuration);
-	memory_chunk = j_memory_chunk_new(memory_chunk_size);
-
-	message = j_message_new(J_MESSAGE_NONE, 0);
-
-	while (j_message_receive(message, connection))
-	{
-		jd_handle_message(message, connection, memory_chunk, memory_chunk_size, statistics);
-	}
-
-	{
-		guint64 value;
-
-		g_mutex_lock(jd_statistics_mutex);
-
-		value = j_statistics_get(statistics, J_STATISTICS_FILES_CREATED);
-		j_statistics_add(jd_statistics, J_STATISTICS_FILES_CREATED, value);
-		value = j_statistics_get(statistics, J_STATISTICS_FILES_DELETED);
-		j_statistics_add(jd_statistics, J_STATISTICS_FILES_DELETED, value);
-		value = j_statistics_get(statistics, J_STATISTICS_SYNC);
-		j_statistics_add(jd_statistics, J_STATISTICS_SYNC, value);
-		value = j_statistics_get(statistics, J_STATISTICS_BYTES_READ);
-		j_statistics_add(jd_statistics, J_STATISTICS_BYTES_READ, value);
-		value = j_statistics_get(statistics, J_STATISTICS_BYTES_WRITTEN);
-		j_statistics_add(jd_statistics, J_STATISTICS_BYTES_WRITTEN, value);
-		value = j_statistics_get(statistics, J_STATISTICS_BYTES_RECEIVED);
-		j_statistics_add(jd_statistics, J_STATISTICS_BYTES_RECEIVED, value);
-		value = j_statistics_get(statistics, J_STATISTICS_BYTES_SENT);
-		j_statistics_add(jd_statistics, J_STATISTICS_BYTES_SENT, value);
-
-		g_mutex_unlock(jd_statistics_mutex);
-	}
-
-	j_memory_chunk_free(memory_chunk);
-	j_statistics_free(statistics);
+	jd_dispatch_add_connection(connection);
 
 	return TRUE;
 }
@@ -189,6 +147,48 @@ jd_is_server_for_backend(gchar const* host, gint port, JBackendType backend_type
 	return FALSE;
 }
 
+/**
+ * Listens on a local socket in addition to TCP.
+ *
+ * \param socket_service A socket service.
+ * \param path           The socket's path.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+static gboolean
+jd_listen_local(GSocketService* socket_service, gchar const* path)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_autoptr(GSocketAddress) address = NULL;
+	GError* error = NULL;
+
+	address = j_helper_local_socket_address_new(path);
+
+	if (address == NULL)
+	{
+		g_warning("Local socket path %s is too long.", path);
+		return FALSE;
+	}
+
+	// A previous server might not have been shut down properly.
+	// We already own the TCP port, so no other server can be using the socket.
+	g_unlink(path);
+
+	if (!g_socket_listener_add_address(G_SOCKET_LISTENER(socket_service), address, G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_DEFAULT, NULL, NULL, &error))
+	{
+		g_warning("%s", error->message);
+		g_error_free(error);
+
+		return FALSE;
+	}
+
+	// Clients usually run as other users than the server.
+	g_chmod(path, 0666);
+
+	return TRUE;
+}
+
 int
 main(int argc, char** argv)
 {
@@ -197,6 +197,11 @@ main(int argc, char** argv)
 	gboolean opt_daemon = FALSE;
 	g_autofree gchar* opt_host = NULL;
 	gint opt_port = 4711;
+	gint opt_io_threads = 1;
+	gint opt_workers = 0;
+	gint opt_timeout = 60;
+	gint opt_memory_limit = 0;
+	gboolean opt_hugepages = FALSE;
 
 	JTrace* trace;
 	GError* error = NULL;
@@ -216,12 +221,18 @@ main(int argc, char** argv)
 	gchar const* db_component;
 	g_autofree gchar* db_path = NULL;
 	g_autofree gchar* port_str = NULL;
+	g_autofree gchar* local_socket_path = NULL;
 	guint listen_retries = 0;
 
 	GOptionEntry entries[] = {
 		{ "daemon", 0, 0, G_OPTION_ARG_NONE, &opt_daemon, "Run as daemon", NULL },
 		{ "host", 0, 0, G_OPTION_ARG_STRING, &opt_host, "Override host name", "hostname" },
 		{ "port", 0, 0, G_OPTION_ARG_INT, &opt_port, "Port to use", "4711" },
+		{ "io-threads", 0, 0, G_OPTION_ARG_INT, &opt_io_threads, "Number of I/O threads", "1" },
+		{ "workers", 0, 0, G_OPTION_ARG_INT, &opt_workers, "Number of worker threads (default: number of processors)", "0" },
+		{ "timeout", 0, 0, G_OPTION_ARG_INT, &opt_timeout, "Seconds to wait for data from clients before closing their connections (0: wait indefinitely)", "60" },
+		{ "memory-limit", 0, 0, G_OPTION_ARG_INT, &opt_memory_limit, "Maximum amount of buffer memory in MiB (default: unlimited)", "0" },
+		{ "hugepages", 0, 0, G_OPTION_ARG_NONE, &opt_hugepages, "Use huge pages for large buffers", NULL },
 		{ NULL, 0, 0, 0, NULL, NULL, NULL }
 	};
 
@@ -239,6 +250,21 @@ main(int argc, char** argv)
 		return 1;
 	}
 
+	if (opt_io_threads <= 0)
+	{
+		opt_io_threads = 1;
+	}
+
+	if (opt_workers <= 0)
+	{
+		opt_workers = g_get_num_processors();
+	}
+
+	if (opt_timeout < 0)
+	{
+		opt_timeout = 0;
+	}
+
 	if (opt_daemon && !jd_daemon())
 	{
 		return 1;
@@ -252,7 +278,7 @@ main(int argc, char** argv)
 		opt_host = g_strdup(hostname);
 	}
 
-	socket_service = g_threaded_socket_service_new(-1);
+	socket_service = g_socket_service_new();
 	g_socket_listener_set_backlog(G_SOCKET_LISTENER(socket_service), 128);
 
 	while (TRUE)
@@ -294,6 +320,14 @@ main(int argc, char** argv)
 		return 1;
 	}
 
+	local_socket_path = j_helper_get_local_socket_path(j_configuration_get_local_socket_directory(jd_configuration), opt_port);
+
+	// Clients on the same host connect using the local socket.
+	if (!jd_listen_local(socket_service, local_socket_path))
+	{
+		g_clear_pointer(&local_socket_path, g_free);
+	}
+
 	jd_object_backend = NULL;
 	jd_kv_backend = NULL;
 	jd_db_backend = NULL;
@@ -351,8 +385,29 @@ main(int argc, char** argv)
 	jd_statistics = j_statistics_new(FALSE);
 	g_mutex_init(jd_statistics_mutex);
 
+	if (opt_memory_limit < 0)
+	{
+		opt_memory_limit = 0;
+	}
+
+	jd_buffer_pool_init(j_configuration_get_max_operation_size(jd_configuration), (guint64)opt_memory_limit * 1024 * 1024, opt_hugepages);
+
+	if (jd_object_backend != NULL && j_configuration_get_fabric_provider(jd_configuration) != NULL)
+	{
+		// Clients fall back to their socket connections if the fabric is not available.
+		if (!jd_fabric_init(j_configuration_get_fabric_provider(jd_configuration), opt_host))
+		{
+			g_warning("Could not initialize fabric, only using sockets.");
+		}
+	}
+
+	if (!jd_dispatch_init(opt_io_threads, opt_workers, j_configuration_get_max_operation_size(jd_configuration), opt_timeout))
+	{
+		return 1;
+	}
+
+	g_signal_connect(socket_service, "incoming", G_CALLBACK(jd_on_incoming), NULL);
 	g_socket_service_start(socket_service);
-	g_signal_connect(socket_service, "run", G_CALLBACK(jd_on_run), NULL);
 
 	main_loop = g_main_loop_new(NULL, FALSE);
 
@@ -364,6 +419,16 @@ main(int argc, char** argv)
 
 	g_socket_service_stop(socket_service);
 
+	if (local_socket_path != NULL)
+	{
+		g_unlink(local_socket_path);
+	}
+
+	jd_dispatch_fini();
+	// Buffers might still be registered with the fabric.
+	jd_buffer_pool_fini();
+	jd_fabric_fini();
+
 	g_mutex_clear(jd_statistics_mutex);
 	j_statistics_free(jd_statistics);
 
@@ -23,10 +23,24 @@
 #include <gio/gio.h>
 
 #include <jbackend.h>
-#include <jmemory-chunk.h>
+#include <jfabric.h>
 #include <jmessage.h>
 #include <jstatistics.h>
 
+struct JdBuffer
+{
+	gpointer data;
+	guint64 size;
+	guint size_class;
+
+	/**
+	 * The buffer's fabric registration, NULL if it has not been registered yet.
+	 **/
+	JFabricMemory* memory;
+};
+
+typedef struct JdBuffer JdBuffer;
+
 G_GNUC_INTERNAL JStatistics* jd_statistics;
 G_GNUC_INTERNAL GMutex jd_statistics_mutex[1];
 
@@ -34,6 +48,26 @@ G_GNUC_INTERNAL JBackend* jd_object_backend;
 G_GNUC_INTERNAL JBackend* jd_kv_backend;
 G_GNUC_INTERNAL JBackend* jd_db_backend;
 
-G_GNUC_INTERNAL gboolean jd_handle_message(JMessage*, GSocketConnection*, JMemoryChunk*, guint64, JStatistics*);
+G_GNUC_INTERNAL void jd_buffer_pool_init(guint64, guint64, gboolean);
+G_GNUC_INTERNAL void jd_buffer_pool_fini(void);
+G_GNUC_INTERNAL JdBuffer* jd_buffer_pool_get(guint64);
+G_GNUC_INTERNAL JdBuffer* jd_buffer_pool_try_get(guint64);
+G_GNUC_INTERNAL void jd_buffer_pool_put(JdBuffer*);
+G_GNUC_INTERNAL JFabricMemory* jd_buffer_pool_register(JdBuffer*, JFabricConnection*);
+
+G_GNUC_INTERNAL gboolean jd_dispatch_init(guint, guint, guint64, guint);
+G_GNUC_INTERNAL void jd_dispatch_fini(void);
+G_GNUC_INTERNAL void jd_dispatch_add_connection(GSocketConnection*);
+
+G_GNUC_INTERNAL gboolean jd_fabric_init(gchar const*, gchar const*);
+G_GNUC_INTERNAL void jd_fabric_fini(void);
+G_GNUC_INTERNAL gboolean jd_fabric_is_available(void);
+G_GNUC_INTERNAL void jd_fabric_handle_message(JMessage*, GSocketConnection*, JMessage*);
+G_GNUC_INTERNAL void jd_fabric_remove_connection(GSocketConnection*);
+
+G_GNUC_INTERNAL gboolean jd_writers_init(guint);
+G_GNUC_INTERNAL void jd_writers_fini(void);
+
+G_GNUC_INTERNAL gboolean jd_handle_message(JMessage*, GSocketConnection*, guint64, JStatistics*);
 
 #endif
@@ -56,9 +56,53 @@ test_background_operation_wait(void)
 	j_background_operation_unref(background_operation);
 }
 
+static gpointer
+on_background_operation_nested(gpointer data)
+{
+	g_autofree gpointer* nested_data = NULL;
+	guint length;
+
+	length = GPOINTER_TO_UINT(data);
+	nested_data = g_new(gpointer, length);
+
+	for (guint i = 0; i < length; i++)
+	{
+		nested_data[i] = GUINT_TO_POINTER(i + 1);
+	}
+
+	// More operations than threads must not deadlock when waiting from within background operations.
+	j_helper_execute_parallel(on_background_operation_completed, nested_data, length);
+
+	for (guint i = 0; i < length; i++)
+	{
+		g_assert_null(nested_data[i]);
+	}
+
+	return data;
+}
+
+static void
+test_background_operation_wait_nested(void)
+{
+	gpointer data[64];
+
+	for (guint i = 0; i < G_N_ELEMENTS(data); i++)
+	{
+		data[i] = GUINT_TO_POINTER(G_N_ELEMENTS(data));
+	}
+
+	j_helper_execute_parallel(on_background_operation_nested, data, G_N_ELEMENTS(data));
+
+	for (guint i = 0; i < G_N_ELEMENTS(data); i++)
+	{
+		g_assert_cmpuint(GPOINTER_TO_UINT(data[i]), ==, G_N_ELEMENTS(data));
+	}
+}
+
 void
 test_background_operation(void)
 {
 	g_test_add_func("/background_operation/new_ref_unref", test_background_operation_new_ref_unref);
 	g_test_add_func("/background_operation/wait", test_background_operation_wait);
+	g_test_add_func("/background_operation/wait_nested", test_background_operation_wait_nested);
 }
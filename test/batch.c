@@ -20,8 +20,11 @@
 
 #include <glib.h>
 
+#include <string.h>
+
 #include <julea.h>
 #include <julea-item.h>
+#include <julea-kv.h>
 
 #include "test.h"
 
@@ -66,6 +69,29 @@ test_batch_semantics(void)
 	j_batch_unref(batch);
 }
 
+static void
+test_batch_allocate(void)
+{
+	g_autoptr(JBatch) batch = NULL;
+	gsize const sizes[] = { 1, 8, 24, 100, 4096, 2 * 1024 * 1024 };
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+	for (guint i = 0; i < 60; i++)
+	{
+		gsize size = sizes[i % G_N_ELEMENTS(sizes)];
+		gchar* data;
+
+		data = j_batch_allocate(batch, size);
+		g_assert_true(data != NULL);
+		g_assert_cmpuint((guintptr)data % 16, ==, 0);
+
+		// The whole allocation has to be usable.
+		memset(data, i % 256, size);
+		g_assert_cmpint(data[size - 1], ==, (gchar)(i % 256));
+	}
+}
+
 static void
 _test_batch_execute(gboolean async)
 {
@@ -115,11 +141,276 @@ test_batch_execute_async(void)
 	_test_batch_execute(TRUE);
 }
 
+static void
+test_batch_execute_relaxed(void)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JSemantics) semantics = NULL;
+	g_autoptr(JKV) kv_a = NULL;
+	g_autoptr(JKV) kv_b = NULL;
+	g_autofree gchar* get_value_a = NULL;
+	g_autofree gchar* get_value_b = NULL;
+	g_autofree gchar* value_a1 = NULL;
+	g_autofree gchar* value_a2 = NULL;
+	g_autofree gchar* value_b = NULL;
+	guint32 get_len_a;
+	guint32 get_len_b;
+	gboolean ret;
+
+	semantics = j_semantics_new(J_SEMANTICS_TEMPLATE_DEFAULT);
+	j_semantics_set(semantics, J_SEMANTICS_ORDERING, J_SEMANTICS_ORDERING_RELAXED);
+	batch = j_batch_new(semantics);
+
+	value_a1 = g_strdup("first-value");
+	value_a2 = g_strdup("second-value");
+	value_b = g_strdup("value");
+
+	kv_a = j_kv_new("test-batch-a", "test-batch-relaxed");
+	kv_b = j_kv_new("test-batch-b", "test-batch-relaxed");
+
+	// Operations on different namespaces are regrouped, operations on the same namespace have to stay in order.
+	j_kv_put(kv_a, value_a1, strlen(value_a1) + 1, NULL, batch);
+	j_kv_put(kv_b, value_b, strlen(value_b) + 1, NULL, batch);
+	j_kv_get(kv_a, (gpointer)&get_value_a, &get_len_a, batch);
+	j_kv_put(kv_a, value_a2, strlen(value_a2) + 1, NULL, batch);
+	j_kv_get(kv_b, (gpointer)&get_value_b, &get_len_b, batch);
+	j_kv_delete(kv_a, batch);
+	j_kv_delete(kv_b, batch);
+
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+
+	g_assert_cmpstr(get_value_a, ==, value_a1);
+	g_assert_cmpuint(get_len_a, ==, strlen(value_a1) + 1);
+	g_assert_cmpstr(get_value_b, ==, value_b);
+	g_assert_cmpuint(get_len_b, ==, strlen(value_b) + 1);
+}
+
+static void
+test_batch_execute_auto_flush(void)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JKV) kv = NULL;
+	g_autofree gchar* get_value = NULL;
+	g_autofree gchar* last_value = NULL;
+	guint32 get_len;
+	guint operations;
+	gboolean ret;
+
+	// Enough operations to be executed automatically twice and to be split into several messages.
+	operations = 2 * j_configuration_get_max_batch_operations(j_configuration()) + 1;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	j_batch_set_auto_flush(batch, TRUE);
+
+	kv = j_kv_new("test-batch", "test-batch-auto-flush");
+
+	for (guint i = 0; i < operations; i++)
+	{
+		gchar* value;
+
+		value = g_strdup_printf("value-%u", i);
+		j_kv_put(kv, value, strlen(value) + 1, g_free, batch);
+	}
+
+	last_value = g_strdup_printf("value-%u", operations - 1);
+
+	// The last put has to be executed before the get, even though it might be part of a different message.
+	j_kv_get(kv, (gpointer)&get_value, &get_len, batch);
+	j_kv_delete(kv, batch);
+
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+
+	g_assert_cmpstr(get_value, ==, last_value);
+	g_assert_cmpuint(get_len, ==, strlen(last_value) + 1);
+
+	// All operations have been executed.
+	ret = j_batch_execute(batch);
+	g_assert_false(ret);
+}
+
+static JBatch*
+test_batch_new_queued(guint i)
+{
+	g_autoptr(JKV) kv = NULL;
+	g_autofree gchar* key = NULL;
+	JBatch* batch;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+	key = g_strdup_printf("test-batch-queued-%u", i);
+	kv = j_kv_new("test-batch", key);
+	j_kv_put(kv, g_strdup(key), strlen(key) + 1, g_free, batch);
+	j_kv_delete(kv, batch);
+
+	return batch;
+}
+
+static void
+test_batch_execute_queued(void)
+{
+	g_autoptr(JCompletionQueue) queue = NULL;
+	guint const n = 8;
+	guint completed = 0;
+
+	queue = j_completion_queue_new();
+
+	for (guint i = 0; i < n; i++)
+	{
+		g_autoptr(JBatch) batch = NULL;
+
+		batch = test_batch_new_queued(i);
+		j_batch_execute_queued(batch, queue);
+	}
+
+	while (completed < n)
+	{
+		GPollFD fd;
+		JBatch* batch;
+		gboolean ret;
+
+		fd.fd = j_completion_queue_get_fd(queue);
+		fd.events = G_IO_IN;
+		fd.revents = 0;
+
+		g_assert_cmpint(g_poll(&fd, 1, -1), ==, 1);
+
+		while ((batch = j_completion_queue_pop(queue, &ret)) != NULL)
+		{
+			g_assert_true(ret);
+			j_batch_unref(batch);
+			completed++;
+		}
+	}
+
+	g_assert_true(j_completion_queue_pop(queue, NULL) == NULL);
+}
+
+static void
+test_batch_execute_queued_many(void)
+{
+	g_autoptr(JCompletionQueue) queue = NULL;
+	g_autofree gpointer* values = NULL;
+	g_autofree guint32* value_lens = NULL;
+	guint const n = 1000;
+	guint completed = 0;
+
+	queue = j_completion_queue_new();
+	values = g_new0(gpointer, n);
+	value_lens = g_new0(guint32, n);
+
+	// All batches are in flight at the same time without requiring a thread each.
+	for (guint i = 0; i < n; i++)
+	{
+		g_autoptr(JBatch) batch = NULL;
+		g_autoptr(JKV) kv = NULL;
+		g_autofree gchar* key = NULL;
+
+		batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+		key = g_strdup_printf("test-batch-queued-many-%u", i);
+		kv = j_kv_new("test-batch", key);
+		j_kv_put(kv, g_strdup(key), strlen(key) + 1, g_free, batch);
+		j_kv_get(kv, &(values[i]), &(value_lens[i]), batch);
+		j_kv_delete(kv, batch);
+
+		j_batch_execute_queued(batch, queue);
+	}
+
+	while (completed < n)
+	{
+		JBatch* batch;
+		gboolean ret;
+
+		batch = j_completion_queue_wait(queue, &ret);
+		g_assert_true(ret);
+		j_batch_unref(batch);
+		completed++;
+	}
+
+	for (guint i = 0; i < n; i++)
+	{
+		g_autofree gchar* key = NULL;
+
+		key = g_strdup_printf("test-batch-queued-many-%u", i);
+
+		g_assert_cmpuint(value_lens[i], ==, strlen(key) + 1);
+		g_assert_cmpstr(values[i], ==, key);
+
+		g_free(values[i]);
+	}
+
+	// The driver has returned all connections to the pool.
+	for (guint i = 0; i < j_configuration_get_server_count(j_configuration(), J_BACKEND_TYPE_KV); i++)
+	{
+		gint64 latency;
+		guint queue_depth;
+
+		j_connection_pool_get_load(J_BACKEND_TYPE_KV, i, &latency, &queue_depth);
+		g_assert_cmpuint(queue_depth, ==, 0);
+	}
+}
+
+static void
+on_batch_queued_completed(JBatch* batch, gboolean ret, gpointer user_data)
+{
+	GMainLoop* loop = user_data;
+
+	(void)batch;
+
+	g_assert_true(ret);
+
+	if (g_atomic_int_dec_and_test(&test_batch_flag))
+	{
+		g_main_loop_quit(loop);
+	}
+}
+
+static void
+test_batch_execute_queued_source(void)
+{
+	g_autoptr(JCompletionQueue) queue = NULL;
+	g_autoptr(GMainContext) context = NULL;
+	g_autoptr(GMainLoop) loop = NULL;
+	g_autoptr(GSource) source = NULL;
+	guint const n = 8;
+
+	context = g_main_context_new();
+	loop = g_main_loop_new(context, FALSE);
+	queue = j_completion_queue_new();
+
+	source = j_completion_queue_source_new(queue, on_batch_queued_completed, loop);
+	g_source_attach(source, context);
+
+	g_atomic_int_set(&test_batch_flag, n);
+
+	for (guint i = 0; i < n; i++)
+	{
+		g_autoptr(JBatch) batch = NULL;
+
+		batch = test_batch_new_queued(i);
+		j_batch_execute_queued(batch, queue);
+	}
+
+	g_main_loop_run(loop);
+
+	g_source_destroy(source);
+
+	g_assert_cmpint(g_atomic_int_get(&test_batch_flag), ==, 0);
+}
+
 void
 test_batch(void)
 {
 	g_test_add_func("/batch/new_free", test_batch_new_free);
 	g_test_add_func("/batch/semantics", test_batch_semantics);
+	g_test_add_func("/batch/allocate", test_batch_allocate);
 	g_test_add_func("/batch/execute", test_batch_execute);
 	g_test_add_func("/batch/execute_async", test_batch_execute_async);
+	g_test_add_func("/batch/execute_relaxed", test_batch_execute_relaxed);
+	g_test_add_func("/batch/execute_auto_flush", test_batch_execute_auto_flush);
+	g_test_add_func("/batch/execute_queued", test_batch_execute_queued);
+	g_test_add_func("/batch/execute_queued_many", test_batch_execute_queued_many);
+	g_test_add_func("/batch/execute_queued_source", test_batch_execute_queued_source);
 }
@@ -20,6 +20,8 @@
 
 #include <glib.h>
 
+#include <string.h>
+
 #include <julea.h>
 
 #include <jcache.h>
@@ -81,10 +83,80 @@ test_cache_release(void)
 	j_cache_free(cache);
 }
 
+static void
+test_cache_release_unordered(void)
+{
+	JCache* cache;
+	gpointer ret[4];
+
+	cache = j_cache_new(4 * 1024);
+
+	for (guint i = 0; i < 4; i++)
+	{
+		ret[i] = j_cache_get(cache, 1024);
+		g_assert_true(ret[i] != NULL);
+		memset(ret[i], i, 1024);
+	}
+
+	g_assert_true(j_cache_get(cache, 1) == NULL);
+
+	j_cache_release(cache, ret[1]);
+	j_cache_release(cache, ret[3]);
+
+	ret[1] = j_cache_get(cache, 2048);
+	g_assert_true(ret[1] != NULL);
+	memset(ret[1], 1, 2048);
+
+	for (guint i = 0; i < 1024; i++)
+	{
+		g_assert_cmpuint(((guchar*)ret[0])[i], ==, 0);
+		g_assert_cmpuint(((guchar*)ret[2])[i], ==, 2);
+	}
+
+	j_cache_release(cache, ret[0]);
+	j_cache_release(cache, ret[1]);
+	j_cache_release(cache, ret[2]);
+
+	j_cache_free(cache);
+}
+
+static void
+test_cache_statistics(void)
+{
+	JCache* cache;
+	JCacheStatistics statistics;
+	gpointer ret1;
+	gpointer ret2;
+
+	cache = j_cache_new(2);
+
+	ret1 = j_cache_get(cache, 1);
+	g_assert_true(ret1 != NULL);
+	ret2 = j_cache_get(cache, 1);
+	g_assert_true(ret2 != NULL);
+	g_assert_true(j_cache_get(cache, 1) == NULL);
+
+	j_cache_release(cache, ret1);
+
+	j_cache_get_statistics(cache, &statistics);
+	g_assert_cmpuint(statistics.size, ==, 2);
+	g_assert_cmpuint(statistics.used, ==, 1);
+	g_assert_cmpuint(statistics.used_max, ==, 2);
+	g_assert_cmpuint(statistics.gets, ==, 3);
+	g_assert_cmpuint(statistics.gets_failed, ==, 1);
+	g_assert_cmpuint(statistics.releases, ==, 1);
+
+	j_cache_release(cache, ret2);
+
+	j_cache_free(cache);
+}
+
 void
 test_cache(void)
 {
 	g_test_add_func("/cache/new_free", test_cache_new_free);
 	g_test_add_func("/cache/get", test_cache_get);
 	g_test_add_func("/cache/release", test_cache_release);
+	g_test_add_func("/cache/release_unordered", test_cache_release_unordered);
+	g_test_add_func("/cache/statistics", test_cache_statistics);
 }
@@ -115,6 +115,12 @@ test_configuration_get(void)
 	g_assert_cmpstr(j_configuration_get_backend_component(configuration, J_BACKEND_TYPE_DB), ==, "client");
 	g_assert_cmpstr(j_configuration_get_backend_path(configuration, J_BACKEND_TYPE_DB), ==, "NULL3");
 
+	// Hedging is disabled by default.
+	g_assert_cmpuint(j_configuration_get_hedge_percentile(configuration), ==, 0);
+	g_assert_cmpuint(j_configuration_get_hedge_budget(configuration), ==, 5);
+
+	g_assert_cmpstr(j_configuration_get_local_socket_directory(configuration), ==, "/tmp");
+
 	j_configuration_unref(configuration);
 
 	g_key_file_free(key_file);
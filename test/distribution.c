@@ -68,7 +68,13 @@ test_distribution_distribute(JDistributionType type, JConfiguration** configurat
 	guint64 length;
 	guint64 offset;
 	guint64 block_id;
+	guint64 end;
+	guint64 erasure_block_size;
+	guint64 replica_offset;
 	guint index;
+	guint replica_index;
+	guint data_blocks;
+	guint parity_blocks;
 
 	(void)data;
 
@@ -91,6 +97,16 @@ test_distribution_distribute(JDistributionType type, JConfiguration** configurat
 			j_distribution_set2(distribution, "weight", 0, 1);
 			j_distribution_set2(distribution, "weight", 1, 2);
 			break;
+		case J_DISTRIBUTION_ERASURE:
+			// Data is stored on server 1, parity on server 0.
+			j_distribution_set(distribution, "start-index", 1);
+			j_distribution_set(distribution, "data-blocks", 1);
+			j_distribution_set(distribution, "parity-blocks", 1);
+			break;
+		case J_DISTRIBUTION_REPLICATED:
+			j_distribution_set(distribution, "start-index", 1);
+			j_distribution_set(distribution, "replicas", 2);
+			break;
 		default:
 			g_warn_if_reached();
 	}
@@ -111,17 +127,35 @@ test_distribution_distribute(JDistributionType type, JConfiguration** configurat
 	g_assert_cmpuint(offset, ==, 42);
 	g_assert_cmpuint(block_id, ==, 0);
 
+	j_distribution_get_replica(distribution, 0, index, offset, &replica_index, &replica_offset);
+	g_assert_cmpuint(replica_index, ==, index);
+	g_assert_cmpuint(replica_offset, ==, offset);
+
+	if (type == J_DISTRIBUTION_REPLICATED)
+	{
+		g_assert_cmpuint(j_distribution_get_replica_count(distribution), ==, 2);
+
+		// The second replica is stored on the next server, in the slot following the first replica.
+		j_distribution_get_replica(distribution, 1, index, offset, &replica_index, &replica_offset);
+		g_assert_cmpuint(replica_index, ==, 0);
+		g_assert_cmpuint(replica_offset, ==, block_size + 42);
+	}
+	else
+	{
+		g_assert_cmpuint(j_distribution_get_replica_count(distribution), ==, 1);
+	}
+
 	ret = j_distribution_distribute(distribution, &index, &length, &offset, &block_id);
 	g_assert_true(ret);
 	g_assert_cmpuint(length, ==, block_size);
 	g_assert_cmpuint(block_id, ==, 1);
 
-	if (type == J_DISTRIBUTION_ROUND_ROBIN)
+	if (type == J_DISTRIBUTION_ROUND_ROBIN || type == J_DISTRIBUTION_REPLICATED)
 	{
 		g_assert_cmpuint(index, ==, 0);
 		g_assert_cmpuint(offset, ==, 0);
 	}
-	else if (type == J_DISTRIBUTION_SINGLE_SERVER)
+	else if (type == J_DISTRIBUTION_SINGLE_SERVER || type == J_DISTRIBUTION_ERASURE)
 	{
 		g_assert_cmpuint(index, ==, 1);
 		g_assert_cmpuint(offset, ==, block_size);
@@ -142,7 +176,7 @@ test_distribution_distribute(JDistributionType type, JConfiguration** configurat
 	{
 		g_assert_cmpuint(offset, ==, block_size);
 	}
-	else if (type == J_DISTRIBUTION_SINGLE_SERVER)
+	else if (type == J_DISTRIBUTION_SINGLE_SERVER || type == J_DISTRIBUTION_ERASURE || type == J_DISTRIBUTION_REPLICATED)
 	{
 		g_assert_cmpuint(offset, ==, 2 * block_size);
 	}
@@ -161,7 +195,12 @@ test_distribution_distribute(JDistributionType type, JConfiguration** configurat
 		g_assert_cmpuint(index, ==, 0);
 		g_assert_cmpuint(offset, ==, block_size);
 	}
-	else if (type == J_DISTRIBUTION_SINGLE_SERVER)
+	else if (type == J_DISTRIBUTION_REPLICATED)
+	{
+		g_assert_cmpuint(index, ==, 0);
+		g_assert_cmpuint(offset, ==, 2 * block_size);
+	}
+	else if (type == J_DISTRIBUTION_SINGLE_SERVER || type == J_DISTRIBUTION_ERASURE)
 	{
 		g_assert_cmpuint(index, ==, 1);
 		g_assert_cmpuint(offset, ==, 3 * block_size);
@@ -182,7 +221,7 @@ test_distribution_distribute(JDistributionType type, JConfiguration** configurat
 	{
 		g_assert_cmpuint(offset, ==, 2 * block_size);
 	}
-	else if (type == J_DISTRIBUTION_SINGLE_SERVER)
+	else if (type == J_DISTRIBUTION_SINGLE_SERVER || type == J_DISTRIBUTION_ERASURE || type == J_DISTRIBUTION_REPLICATED)
 	{
 		g_assert_cmpuint(offset, ==, 4 * block_size);
 	}
@@ -193,6 +232,54 @@ test_distribution_distribute(JDistributionType type, JConfiguration** configurat
 
 	ret = j_distribution_distribute(distribution, &index, &length, &offset, &block_id);
 	g_assert_true(!ret);
+
+	g_assert_true(j_distribution_uses_server(distribution, 1));
+
+	if (type == J_DISTRIBUTION_SINGLE_SERVER)
+	{
+		g_assert_false(j_distribution_uses_server(distribution, 0));
+	}
+	else
+	{
+		g_assert_true(j_distribution_uses_server(distribution, 0));
+	}
+
+	// The size calculated for a server has to match the end of the data stored on it.
+	end = 42;
+	j_distribution_reset(distribution, 4 * block_size, end);
+
+	while (j_distribution_distribute(distribution, &index, &length, &offset, &block_id))
+	{
+		end += length;
+
+		for (guint i = 0; i < j_distribution_get_replica_count(distribution); i++)
+		{
+			j_distribution_get_replica(distribution, i, index, offset, &replica_index, &replica_offset);
+			g_assert_cmpuint(j_distribution_get_size(distribution, replica_index, replica_offset + length), ==, end);
+		}
+	}
+
+	g_assert_cmpuint(j_distribution_get_size(distribution, 1, 0), ==, 0);
+
+	ret = j_distribution_get_erasure_code(distribution, &data_blocks, &parity_blocks, &erasure_block_size);
+
+	if (type == J_DISTRIBUTION_ERASURE)
+	{
+		g_assert_true(ret);
+		g_assert_cmpuint(data_blocks, ==, 1);
+		g_assert_cmpuint(parity_blocks, ==, 1);
+		g_assert_cmpuint(erasure_block_size, ==, block_size);
+
+		g_assert_cmpuint(j_distribution_get_erasure_server(distribution, 0), ==, 1);
+		g_assert_cmpuint(j_distribution_get_erasure_server(distribution, 1), ==, 0);
+
+		// Parity servers do not contribute to the size.
+		g_assert_cmpuint(j_distribution_get_size(distribution, 0, block_size), ==, 0);
+	}
+	else
+	{
+		g_assert_false(ret);
+	}
 }
 
 static void
@@ -213,10 +300,24 @@ test_distribution_weighted(JConfiguration** configuration, gconstpointer data)
 	test_distribution_distribute(J_DISTRIBUTION_WEIGHTED, configuration, data);
 }
 
+static void
+test_distribution_erasure(JConfiguration** configuration, gconstpointer data)
+{
+	test_distribution_distribute(J_DISTRIBUTION_ERASURE, configuration, data);
+}
+
+static void
+test_distribution_replicated(JConfiguration** configuration, gconstpointer data)
+{
+	test_distribution_distribute(J_DISTRIBUTION_REPLICATED, configuration, data);
+}
+
 void
 test_distribution(void)
 {
 	g_test_add("/distribution/round_robin", JConfiguration*, NULL, test_distribution_fixture_setup, test_distribution_round_robin, test_distribution_fixture_teardown);
 	g_test_add("/distribution/single_server", JConfiguration*, NULL, test_distribution_fixture_setup, test_distribution_single_server, test_distribution_fixture_teardown);
 	g_test_add("/distribution/weighted", JConfiguration*, NULL, test_distribution_fixture_setup, test_distribution_weighted, test_distribution_fixture_teardown);
+	g_test_add("/distribution/erasure", JConfiguration*, NULL, test_distribution_fixture_setup, test_distribution_erasure, test_distribution_fixture_teardown);
+	g_test_add("/distribution/replicated", JConfiguration*, NULL, test_distribution_fixture_setup, test_distribution_replicated, test_distribution_fixture_teardown);
 }
@@ -23,6 +23,8 @@
 
 #include <string.h>
 
+#include <sys/socket.h>
+
 #include <julea.h>
 
 #include <jmessage.h>
@@ -165,6 +167,52 @@ test_message_write_read(void)
 	g_assert_cmpstr(dummy_str, ==, "42");
 }
 
+static void
+test_message_write_read_large(void)
+{
+	guint const n = 200000;
+
+	g_autoptr(JMessage) message_recv = NULL;
+	g_autoptr(JMessage) message_send = NULL;
+	g_autoptr(GOutputStream) output = NULL;
+	g_autoptr(GInputStream) input = NULL;
+	gboolean ret;
+
+	output = g_memory_output_stream_new(NULL, 0, g_realloc, g_free);
+	input = g_memory_input_stream_new();
+
+	message_send = j_message_new(J_MESSAGE_NONE, 0);
+	g_assert_true(message_send != NULL);
+	message_recv = j_message_new(J_MESSAGE_NONE, 0);
+	g_assert_true(message_recv != NULL);
+
+	/* The body is split into multiple segments */
+	for (guint64 i = 0; i < n; i++)
+	{
+		j_message_add_operation(message_send, sizeof(guint64));
+		ret = j_message_append_8(message_send, &i);
+		g_assert_true(ret);
+	}
+
+	ret = j_message_write(message_send, output);
+	g_assert_true(ret);
+
+	g_memory_input_stream_add_data(
+		G_MEMORY_INPUT_STREAM(input),
+		g_memory_output_stream_get_data(G_MEMORY_OUTPUT_STREAM(output)),
+		g_memory_output_stream_get_data_size(G_MEMORY_OUTPUT_STREAM(output)),
+		NULL);
+
+	ret = j_message_read(message_recv, input);
+	g_assert_true(ret);
+	g_assert_cmpuint(j_message_get_count(message_recv), ==, n);
+
+	for (guint64 i = 0; i < n; i++)
+	{
+		g_assert_cmpuint(j_message_get_8(message_recv), ==, i);
+	}
+}
+
 static void
 test_message_semantics(void)
 {
@@ -190,6 +238,567 @@ test_message_semantics(void)
 	g_assert_cmpint(j_semantics_get(semantics, J_SEMANTICS_SECURITY), ==, j_semantics_get(msg_semantics, J_SEMANTICS_SECURITY));
 }
 
+struct MultiplexData
+{
+	GSocketConnection* connection;
+	guint32 value;
+};
+
+typedef struct MultiplexData MultiplexData;
+
+static gpointer
+test_message_multiplex_client(gpointer data)
+{
+	MultiplexData* multiplex_data = data;
+
+	g_autoptr(JMessage) message = NULL;
+	g_autoptr(JMessage) reply = NULL;
+	gboolean ret;
+	guint32 value;
+
+	message = j_message_new(J_MESSAGE_NONE, 4);
+	j_message_append_4(message, &(multiplex_data->value));
+
+	ret = j_message_send(message, multiplex_data->connection);
+	g_assert_true(ret);
+
+	reply = j_message_new_reply(message);
+	ret = j_message_receive(reply, multiplex_data->connection);
+	g_assert_true(ret);
+
+	value = j_message_get_4(reply);
+	g_assert_cmpuint(value, ==, multiplex_data->value * 2);
+
+	return NULL;
+}
+
+static void
+test_message_multiplex(void)
+{
+	g_autoptr(GSocket) client_socket = NULL;
+	g_autoptr(GSocket) server_socket = NULL;
+	g_autoptr(GSocketConnection) client = NULL;
+	g_autoptr(GSocketConnection) server = NULL;
+	GInputStream* input;
+	GThread* threads[4];
+	JMessage* messages[4];
+	MultiplexData data[4];
+	gint fds[2];
+	gint ret;
+
+	ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+	g_assert_cmpint(ret, ==, 0);
+
+	client_socket = g_socket_new_from_fd(fds[0], NULL);
+	server_socket = g_socket_new_from_fd(fds[1], NULL);
+	g_assert_true(client_socket != NULL);
+	g_assert_true(server_socket != NULL);
+
+	client = g_socket_connection_factory_create_connection(client_socket);
+	server = g_socket_connection_factory_create_connection(server_socket);
+
+	j_message_multiplex_init(client);
+
+	for (guint i = 0; i < G_N_ELEMENTS(threads); i++)
+	{
+		data[i].connection = client;
+		data[i].value = i + 1;
+
+		threads[i] = g_thread_new("multiplex", test_message_multiplex_client, &(data[i]));
+	}
+
+	input = g_io_stream_get_input_stream(G_IO_STREAM(server));
+
+	for (guint i = 0; i < G_N_ELEMENTS(messages); i++)
+	{
+		messages[i] = j_message_new(J_MESSAGE_NONE, 0);
+		g_assert_true(j_message_read(messages[i], input));
+	}
+
+	/* Reply in reverse order */
+	for (guint i = G_N_ELEMENTS(messages); i > 0; i--)
+	{
+		g_autoptr(JMessage) reply = NULL;
+		guint32 value;
+
+		value = j_message_get_4(messages[i - 1]) * 2;
+
+		reply = j_message_new_reply(messages[i - 1]);
+		j_message_add_operation(reply, 4);
+		j_message_append_4(reply, &value);
+		g_assert_true(j_message_send(reply, server));
+
+		j_message_unref(messages[i - 1]);
+	}
+
+	for (guint i = 0; i < G_N_ELEMENTS(threads); i++)
+	{
+		g_thread_join(threads[i]);
+	}
+}
+
+static void
+test_message_multiplex_send(void)
+{
+	g_autoptr(GSocket) client_socket = NULL;
+	g_autoptr(GSocket) server_socket = NULL;
+	g_autoptr(GSocketConnection) client = NULL;
+	g_autoptr(GSocketConnection) server = NULL;
+	GInputStream* input;
+	JMessage* messages[2];
+	JMessage* requests[2];
+	gchar const* data[2] = { "first", "second" };
+	gint fds[2];
+	gint ret;
+
+	ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+	g_assert_cmpint(ret, ==, 0);
+
+	client_socket = g_socket_new_from_fd(fds[0], NULL);
+	server_socket = g_socket_new_from_fd(fds[1], NULL);
+	g_assert_true(client_socket != NULL);
+	g_assert_true(server_socket != NULL);
+
+	client = g_socket_connection_factory_create_connection(client_socket);
+	server = g_socket_connection_factory_create_connection(server_socket);
+
+	j_message_multiplex_init(client);
+
+	/* A single thread has multiple messages in flight */
+	for (guint i = 0; i < G_N_ELEMENTS(messages); i++)
+	{
+		messages[i] = j_message_new(J_MESSAGE_NONE, 0);
+		g_assert_true(j_message_send(messages[i], client));
+	}
+
+	input = g_io_stream_get_input_stream(G_IO_STREAM(server));
+
+	for (guint i = 0; i < G_N_ELEMENTS(requests); i++)
+	{
+		requests[i] = j_message_new(J_MESSAGE_NONE, 0);
+		g_assert_true(j_message_read(requests[i], input));
+	}
+
+	/* Reply in reverse order, followed by additional data */
+	for (guint i = G_N_ELEMENTS(requests); i > 0; i--)
+	{
+		g_autoptr(JMessage) reply = NULL;
+		guint64 length;
+
+		length = strlen(data[i - 1]) + 1;
+
+		reply = j_message_new_reply(requests[i - 1]);
+		j_message_add_operation(reply, 8);
+		j_message_append_8(reply, &length);
+		j_message_add_send(reply, data[i - 1], length);
+		g_assert_true(j_message_send(reply, server));
+
+		j_message_unref(requests[i - 1]);
+	}
+
+	for (guint i = 0; i < G_N_ELEMENTS(messages); i++)
+	{
+		g_autoptr(JMessage) reply = NULL;
+		gchar buffer[16];
+		guint64 length;
+
+		reply = j_message_new_reply(messages[i]);
+		g_assert_true(j_message_receive(reply, client));
+
+		/* The first reply's data is received from the connection, the second one has been buffered while reading the first */
+		length = j_message_get_8(reply);
+		g_assert_cmpuint(length, <=, sizeof(buffer));
+		g_assert_true(j_message_receive_send(reply, buffer, length));
+		g_assert_cmpstr(buffer, ==, data[i]);
+
+		/* Freeing a message only releases its own slot, the other reply has already been queued */
+		j_message_unref(messages[i]);
+	}
+}
+
+struct FanoutData
+{
+	GSocketConnection* server;
+	guint32 value;
+	guint replies;
+};
+
+typedef struct FanoutData FanoutData;
+
+static gboolean
+test_message_fanout_reply(JMessage* reply, gpointer connection, gpointer data)
+{
+	FanoutData* fanout_data = data;
+
+	guint32 value;
+
+	(void)connection;
+
+	value = j_message_get_4(reply);
+	g_assert_cmpuint(value, ==, fanout_data->value * 2);
+
+	fanout_data->replies++;
+
+	// The first connection answers with two replies.
+	return (fanout_data->value == 1 && fanout_data->replies < 2);
+}
+
+static gpointer
+test_message_fanout_server(gpointer data)
+{
+	FanoutData* fanout_data = data;
+
+	JMessage* messages[3];
+
+	for (guint i = 0; i < G_N_ELEMENTS(messages); i++)
+	{
+		messages[i] = j_message_new(J_MESSAGE_NONE, 0);
+		g_assert_true(j_message_read(messages[i], g_io_stream_get_input_stream(G_IO_STREAM(fanout_data[i].server))));
+	}
+
+	/* Reply in reverse order */
+	for (guint i = G_N_ELEMENTS(messages); i > 0; i--)
+	{
+		guint const replies = (i == 1) ? 2 : 1;
+		guint32 value;
+
+		value = j_message_get_4(messages[i - 1]) * 2;
+
+		for (guint j = 0; j < replies; j++)
+		{
+			g_autoptr(JMessage) reply = NULL;
+
+			reply = j_message_new_reply(messages[i - 1]);
+			j_message_add_operation(reply, 4);
+			j_message_append_4(reply, &value);
+			g_assert_true(j_message_send(reply, fanout_data[i - 1].server));
+		}
+
+		j_message_unref(messages[i - 1]);
+	}
+
+	return NULL;
+}
+
+static void
+test_message_fanout(void)
+{
+	g_autoptr(JMessageFanout) fanout = NULL;
+	GSocketConnection* clients[3];
+	FanoutData data[3];
+	GThread* thread;
+
+	fanout = j_message_fanout_new();
+
+	for (guint i = 0; i < G_N_ELEMENTS(clients); i++)
+	{
+		g_autoptr(GSocket) client_socket = NULL;
+		g_autoptr(GSocket) server_socket = NULL;
+		g_autoptr(JMessage) message = NULL;
+		gint fds[2];
+		gint ret;
+
+		ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+		g_assert_cmpint(ret, ==, 0);
+
+		client_socket = g_socket_new_from_fd(fds[0], NULL);
+		server_socket = g_socket_new_from_fd(fds[1], NULL);
+		g_assert_true(client_socket != NULL);
+		g_assert_true(server_socket != NULL);
+
+		clients[i] = g_socket_connection_factory_create_connection(client_socket);
+		data[i].server = g_socket_connection_factory_create_connection(server_socket);
+		data[i].value = i + 1;
+		data[i].replies = 0;
+
+		message = j_message_new(J_MESSAGE_NONE, 4);
+		j_message_append_4(message, &(data[i].value));
+
+		j_message_fanout_add(fanout, message, clients[i], test_message_fanout_reply, &(data[i]));
+	}
+
+	thread = g_thread_new("fanout", test_message_fanout_server, data);
+
+	g_assert_true(j_message_fanout_execute(fanout));
+
+	g_thread_join(thread);
+
+	for (guint i = 0; i < G_N_ELEMENTS(clients); i++)
+	{
+		g_assert_cmpuint(data[i].replies, ==, (i == 0) ? 2 : 1);
+
+		g_object_unref(clients[i]);
+		g_object_unref(data[i].server);
+	}
+}
+
+struct FanoutSharedData
+{
+	GSocketConnection* clients[2];
+	FanoutData data[2];
+};
+
+typedef struct FanoutSharedData FanoutSharedData;
+
+static gboolean
+test_message_fanout_shared_reply(JMessage* reply, gpointer connection, gpointer data)
+{
+	FanoutData* fanout_data = data;
+
+	guint32 value;
+
+	(void)connection;
+
+	value = j_message_get_4(reply);
+	g_assert_cmpuint(value, ==, fanout_data->value * 2);
+
+	fanout_data->replies++;
+
+	// Every connection answers with two replies.
+	return (fanout_data->replies < 2);
+}
+
+static gpointer
+test_message_fanout_shared_client(gpointer data)
+{
+	FanoutSharedData* shared_data = data;
+
+	g_autoptr(JMessageFanout) fanout = NULL;
+
+	fanout = j_message_fanout_new();
+
+	for (guint i = 0; i < G_N_ELEMENTS(shared_data->clients); i++)
+	{
+		g_autoptr(JMessage) message = NULL;
+
+		message = j_message_new(J_MESSAGE_NONE, 4);
+		j_message_append_4(message, &(shared_data->data[i].value));
+
+		j_message_fanout_add(fanout, message, shared_data->clients[i], test_message_fanout_shared_reply, &(shared_data->data[i]));
+	}
+
+	g_assert_true(j_message_fanout_execute(fanout));
+
+	return NULL;
+}
+
+static gpointer
+test_message_fanout_shared_server(gpointer data)
+{
+	FanoutData* fanout_data = data;
+
+	JMessage* messages[2];
+	guint32 values[2];
+	guint order[4];
+
+	for (guint i = 0; i < G_N_ELEMENTS(messages); i++)
+	{
+		messages[i] = j_message_new(J_MESSAGE_NONE, 0);
+		g_assert_true(j_message_read(messages[i], g_io_stream_get_input_stream(G_IO_STREAM(fanout_data->server))));
+
+		values[i] = j_message_get_4(messages[i]) * 2;
+	}
+
+	/* Interleave the replies, the connections start with different messages */
+	order[0] = fanout_data->value;
+	order[1] = 1 - order[0];
+	order[2] = order[1];
+	order[3] = order[0];
+
+	for (guint i = 0; i < G_N_ELEMENTS(order); i++)
+	{
+		g_autoptr(JMessage) reply = NULL;
+
+		reply = j_message_new_reply(messages[order[i]]);
+		j_message_add_operation(reply, 4);
+		j_message_append_4(reply, &(values[order[i]]));
+		g_assert_true(j_message_send(reply, fanout_data->server));
+
+		// Give the other connection's reader a chance to get ahead.
+		g_usleep(1000);
+	}
+
+	for (guint i = 0; i < G_N_ELEMENTS(messages); i++)
+	{
+		j_message_unref(messages[i]);
+	}
+
+	return NULL;
+}
+
+static void
+test_message_fanout_shared(void)
+{
+	GSocketConnection* clients[2];
+	FanoutData server_data[2];
+	FanoutSharedData shared_data[2];
+	GThread* client_threads[2];
+	GThread* server_threads[2];
+
+	for (guint i = 0; i < G_N_ELEMENTS(clients); i++)
+	{
+		g_autoptr(GSocket) client_socket = NULL;
+		g_autoptr(GSocket) server_socket = NULL;
+		gint fds[2];
+		gint ret;
+
+		ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+		g_assert_cmpint(ret, ==, 0);
+
+		client_socket = g_socket_new_from_fd(fds[0], NULL);
+		server_socket = g_socket_new_from_fd(fds[1], NULL);
+		g_assert_true(client_socket != NULL);
+		g_assert_true(server_socket != NULL);
+
+		clients[i] = g_socket_connection_factory_create_connection(client_socket);
+		server_data[i].server = g_socket_connection_factory_create_connection(server_socket);
+		server_data[i].value = i;
+		server_data[i].replies = 0;
+
+		j_message_multiplex_init(clients[i]);
+	}
+
+	/* Two fan-outs share the same connections */
+	for (guint i = 0; i < G_N_ELEMENTS(shared_data); i++)
+	{
+		for (guint j = 0; j < G_N_ELEMENTS(clients); j++)
+		{
+			shared_data[i].clients[j] = clients[j];
+			shared_data[i].data[j].server = NULL;
+			shared_data[i].data[j].value = 10 * (i + 1) + j;
+			shared_data[i].data[j].replies = 0;
+		}
+
+		client_threads[i] = g_thread_new("fanout", test_message_fanout_shared_client, &(shared_data[i]));
+	}
+
+	for (guint i = 0; i < G_N_ELEMENTS(server_threads); i++)
+	{
+		server_threads[i] = g_thread_new("fanout", test_message_fanout_shared_server, &(server_data[i]));
+	}
+
+	for (guint i = 0; i < G_N_ELEMENTS(client_threads); i++)
+	{
+		g_thread_join(client_threads[i]);
+		g_thread_join(server_threads[i]);
+	}
+
+	for (guint i = 0; i < G_N_ELEMENTS(shared_data); i++)
+	{
+		for (guint j = 0; j < G_N_ELEMENTS(clients); j++)
+		{
+			g_assert_cmpuint(shared_data[i].data[j].replies, ==, 2);
+		}
+	}
+
+	for (guint i = 0; i < G_N_ELEMENTS(clients); i++)
+	{
+		g_object_unref(clients[i]);
+		g_object_unref(server_data[i].server);
+	}
+}
+
+static gpointer
+test_message_fanout_cancel_server(gpointer data)
+{
+	FanoutData* fanout_data = data;
+
+	g_autoptr(JMessage) reply = NULL;
+	JMessage* messages[2];
+	guint32 value;
+
+	for (guint i = 0; i < G_N_ELEMENTS(messages); i++)
+	{
+		messages[i] = j_message_new(J_MESSAGE_NONE, 0);
+		g_assert_true(j_message_read(messages[i], g_io_stream_get_input_stream(G_IO_STREAM(fanout_data[i].server))));
+	}
+
+	/* Only the first message is answered */
+	value = j_message_get_4(messages[0]) * 2;
+
+	reply = j_message_new_reply(messages[0]);
+	j_message_add_operation(reply, 4);
+	j_message_append_4(reply, &value);
+	g_assert_true(j_message_send(reply, fanout_data[0].server));
+
+	for (guint i = 0; i < G_N_ELEMENTS(messages); i++)
+	{
+		j_message_unref(messages[i]);
+	}
+
+	return NULL;
+}
+
+static void
+test_message_fanout_cancel(void)
+{
+	g_autoptr(JMessageFanout) fanout = NULL;
+	GSocketConnection* clients[2];
+	FanoutData data[2];
+	GThread* thread;
+
+	fanout = j_message_fanout_new();
+
+	for (guint i = 0; i < G_N_ELEMENTS(clients); i++)
+	{
+		g_autoptr(GSocket) client_socket = NULL;
+		g_autoptr(GSocket) server_socket = NULL;
+		g_autoptr(JMessage) message = NULL;
+		gint fds[2];
+		gint ret;
+
+		ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+		g_assert_cmpint(ret, ==, 0);
+
+		client_socket = g_socket_new_from_fd(fds[0], NULL);
+		server_socket = g_socket_new_from_fd(fds[1], NULL);
+		g_assert_true(client_socket != NULL);
+		g_assert_true(server_socket != NULL);
+
+		clients[i] = g_socket_connection_factory_create_connection(client_socket);
+		data[i].server = g_socket_connection_factory_create_connection(server_socket);
+		// Neither value expects a second reply.
+		data[i].value = i + 2;
+		data[i].replies = 0;
+
+		message = j_message_new(J_MESSAGE_NONE, 4);
+		j_message_append_4(message, &(data[i].value));
+
+		j_message_fanout_add(fanout, message, clients[i], test_message_fanout_reply, &(data[i]));
+	}
+
+	g_assert_true(j_message_fanout_is_pending(fanout, NULL));
+
+	thread = g_thread_new("fanout", test_message_fanout_cancel_server, data);
+
+	// Returns as soon as the first entry has been completed.
+	g_assert_true(j_message_fanout_execute_until(fanout, g_get_monotonic_time() + 10 * G_USEC_PER_SEC));
+	g_assert_cmpuint(data[0].replies, ==, 1);
+	g_assert_false(j_message_fanout_is_pending(fanout, clients[0]));
+	g_assert_true(j_message_fanout_is_pending(fanout, clients[1]));
+
+	g_thread_join(thread);
+
+	// Returns once the deadline has passed.
+	g_assert_true(j_message_fanout_execute_until(fanout, g_get_monotonic_time() + 20 * 1000));
+	g_assert_true(j_message_fanout_is_pending(fanout, clients[1]));
+
+	// Returns once woken up, even without a deadline.
+	j_message_fanout_wakeup(fanout);
+	g_assert_true(j_message_fanout_execute_until(fanout, -1));
+	g_assert_true(j_message_fanout_is_pending(fanout, clients[1]));
+
+	j_message_fanout_cancel(fanout, clients[1]);
+	g_assert_false(j_message_fanout_is_pending(fanout, NULL));
+	g_assert_cmpuint(data[1].replies, ==, 0);
+
+	for (guint i = 0; i < G_N_ELEMENTS(clients); i++)
+	{
+		g_object_unref(clients[i]);
+		g_object_unref(data[i].server);
+	}
+}
+
 void
 test_message(void)
 {
@@ -198,5 +807,11 @@ test_message(void)
 	g_test_add_func("/message/header", test_message_header);
 	g_test_add_func("/message/append", test_message_append);
 	g_test_add_func("/message/write_read", test_message_write_read);
+	g_test_add_func("/message/write_read_large", test_message_write_read_large);
 	g_test_add_func("/message/semantics", test_message_semantics);
+	g_test_add_func("/message/multiplex", test_message_multiplex);
+	g_test_add_func("/message/multiplex_send", test_message_multiplex_send);
+	g_test_add_func("/message/fanout", test_message_fanout);
+	g_test_add_func("/message/fanout_cancel", test_message_fanout_cancel);
+	g_test_add_func("/message/fanout_shared", test_message_fanout_shared);
 }
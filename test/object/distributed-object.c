@@ -149,6 +149,141 @@ test_object_read_write(void)
 	g_assert_true(ret);
 }
 
+static void
+test_object_read_write_erasure(void)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JDistribution) distribution = NULL;
+	g_autoptr(JDistributedObject) object = NULL;
+	g_autofree gchar* buffer = NULL;
+	g_autofree gchar* expected = NULL;
+	guint64 const block_size = 1024;
+	guint64 const length = 5 * block_size + 100;
+	guint64 nbytes = 0;
+	guint64 size = 0;
+	gboolean ret;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	buffer = g_malloc(length);
+	expected = g_malloc0(500 + length);
+
+	for (guint64 i = 0; i < length; i++)
+	{
+		buffer[i] = i % 251;
+	}
+
+	memcpy(expected + 500, buffer, length);
+
+	// Uses the default number of data and parity blocks, which depends on the number of servers.
+	distribution = j_distribution_new(J_DISTRIBUTION_ERASURE);
+	j_distribution_set_block_size(distribution, block_size);
+	object = j_distributed_object_new("test", "test-distributed-object-erasure", distribution);
+	g_assert_true(object != NULL);
+
+	j_distributed_object_create(object, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+
+	// Neither start nor end are aligned to stripes.
+	j_distributed_object_write(object, buffer, length, 500, &nbytes, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+	g_assert_cmpuint(nbytes, ==, length);
+
+	// Partially overwrite stripes, their parity has to be updated.
+	memset(buffer, 42, 2 * block_size);
+	memset(expected + block_size, 42, 2 * block_size);
+
+	j_distributed_object_write(object, buffer, 2 * block_size, block_size, &nbytes, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+	g_assert_cmpuint(nbytes, ==, 2 * block_size);
+
+	g_free(buffer);
+	buffer = g_malloc0(500 + length);
+
+	j_distributed_object_read(object, buffer, 500 + length, 0, &nbytes, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+	g_assert_cmpuint(nbytes, ==, 500 + length);
+	g_assert_cmpmem(buffer, 500 + length, expected, 500 + length);
+
+	j_distributed_object_status(object, NULL, &size, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+	g_assert_cmpuint(size, ==, 500 + length);
+
+	j_distributed_object_delete(object, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+}
+
+static void
+test_object_read_write_replicated(void)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JDistribution) distribution = NULL;
+	g_autoptr(JDistributedObject) object = NULL;
+	g_autofree gchar* buffer = NULL;
+	g_autofree gchar* expected = NULL;
+	guint64 const block_size = 1024;
+	guint64 const length = 5 * block_size + 100;
+	guint64 nbytes = 0;
+	guint64 size = 0;
+	gboolean ret;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	buffer = g_malloc(length);
+	expected = g_malloc0(500 + length);
+
+	for (guint64 i = 0; i < length; i++)
+	{
+		buffer[i] = i % 251;
+	}
+
+	memcpy(expected + 500, buffer, length);
+
+	// Uses the default number of replicas, which depends on the number of servers.
+	distribution = j_distribution_new(J_DISTRIBUTION_REPLICATED);
+	j_distribution_set_block_size(distribution, block_size);
+	object = j_distributed_object_new("test", "test-distributed-object-replicated", distribution);
+	g_assert_true(object != NULL);
+
+	j_distributed_object_create(object, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+
+	// Replicas do not count towards the bytes written.
+	j_distributed_object_write(object, buffer, length, 500, &nbytes, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+	g_assert_cmpuint(nbytes, ==, length);
+
+	g_free(buffer);
+	buffer = g_malloc0(500 + length);
+
+	// Reading repeatedly lets the replicas be chosen based on their measured latencies.
+	for (guint i = 0; i < 3; i++)
+	{
+		memset(buffer, 0, 500 + length);
+
+		j_distributed_object_read(object, buffer, 500 + length, 0, &nbytes, batch);
+		ret = j_batch_execute(batch);
+		g_assert_true(ret);
+		g_assert_cmpuint(nbytes, ==, 500 + length);
+		g_assert_cmpmem(buffer, 500 + length, expected, 500 + length);
+	}
+
+	j_distributed_object_status(object, NULL, &size, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+	g_assert_cmpuint(size, ==, 500 + length);
+
+	j_distributed_object_delete(object, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+}
+
 static void
 test_object_status(void)
 {
@@ -159,6 +294,7 @@ test_object_status(void)
 	gint64 modification_time = 0;
 	guint64 nbytes = 0;
 	guint64 size = 0;
+	guint64 stripe_size;
 	gboolean ret;
 
 	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
@@ -183,6 +319,18 @@ test_object_status(void)
 	g_assert_cmpint(modification_time, !=, 0);
 	g_assert_cmpuint(size, ==, 42);
 
+	// Leave a hole, the size has to include it.
+	stripe_size = j_configuration_get_stripe_size(j_configuration());
+	j_distributed_object_write(object, buffer, 42, 2 * stripe_size, &nbytes, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+	g_assert_cmpuint(nbytes, ==, 42);
+
+	j_distributed_object_status(object, &modification_time, &size, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+	g_assert_cmpuint(size, ==, 2 * stripe_size + 42);
+
 	j_distributed_object_delete(object, batch);
 	ret = j_batch_execute(batch);
 	g_assert_true(ret);
@@ -194,5 +342,7 @@ test_object_distributed_object(void)
 	g_test_add_func("/object/distributed-object/new_free", test_object_new_free);
 	g_test_add_func("/object/distributed-object/create_delete", test_object_create_delete);
 	g_test_add_func("/object/distributed-object/read_write", test_object_read_write);
+	g_test_add_func("/object/distributed-object/read_write_erasure", test_object_read_write_erasure);
+	g_test_add_func("/object/distributed-object/read_write_replicated", test_object_read_write_replicated);
 	g_test_add_func("/object/distributed-object/status", test_object_status);
 }
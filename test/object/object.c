@@ -20,6 +20,8 @@
 
 #include <glib.h>
 
+#include <string.h>
+
 #include <julea.h>
 #include <julea-object.h>
 
@@ -142,6 +144,155 @@ test_object_read_write(void)
 	g_assert_true(ret);
 }
 
+static void
+test_object_read_large(void)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JObject) object = NULL;
+	g_autofree gchar* buffer = NULL;
+	g_autofree gchar* read_buffer = NULL;
+	guint64 max_operation_size;
+	guint64 length;
+	guint64 nbytes = 0;
+	gboolean ret;
+
+	max_operation_size = j_configuration_get_max_operation_size(j_configuration());
+	length = 2 * max_operation_size + 42;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	buffer = g_malloc(length);
+	read_buffer = g_malloc0(length + 42);
+
+	for (guint64 i = 0; i < length; i++)
+	{
+		buffer[i] = i % 251;
+	}
+
+	object = j_object_new("test", "test-object-read-large");
+	g_assert_true(object != NULL);
+
+	j_object_create(object, batch);
+	j_object_write(object, buffer, length, 0, &nbytes, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+	g_assert_cmpuint(nbytes, ==, length);
+
+	// Reads past the end of the object and spans multiple reply fragments
+	j_object_read(object, read_buffer, length + 42, 0, &nbytes, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+	g_assert_cmpuint(nbytes, ==, length);
+	g_assert_true(memcmp(buffer, read_buffer, length) == 0);
+
+	j_object_delete(object, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+}
+
+static void
+test_object_read_write_coalesced(void)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JObject) object = NULL;
+	gchar read_buffer[4][8];
+	guint64 nbytes[4];
+	guint64 nbytes_overlap = 0;
+	gboolean ret;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+	object = j_object_new("test", "test-object-rw-coalesced");
+	g_assert_true(object != NULL);
+
+	j_object_create(object, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+
+	// Contiguous and overlapping writes are coalesced, the later write has to win.
+	j_object_write(object, "aaaaaaaa", 8, 0, &(nbytes[0]), batch);
+	j_object_write(object, "bbbbbbbb", 8, 8, &(nbytes[1]), batch);
+	j_object_write(object, "cccccccc", 8, 16, &(nbytes[2]), batch);
+	j_object_write(object, "dddddddd", 8, 24, &(nbytes[3]), batch);
+	j_object_write(object, "xxxx", 4, 6, &nbytes_overlap, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+
+	for (guint i = 0; i < 4; i++)
+	{
+		g_assert_cmpuint(nbytes[i], ==, 8);
+	}
+
+	g_assert_cmpuint(nbytes_overlap, ==, 4);
+
+	// Reads beyond the end of the object have to be truncated.
+	for (guint i = 0; i < 4; i++)
+	{
+		j_object_read(object, read_buffer[i], 8, 4 + i * 8, &(nbytes[i]), batch);
+	}
+
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+
+	g_assert_cmpuint(nbytes[0], ==, 8);
+	g_assert_true(memcmp(read_buffer[0], "aaxxxxbb", 8) == 0);
+	g_assert_cmpuint(nbytes[1], ==, 8);
+	g_assert_true(memcmp(read_buffer[1], "bbbbcccc", 8) == 0);
+	g_assert_cmpuint(nbytes[2], ==, 8);
+	g_assert_true(memcmp(read_buffer[2], "ccccdddd", 8) == 0);
+	g_assert_cmpuint(nbytes[3], ==, 4);
+	g_assert_true(memcmp(read_buffer[3], "dddd", 4) == 0);
+
+	j_object_delete(object, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+}
+
+static void
+test_object_write_eventual(void)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JBatch) eventual_batch = NULL;
+	g_autoptr(JSemantics) semantics = NULL;
+	g_autoptr(JObject) object = NULL;
+	gchar buffer[8];
+	guint64 nbytes = 0;
+	gboolean ret;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+	semantics = j_semantics_new(J_SEMANTICS_TEMPLATE_DEFAULT);
+	j_semantics_set(semantics, J_SEMANTICS_PERSISTENCY, J_SEMANTICS_PERSISTENCY_EVENTUAL);
+	eventual_batch = j_batch_new(semantics);
+
+	object = j_object_new("test", "test-object-write-eventual");
+	g_assert_true(object != NULL);
+
+	j_object_create(object, eventual_batch);
+	ret = j_batch_execute(eventual_batch);
+	g_assert_true(ret);
+
+	memcpy(buffer, "eventual", 8);
+
+	// The data is copied, so the buffer can be reused right away.
+	j_object_write(object, buffer, 8, 0, &nbytes, eventual_batch);
+	ret = j_batch_execute(eventual_batch);
+	g_assert_true(ret);
+	g_assert_cmpuint(nbytes, ==, 8);
+
+	memset(buffer, 0, 8);
+
+	// Reading has to wait for the cached write.
+	j_object_read(object, buffer, 8, 0, &nbytes, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+	g_assert_cmpuint(nbytes, ==, 8);
+	g_assert_true(memcmp(buffer, "eventual", 8) == 0);
+
+	j_object_delete(object, eventual_batch);
+	ret = j_batch_execute(eventual_batch);
+	g_assert_true(ret);
+}
+
 static void
 test_object_status(void)
 {
@@ -185,5 +336,8 @@ test_object_object(void)
 	g_test_add_func("/object/object/new_free", test_object_new_free);
 	g_test_add_func("/object/object/create_delete", test_object_create_delete);
 	g_test_add_func("/object/object/read_write", test_object_read_write);
+	g_test_add_func("/object/object/read_large", test_object_read_large);
+	g_test_add_func("/object/object/read_write_coalesced", test_object_read_write_coalesced);
+	g_test_add_func("/object/object/write_eventual", test_object_write_eventual);
 	g_test_add_func("/object/object/status", test_object_status);
 }
@@ -0,0 +1,142 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2020 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <julea.h>
+
+#include "test.h"
+
+#define TEST_PLACEMENT_KEYS 10000
+
+static void
+test_placement_modulo(void)
+{
+	g_autoptr(JPlacement) placement = NULL;
+
+	placement = j_placement_new(J_PLACEMENT_MODULO, 7, 0);
+
+	g_assert_cmpint(j_placement_get_type(placement), ==, J_PLACEMENT_MODULO);
+
+	// The modulo placement has to stay compatible with existing deployments.
+	for (guint i = 0; i < 100; i++)
+	{
+		g_autofree gchar* key = NULL;
+
+		key = g_strdup_printf("key-%u", i);
+		g_assert_cmpuint(j_placement_get_index(placement, key), ==, j_helper_hash(key) % 7);
+	}
+}
+
+static void
+test_placement_type_from_string(void)
+{
+	JPlacementType type;
+	gboolean ret;
+
+	ret = j_placement_type_from_string("ring", &type);
+	g_assert_true(ret);
+	g_assert_cmpint(type, ==, J_PLACEMENT_RING);
+
+	ret = j_placement_type_from_string("jump", &type);
+	g_assert_true(ret);
+	g_assert_cmpint(type, ==, J_PLACEMENT_JUMP);
+
+	ret = j_placement_type_from_string("unknown", &type);
+	g_assert_false(ret);
+}
+
+static void
+test_placement_balance(gconstpointer data)
+{
+	JPlacementType type = GPOINTER_TO_INT(data);
+	g_autoptr(JPlacement) placement = NULL;
+	guint counts[4] = { 0, 0, 0, 0 };
+
+	placement = j_placement_new(type, G_N_ELEMENTS(counts), 0);
+
+	for (guint i = 0; i < TEST_PLACEMENT_KEYS; i++)
+	{
+		g_autofree gchar* key = NULL;
+		guint32 index;
+
+		key = g_strdup_printf("key-%u", i);
+		index = j_placement_get_index(placement, key);
+
+		g_assert_cmpuint(index, <, G_N_ELEMENTS(counts));
+		// The placement has to be deterministic.
+		g_assert_cmpuint(j_placement_get_index(placement, key), ==, index);
+
+		counts[index]++;
+	}
+
+	for (guint i = 0; i < G_N_ELEMENTS(counts); i++)
+	{
+		g_assert_cmpuint(counts[i], >, TEST_PLACEMENT_KEYS / G_N_ELEMENTS(counts) / 2);
+		g_assert_cmpuint(counts[i], <, TEST_PLACEMENT_KEYS / G_N_ELEMENTS(counts) * 3 / 2);
+	}
+}
+
+static void
+test_placement_grow(gconstpointer data)
+{
+	JPlacementType type = GPOINTER_TO_INT(data);
+	g_autoptr(JPlacement) placement = NULL;
+	g_autoptr(JPlacement) grown_placement = NULL;
+	guint moved = 0;
+
+	placement = j_placement_new(type, 4, 0);
+	grown_placement = j_placement_new(type, 5, 0);
+
+	for (guint i = 0; i < TEST_PLACEMENT_KEYS; i++)
+	{
+		g_autofree gchar* key = NULL;
+		guint32 index;
+		guint32 grown_index;
+
+		key = g_strdup_printf("key-%u", i);
+		index = j_placement_get_index(placement, key);
+		grown_index = j_placement_get_index(grown_placement, key);
+
+		if (index != grown_index)
+		{
+			// Keys only move to the new server.
+			g_assert_cmpuint(grown_index, ==, 4);
+			moved++;
+		}
+	}
+
+	// About a fifth of the keys should have moved.
+	g_assert_cmpuint(moved, >, TEST_PLACEMENT_KEYS / 10);
+	g_assert_cmpuint(moved, <, TEST_PLACEMENT_KEYS * 3 / 10);
+}
+
+void
+test_placement(void)
+{
+	g_test_add_func("/placement/modulo", test_placement_modulo);
+	g_test_add_func("/placement/type_from_string", test_placement_type_from_string);
+	g_test_add_data_func("/placement/jump/balance", GINT_TO_POINTER(J_PLACEMENT_JUMP), test_placement_balance);
+	g_test_add_data_func("/placement/jump/grow", GINT_TO_POINTER(J_PLACEMENT_JUMP), test_placement_grow);
+	g_test_add_data_func("/placement/rendezvous/balance", GINT_TO_POINTER(J_PLACEMENT_RENDEZVOUS), test_placement_balance);
+	g_test_add_data_func("/placement/rendezvous/grow", GINT_TO_POINTER(J_PLACEMENT_RENDEZVOUS), test_placement_grow);
+	g_test_add_data_func("/placement/ring/balance", GINT_TO_POINTER(J_PLACEMENT_RING), test_placement_balance);
+	g_test_add_data_func("/placement/ring/grow", GINT_TO_POINTER(J_PLACEMENT_RING), test_placement_grow);
+}
@@ -0,0 +1,129 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2020 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <julea.h>
+
+#include "test.h"
+
+#define TEST_REED_SOLOMON_DATA_BLOCKS 4
+#define TEST_REED_SOLOMON_PARITY_BLOCKS 2
+#define TEST_REED_SOLOMON_BLOCKS (TEST_REED_SOLOMON_DATA_BLOCKS + TEST_REED_SOLOMON_PARITY_BLOCKS)
+
+// Not a multiple of the vector size, to also cover the scalar implementation.
+#define TEST_REED_SOLOMON_LENGTH (64 * 1024 + 7)
+
+static void
+test_reed_solomon_reconstruct(void)
+{
+	g_autoptr(JReedSolomon) rs = NULL;
+	guint8* original[TEST_REED_SOLOMON_BLOCKS];
+	guint8* blocks[TEST_REED_SOLOMON_BLOCKS];
+
+	rs = j_reed_solomon_new(TEST_REED_SOLOMON_DATA_BLOCKS, TEST_REED_SOLOMON_PARITY_BLOCKS);
+
+	for (guint i = 0; i < TEST_REED_SOLOMON_BLOCKS; i++)
+	{
+		original[i] = g_malloc(TEST_REED_SOLOMON_LENGTH);
+		blocks[i] = g_malloc(TEST_REED_SOLOMON_LENGTH);
+	}
+
+	for (guint i = 0; i < TEST_REED_SOLOMON_DATA_BLOCKS; i++)
+	{
+		for (guint j = 0; j < TEST_REED_SOLOMON_LENGTH; j++)
+		{
+			original[i][j] = g_random_int();
+		}
+	}
+
+	j_reed_solomon_encode(rs, (gconstpointer const*)original, (gpointer*)(original + TEST_REED_SOLOMON_DATA_BLOCKS), TEST_REED_SOLOMON_LENGTH);
+
+	// Try all combinations of missing blocks.
+	for (guint missing = 0; missing < (1 << TEST_REED_SOLOMON_BLOCKS); missing++)
+	{
+		gboolean available[TEST_REED_SOLOMON_BLOCKS];
+		guint missing_count = 0;
+		gboolean data_missing = FALSE;
+		gboolean ret;
+
+		for (guint i = 0; i < TEST_REED_SOLOMON_BLOCKS; i++)
+		{
+			available[i] = !(missing & (1 << i));
+
+			if (available[i])
+			{
+				memcpy(blocks[i], original[i], TEST_REED_SOLOMON_LENGTH);
+			}
+			else
+			{
+				memset(blocks[i], 0xff, TEST_REED_SOLOMON_LENGTH);
+				missing_count++;
+				data_missing = data_missing || (i < TEST_REED_SOLOMON_DATA_BLOCKS);
+			}
+		}
+
+		ret = j_reed_solomon_reconstruct(rs, (gpointer*)blocks, available, TEST_REED_SOLOMON_LENGTH);
+
+		if (missing_count > TEST_REED_SOLOMON_PARITY_BLOCKS)
+		{
+			// Too many blocks are missing, unless only parity blocks are missing.
+			g_assert_true(ret == !data_missing);
+			continue;
+		}
+
+		g_assert_true(ret);
+
+		for (guint i = 0; i < TEST_REED_SOLOMON_DATA_BLOCKS; i++)
+		{
+			g_assert_cmpmem(blocks[i], TEST_REED_SOLOMON_LENGTH, original[i], TEST_REED_SOLOMON_LENGTH);
+		}
+	}
+
+	for (guint i = 0; i < TEST_REED_SOLOMON_BLOCKS; i++)
+	{
+		g_free(original[i]);
+		g_free(blocks[i]);
+	}
+}
+
+static void
+test_reed_solomon_no_parity(void)
+{
+	g_autoptr(JReedSolomon) rs = NULL;
+	guint8 block[16];
+	gpointer blocks[1] = { block };
+	gboolean available[1] = { FALSE };
+
+	rs = j_reed_solomon_new(1, 0);
+
+	// Data without parity cannot be reconstructed.
+	g_assert_false(j_reed_solomon_reconstruct(rs, blocks, available, sizeof(block)));
+
+	available[0] = TRUE;
+	g_assert_true(j_reed_solomon_reconstruct(rs, blocks, available, sizeof(block)));
+}
+
+void
+test_reed_solomon(void)
+{
+	g_test_add_func("/reed-solomon/reconstruct", test_reed_solomon_reconstruct);
+	g_test_add_func("/reed-solomon/no_parity", test_reed_solomon_no_parity);
+}
@@ -42,6 +42,8 @@ main(int argc, char** argv)
 	test_list_iterator();
 	test_memory_chunk();
 	test_message();
+	test_placement();
+	test_reed_solomon();
 	test_semantics();
 
 	// Object client
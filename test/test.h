@@ -29,6 +29,8 @@ void test_list(void);
 void test_list_iterator(void);
 void test_memory_chunk(void);
 void test_message(void);
+void test_placement(void);
+void test_reed_solomon(void);
 void test_semantics(void);
 
 void test_object_distributed_object(void);
@@ -43,6 +43,15 @@ static gchar const* opt_db_path = NULL;
 static gint64 opt_max_operation_size = 0;
 static gint opt_max_connections = 0;
 static gint64 opt_stripe_size = 0;
+static gint opt_max_batch_operations = 0;
+static gint64 opt_max_batch_size = 0;
+static gint opt_hedge_percentile = 0;
+static gint opt_hedge_budget = 0;
+static gchar const* opt_placement = NULL;
+static gint opt_placement_virtual_nodes = 0;
+static gboolean opt_local_sockets = TRUE;
+static gchar const* opt_local_socket_directory = NULL;
+static gchar const* opt_fabric_provider = NULL;
 
 static gchar**
 string_split(gchar const* string)
@@ -104,8 +113,31 @@ write_config(gchar* path)
 
 	key_file = g_key_file_new();
 	g_key_file_set_int64(key_file, "core", "max-operation-size", opt_stripe_size);
+
+	if (opt_fabric_provider != NULL)
+	{
+		g_key_file_set_string(key_file, "core", "fabric-provider", opt_fabric_provider);
+	}
+
+	if (opt_local_socket_directory != NULL)
+	{
+		g_key_file_set_string(key_file, "core", "local-socket-directory", opt_local_socket_directory);
+	}
+
 	g_key_file_set_integer(key_file, "clients", "max-connections", opt_max_connections);
 	g_key_file_set_int64(key_file, "clients", "stripe-size", opt_stripe_size);
+	g_key_file_set_integer(key_file, "clients", "max-batch-operations", opt_max_batch_operations);
+	g_key_file_set_int64(key_file, "clients", "max-batch-size", opt_max_batch_size);
+	g_key_file_set_integer(key_file, "clients", "hedge-percentile", opt_hedge_percentile);
+	g_key_file_set_integer(key_file, "clients", "hedge-budget", opt_hedge_budget);
+
+	if (opt_placement != NULL)
+	{
+		g_key_file_set_string(key_file, "clients", "placement", opt_placement);
+	}
+
+	g_key_file_set_integer(key_file, "clients", "placement-virtual-nodes", opt_placement_virtual_nodes);
+	g_key_file_set_boolean(key_file, "clients", "local-sockets", opt_local_sockets);
 	g_key_file_set_string_list(key_file, "servers", "object", (gchar const* const*)servers_object, g_strv_length(servers_object));
 	g_key_file_set_string_list(key_file, "servers", "kv", (gchar const* const*)servers_kv, g_strv_length(servers_kv));
 	g_key_file_set_string_list(key_file, "servers", "db", (gchar const* const*)servers_db, g_strv_length(servers_db));
@@ -166,6 +198,15 @@ main(gint argc, gchar** argv)
 		{ "max-operation-size", 0, 0, G_OPTION_ARG_INT64, &opt_max_operation_size, "Maximum size of an operation", "0" },
 		{ "max-connections", 0, 0, G_OPTION_ARG_INT, &opt_max_connections, "Maximum number of connections", "0" },
 		{ "stripe-size", 0, 0, G_OPTION_ARG_INT64, &opt_stripe_size, "Default stripe size", "0" },
+		{ "max-batch-operations", 0, 0, G_OPTION_ARG_INT, &opt_max_batch_operations, "Maximum number of operations per batch message", "0" },
+		{ "max-batch-size", 0, 0, G_OPTION_ARG_INT64, &opt_max_batch_size, "Maximum size of a batch message", "0" },
+		{ "hedge-percentile", 0, 0, G_OPTION_ARG_INT, &opt_hedge_percentile, "Latency percentile after which redundant object reads are hedged", "0" },
+		{ "hedge-budget", 0, 0, G_OPTION_ARG_INT, &opt_hedge_budget, "Percentage of object reads that may be hedged", "0" },
+		{ "placement", 0, 0, G_OPTION_ARG_STRING, &opt_placement, "Placement used to map keys to servers", "modulo|jump|rendezvous|ring" },
+		{ "placement-virtual-nodes", 0, 0, G_OPTION_ARG_INT, &opt_placement_virtual_nodes, "Number of virtual nodes per server for the ring placement", "0" },
+		{ "fabric-provider", 0, 0, G_OPTION_ARG_STRING, &opt_fabric_provider, "libfabric provider to use for bulk data transfers", "sockets|verbs|…" },
+		{ "no-local-sockets", 0, G_OPTION_FLAG_REVERSE, G_OPTION_ARG_NONE, &opt_local_sockets, "Always use TCP to connect to servers on the local host", NULL },
+		{ "local-socket-directory", 0, 0, G_OPTION_ARG_STRING, &opt_local_socket_directory, "Directory containing the servers' local sockets (default: /tmp)", "/path/to/directory" },
 		{ NULL, 0, 0, 0, NULL, NULL, NULL }
 	};
 
@@ -189,7 +230,12 @@ main(gint argc, gchar** argv)
 	    || (!opt_read && (opt_servers_object == NULL || opt_servers_kv == NULL || opt_servers_db == NULL || opt_object_backend == NULL || opt_object_component == NULL || opt_object_path == NULL || opt_kv_backend == NULL || opt_kv_component == NULL || opt_kv_path == NULL || opt_db_backend == NULL || opt_db_component == NULL || opt_db_path == NULL))
 	    || opt_max_operation_size < 0
 	    || opt_max_connections < 0
-	    || opt_stripe_size < 0)
+	    || opt_stripe_size < 0
+	    || opt_max_batch_operations < 0
+	    || opt_max_batch_size < 0
+	    || opt_hedge_percentile < 0 || opt_hedge_percentile > 100
+	    || opt_hedge_budget < 0 || opt_hedge_budget > 100
+	    || opt_placement_virtual_nodes < 0)
 	{
 		g_autofree gchar* help = NULL;
 